@@ -3,6 +3,7 @@
 #include <Engine/Includes/Version.h>
 #include <Engine/InputManager.h>
 #include <Engine/Audio/AudioManager.h>
+#include <Engine/Audio/AudioPlayback.h>
 #include <Engine/Scene.h>
 #include <Engine/Math/Math.h>
 #include <Engine/TextFormats/INI/INI.h>
@@ -52,19 +53,33 @@ public:
 #include <Engine/Graphics.h>
 
 #include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/Bytecode.h>
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/ScriptJobs.h>
 #include <Engine/Bytecode/SourceFileMap.h>
+#include <Engine/Diagnostics/Benchmark.h>
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Diagnostics/MemoryPools.h>
+#include <Engine/Diagnostics/RemoteDebug.h>
+#include <Engine/Diagnostics/Tracer.h>
 #include <Engine/Filesystem/Directory.h>
+#include <Engine/Network/WebSocketClient.h>
+#include <Engine/Rendering/PolygonRenderer.h>
+#include <Engine/Rendering/PoseCache.h>
+#include <Engine/Rendering/Software/HierarchicalDepth.h>
+#include <Engine/ResourceTypes/AsyncLoader.h>
+#include <Engine/ResourceTypes/DecodedImageCache.h>
+#include <Engine/ResourceTypes/ResourceCache.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/SpriteSheetPreloader.h>
 #include <Engine/Scene/SceneInfo.h>
 #include <Engine/TextFormats/XML/XMLParser.h>
 #include <Engine/TextFormats/XML/XMLNode.h>
 #include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
 
 #include <Engine/Media/MediaSource.h>
 #include <Engine/Media/MediaPlayer.h>
@@ -182,6 +197,7 @@ PUBLIC STATIC void Application::Init(int argc, char* args[]) {
 #endif
 
     MemoryPools::Init();
+    Tracer::Init();
 
     SDL_SetHint(SDL_HINT_WINDOWS_DISABLE_THREAD_NAMING, "1");
     SDL_SetHint(SDL_HINT_ACCELEROMETER_AS_JOYSTICK, "0");
@@ -212,6 +228,7 @@ PUBLIC STATIC void Application::Init(int argc, char* args[]) {
     Graphics::ChooseBackend();
 
     Application::Settings->GetBool("dev", "writeToFile", &Log::WriteToFile);
+    Application::Settings->GetInteger("dev", "logFileSizeLimit", &Log::MaxFileSize);
 
     bool allowRetina = false;
     Application::Settings->GetBool("display", "retina", &allowRetina);
@@ -252,6 +269,7 @@ PUBLIC STATIC void Application::Init(int argc, char* args[]) {
     AudioManager::Init();
     InputManager::Init();
     Clock::Init();
+    WorkerPool::Init();
 
     Application::LoadGameConfig();
     Application::LoadGameInfo();
@@ -332,6 +350,11 @@ double  MetricRenderTime = -1;
 double  MetricFPSCounterTime = -1;
 double  MetricPresentTime = -1;
 double  MetricFrameTime = 0.0;
+
+// Resource cache counters at the last snapshot
+Uint64  SnapshotCacheHits = 0;
+Uint64  SnapshotCacheMisses = 0;
+Uint64  SnapshotCacheEvictions = 0;
 vector<ObjectList*> ListList;
 PUBLIC STATIC void Application::GetPerformanceSnapshot() {
     if (Scene::ObjectLists) {
@@ -450,6 +473,92 @@ PUBLIC STATIC void Application::GetPerformanceSnapshot() {
 
         Log::Print(Log::LOG_IMPORTANT, "Garbage Size:");
         Log::Print(Log::LOG_INFO, "%u", (Uint32)GarbageCollector::GarbageSize);
+
+        // Software 3D Occlusion Snapshot (counted since the last snapshot)
+        if (HierarchicalDepth::Enabled && HierarchicalDepth::TestedFaces > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Software 3D Occlusion Snapshot:");
+            Log::Print(Log::LOG_INFO, "Faces Tested:    %llu", (unsigned long long)HierarchicalDepth::TestedFaces);
+            Log::Print(Log::LOG_INFO, "Faces Rejected:  %llu (%.1f%%)", (unsigned long long)HierarchicalDepth::RejectedFaces,
+                HierarchicalDepth::RejectedFaces * 100.0 / HierarchicalDepth::TestedFaces);
+            Log::Print(Log::LOG_INFO, "Blocks Rejected: %llu", (unsigned long long)HierarchicalDepth::RejectedBlocks);
+            Log::Print(Log::LOG_INFO, "Pixels Rejected: %llu", (unsigned long long)HierarchicalDepth::RejectedPixels);
+            HierarchicalDepth::ResetStats();
+        }
+
+        // Pose Cache Snapshot (counted since the last snapshot)
+        Uint64 poseLookups = PoseCache::Hits + PoseCache::Misses;
+        if (PoseCache::Enabled && poseLookups > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Pose Cache Snapshot:");
+            Log::Print(Log::LOG_INFO, "Hits:      %llu (%.1f%%)", (unsigned long long)PoseCache::Hits,
+                PoseCache::Hits * 100.0 / poseLookups);
+            Log::Print(Log::LOG_INFO, "Misses:    %llu", (unsigned long long)PoseCache::Misses);
+            Log::Print(Log::LOG_INFO, "Evictions: %llu", (unsigned long long)PoseCache::Evictions);
+            PoseCache::ResetStats();
+        }
+
+        // Resource Cache Snapshot (hits counted since the last snapshot)
+        if (ResourceCache::Budget > 0) {
+            // Scripts read the totals, so they're left alone
+            Uint64 cacheHits = ResourceCache::Hits - SnapshotCacheHits;
+            Uint64 cacheMisses = ResourceCache::Misses - SnapshotCacheMisses;
+            Uint64 cacheEvictions = ResourceCache::Evictions - SnapshotCacheEvictions;
+            Uint64 cacheLookups = cacheHits + cacheMisses;
+            Log::Print(Log::LOG_IMPORTANT, "Resource Cache Snapshot:");
+            Log::Print(Log::LOG_INFO, "Hits:      %llu (%.1f%%)", (unsigned long long)cacheHits,
+                cacheLookups ? cacheHits * 100.0 / cacheLookups : 0.0);
+            Log::Print(Log::LOG_INFO, "Misses:    %llu", (unsigned long long)cacheMisses);
+            Log::Print(Log::LOG_INFO, "Evictions: %llu", (unsigned long long)cacheEvictions);
+            Log::Print(Log::LOG_INFO, "Size:      %.1f / %.1f MB (%u resources)",
+                ResourceCache::GetSize() / 1048576.0, ResourceCache::Budget / 1048576.0, ResourceCache::GetCount());
+
+            const char* typeNames[] = { "Sprites", "Images", "Sounds", "Models" };
+            for (int i = 0; i < ResourceCache::CACHE_TYPE_COUNT; i++) {
+                Log::Print(Log::LOG_INFO, "  %-8s %.1f MB (%u)", typeNames[i],
+                    ResourceCache::GetSize(i) / 1048576.0, ResourceCache::GetCount(i));
+            }
+            SnapshotCacheHits = ResourceCache::Hits;
+            SnapshotCacheMisses = ResourceCache::Misses;
+            SnapshotCacheEvictions = ResourceCache::Evictions;
+        }
+
+        // Decoded Image Cache Snapshot (counted since the last snapshot)
+        int imageCacheHits = SDL_AtomicGet(&DecodedImageCache::Hits);
+        int imageCacheLookups = imageCacheHits + SDL_AtomicGet(&DecodedImageCache::Misses);
+        if (DecodedImageCache::Enabled && imageCacheLookups > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Decoded Image Cache Snapshot:");
+            Log::Print(Log::LOG_INFO, "Hits:      %d (%.1f%%)", imageCacheHits, imageCacheHits * 100.0 / imageCacheLookups);
+            Log::Print(Log::LOG_INFO, "Misses:    %d", imageCacheLookups - imageCacheHits);
+            DecodedImageCache::ResetStats();
+        }
+
+        // Script Bytecode Snapshot (totals since the game started)
+        if (Bytecode::LoadedFunctionCount > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Script Bytecode Snapshot:");
+            Log::Print(Log::LOG_INFO, "Read:      %.1f KB in %.3f ms", Bytecode::LoadedFileSize / 1024.0, Bytecode::LoadTime);
+            Log::Print(Log::LOG_INFO, "Resident:  %.1f KB (%.1f%% of read)", Bytecode::LoadedImageSize / 1024.0,
+                Bytecode::LoadedFileSize ? Bytecode::LoadedImageSize * 100.0 / Bytecode::LoadedFileSize : 0.0);
+            Log::Print(Log::LOG_INFO, "Functions: %u of %u called", Bytecode::DecodedFunctionCount, Bytecode::LoadedFunctionCount);
+        }
+
+        // Audio Snapshot (counted since the last snapshot)
+        int underruns = SDL_AtomicGet(&AudioPlayback::Underruns);
+        int peakVoices = SDL_AtomicGet(&AudioManager::PeakVoices);
+        if (underruns > 0 || peakVoices > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Audio Snapshot:");
+            Log::Print(Log::LOG_INFO, "Active voices:       %d (peak %d, limit %d)", AudioManager::ActiveVoices, peakVoices, AudioManager::MaxVoices);
+            Log::Print(Log::LOG_INFO, "Inaudible voices:    %d", AudioManager::InaudibleVoices);
+            Log::Print(Log::LOG_INFO, "Stolen voices:       %d", AudioManager::StolenVoices);
+            Log::Print(Log::LOG_INFO, "Streaming underruns: %d", underruns);
+            SDL_AtomicSet(&AudioPlayback::Underruns, 0);
+            AudioManager::ResetVoiceStats();
+        }
+
+        // Log Snapshot (total since the game started)
+        int droppedLogMessages = Log::GetDroppedCount();
+        if (droppedLogMessages > 0) {
+            Log::Print(Log::LOG_IMPORTANT, "Log Snapshot:");
+            Log::Print(Log::LOG_INFO, "Dropped messages: %d", droppedLogMessages);
+        }
     }
 }
 
@@ -522,6 +631,7 @@ PRIVATE STATIC void Application::Restart() {
     ScriptEntity::DisableAutoAnimate = false;
 
     Graphics::Reset();
+    ResourceManager::RefreshDataFolderIndex();
 
     Application::LoadGameConfig();
     Application::LoadGameInfo();
@@ -620,6 +730,7 @@ PRIVATE STATIC void Application::LoadKeyBinds() {
     GET_KEY("devShowTileCol",        DevTileCol,       Key_F7);
     GET_KEY("devShowObjectRegions",  DevObjectRegions, Key_F8);
     GET_KEY("devQuit",               DevQuit,          Key_ESCAPE);
+    GET_KEY("devTrace",              DevTrace,         Key_F11);
 
 #undef GET_KEY
 }
@@ -629,6 +740,14 @@ PRIVATE STATIC void Application::LoadDevSettings() {
     Application::Settings->GetBool("dev", "viewPerformance", &ShowFPS);
     Application::Settings->GetBool("dev", "donothing", &DoNothing);
     Application::Settings->GetInteger("dev", "fastforward", &UpdatesPerFastForward);
+
+    Application::Settings->GetBool("dev", "remoteDebug", &RemoteDebug::UsingRemoteDebug);
+    Application::Settings->GetInteger("dev", "remoteDebugPort", &RemoteDebug::Port);
+    if (RemoteDebug::UsingRemoteDebug)
+        RemoteDebug::Init();
+
+    Application::Settings->GetInteger("dev", "traceFrames", &Tracer::FrameCount);
+    Application::Settings->GetInteger("dev", "traceBufferEvents", &Tracer::BufferSize);
 }
 
 PUBLIC STATIC bool Application::IsWindowResizeable() {
@@ -738,6 +857,11 @@ PRIVATE STATIC void Application::PollEvents() {
                         TakeSnapshot = true;
                         break;
                     }
+                    // Record a trace of the next few frames (dev)
+                    else if (key == KeyBindsSDL[(int)KeyBind::DevTrace]) {
+                        Tracer::Start();
+                        break;
+                    }
                     // Recompile and restart scene (dev)
                     else if (key == KeyBindsSDL[(int)KeyBind::DevRecompile]) {
                         Application::Restart();
@@ -829,12 +953,15 @@ PRIVATE STATIC void Application::PollEvents() {
     }
 }
 PRIVATE STATIC void Application::RunFrame(void* p) {
+    Tracer::BeginFrame();
+
     FrameTimeStart = Clock::GetTicks();
 
     // Event loop
     MetricEventTime = Clock::GetTicks();
     Application::PollEvents();
     MetricEventTime = Clock::GetTicks() - MetricEventTime;
+    TRACE_ELAPSED("frame", "Event Polling", MetricEventTime);
 
     // BUG: Having Stepper on prevents the first
     //   frame of a new scene from Updating, but still rendering.
@@ -842,8 +969,12 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
         Step = true;
 
     MetricAfterSceneTime = Clock::GetTicks();
+    ResourceManager::Update();
     Scene::AfterScene();
+    AsyncLoader::Update();
+    WebSocketClient::DeleteClosed(false);
     MetricAfterSceneTime = Clock::GetTicks() - MetricAfterSceneTime;
+    TRACE_ELAPSED("frame", "After Scene", MetricAfterSceneTime);
 
     if (DoNothing) goto DO_NOTHING;
 
@@ -857,11 +988,13 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
             MetricPollTime = Clock::GetTicks();
             InputManager::Poll();
             MetricPollTime = Clock::GetTicks() - MetricPollTime;
+            TRACE_ELAPSED("frame", "Input Polling", MetricPollTime);
 
             // Update scene
             MetricUpdateTime = Clock::GetTicks();
             Scene::Update();
             MetricUpdateTime = Clock::GetTicks() - MetricUpdateTime;
+            TRACE_ELAPSED("frame", "Entity Update", MetricUpdateTime);
         }
         Step = false;
         if (UpdatesPerFrame != 1 && (*Scene::NextScene || Scene::DoRestart))
@@ -872,10 +1005,12 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
     MetricClearTime = Clock::GetTicks();
     Graphics::Clear();
     MetricClearTime = Clock::GetTicks() - MetricClearTime;
+    TRACE_ELAPSED("frame", "Clear", MetricClearTime);
 
     MetricRenderTime = Clock::GetTicks();
     Scene::Render();
     MetricRenderTime = Clock::GetTicks() - MetricRenderTime;
+    TRACE_ELAPSED("frame", "World Render Commands", MetricRenderTime);
 
     DO_NOTHING:
 
@@ -1087,12 +1222,30 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
         Graphics::Restore();
     }
     MetricFPSCounterTime = Clock::GetTicks() - MetricFPSCounterTime;
+    TRACE_ELAPSED("frame", "FPS Counter", MetricFPSCounterTime);
 
     MetricPresentTime = Clock::GetTicks();
     Graphics::Present();
     MetricPresentTime = Clock::GetTicks() - MetricPresentTime;
+    TRACE_ELAPSED("frame", "Frame Present", MetricPresentTime);
 
     MetricFrameTime = Clock::GetTicks() - FrameTimeStart;
+    TRACE_ELAPSED("frame", "Frame", MetricFrameTime);
+
+    if (RemoteDebug::UsingRemoteDebug) {
+        Perf_Application perf = {
+            MetricEventTime,
+            MetricAfterSceneTime,
+            MetricPollTime,
+            MetricUpdateTime,
+            MetricClearTime,
+            MetricRenderTime,
+            MetricFPSCounterTime,
+            MetricPresentTime,
+            MetricFrameTime,
+        };
+        RemoteDebug::Update(&perf, FPS);
+    }
 }
 PRIVATE STATIC void Application::DelayFrame() {
     // HACK: MacOS V-Sync timing gets disabled if window is not visible
@@ -1122,10 +1275,21 @@ PRIVATE STATIC void Application::DelayFrame() {
     }
 }
 PUBLIC STATIC void Application::Run(int argc, char* args[]) {
+    argc = Tracer::ParseArguments(argc, args);
+
     Application::Init(argc, args);
     if (!Running)
         return;
 
+    if (argc > 2 && !strcmp(args[1], "--benchmark")) {
+        bool passed = Benchmark::Run(args[2]);
+        Application::Cleanup();
+        // So that scripts running benchmarks can tell when a check failed
+        if (!passed)
+            exit(EXIT_FAILURE);
+        return;
+    }
+
     Scene::Init();
 
     if (argc > 1) {
@@ -1206,14 +1370,22 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
 }
 
 PUBLIC STATIC void Application::Cleanup() {
+    AsyncLoader::Dispose();
+    SpriteSheetPreloader::Dispose();
     ResourceManager::Dispose();
     AudioManager::Dispose();
     InputManager::Dispose();
+    WebSocketClient::DeleteClosed(true);
+    WorkerPool::Dispose();
+    RemoteDebug::Dispose();
+    Tracer::Dispose();
 
     Graphics::Dispose();
 
     SDL_DestroyWindow(Application::Window);
 
+    Log::Dispose();
+
     SDL_Quit();
 
 #ifdef MSYS
@@ -1481,9 +1653,41 @@ PUBLIC STATIC void Application::InitSettings(const char* filename) {
     AutomaticPerformanceSnapshotFrameTimeThreshold = apsFrameTimeThreshold;
     AutomaticPerformanceSnapshotMinInterval = apsMinInterval;
 
+    Application::Settings->GetInteger("audio", "decodeAhead", &AudioPlayback::DecodeAheadTime);
+    Application::Settings->GetInteger("audio", "preDecodeLimit", &ISound::PreDecodeLimit);
+    Application::Settings->GetInteger("audio", "maxVoices", &AudioManager::MaxVoices);
+    char resampler[16];
+    if (Application::Settings->GetString("audio", "resampler", resampler, sizeof resampler)) {
+        if (!strcmp(resampler, "nearest"))
+            AudioManager::Resampler = AudioManager::RESAMPLE_NEAREST;
+        else if (!strcmp(resampler, "cubic"))
+            AudioManager::Resampler = AudioManager::RESAMPLE_CUBIC;
+        else
+            AudioManager::Resampler = AudioManager::RESAMPLE_LINEAR;
+    }
+
     Application::Settings->GetBool("display", "vsync", &Graphics::VsyncEnabled);
     Application::Settings->GetInteger("display", "multisample", &Graphics::MultisamplingEnabled);
     Application::Settings->GetInteger("display", "defaultMonitor", &Application::DefaultMonitor);
+    Application::Settings->GetInteger("display", "faceSortBuckets", &PolygonRenderer::FaceSortBuckets);
+    Application::Settings->GetBool("display", "poseCache", &PoseCache::Enabled);
+    Application::Settings->GetInteger("display", "poseCacheSize", &PoseCache::Capacity);
+    Application::Settings->GetInteger("display", "poseCacheSteps", &PoseCache::InbetweenSteps);
+    Application::Settings->GetInteger("dev", "workerThreads", &WorkerPool::ThreadCount);
+    Application::Settings->GetInteger("dev", "scriptJobWorkers", &ScriptJobs::MaxWorkers);
+    Application::Settings->GetDecimal("dev", "asyncUploadBudget", &AsyncLoader::UploadBudget);
+
+    int resourceCacheSize = 0;
+    if (Application::Settings->GetInteger("dev", "resourceCacheSize", &resourceCacheSize) && resourceCacheSize > 0)
+        ResourceCache::Budget = (size_t)resourceCacheSize * 1024 * 1024;
+
+    Application::Settings->GetBool("dev", "decodedImageCache", &DecodedImageCache::Enabled);
+    Application::Settings->GetString("dev", "decodedImageCachePath", DecodedImageCache::Path, sizeof(DecodedImageCache::Path));
+    DecodedImageCache::Init();
+
+    Application::Settings->GetBool("dev", "preloadSpriteSheets", &SpriteSheetPreloader::Enabled);
+    Application::Settings->GetString("dev", "spriteSheetManifest", SpriteSheetPreloader::ManifestPath, sizeof(SpriteSheetPreloader::ManifestPath));
+    SpriteSheetPreloader::Init();
 }
 PUBLIC STATIC void Application::SaveSettings() {
     if (Application::Settings)
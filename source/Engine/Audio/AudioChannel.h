@@ -20,6 +20,9 @@ struct AudioChannel {
     float          Pan = 0.0f;
     float          Volume = 0.0f;
     void*          Origin = nullptr;
+    // For picking which channel to take over when they're all in use
+    int            Priority = 0;
+    Uint32         StartOrder = 0;
 
     ~AudioChannel() {
         delete Playback;
@@ -2,6 +2,8 @@
 #define ENGINE_AUDIO_AUDIOINCLUDES_H
 
 #define AUDIO_FIRST_LOAD_SAMPLE_BOOST 4
+// Silent frames after the end of a sound, for interpolating its last frames
+#define AUDIO_MIX_SOURCE_PADDING 4
 
 enum {
     MusicFade_None,
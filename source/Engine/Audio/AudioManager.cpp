@@ -12,18 +12,32 @@ public:
     static bool                 AudioEnabled;
 
     static Uint8                BytesPerSample;
-    static Uint8*               MixBuffer;
-    static size_t               MixBufferSize;
+    static float*               MixBus;
+    static float*               MixScratch;
+    static size_t               MixBusFrames;
 
     static deque<AudioChannel*> MusicStack;
     static AudioChannel*        SoundArray;
     static int                  SoundArrayLength;
 
+    // Sound effect channels mixed at once before new ones replace old ones
+    static int                  MaxVoices;
+    // Sound effects quieter than this aren't mixed, only kept in time
+    static float                InaudibleVolume;
+
+    // Channels mixed and skipped by the last audio callback
+    static int                  ActiveVoices;
+    static int                  InaudibleVoices;
+    // Counted since the last call to ResetVoiceStats
+    static SDL_atomic_t         PeakVoices;
+    static int                  StolenVoices;
+
     static float                MasterVolume;
     static float                MusicVolume;
     static float                SoundVolume;
 
     static float                LowPassFilter;
+    static int                  Resampler;
 
     static Uint8*               AudioQueue;
     static size_t               AudioQueueSize;
@@ -34,6 +48,13 @@ public:
         REQUEST_ERROR = -1,
         REQUEST_CONVERTING = -2,
     };
+
+    // How sounds playing at other speeds are resampled
+    enum {
+        RESAMPLE_NEAREST,
+        RESAMPLE_LINEAR,
+        RESAMPLE_CUBIC,
+    };
 };
 #endif
 
@@ -42,29 +63,49 @@ public:
 #include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Tracer.h>
+#include <Engine/Includes/SIMD.h>
 
 SDL_AudioDeviceID    AudioManager::Device;
 SDL_AudioSpec        AudioManager::DeviceFormat;
 bool                 AudioManager::AudioEnabled = false;
 
 Uint8                AudioManager::BytesPerSample;
-Uint8*               AudioManager::MixBuffer;
-size_t               AudioManager::MixBufferSize;
+float*               AudioManager::MixBus = NULL;
+float*               AudioManager::MixScratch = NULL;
+size_t               AudioManager::MixBusFrames = 0;
 
 deque<AudioChannel*> AudioManager::MusicStack;
 AudioChannel*        AudioManager::SoundArray = NULL;
 int                  AudioManager::SoundArrayLength = 512;
 
+int                  AudioManager::MaxVoices = 64;
+float                AudioManager::InaudibleVolume = 1.0f / 1024.0f;
+
+int                  AudioManager::ActiveVoices = 0;
+int                  AudioManager::InaudibleVoices = 0;
+SDL_atomic_t         AudioManager::PeakVoices;
+int                  AudioManager::StolenVoices = 0;
+
 float                AudioManager::MasterVolume = 1.0f;
 float                AudioManager::MusicVolume = 1.0f;
 float                AudioManager::SoundVolume = 1.0f;
 
 float                AudioManager::LowPassFilter = 0.0f;
+int                  AudioManager::Resampler = AudioManager::RESAMPLE_LINEAR;
 
 Uint8*               AudioManager::AudioQueue = NULL;
 size_t               AudioManager::AudioQueueSize = 0;
 size_t               AudioManager::AudioQueueMaxSize = 0;
 
+// Orders sound effects by when they started, for voice stealing
+static Uint32 PlayCount = 0;
+// Voices counted by the audio callback in progress
+static int    MixedVoiceCount = 0;
+static int    InaudibleVoiceCount = 0;
+// Held while a sound is decoded for SetSound, outside the audio lock
+static SDL_mutex* DecodeLock = NULL;
+
 enum {
     FILTER_TYPE_LOW_PASS,
     FILTER_TYPE_HIGH_PASS,
@@ -80,8 +121,6 @@ double mNormalizedFreq = 1.0 / 64.0; // Good for low pass
 int    mFilterType = FILTER_TYPE_LOW_PASS;
 // double mNormalizedFreq = 1.0 / 8.0;
 // int    mFilterType = FILTER_TYPE_HIGH_PASS;
-Sint16 mZx[2 * 2]; // 2 per channel
-Sint16 mZy[2 * 2]; // 2 per channel
 float  mZxF[2 * 2]; // 2 per channel
 float  mZyF[2 * 2]; // 2 per channel
 
@@ -91,11 +130,6 @@ PUBLIC STATIC void   AudioManager::CalculateCoeffs() {
     double beta = 0.5 * ( (1.0 - d) / (1.0 + d) );
     double gamma = (0.5 + beta) * cos(theta);
 
-    mZx[0] = 0;
-    mZx[1] = 0;
-    mZy[0] = 0;
-    mZy[1] = 0;
-
     mZxF[0] = 0;
     mZxF[1] = 0;
     mZyF[0] = 0;
@@ -114,47 +148,11 @@ PUBLIC STATIC void   AudioManager::CalculateCoeffs() {
     b1 = -2.0 * gamma;
     b2 = 2.0 * beta;
 }
-PUBLIC STATIC Sint16 AudioManager::ProcessSample(Sint16 inSample, int channel) {
-    Sint16 outSample;
-    int idx0 = 2 * channel;
-    int idx1 = idx0 + 1;
-
-    outSample = (Sint16)(
-        (a0 * inSample)  + (a1 * mZx[idx0]) +
-        (a2 * mZx[idx1]) - (b1 * mZy[idx0]) - (b2 * mZy[idx1]));
-
-    // if (outSample > 0x3FFF)
-    //     outSample = 0x3FFF;
-    // if (outSample < -0x3FFF)
-    //     outSample = -0x3FFF;
-
-    mZx[idx1] = mZx[idx0];
-    mZx[idx0] = inSample;
-    mZy[idx1] = mZy[idx0];
-    mZy[idx0] = outSample;
-
-    return (Sint16)(inSample * (1.0 - AudioManager::LowPassFilter) + outSample * mGain * AudioManager::LowPassFilter);
-}
-PUBLIC STATIC float  AudioManager::ProcessSampleFloat(float inSample, int channel) {
-    float outSample;
-    int idx0 = 2 * channel;
-    int idx1 = idx0 + 1;
-
-    outSample = (float)(
-        (a0 * inSample)  + (a1 * mZxF[idx0]) +
-        (a2 * mZxF[idx1]) - (b1 * mZyF[idx0]) - (b2 * mZyF[idx1]));
-
-    mZxF[idx1] = mZxF[idx0];
-    mZxF[idx0] = inSample;
-    mZyF[idx1] = mZyF[idx0];
-    mZyF[idx0] = outSample;
-
-    return (float)(inSample * (1.0 - AudioManager::LowPassFilter) + outSample * mGain * AudioManager::LowPassFilter);
-}
-
 PUBLIC STATIC void   AudioManager::Init() {
     CalculateCoeffs();
 
+    DecodeLock = SDL_CreateMutex();
+
     SoundArray = (AudioChannel*)Memory::Calloc(SoundArrayLength, sizeof(AudioChannel));
     for (int i = 0; i < SoundArrayLength; i++)
         SoundArray[i].Paused = true;
@@ -204,10 +202,11 @@ PUBLIC STATIC void   AudioManager::Init() {
 
     BytesPerSample = ((DeviceFormat.format & 0xFF) >> 3) * DeviceFormat.channels;
 
-    if (DeviceFormat.channels == 2) {
-        MixBufferSize = DeviceFormat.samples;
-        MixBuffer = (Uint8*)Memory::Malloc(MixBufferSize * BytesPerSample);
-    }
+    // Every channel is mixed in floats, and converted to the device's
+    // format once at the end
+    MixBusFrames = DeviceFormat.samples;
+    MixBus = (float*)Memory::Calloc(MixBusFrames * DeviceFormat.channels, sizeof(float));
+    MixScratch = (float*)Memory::Calloc(MixBusFrames * DeviceFormat.channels, sizeof(float));
 
     // AudioQueueMaxSize = DeviceFormat.samples * DeviceFormat.channels * (SDL_AUDIO_BITSIZE(DeviceFormat.format) >> 3);
     AudioQueueMaxSize = 0x1000;
@@ -230,29 +229,46 @@ PUBLIC STATIC void   AudioManager::ClampParams(float& pan, float& speed, float&
         volume = 0.0f;
 }
 
-PRIVATE STATIC void   AudioManager::UpdateChannelPlayer(AudioPlayback* playback, ISound* sound) {
-    if (!playback->SoundData) {
-        playback->SoundData = new SoundFormat;
-        playback->OwnsSoundData = true;
-    }
+// Points the playback at the sound's decoded samples. They're decoded once,
+// and shared by every channel playing the sound.
+// Decodes a sound before it's played as a sound effect, without holding the
+// audio lock, so that a long one doesn't hold up the callback. A sound that's
+// also playing as music is read by the callback, so SetSound decodes that one
+// with the lock held instead.
+PRIVATE STATIC void   AudioManager::DecodeSound(ISound* sound) {
+    if (sound->Decoded)
+        return;
 
-    SoundFormat* srcSndData = sound->SoundData;
-    if (srcSndData)
-        srcSndData->CopySamples(playback->SoundData);
-    else {
-        playback->SoundData->Samples.clear();
-        playback->SoundData->Samples.shrink_to_fit();
-    }
+    AudioManager::Lock();
+    bool playingAsMusic = AudioManager::IsPlayingMusic(sound);
+    AudioManager::Unlock();
+    if (playingAsMusic)
+        return;
 
-    playback->SoundData->SampleIndex = 0;
+    SDL_LockMutex(DecodeLock);
+    size_t count;
+    sound->GetDecodedSamples(&count);
+    SDL_UnlockMutex(DecodeLock);
+}
+PRIVATE STATIC void   AudioManager::UpdateChannelPlayer(AudioPlayback* playback, ISound* sound) {
+    size_t count;
+    SDL_LockMutex(DecodeLock);
+    Uint8* samples = sound->GetDecodedSamples(&count);
+    SDL_UnlockMutex(DecodeLock);
+    playback->SetSharedSamples(sound->SoundData, samples, count);
 }
 
 PUBLIC STATIC void   AudioManager::SetSound(int channel, ISound* music) {
     AudioManager::SetSound(channel, music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
 }
 PUBLIC STATIC void   AudioManager::SetSound(int channel, ISound* sound, bool loop, int loopPoint, float pan, float speed, float volume, void* origin) {
+    AudioManager::DecodeSound(sound);
+
     AudioManager::Lock();
 
+    // Sharing the samples decodes the whole sound
+    AudioManager::StopMusicDecoders(sound);
+
     AudioChannel* audio = &SoundArray[channel];
     AudioPlayback* playback = audio->Playback;
 
@@ -268,6 +284,8 @@ PUBLIC STATIC void   AudioManager::SetSound(int channel, ISound* sound, bool loo
     audio->Pan = pan;
     audio->Speed = (Uint32)(speed * 0x10000);
     audio->Volume = volume;
+    audio->Priority = sound->Priority;
+    audio->StartOrder = ++PlayCount;
 
     int requiredSamples = AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST;
     if (playback == nullptr) {
@@ -290,14 +308,58 @@ PUBLIC STATIC int    AudioManager::PlaySound(ISound* music) {
     return AudioManager::PlaySound(music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
 }
 PUBLIC STATIC int    AudioManager::PlaySound(ISound* music, bool loop, int loopPoint, float pan, float speed, float volume, void* origin) {
+    int channel = AudioManager::FindVoice(music);
+    if (channel >= 0)
+        AudioManager::SetSound(channel, music, loop, loopPoint, pan, speed, volume, origin);
+
+    return channel;
+}
+// Picks the channel a sound effect plays on. A sound at its instance limit
+// replaces its own oldest channel. With MaxVoices channels playing, it
+// replaces the oldest one with the lowest priority, as long as that isn't
+// higher than its own. Returns -1 if nothing can be replaced.
+PRIVATE STATIC int    AudioManager::FindVoice(ISound* sound) {
+    int freeChannel = -1;
+    int voices = 0;
+    int instances = 0;
+    int oldestInstance = -1;
+    int victim = -1;
+
     for (int i = 0; i < SoundArrayLength; i++) {
         AudioChannel* audio = &SoundArray[i];
         if (!audio->Audio || audio->Stopped) {
-            AudioManager::SetSound(i, music, loop, loopPoint, pan, speed, volume, origin);
-            return i;
+            if (freeChannel < 0)
+                freeChannel = i;
+            continue;
+        }
+
+        if (audio->Audio == sound) {
+            instances++;
+            if (oldestInstance < 0 || (Sint32)(audio->StartOrder - SoundArray[oldestInstance].StartOrder) < 0)
+                oldestInstance = i;
         }
+
+        // Paused channels aren't mixed, so they don't use up a voice
+        if (audio->Paused)
+            continue;
+
+        voices++;
+        if (victim < 0
+            || audio->Priority < SoundArray[victim].Priority
+            || (audio->Priority == SoundArray[victim].Priority && (Sint32)(audio->StartOrder - SoundArray[victim].StartOrder) < 0))
+            victim = i;
     }
 
+    if (sound->MaxInstances > 0 && instances >= sound->MaxInstances) {
+        StolenVoices++;
+        return oldestInstance;
+    }
+    if (freeChannel >= 0 && (MaxVoices <= 0 || voices < MaxVoices))
+        return freeChannel;
+    if (victim >= 0 && SoundArray[victim].Priority <= sound->Priority) {
+        StolenVoices++;
+        return victim;
+    }
     return -1;
 }
 
@@ -318,6 +380,9 @@ PUBLIC STATIC void   AudioManager::PushMusicAt(ISound* music, double at, bool lo
 
     AudioManager::ClampParams(pan, speed, volume);
 
+    // Two decoder threads can't read from the same sound
+    AudioManager::StopMusicDecoders(music);
+
     AudioChannel* newms = new AudioChannel();
     newms->Audio = music;
     newms->Playback = music->CreatePlayer();
@@ -339,10 +404,18 @@ PUBLIC STATIC void   AudioManager::PushMusicAt(ISound* music, double at, bool lo
     if (loop)
         newms->Playback->LoopIndex = (Sint32)lp;
 
+    newms->Playback->StartDecoder(loop, (int)lp);
+
     MusicStack.push_front(newms);
 
     AudioManager::Unlock();
 }
+PRIVATE STATIC void  AudioManager::StopMusicDecoders(ISound* music) {
+    for (size_t i = 0; i < MusicStack.size(); i++) {
+        if (MusicStack[i]->Audio == music && MusicStack[i]->Playback)
+            MusicStack[i]->Playback->StopDecoder();
+    }
+}
 PUBLIC STATIC void   AudioManager::RemoveMusic(ISound* music) {
     AudioManager::Lock();
     for (size_t i = 0; i < MusicStack.size(); i++) {
@@ -407,7 +480,7 @@ PUBLIC STATIC double AudioManager::GetMusicPosition(ISound* music) {
     double position = 0.0;
     for (size_t i = 0; i < MusicStack.size(); i++) {
         if (MusicStack[i]->Audio == music) {
-            position = MusicStack[i]->Playback->SoundData->GetPosition();
+            position = MusicStack[i]->Playback->GetPosition();
             break;
         }
     }
@@ -548,40 +621,207 @@ PUBLIC STATIC void   AudioManager::StopAllOriginSounds(void* origin) {
     AudioManager::Unlock();
 }
 
-PUBLIC STATIC void   AudioManager::MixAudioLR(Uint8* dest, Uint8* src, size_t len, float volumeL, float volumeR) {
-#define DEFINE_STREAM_PTR(type) type* src##type; type* dest##type
-#define PAN_STREAM_PTR(type) \
-    src##type = (type*)(src); \
-    dest##type = (type*)(dest); \
-    for (Uint32 o = 0; o < len; o++) { \
-        dest##type[0] = (type)(src##type[0] * volumeL); \
-        dest##type[1] = (type)(src##type[1] * volumeR); \
-        src##type += 2; \
-        dest##type += 2; \
+// Turns samples in the device's format into floats between -1 and 1.
+PUBLIC STATIC void   AudioManager::ConvertToFloat(const Uint8* in, float* out, size_t count, SDL_AudioFormat format) {
+    switch (format) {
+        case AUDIO_S16SYS: {
+            const Sint16* src = (const Sint16*)in;
+            for (size_t i = 0; i < count; i++)
+                out[i] = src[i] * (1.0f / 32768.0f);
+            break;
+        }
+        case AUDIO_F32SYS:
+            memcpy(out, in, count * sizeof(float));
+            break;
+        case AUDIO_S32SYS: {
+            const Sint32* src = (const Sint32*)in;
+            for (size_t i = 0; i < count; i++)
+                out[i] = (float)(src[i] * (1.0 / 2147483648.0));
+            break;
+        }
+        case AUDIO_U16SYS: {
+            const Uint16* src = (const Uint16*)in;
+            for (size_t i = 0; i < count; i++)
+                out[i] = (src[i] - 32768) * (1.0f / 32768.0f);
+            break;
+        }
+        case AUDIO_S8: {
+            const Sint8* src = (const Sint8*)in;
+            for (size_t i = 0; i < count; i++)
+                out[i] = src[i] * (1.0f / 128.0f);
+            break;
+        }
+        case AUDIO_U8:
+            for (size_t i = 0; i < count; i++)
+                out[i] = (in[i] - 128) * (1.0f / 128.0f);
+            break;
+        default:
+            memset(out, 0, count * sizeof(float));
+            break;
+    }
+}
+// Turns floats back into the device's format, clamping them.
+PUBLIC STATIC void   AudioManager::ConvertFromFloat(const float* in, Uint8* out, size_t count, SDL_AudioFormat format) {
+    size_t i = 0;
+    switch (format) {
+        case AUDIO_S16SYS: {
+            Sint16* dest = (Sint16*)out;
+            SIMDFloat4 scale = SIMDFloat4::Splat(32768.0f);
+            SIMDFloat4 low = SIMDFloat4::Splat(-32768.0f);
+            SIMDFloat4 high = SIMDFloat4::Splat(32767.0f);
+            Sint32 lanes[4];
+            for (; i + 4 <= count; i += 4) {
+                SIMDFloat4 v = SIMDFloat4::Mul(SIMDFloat4::Load(in + i), scale);
+                v = SIMDFloat4::Min(SIMDFloat4::Max(v, low), high);
+                SIMDInt4::Store(lanes, SIMDFloat4::Truncate(v));
+                dest[i + 0] = (Sint16)lanes[0];
+                dest[i + 1] = (Sint16)lanes[1];
+                dest[i + 2] = (Sint16)lanes[2];
+                dest[i + 3] = (Sint16)lanes[3];
+            }
+            for (; i < count; i++) {
+                float v = in[i] * 32768.0f;
+                dest[i] = (Sint16)(v < -32768.0f ? -32768.0f : v > 32767.0f ? 32767.0f : v);
+            }
+            break;
+        }
+        case AUDIO_F32SYS: {
+            float* dest = (float*)out;
+            SIMDFloat4 low = SIMDFloat4::Splat(-1.0f);
+            SIMDFloat4 high = SIMDFloat4::Splat(1.0f);
+            for (; i + 4 <= count; i += 4)
+                SIMDFloat4::Store(dest + i, SIMDFloat4::Min(SIMDFloat4::Max(SIMDFloat4::Load(in + i), low), high));
+            for (; i < count; i++)
+                dest[i] = in[i] < -1.0f ? -1.0f : in[i] > 1.0f ? 1.0f : in[i];
+            break;
+        }
+        case AUDIO_S32SYS: {
+            Sint32* dest = (Sint32*)out;
+            for (; i < count; i++) {
+                double v = in[i] * 2147483648.0;
+                dest[i] = (Sint32)(v < -2147483648.0 ? -2147483648.0 : v > 2147483647.0 ? 2147483647.0 : v);
+            }
+            break;
+        }
+        case AUDIO_U16SYS: {
+            Uint16* dest = (Uint16*)out;
+            for (; i < count; i++) {
+                float v = in[i] * 32768.0f;
+                dest[i] = (Uint16)((v < -32768.0f ? -32768.0f : v > 32767.0f ? 32767.0f : v) + 32768.0f);
+            }
+            break;
+        }
+        case AUDIO_S8: {
+            Sint8* dest = (Sint8*)out;
+            for (; i < count; i++) {
+                float v = in[i] * 128.0f;
+                dest[i] = (Sint8)(v < -128.0f ? -128.0f : v > 127.0f ? 127.0f : v);
+            }
+            break;
+        }
+        case AUDIO_U8:
+            for (; i < count; i++) {
+                float v = in[i] * 128.0f;
+                out[i] = (Uint8)((v < -128.0f ? -128.0f : v > 127.0f ? 127.0f : v) + 128.0f);
+            }
+            break;
+    }
+}
+// Adds frames to the mix bus. With two channels, gainL and gainR apply to
+// the left and right; otherwise every channel gets gainL.
+PUBLIC STATIC void   AudioManager::MixFramesToBus(float* bus, const float* src, size_t frames, int channels, float gainL, float gainR) {
+    size_t count = frames * channels;
+    size_t i = 0;
+
+    SIMDFloat4 gain = channels == 2 ? SIMDFloat4::Set(gainL, gainR, gainL, gainR) : SIMDFloat4::Splat(gainL);
+    for (; i + 4 <= count; i += 4)
+        SIMDFloat4::Store(bus + i, SIMDFloat4::Add(SIMDFloat4::Load(bus + i), SIMDFloat4::Mul(SIMDFloat4::Load(src + i), gain)));
+
+    // An odd number of stereo frames leaves one behind
+    for (; i < count; i++)
+        bus[i] += src[i] * (channels == 2 && (i & 1) ? gainR : gainL);
+}
+// Adds frames to the mix bus while stepping through the source at a
+// different rate. Reads up to two frames past the position it's at, so the
+// source has to have them. Returns the number of frames mixed, which is less
+// than frames if the position reached end.
+PUBLIC STATIC size_t AudioManager::ResampleToBus(float* bus, const float* src, size_t end, double* position, double step, size_t frames, int channels, float gainL, float gainR, int quality) {
+    double pos = *position;
+    size_t written = 0;
+
+    for (; written < frames && (size_t)pos < end; written++) {
+        size_t index = (size_t)pos;
+        float t = (float)(pos - index);
+
+        const float* s1 = src + index * channels;
+        const float* s0 = index > 0 ? s1 - channels : s1;
+        const float* s2 = s1 + channels;
+        const float* s3 = s2 + channels;
+
+        for (int c = 0; c < channels; c++) {
+            float value;
+            switch (quality) {
+                case RESAMPLE_NEAREST:
+                    value = s1[c];
+                    break;
+                case RESAMPLE_CUBIC: {
+                    // Catmull-Rom spline through the four frames around pos
+                    float a = -0.5f * s0[c] + 1.5f * s1[c] - 1.5f * s2[c] + 0.5f * s3[c];
+                    float b = s0[c] - 2.5f * s1[c] + 2.0f * s2[c] - 0.5f * s3[c];
+                    float d = -0.5f * s0[c] + 0.5f * s2[c];
+                    value = ((a * t + b) * t + d) * t + s1[c];
+                    break;
+                }
+                default:
+                    value = s1[c] + (s2[c] - s1[c]) * t;
+                    break;
+            }
+            *bus++ += value * (channels == 2 && c == 1 ? gainR : gainL);
+        }
+        pos += step;
     }
 
-    DEFINE_STREAM_PTR(Uint8);
-    DEFINE_STREAM_PTR(Sint8);
-    DEFINE_STREAM_PTR(Uint16);
-    DEFINE_STREAM_PTR(Sint16);
-    DEFINE_STREAM_PTR(Sint32);
-    DEFINE_STREAM_PTR(float);
+    *position = pos;
+    return written;
+}
+// The low pass filter over the whole mix bus. It's recursive, so it can't
+// be done a few samples at a time, but it only runs once per callback now.
+PUBLIC STATIC void   AudioManager::FilterBus(float* bus, size_t frames, int channels) {
+    float fa0 = (float)a0, fa1 = (float)a1, fa2 = (float)a2, fb1 = (float)b1, fb2 = (float)b2;
+    float dry = 1.0f - LowPassFilter;
+    float wet = (float)mGain * LowPassFilter;
+
+    int stride = channels;
+    if (channels > 2)
+        channels = 2;
+
+    for (int c = 0; c < channels; c++) {
+        int idx0 = 2 * c;
+        int idx1 = idx0 + 1;
+        float x0 = mZxF[idx0], x1 = mZxF[idx1];
+        float y0 = mZyF[idx0], y1 = mZyF[idx1];
+
+        float* sample = bus + c;
+        for (size_t i = 0; i < frames; i++, sample += stride) {
+            float in = *sample;
+            float out = fa0 * in + fa1 * x0 + fa2 * x1 - fb1 * y0 - fb2 * y1;
+            x1 = x0;
+            x0 = in;
+            y1 = y0;
+            y0 = out;
+            *sample = in * dry + out * wet;
+        }
 
-    switch (DeviceFormat.format) {
-        case AUDIO_U8: PAN_STREAM_PTR(Uint8); break;
-        case AUDIO_S8: PAN_STREAM_PTR(Sint8); break;
-        case AUDIO_U16SYS: PAN_STREAM_PTR(Uint16); break;
-        case AUDIO_S16SYS: PAN_STREAM_PTR(Sint16); break;
-        case AUDIO_S32SYS: PAN_STREAM_PTR(Sint32); break;
-        case AUDIO_F32SYS: PAN_STREAM_PTR(float); break;
+        mZxF[idx0] = x0;
+        mZxF[idx1] = x1;
+        mZyF[idx0] = y0;
+        mZyF[idx1] = y1;
     }
-#undef DEFINE_STREAM_PTR
-#undef PAN_STREAM_PTR
 }
 
-PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio) {
+PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio, int frames) {
     if (audio->Fading == MusicFade_Out) {
-        audio->FadeTimer -= (double)DeviceFormat.samples / DeviceFormat.freq;
+        audio->FadeTimer -= (double)frames / DeviceFormat.freq;
         if (audio->FadeTimer < 0.0) {
             audio->FadeTimer = 1.0;
             audio->FadeTimerMax = 1.0;
@@ -590,7 +830,7 @@ PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio) {
         }
     }
     else if (audio->Fading == MusicFade_In) {
-        audio->FadeTimer += (double)DeviceFormat.samples / DeviceFormat.freq;
+        audio->FadeTimer += (double)frames / DeviceFormat.freq;
         if (audio->FadeTimer > audio->FadeTimerMax) {
             audio->FadeTimer = 1.0;
             audio->FadeTimerMax = 1.0;
@@ -599,115 +839,135 @@ PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio) {
     }
     return false;
 }
-PUBLIC STATIC bool   AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, float volume) {
-    if (AudioManager::HandleFading(audio))
+// Moves the playback's next samples into its float buffer, keeping the frame
+// before the read position around for interpolation.
+PRIVATE STATIC int   AudioManager::FillMixSource(AudioChannel* audio, AudioPlayback* playback) {
+    int channels = DeviceFormat.channels;
+
+    size_t keepFrom = (size_t)playback->MixPosition;
+    if (keepFrom > 0)
+        keepFrom--;
+    if (keepFrom > playback->MixSourceFrames)
+        keepFrom = playback->MixSourceFrames;
+    if (keepFrom > 0) {
+        memmove(playback->MixSource, playback->MixSource + keepFrom * channels, (playback->MixSourceFrames - keepFrom) * channels * sizeof(float));
+        playback->MixSourceFrames -= keepFrom;
+        playback->MixPosition -= keepFrom;
+    }
+
+    int bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
+    if (bytes == REQUEST_EOF) {
+        // Pad the end with silence, so that the last frames can still be
+        // interpolated
+        playback->MixEnded = true;
+        playback->MixEndFrame = playback->MixSourceFrames;
+        memset(playback->MixSource + playback->MixSourceFrames * channels, 0, AUDIO_MIX_SOURCE_PADDING * channels * sizeof(float));
+        playback->MixSourceFrames += AUDIO_MIX_SOURCE_PADDING;
+    }
+    if (bytes <= 0)
+        return bytes;
+
+    size_t frames = bytes / BytesPerSample;
+    if (playback->MixSourceFrames + frames > playback->MixSourceCapacity)
+        frames = playback->MixSourceCapacity - playback->MixSourceFrames;
+
+    AudioManager::ConvertToFloat(playback->Buffer, playback->MixSource + playback->MixSourceFrames * channels, frames * channels, DeviceFormat.format);
+    playback->MixSourceFrames += frames;
+    playback->BufferedSamples = 0;
+    return bytes;
+}
+PUBLIC STATIC bool   AudioManager::AudioPlayMix(AudioChannel* audio, float* bus, int frames, float volume) {
+    if (AudioManager::HandleFading(audio, frames))
         return true;
 
     AudioPlayback* playback = audio->Playback;
-    if (!playback || !audio->Playback->SoundData)
+    if (!playback || !playback->SoundData || !playback->MixSource)
         return false;
 
-    int bytesPerSample = BytesPerSample;
-    int bytes = playback->BufferedSamples * bytesPerSample;
-
-    unsigned advanceAccumulator = 0;
-    unsigned advanceReadIndex = 0;
-    unsigned advance = 0;
-    unsigned speed = audio->Speed;
-
-    // Read more bytes
-    if (bytes == 0) {
-        bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
-    }
-    else {
-        advanceReadIndex = len - bytes;
-    }
+    int channels = DeviceFormat.channels;
 
-    int mixVolume;
+    float gain = MasterVolume * volume;
     if (audio->Fading)
-        mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume * (audio->FadeTimer / audio->FadeTimerMax));
-    else
-        mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume);
+        gain *= (float)(audio->FadeTimer / audio->FadeTimerMax);
 
-    float volumeL = 1.0f;
-    float volumeR = 1.0f;
-
-    bool doPanning = audio->Pan != 0.0f && DeviceFormat.channels == 2;
-    if (doPanning) {
+    float gainL = gain;
+    float gainR = gain;
+    if (audio->Pan != 0.0f && channels == 2) {
         if (audio->Pan < 0.f)
-            volumeR += audio->Pan;
+            gainR *= 1.0f + audio->Pan;
         else
-            volumeL -= audio->Pan;
+            gainL *= 1.0f - audio->Pan;
     }
 
-    switch (bytes) {
-        // End of file
-        case REQUEST_EOF:
-            return true; // Stop playing audio.
-        // Waiting
-        case REQUEST_CONVERTING:
-            break;
-        // Error
-        case REQUEST_ERROR:
-            break;
-        // Normal
-        default:
-            if (speed == 0x10000) {
-                if (!doPanning)
-                    SDL_MixAudioFormat(stream, playback->Buffer, DeviceFormat.format, (Uint32)bytes, mixVolume);
-                else {
-                    Uint32 mixAdvance = MixBufferSize * bytesPerSample;
-                    for (Uint32 o = 0; o < (unsigned)len; o += mixAdvance) {
-                        AudioManager::MixAudioLR(MixBuffer, playback->Buffer + advanceReadIndex, MixBufferSize, volumeL, volumeR);
-                        SDL_MixAudioFormat(stream + o, MixBuffer, DeviceFormat.format, mixAdvance, mixVolume);
-                        advanceReadIndex += mixAdvance;
-                    }
-                }
+    double step = audio->Speed / 65536.0;
 
-                playback->BufferedSamples -= bytes / bytesPerSample;
-            }
-            else for (Uint32 o = 0; o < (unsigned)len; o += bytesPerSample) {
-                advanceAccumulator += speed;
-                advance = advanceAccumulator >> 16;
-                advanceAccumulator &= 0xFFFF;
-
-                if (doPanning) {
-                    AudioManager::MixAudioLR(MixBuffer, playback->Buffer + advanceReadIndex, 1, volumeL, volumeR);
-                    SDL_MixAudioFormat(stream + o, MixBuffer, DeviceFormat.format, (Uint32)bytesPerSample, mixVolume);
-                }
-                else
-                    SDL_MixAudioFormat(stream + o, playback->Buffer + advanceReadIndex, DeviceFormat.format, (Uint32)bytesPerSample, mixVolume);
+    // Too quiet to hear; only keep it in time
+    if (gainL < InaudibleVolume && gainR < InaudibleVolume && playback->SharedSamples) {
+        InaudibleVoiceCount++;
+        return !playback->Skip(frames * step, audio->Loop, audio->LoopPoint);
+    }
+    MixedVoiceCount++;
 
-                advanceReadIndex += advance * bytesPerSample;
-                if (playback->BufferedSamples <= advance) {
-                    playback->BufferedSamples = 0;
-                    advanceReadIndex = 0;
+    int quality = step == 1.0 ? RESAMPLE_NEAREST : Resampler;
+    size_t lookahead = quality == RESAMPLE_CUBIC ? 2 : quality == RESAMPLE_LINEAR ? 1 : 0;
 
-                    bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
-                }
-                else
-                    playback->BufferedSamples -= advance;
-            }
+    size_t written = 0;
+    while (written < (size_t)frames) {
+        size_t position = (size_t)playback->MixPosition;
+        if (playback->MixEnded) {
+            if (position >= playback->MixEndFrame)
+                return true; // Stop playing audio.
+        }
+        else if (position + lookahead >= playback->MixSourceFrames) {
+            int result = AudioManager::FillMixSource(audio, playback);
+            // Still converting, or an error; stay silent until next time
+            if (result < 0)
+                break;
+            continue;
+        }
+
+        size_t end = playback->MixEnded ? playback->MixEndFrame : playback->MixSourceFrames - lookahead;
+        float* out = bus + written * channels;
+        if (step == 1.0 && playback->MixPosition == (double)position) {
+            size_t count = end - position;
+            if (count > frames - written)
+                count = frames - written;
+
+            AudioManager::MixFramesToBus(out, playback->MixSource + position * channels, count, channels, gainL, gainR);
+            playback->MixPosition += count;
+            written += count;
+        }
+        else
+            written += AudioManager::ResampleToBus(out, playback->MixSource, end, &playback->MixPosition, step, frames - written, channels, gainL, gainR, quality);
     }
     return false;
 }
 
-PUBLIC STATIC void   AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
-    memset(stream, 0x00, len);
+// Mixes frames into stream, up to MixBusFrames of them.
+PRIVATE STATIC void  AudioManager::MixToStream(Uint8* stream, size_t frames) {
+    int channels = DeviceFormat.channels;
+    size_t bytes = frames * BytesPerSample;
+
+    float* bus = MixBus;
+    memset(bus, 0, frames * channels * sizeof(float));
 
-    if (AudioManager::AudioQueueSize >= (size_t)len) {
-        SDL_MixAudioFormat(stream, AudioManager::AudioQueue, DeviceFormat.format, (Uint32)len, (int)(SDL_MIX_MAXVOLUME * MasterVolume));
+    MixedVoiceCount = 0;
+    InaudibleVoiceCount = 0;
 
-        AudioManager::AudioQueueSize -= len;
+    if (AudioManager::AudioQueueSize >= bytes) {
+        AudioManager::ConvertToFloat(AudioManager::AudioQueue, MixScratch, frames * channels, DeviceFormat.format);
+        AudioManager::MixFramesToBus(bus, MixScratch, frames, channels, MasterVolume, MasterVolume);
+
+        AudioManager::AudioQueueSize -= bytes;
         if (AudioManager::AudioQueueSize > 0)
-            memmove(AudioManager::AudioQueue, AudioManager::AudioQueue + len, AudioManager::AudioQueueSize);
+            memmove(AudioManager::AudioQueue, AudioManager::AudioQueue + bytes, AudioManager::AudioQueueSize);
     }
 
     // Make track system
     if (MusicStack.size() > 0) {
         AudioChannel* audio = MusicStack.front();
         if (!audio->Paused) {
-            if (AudioManager::AudioPlayMix(audio, stream, len, audio->Volume * MusicVolume)) {
+            if (AudioManager::AudioPlayMix(audio, bus, (int)frames, audio->Volume * MusicVolume)) {
                 delete audio;
                 MusicStack.pop_front();
             }
@@ -719,41 +979,57 @@ PUBLIC STATIC void   AudioManager::AudioCallback(void* data, Uint8* stream, int
         if (!audio->Audio || audio->Stopped || audio->Paused)
             continue;
 
-        if (AudioManager::AudioPlayMix(audio, stream, len, audio->Volume * SoundVolume)) {
+        if (AudioManager::AudioPlayMix(audio, bus, (int)frames, audio->Volume * SoundVolume)) {
             audio->Stopped = true;
         }
     }
 
-    if (LowPassFilter > 0.0) {
-        size_t channels = 2;
-        if (SDL_AUDIO_ISFLOAT(DeviceFormat.format)) {
-            size_t samples = len / sizeof(float) / channels;
+    ActiveVoices = MixedVoiceCount;
+    InaudibleVoices = InaudibleVoiceCount;
+    if (ActiveVoices > SDL_AtomicGet(&PeakVoices))
+        SDL_AtomicSet(&PeakVoices, ActiveVoices);
 
-            float* in  = (float*)stream;
-            float* out = (float*)stream;
-            for (size_t i = 0; i < samples; i++) {
-                *out++ = ProcessSampleFloat(*in++, 1);
-                *out++ = ProcessSampleFloat(*in++, 0);
-            }
-        }
-        else {
-            size_t samples = len / sizeof(Sint16) / channels;
-
-            Sint16* in  = (Sint16*)stream;
-            Sint16* out = (Sint16*)stream;
-            for (size_t i = 0; i < samples; i++) {
-                *out++ = (Sint16)ProcessSample(*in++, 1);
-                *out++ = (Sint16)ProcessSample(*in++, 0);
-            }
-        }
+    if (LowPassFilter > 0.0)
+        AudioManager::FilterBus(bus, frames, channels);
+
+    AudioManager::ConvertFromFloat(bus, stream, frames * channels, DeviceFormat.format);
+}
+PUBLIC STATIC void   AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
+    double traceStart = Tracer::Enabled ? Clock::GetTicks() : 0.0;
+
+    // The device can ask for more frames than the mix bus holds, so it's
+    // mixed as many times as it takes to fill the stream
+    size_t frames = MixBusFrames ? len / BytesPerSample : 0;
+    size_t mixed = 0;
+    while (mixed < frames) {
+        size_t count = frames - mixed;
+        if (count > MixBusFrames)
+            count = MixBusFrames;
+
+        AudioManager::MixToStream(stream + mixed * BytesPerSample, count);
+        mixed += count;
     }
+    if (mixed * BytesPerSample < (size_t)len)
+        memset(stream + mixed * BytesPerSample, 0x00, len - mixed * BytesPerSample);
+
+    if (Tracer::Enabled && traceStart > 0.0)
+        Tracer::Record("audio", "Audio Callback", traceStart, Clock::GetTicks() - traceStart);
+}
+
+PUBLIC STATIC void   AudioManager::ResetVoiceStats() {
+    SDL_AtomicSet(&PeakVoices, ActiveVoices);
+    StolenVoices = 0;
 }
 
 PUBLIC STATIC void   AudioManager::Dispose() {
     Memory::Free(SoundArray);
     Memory::Free(AudioQueue);
-    Memory::Free(MixBuffer);
+    Memory::Free(MixBus);
+    Memory::Free(MixScratch);
 
     SDL_PauseAudioDevice(Device, 1);
     SDL_CloseAudioDevice(Device);
+
+    SDL_DestroyMutex(DecodeLock);
+    DecodeLock = NULL;
 }
@@ -17,11 +17,60 @@ public:
     SoundFormat*     SoundData = NULL;
     bool             OwnsSoundData = false;
     Sint32           LoopIndex = -1;
+
+    // A sound's decoded samples, shared with every other channel playing it
+    Uint8*           SharedSamples = NULL;
+    size_t           SharedSampleCount = 0;
+    size_t           SharedPosition = 0;
+
+    // How far ahead streamed sounds are decoded, in milliseconds. 0 decodes
+    // them in the audio callback.
+    static int          DecodeAheadTime;
+    // Times the audio callback ran out of decoded samples
+    static SDL_atomic_t Underruns;
+
+    SDL_Thread*      DecodeThread = NULL;
+    SDL_mutex*       DecodeLock = NULL;
+    SDL_sem*         DecodeWake = NULL;
+    SDL_atomic_t     DecodeQuit;
+    SDL_atomic_t     DecodeFinished;
+    Uint8*           DecodeBuffer = NULL;
+    size_t           DecodeBufferSize = 0;
+    bool             DecodeLoop = false;
+    Sint32           DecodeLoopPoint = 0;
+    bool             DecodeFlushed = false;
+
+    // Decoded samples in the device format, written by the decoder thread and
+    // read by the audio callback. Read and write positions only ever grow.
+    Uint8*           Ring = NULL;
+    Uint32           RingSize = 0;
+    SDL_atomic_t     RingRead;
+    SDL_atomic_t     RingWrite;
+    SDL_atomic_t     RingFilled;
+
+    size_t           StartSample = 0;
+    Uint64           PlayedSamples = 0;
+
+    // Samples waiting to be mixed, as floats. MixPosition is fractional when
+    // the sound plays at another speed.
+    float*           MixSource = NULL;
+    size_t           MixSourceFrames = 0;
+    size_t           MixSourceCapacity = 0;
+    double           MixPosition = 0.0;
+    bool             MixEnded = false;
+    size_t           MixEndFrame = 0;
 };
 #endif
 
 #include <Engine/Audio/AudioPlayback.h>
 #include <Engine/Audio/AudioManager.h>
+#include <Engine/Audio/AudioIncludes.h>
+
+// Source samples decoded at a time by the decoder thread
+#define DECODE_CHUNK_SAMPLES 2048
+
+int          AudioPlayback::DecodeAheadTime = 250;
+SDL_atomic_t AudioPlayback::Underruns;
 
 PUBLIC      AudioPlayback::AudioPlayback(SDL_AudioSpec format, size_t requiredSamples, size_t audioBytesPerSample, size_t deviceBytesPerSample) {
     Format = format;
@@ -32,6 +81,7 @@ PUBLIC      AudioPlayback::AudioPlayback(SDL_AudioSpec format, size_t requiredSa
     // Create sample buffers
     Buffer = (Uint8*)Memory::TrackedMalloc("Playback::Buffer", requiredSamples * deviceBytesPerSample);
     UnconvertedSampleBuffer = (Uint8*)Memory::TrackedMalloc("Playback::UnconvertedSampleBuffer", requiredSamples * audioBytesPerSample);
+    AllocateMixSource(requiredSamples);
 
     // Create sound conversion stream
     CreateConversionStream(format);
@@ -48,6 +98,8 @@ PUBLIC void AudioPlayback::Change(SDL_AudioSpec format, size_t requiredSamples,
     if (bufSize > RequiredSamples * BytesPerSample)
         UnconvertedSampleBuffer = (Uint8*)Memory::Realloc(UnconvertedSampleBuffer, bufSize);
 
+    AllocateMixSource(requiredSamples);
+
     Format = format;
     RequiredSamples = requiredSamples;
     BytesPerSample = audioBytesPerSample;
@@ -60,6 +112,25 @@ PUBLIC void AudioPlayback::Change(SDL_AudioSpec format, size_t requiredSamples,
     }
 }
 
+PRIVATE void AudioPlayback::AllocateMixSource(size_t requiredSamples) {
+    size_t capacity = requiredSamples + AUDIO_MIX_SOURCE_PADDING;
+    if (capacity <= MixSourceCapacity)
+        return;
+
+    size_t size = capacity * AudioManager::DeviceFormat.channels * sizeof(float);
+    if (MixSource)
+        MixSource = (float*)Memory::Realloc(MixSource, size);
+    else
+        MixSource = (float*)Memory::TrackedMalloc("Playback::MixSource", size);
+    MixSourceCapacity = capacity;
+}
+PUBLIC void AudioPlayback::ResetMix() {
+    MixSourceFrames = 0;
+    MixPosition = 0.0;
+    MixEnded = false;
+    MixEndFrame = 0;
+}
+
 PRIVATE void AudioPlayback::CreateConversionStream(SDL_AudioSpec format) {
     ConversionStream = SDL_NewAudioStream(Format.format, Format.channels, Format.freq, AudioManager::DeviceFormat.format, AudioManager::DeviceFormat.channels, AudioManager::DeviceFormat.freq);
     if (ConversionStream == NULL) {
@@ -76,6 +147,8 @@ PRIVATE void AudioPlayback::CreateConversionStream(SDL_AudioSpec format) {
 }
 
 PUBLIC void AudioPlayback::Dispose() {
+    StopDecoder();
+
     if (Buffer) {
         Memory::Free(Buffer);
         Buffer = NULL;
@@ -88,6 +161,11 @@ PUBLIC void AudioPlayback::Dispose() {
         SDL_FreeAudioStream(ConversionStream);
         ConversionStream = NULL;
     }
+    if (MixSource) {
+        Memory::Free(MixSource);
+        MixSource = NULL;
+        MixSourceCapacity = 0;
+    }
 
     if (SoundData) {
         if (OwnsSoundData) {
@@ -98,18 +176,83 @@ PUBLIC void AudioPlayback::Dispose() {
     }
 }
 
+// Plays a sound's decoded samples without copying them. soundData is the
+// sound's own, and isn't disposed with the playback.
+PUBLIC void AudioPlayback::SetSharedSamples(SoundFormat* soundData, Uint8* samples, size_t count) {
+    if (SoundData && OwnsSoundData) {
+        SoundData->Dispose();
+        delete SoundData;
+    }
+    SoundData = soundData;
+    OwnsSoundData = false;
+
+    SharedSamples = samples;
+    SharedSampleCount = samples ? count : 0;
+    SharedPosition = 0;
+}
+PRIVATE int AudioPlayback::ReadSamples(Uint8* buffer, size_t count) {
+    if (!SharedSamples)
+        return SoundData->GetSamples(buffer, count, LoopIndex);
+
+    if (SharedPosition >= SharedSampleCount)
+        return 0;
+    if (count > SharedSampleCount - SharedPosition)
+        count = SharedSampleCount - SharedPosition;
+
+    memcpy(buffer, SharedSamples + SharedPosition * BytesPerSample, count * BytesPerSample);
+    SharedPosition += count;
+    return (int)count;
+}
+PRIVATE void AudioPlayback::SeekSamples(int index) {
+    if (!SharedSamples) {
+        SoundData->SeekSample(index);
+        return;
+    }
+
+    SharedPosition = index < 0 ? 0 : (size_t)index;
+    if (SharedPosition > SharedSampleCount)
+        SharedPosition = SharedSampleCount;
+}
+// Moves ahead by a number of device frames without producing any samples,
+// for channels too quiet to be heard. Only shared samples can skip; returns
+// false if the sound ended.
+PUBLIC bool AudioPlayback::Skip(double frames, bool loop, int loopPoint) {
+    if (!SharedSamples)
+        return true;
+
+    ResetMix();
+    BufferedSamples = 0;
+    if (ConversionStream)
+        SDL_AudioStreamClear(ConversionStream);
+
+    SharedPosition += (size_t)(frames * Format.freq / AudioManager::DeviceFormat.freq);
+    if (SharedPosition >= SharedSampleCount) {
+        if (!loop) {
+            SharedPosition = SharedSampleCount;
+            return false;
+        }
+
+        size_t loopStart = loopPoint >= 0 && (size_t)loopPoint < SharedSampleCount ? loopPoint : 0;
+        SharedPosition = loopStart + (SharedPosition - SharedSampleCount) % (SharedSampleCount - loopStart);
+    }
+    return true;
+}
+
 PUBLIC int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_loop_to) {
     if (!SoundData)
         return AudioManager::REQUEST_ERROR;
 
+    if (DecodeThread)
+        return ReadDecodedSamples(samples);
+
     // If the format is the same, no need to convert.
     if (Format.freq == AudioManager::DeviceFormat.freq
     && Format.format == AudioManager::DeviceFormat.format
     && Format.channels == AudioManager::DeviceFormat.channels) {
-        int num_samples = SoundData->GetSamples(Buffer, samples, LoopIndex);
+        int num_samples = ReadSamples(Buffer, samples);
         if (num_samples == 0 && loop) {
-            SoundData->SeekSample(sample_to_loop_to);
-            num_samples = SoundData->GetSamples(Buffer, samples, LoopIndex);
+            SeekSamples(sample_to_loop_to);
+            num_samples = ReadSamples(Buffer, samples);
         }
 
         if (num_samples == 0)
@@ -129,10 +272,10 @@ PUBLIC int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_l
     int availableBytes = SDL_AudioStreamAvailable(ConversionStream);
     if (availableBytes < samplesRequestedInBytes) {
         // Load extra samples if we have none
-        int num_samples = SoundData->GetSamples(UnconvertedSampleBuffer, samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST, LoopIndex);
+        int num_samples = ReadSamples(UnconvertedSampleBuffer, samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST);
         if (num_samples == 0 && loop) {
-            SoundData->SeekSample(sample_to_loop_to);
-            num_samples = SoundData->GetSamples(UnconvertedSampleBuffer, samples, LoopIndex);
+            SeekSamples(sample_to_loop_to);
+            num_samples = ReadSamples(UnconvertedSampleBuffer, samples);
         }
 
         if (num_samples == 0) {
@@ -164,11 +307,274 @@ PUBLIC int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_l
     return received_bytes;
 }
 
+// With a decoder thread running, this has to be called with the audio device
+// locked, since it empties the ring the audio callback reads from.
 PUBLIC void AudioPlayback::Seek(int samples) {
     if (!SoundData)
         return;
 
+    ResetMix();
+
+    if (!DecodeThread) {
+        SeekSamples(samples);
+        return;
+    }
+
+    SDL_LockMutex(DecodeLock);
     SoundData->SeekSample(samples);
+    if (ConversionStream)
+        SDL_AudioStreamClear(ConversionStream);
+    SDL_AtomicSet(&RingRead, 0);
+    SDL_AtomicSet(&RingWrite, 0);
+    SDL_AtomicSet(&RingFilled, 0);
+    SDL_AtomicSet(&DecodeFinished, 0);
+    DecodeFlushed = false;
+    StartSample = (size_t)samples;
+    PlayedSamples = 0;
+    BufferedSamples = 0;
+    SDL_UnlockMutex(DecodeLock);
+
+    SDL_SemPost(DecodeWake);
+}
+
+// Where playback is in the sound, in seconds. Streamed sounds are decoded
+// ahead of what's heard, so this can't always ask the SoundFormat.
+PUBLIC double AudioPlayback::GetPosition() {
+    if (!SoundData)
+        return 0.0;
+    if (SharedSamples)
+        return (double)SharedPosition / Format.freq;
+    if (!DecodeThread)
+        return SoundData->GetPosition();
+
+    double sample = StartSample + (double)PlayedSamples * Format.freq / AudioManager::DeviceFormat.freq;
+    double total = SoundData->TotalPossibleSamples;
+    if (sample >= total) {
+        double loopStart = DecodeLoopPoint;
+        if (DecodeLoop && loopStart < total)
+            sample = loopStart + fmod(sample - total, total - loopStart);
+        else
+            sample = total;
+    }
+    return sample / Format.freq;
+}
+
+// Starts decoding a streamed sound on its own thread, so that the audio
+// callback only has to copy samples. Does nothing for sounds that are
+// already decoded, or with DecodeAheadTime set to 0.
+PUBLIC void AudioPlayback::StartDecoder(bool loop, int loopPoint) {
+    if (DecodeThread || !SoundData || DecodeAheadTime <= 0)
+        return;
+    if (SoundData->Samples.size() >= (size_t)SoundData->TotalPossibleSamples)
+        return;
+
+    bool sameFormat = Format.freq == AudioManager::DeviceFormat.freq
+        && Format.format == AudioManager::DeviceFormat.format
+        && Format.channels == AudioManager::DeviceFormat.channels;
+    if (!sameFormat && !ConversionStream)
+        return;
+
+    // At least two callbacks' worth, rounded up to a power of two so that
+    // the positions can wrap around
+    size_t ringBytes = (size_t)DecodeAheadTime * AudioManager::DeviceFormat.freq / 1000 * DeviceBytesPerSample;
+    size_t minimumBytes = (size_t)AudioManager::DeviceFormat.samples * DeviceBytesPerSample * 2;
+    if (ringBytes < minimumBytes)
+        ringBytes = minimumBytes;
+    RingSize = 1;
+    while (RingSize < ringBytes)
+        RingSize <<= 1;
+
+    DecodeBufferSize = DECODE_CHUNK_SAMPLES * (BytesPerSample > DeviceBytesPerSample ? BytesPerSample : DeviceBytesPerSample);
+    Ring = (Uint8*)Memory::TrackedMalloc("Playback::Ring", RingSize);
+    DecodeBuffer = (Uint8*)Memory::TrackedMalloc("Playback::DecodeBuffer", DecodeBufferSize);
+    DecodeLock = SDL_CreateMutex();
+    DecodeWake = SDL_CreateSemaphore(0);
+
+    DecodeLoop = loop;
+    DecodeLoopPoint = loopPoint;
+    DecodeFlushed = false;
+    SDL_AtomicSet(&DecodeQuit, 0);
+    SDL_AtomicSet(&DecodeFinished, 0);
+    SDL_AtomicSet(&RingRead, 0);
+    SDL_AtomicSet(&RingWrite, 0);
+    SDL_AtomicSet(&RingFilled, 0);
+    StartSample = SoundData->TellSample();
+    PlayedSamples = 0;
+    BufferedSamples = 0;
+
+    DecodeThread = SDL_CreateThread(AudioPlayback::DecodeThreadFunc, "AudioPlayback::DecodeThreadFunc", this);
+    if (!DecodeThread) {
+        Log::Print(Log::LOG_ERROR, "Could not create audio decoder thread: %s", SDL_GetError());
+        StopDecoder();
+    }
+}
+// Stops the decoder thread. Whatever it had decoded is dropped, and the audio
+// callback goes back to decoding from where the thread left off.
+PUBLIC void AudioPlayback::StopDecoder() {
+    if (DecodeThread) {
+        SDL_AtomicSet(&DecodeQuit, 1);
+        SDL_SemPost(DecodeWake);
+        SDL_WaitThread(DecodeThread, NULL);
+        DecodeThread = NULL;
+    }
+    if (DecodeLock) {
+        SDL_DestroyMutex(DecodeLock);
+        DecodeLock = NULL;
+    }
+    if (DecodeWake) {
+        SDL_DestroySemaphore(DecodeWake);
+        DecodeWake = NULL;
+    }
+    if (Ring) {
+        Memory::Free(Ring);
+        Ring = NULL;
+    }
+    if (DecodeBuffer) {
+        Memory::Free(DecodeBuffer);
+        DecodeBuffer = NULL;
+    }
+    BufferedSamples = 0;
+}
+
+PRIVATE STATIC int AudioPlayback::DecodeThreadFunc(void* data) {
+    AudioPlayback* playback = (AudioPlayback*)data;
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    while (!SDL_AtomicGet(&playback->DecodeQuit)) {
+        SDL_LockMutex(playback->DecodeLock);
+        playback->FillRing();
+        SDL_UnlockMutex(playback->DecodeLock);
+
+        // Woken up by the audio callback when it takes samples, but also
+        // checks on its own in case a wake up got lost
+        SDL_SemWaitTimeout(playback->DecodeWake, 20);
+    }
+    return 0;
+}
+
+PRIVATE int  AudioPlayback::DecodeSamples(Uint8* buffer, size_t count) {
+    int num_samples = SoundData->GetSamples(buffer, count, LoopIndex);
+    if (num_samples == 0 && DecodeLoop) {
+        SoundData->SeekSample(DecodeLoopPoint);
+        num_samples = SoundData->GetSamples(buffer, count, LoopIndex);
+    }
+    return num_samples;
+}
+PRIVATE void AudioPlayback::WriteRing(Uint8* data, Uint32 size) {
+    Uint32 write = (Uint32)SDL_AtomicGet(&RingWrite);
+    Uint32 offset = write & (RingSize - 1);
+    Uint32 first = RingSize - offset;
+    if (first > size)
+        first = size;
+
+    memcpy(Ring + offset, data, first);
+    memcpy(Ring, data + first, size - first);
+
+    // Publishes the samples to the audio callback
+    SDL_AtomicSet(&RingWrite, (int)(write + size));
+}
+// Decodes until the ring is full or the sound is over.
+PRIVATE void AudioPlayback::FillRing() {
+    bool sameFormat = Format.freq == AudioManager::DeviceFormat.freq
+        && Format.format == AudioManager::DeviceFormat.format
+        && Format.channels == AudioManager::DeviceFormat.channels;
+
+    while (!SDL_AtomicGet(&DecodeFinished) && !SDL_AtomicGet(&DecodeQuit)) {
+        Uint32 used = (Uint32)SDL_AtomicGet(&RingWrite) - (Uint32)SDL_AtomicGet(&RingRead);
+        Uint32 space = RingSize - used;
+        space -= space % DeviceBytesPerSample;
+        if (space == 0) {
+            SDL_AtomicSet(&RingFilled, 1);
+            break;
+        }
+
+        if (sameFormat) {
+            size_t count = space / DeviceBytesPerSample;
+            if (count > DECODE_CHUNK_SAMPLES)
+                count = DECODE_CHUNK_SAMPLES;
+
+            int num_samples = DecodeSamples(DecodeBuffer, count);
+            if (num_samples <= 0) {
+                SDL_AtomicSet(&DecodeFinished, 1);
+                break;
+            }
+            WriteRing(DecodeBuffer, (Uint32)(num_samples * DeviceBytesPerSample));
+            continue;
+        }
+
+        int received_bytes = 0;
+        if (SDL_AudioStreamAvailable(ConversionStream) > 0) {
+            int wanted = space < DecodeBufferSize ? (int)space : (int)DecodeBufferSize;
+            received_bytes = SDL_AudioStreamGet(ConversionStream, DecodeBuffer, wanted - wanted % (int)DeviceBytesPerSample);
+        }
+        if (received_bytes < 0) {
+            Log::Print(Log::LOG_ERROR, "Failed to get converted samples: %s", SDL_GetError());
+            SDL_AtomicSet(&DecodeFinished, 1);
+            break;
+        }
+        if (received_bytes > 0) {
+            WriteRing(DecodeBuffer, (Uint32)received_bytes);
+            continue;
+        }
+
+        // Out of converted samples, so decode some more
+        if (DecodeFlushed) {
+            SDL_AtomicSet(&DecodeFinished, 1);
+            break;
+        }
+
+        int num_samples = DecodeSamples(DecodeBuffer, DECODE_CHUNK_SAMPLES);
+        if (num_samples <= 0) {
+            // Get whatever the stream was holding on to
+            SDL_AudioStreamFlush(ConversionStream);
+            DecodeFlushed = true;
+        }
+        else if (SDL_AudioStreamPut(ConversionStream, DecodeBuffer, num_samples * BytesPerSample) == -1) {
+            Log::Print(Log::LOG_ERROR, "Failed to put samples in conversion stream: %s", SDL_GetError());
+            SDL_AtomicSet(&DecodeFinished, 1);
+            break;
+        }
+    }
+}
+// Called from the audio callback instead of decoding.
+PRIVATE int  AudioPlayback::ReadDecodedSamples(int samples) {
+    Uint32 read = (Uint32)SDL_AtomicGet(&RingRead);
+    Uint32 available = (Uint32)SDL_AtomicGet(&RingWrite) - read;
+    Uint32 size = (Uint32)(samples * DeviceBytesPerSample);
+
+    if (available < size) {
+        if (SDL_AtomicGet(&DecodeFinished)) {
+            if (available == 0)
+                return AudioManager::REQUEST_EOF;
+        }
+        // Only counts once the decoder has caught up after starting or
+        // seeking
+        else if (SDL_AtomicGet(&RingFilled))
+            SDL_AtomicIncRef(&Underruns);
+
+        size = available - available % DeviceBytesPerSample;
+        if (size == 0) {
+            SDL_SemPost(DecodeWake);
+            return AudioManager::REQUEST_CONVERTING;
+        }
+    }
+
+    Uint32 offset = read & (RingSize - 1);
+    Uint32 first = RingSize - offset;
+    if (first > size)
+        first = size;
+
+    memcpy(Buffer, Ring + offset, first);
+    memcpy(Buffer + first, Ring, size - first);
+
+    SDL_AtomicSet(&RingRead, (int)(read + size));
+    if (SDL_SemValue(DecodeWake) == 0)
+        SDL_SemPost(DecodeWake);
+
+    BufferedSamples = size / DeviceBytesPerSample;
+    PlayedSamples += BufferedSamples;
+    return (int)size;
 }
 
 PUBLIC AudioPlayback::~AudioPlayback() {
@@ -8,16 +8,28 @@ public:
     static Uint32              LatestVersion;
     static vector<const char*> FunctionNames;
 
+    // Totals for every script read, and how many of their functions have
+    // been called
+    static size_t              LoadedFileSize;
+    static size_t              LoadedImageSize;
+    static Uint32              LoadedFunctionCount;
+    static Uint32              DecodedFunctionCount;
+    static double              LoadTime;
+
     vector<ObjFunction*>       Functions;
 
     Uint8                      Version;
     bool                       HasDebugInfo = false;
     const char*                SourceFilename = nullptr;
+    // The code and constants of Functions, to be taken by the caller
+    BytecodeContainer          Image = { NULL, 0 };
 };
 #endif
 
 #include <Engine/Bytecode/Bytecode.h>
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/IO/MemoryStream.h>
+#include <Engine/IO/ResourceStream.h>
 #include <Engine/Utilities/StringUtils.h>
 
 #define BYTECODE_VERSION 0x0002
@@ -26,15 +38,24 @@ const char*         Bytecode::Magic = "HTVM";
 Uint32              Bytecode::LatestVersion = BYTECODE_VERSION;
 vector<const char*> Bytecode::FunctionNames{ "<anonymous-fn>", "main" };
 
+size_t              Bytecode::LoadedFileSize = 0;
+size_t              Bytecode::LoadedImageSize = 0;
+Uint32              Bytecode::LoadedFunctionCount = 0;
+Uint32              Bytecode::DecodedFunctionCount = 0;
+double              Bytecode::LoadTime = 0.0;
+
 PUBLIC              Bytecode::Bytecode() {
     Version = LatestVersion;
 }
 
 PUBLIC              Bytecode::~Bytecode() {
     Memory::Free((void*)SourceFilename);
+    Memory::Free(Image.Data);
 }
 
 PUBLIC bool        Bytecode::Read(BytecodeContainer bytecode, HashMap<char*>* tokens) {
+    double ticks = Clock::GetTicks();
+
     MemoryStream* stream = MemoryStream::New(bytecode.Data, bytecode.Size);
     if (!stream)
         return false;
@@ -51,6 +72,7 @@ PUBLIC bool        Bytecode::Read(BytecodeContainer bytecode, HashMap<char*>* to
 
     if (Version > BYTECODE_VERSION) {
         Log::Print(Log::LOG_ERROR, "Unsupported bytecode version 0x%02X!", Version);
+        stream->Close();
         return false;
     }
 
@@ -61,54 +83,103 @@ PUBLIC bool        Bytecode::Read(BytecodeContainer bytecode, HashMap<char*>* to
     HasDebugInfo = opts & 1;
 
     int chunkCount = stream->ReadInt32();
-    if (!chunkCount)
+    if (!chunkCount) {
+        stream->Close();
         return false;
+    }
+
+    // Only the code and the constants of each function are kept, in an
+    // image of their own. Constants are decoded when the function is first
+    // called, and line numbers are read from the file again if an error
+    // needs them.
+    struct FunctionInfo {
+        int    Length;
+        int    Arity;
+        int    MinArity;
+        Uint32 Hash;
+        size_t CodeOffset;
+        size_t LinesOffset;
+        size_t ConstantsOffset;
+        size_t ConstantsSize;
+    };
+    vector<FunctionInfo> infos;
+    size_t imageSize = 0;
 
     for (int i = 0; i < chunkCount; i++) {
-        int length = stream->ReadInt32();
-        int arity, minArity;
+        FunctionInfo info;
+        info.Length = stream->ReadInt32();
 
         if (Version < 0x0001) {
-            arity = stream->ReadInt32();
-            minArity = arity;
+            info.Arity = stream->ReadInt32();
+            info.MinArity = info.Arity;
         }
         else {
-            arity = stream->ReadByte();
-            minArity = stream->ReadByte();
+            info.Arity = stream->ReadByte();
+            info.MinArity = stream->ReadByte();
         }
 
-        Uint32 hash = stream->ReadUInt32();
-
-        ObjFunction* function = NewFunction();
-        function->Arity = arity;
-        function->MinArity = minArity;
-        function->NameHash = hash;
-        function->Chunk.Count = length;
-        function->Chunk.OwnsMemory = false;
+        info.Hash = stream->ReadUInt32();
 
-        function->Chunk.Code = stream->pointer;
-        stream->Skip(length * sizeof(Uint8));
+        info.CodeOffset = stream->Position();
+        stream->Skip(info.Length * sizeof(Uint8));
 
+        info.LinesOffset = 0;
         if (HasDebugInfo) {
-            function->Chunk.Lines = (int*)stream->pointer;
-            stream->Skip(length * sizeof(int));
+            info.LinesOffset = stream->Position();
+            stream->Skip(info.Length * sizeof(int));
         }
 
+        info.ConstantsOffset = stream->Position();
         int constantCount = stream->ReadInt32();
         for (int c = 0; c < constantCount; c++) {
             Uint8 type = stream->ReadByte();
             switch (type) {
                 case VAL_INTEGER:
-                    function->Chunk.AddConstant(INTEGER_VAL(stream->ReadInt32()));
+                    stream->Skip(sizeof(int));
                     break;
                 case VAL_DECIMAL:
-                    function->Chunk.AddConstant(DECIMAL_VAL(stream->ReadFloat()));
+                    stream->Skip(sizeof(float));
                     break;
                 case VAL_OBJECT:
-                    function->Chunk.AddConstant(OBJECT_VAL(TakeString(stream->ReadString())));
+                    stream->SkipString();
                     break;
             }
         }
+        info.ConstantsSize = stream->Position() - info.ConstantsOffset;
+
+        if (stream->Position() > bytecode.Size) {
+            Log::Print(Log::LOG_ERROR, "Bytecode is truncated!");
+            stream->Close();
+            return false;
+        }
+
+        imageSize += info.Length + info.ConstantsSize;
+        infos.push_back(info);
+    }
+
+    Image.Size = imageSize;
+    Image.Data = (Uint8*)Memory::TrackedMalloc("Bytecode::Image", imageSize);
+
+    Uint8* imagePointer = Image.Data;
+    for (size_t i = 0; i < infos.size(); i++) {
+        FunctionInfo& info = infos[i];
+
+        ObjFunction* function = NewFunction();
+        function->Arity = info.Arity;
+        function->MinArity = info.MinArity;
+        function->NameHash = info.Hash;
+        function->Chunk.Count = info.Length;
+        function->Chunk.OwnsMemory = false;
+
+        function->Chunk.Code = imagePointer;
+        memcpy(imagePointer, bytecode.Data + info.CodeOffset, info.Length);
+        imagePointer += info.Length;
+
+        function->Chunk.EncodedConstants = imagePointer;
+        memcpy(imagePointer, bytecode.Data + info.ConstantsOffset, info.ConstantsSize);
+        imagePointer += info.ConstantsSize;
+
+        function->Chunk.LinesOffset = (Uint32)info.LinesOffset;
 
         Functions.push_back(function);
     }
@@ -116,16 +187,17 @@ PUBLIC bool        Bytecode::Read(BytecodeContainer bytecode, HashMap<char*>* to
     if (HasDebugInfo) {
         int tokenCount = stream->ReadInt32();
         for (int t = 0; t < tokenCount; t++) {
-            char* string = stream->ReadString();
-            if (!tokens)
+            if (!tokens) {
                 stream->SkipString();
-            else {
-                Uint32 hash = Murmur::EncryptString(string);
-                if (!tokens->Exists(hash))
-                    tokens->Put(hash, string);
-                else
-                    Memory::Free(string);
+                continue;
             }
+
+            char* string = stream->ReadString();
+            Uint32 hash = Murmur::EncryptString(string);
+            if (!tokens->Exists(hash))
+                tokens->Put(hash, string);
+            else
+                Memory::Free(string);
         }
 
         if (tokens) {
@@ -140,9 +212,68 @@ PUBLIC bool        Bytecode::Read(BytecodeContainer bytecode, HashMap<char*>* to
     if (hasSourceFilename)
         SourceFilename = stream->ReadString();
 
+    stream->Close();
+
+    LoadedFileSize += bytecode.Size;
+    LoadedImageSize += Image.Size;
+    LoadedFunctionCount += (Uint32)Functions.size();
+    LoadTime += Clock::GetTicks() - ticks;
+
     return true;
 }
 
+// Reads the line numbers of the functions in a module, if they weren't
+// already. They're all read at once, since an error usually needs more
+// than one of them.
+PUBLIC STATIC void Bytecode::LoadLines(ObjModule* module) {
+    if (!module || !module->FilenameHash)
+        return;
+
+    bool needed = false;
+    for (size_t i = 0; i < module->Functions->size(); i++) {
+        Chunk* chunk = &(*module->Functions)[i]->Chunk;
+        if (!chunk->Lines && chunk->LinesOffset)
+            needed = true;
+    }
+    if (!needed)
+        return;
+
+    char filename[64];
+    snprintf(filename, sizeof filename, "Objects/%08X.ibc", module->FilenameHash);
+
+    Uint8* data = NULL;
+    size_t size = 0;
+    ResourceStream* stream = ResourceStream::New(filename);
+    if (stream) {
+        size = stream->Length();
+        data = (Uint8*)Memory::Malloc(size);
+        stream->ReadBytes(data, size);
+        stream->Close();
+    }
+
+    for (size_t i = 0; i < module->Functions->size(); i++) {
+        Chunk* chunk = &(*module->Functions)[i]->Chunk;
+        if (chunk->Lines || !chunk->LinesOffset)
+            continue;
+
+        // The script could have been compiled again since it was loaded, so
+        // the code in front of the lines has to match
+        size_t linesSize = chunk->Count * sizeof(int);
+        if (!data
+            || chunk->LinesOffset < (Uint32)chunk->Count
+            || chunk->LinesOffset + linesSize > size
+            || memcmp(data + chunk->LinesOffset - chunk->Count, chunk->Code, chunk->Count) != 0) {
+            chunk->LinesOffset = 0;
+            continue;
+        }
+
+        chunk->Lines = (int*)Memory::TrackedMalloc("Chunk::Lines", linesSize);
+        memcpy(chunk->Lines, data + chunk->LinesOffset, linesSize);
+    }
+
+    Memory::Free(data);
+}
+
 PUBLIC void        Bytecode::Write(Stream* stream, const char* sourceFilename, HashMap<Token>* tokenMap) {
     int hasSourceFilename = (sourceFilename != nullptr) ? 1 : 0;
     int hasDebugInfo = HasDebugInfo ? 1 : 0;
@@ -4,12 +4,21 @@
 
 class Compiler {
 public:
-    static Parser               parser;
-    static Scanner              scanner;
+    // The state of the file being compiled. Each thread has its own, so
+    // that several files can be compiled at once.
+    static thread_local Parser               parser;
+    static thread_local Scanner              scanner;
+    static thread_local vector<ObjFunction*> Functions;
+    static thread_local vector<Local>        ModuleLocals;
+    static thread_local HashMap<Token>*      TokenMap;
+    // Syntax errors stop the game, unless scripts are being reloaded or
+    // compiled in parallel
+    static thread_local bool                 ExitOnError;
+    // Off while compiling in parallel, where a file that fails is compiled
+    // again to report its errors
+    static thread_local bool                 LogErrors;
+
     static ParseRule*           Rules;
-    static vector<ObjFunction*> Functions;
-    static vector<Local>        ModuleLocals;
-    static HashMap<Token>*      TokenMap;
     static bool                 ShowWarnings;
     static bool                 WriteDebugInfo;
     static bool                 WriteSourceFilename;
@@ -42,13 +51,15 @@ public:
 
 #include <Engine/Application.h>
 
-Parser               Compiler::parser;
-Scanner              Compiler::scanner;
-ParseRule*           Compiler::Rules = NULL;
-vector<ObjFunction*> Compiler::Functions;
-vector<Local>        Compiler::ModuleLocals;
-HashMap<Token>*      Compiler::TokenMap = NULL;
+thread_local Parser               Compiler::parser;
+thread_local Scanner              Compiler::scanner;
+thread_local vector<ObjFunction*> Compiler::Functions;
+thread_local vector<Local>        Compiler::ModuleLocals;
+thread_local HashMap<Token>*      Compiler::TokenMap = NULL;
+thread_local bool                 Compiler::ExitOnError = true;
+thread_local bool                 Compiler::LogErrors = true;
 
+ParseRule*           Compiler::Rules = NULL;
 bool                 Compiler::ShowWarnings = false;
 bool                 Compiler::WriteDebugInfo = false;
 bool                 Compiler::WriteSourceFilename = false;
@@ -674,6 +685,8 @@ PUBLIC void          Compiler::SynchronizeToken() {
 PUBLIC bool          Compiler::ReportError(int line, bool fatal, const char* string, ...) {
     if (!fatal && !Compiler::ShowWarnings)
         return true;
+    if (fatal && !Compiler::LogErrors)
+        return false;
 
     char message[4096];
     memset(message, 0, sizeof message);
@@ -685,7 +698,7 @@ PUBLIC bool          Compiler::ReportError(int line, bool fatal, const char* str
 
     Log::Print(fatal ? Log::LOG_ERROR : Log::LOG_WARN, "in file '%s' on line %d:\n    %s\n\n", scanner.SourceFilename, line, message);
 
-    if (fatal)
+    if (fatal && ExitOnError)
         assert(false);
 
     return !fatal;
@@ -693,6 +706,8 @@ PUBLIC bool          Compiler::ReportError(int line, bool fatal, const char* str
 PUBLIC bool          Compiler::ReportErrorPos(int line, int pos, bool fatal, const char* string, ...) {
     if (!fatal && !Compiler::ShowWarnings)
         return true;
+    if (fatal && !Compiler::LogErrors)
+        return false;
 
     char message[4096];
     memset(message, 0, sizeof message);
@@ -719,6 +734,11 @@ PUBLIC bool          Compiler::ReportErrorPos(int line, int pos, bool fatal, con
 
 	Log::Print(Log::LOG_ERROR, textBuffer);
 
+    if (!ExitOnError) {
+        free(textBuffer);
+        return false;
+    }
+
 	const SDL_MessageBoxButtonData buttonsFatal[] = {
 		{ SDL_MESSAGEBOX_BUTTON_ESCAPEKEY_DEFAULT, 0, "Exit" },
 	};
@@ -11,6 +11,10 @@ public:
     static size_t       GarbageSize;
     static double       MaxTimeAlotted;
 
+    static Uint32       CollectCount;
+    // Total time spent collecting, in milliseconds
+    static double       CollectTime;
+
     static bool         Print;
     static bool         FilterSweepEnabled;
     static int          FilterSweepType;
@@ -20,10 +24,12 @@ public:
 #include <Engine/Bytecode/GarbageCollector.h>
 
 #include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Bytecode/ScriptJobs.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Compiler.h>
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Tracer.h>
 #include <Engine/Scene.h>
 
 #define GC_HEAP_GROW_FACTOR 2
@@ -35,6 +41,9 @@ size_t       GarbageCollector::NextGC = 1024;
 size_t       GarbageCollector::GarbageSize = 0;
 double       GarbageCollector::MaxTimeAlotted = 1.0; // 1ms
 
+Uint32       GarbageCollector::CollectCount = 0;
+double       GarbageCollector::CollectTime = 0.0;
+
 bool         GarbageCollector::Print = false;
 bool         GarbageCollector::FilterSweepEnabled = false;
 int          GarbageCollector::FilterSweepType = 0;
@@ -62,6 +71,9 @@ PUBLIC STATIC void GarbageCollector::Collect() {
         }
     }
 
+    // Mark values held by script jobs
+    ScriptJobs::GrayValues();
+
     // Mark global roots
     GrayHashMap(ScriptManager::Globals);
 
@@ -156,6 +168,11 @@ PUBLIC STATIC void GarbageCollector::Collect() {
     }
 
     GarbageCollector::NextGC = GarbageCollector::GarbageSize + (1024 * 1024);
+
+    double elapsed = grayElapsed + blackenElapsed + freeElapsed;
+    GarbageCollector::CollectCount++;
+    GarbageCollector::CollectTime += elapsed;
+    TRACE_ELAPSED("gc", "Garbage Collection", elapsed);
 }
 
 PRIVATE STATIC void GarbageCollector::FreeValue(VMValue value) {
@@ -172,7 +189,7 @@ PRIVATE STATIC void GarbageCollector::FreeValue(VMValue value) {
     ScriptManager::FreeValue(value);
 }
 
-PRIVATE STATIC void GarbageCollector::GrayValue(VMValue value) {
+PUBLIC STATIC void GarbageCollector::GrayValue(VMValue value) {
     if (!IS_OBJECT(value)) return;
     GrayObject(AS_OBJECT(value));
 }
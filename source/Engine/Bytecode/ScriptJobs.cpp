@@ -0,0 +1,505 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Bytecode/Types.h>
+
+class ScriptJobs {
+public:
+    // Finished jobs whose results nobody asked for are forgotten after this
+    // many more have finished
+    static Uint32 MaxFinished;
+    // How many workers can run jobs at once. 0 or less means half of them.
+    static int    MaxWorkers;
+    // How long Dispose waits for running jobs, in milliseconds
+    static Uint32 DisposeTimeout;
+};
+#endif
+
+#include <Engine/Bytecode/ScriptJobs.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+// Script functions run in the background on the worker pool, for
+// Thread.RunEvent. Every job gets a handle that scripts can poll or wait on.
+// Callbacks for jobs that finished or were cancelled run on the main
+// thread, at the end of the frame.
+//
+// Jobs wait in a queue of their own, which at most MaxWorkers workers take
+// from, so a job that never returns can't starve resource loading and the
+// other users of the pool. Each of those workers has one of
+// ScriptManager::Threads to itself (the first one is the main thread's).
+//
+// The garbage collector can't see what a running job holds, so it doesn't
+// run while any are.
+
+enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_CANCELLED,
+};
+
+struct ScriptJob {
+    Uint32          ID;
+    SDL_atomic_t    State;
+    SDL_atomic_t    CancelRequested;
+    // Held by Jobs, by Queue until a worker is done with it, by Finished,
+    // and by Wait
+    SDL_atomic_t    References;
+    VMValue         Callback;
+    vector<VMValue> Args;
+    VMValue         Result;
+    VMValue         OnComplete;
+    VMValue         OnCancel;
+    // In Finished
+    bool            Pending;
+    // Still running when Dispose gave up on it
+    bool            Abandoned;
+};
+
+#define THREAD_COUNT (sizeof(ScriptManager::Threads) / sizeof(VMThread))
+
+Uint32 ScriptJobs::MaxFinished = 256;
+int    ScriptJobs::MaxWorkers = 0;
+Uint32 ScriptJobs::DisposeTimeout = 2000;
+
+static SDL_mutex*              Lock = NULL;
+static SDL_cond*               JobDone = NULL;
+static SDL_atomic_t            Running;
+
+// Everything below is guarded by Lock
+static bool                    ThreadUsed[THREAD_COUNT];
+// Jobs that haven't been taken by a worker yet
+static deque<ScriptJob*>       Queue;
+// Workers taking jobs from Queue
+static int                     ActiveWorkers = 0;
+static map<Uint32, ScriptJob*> Jobs;
+static Uint32                  NextID = 1;
+// Jobs whose callbacks are due
+static vector<ScriptJob*>      Finished;
+// Finished jobs, oldest first
+static deque<Uint32>           Unclaimed;
+
+static thread_local ScriptJob* CurrentJob = NULL;
+
+static void ReleaseJob(ScriptJob* job) {
+    if (SDL_AtomicDecRef(&job->References))
+        delete job;
+}
+static ScriptJob* FindJob(Uint32 id) {
+    auto it = Jobs.find(id);
+    if (it == Jobs.end())
+        return NULL;
+    return it->second;
+}
+static void ForgetJob(Uint32 id) {
+    auto it = Jobs.find(id);
+    if (it == Jobs.end())
+        return;
+
+    ScriptJob* job = it->second;
+    Jobs.erase(it);
+    ReleaseJob(job);
+}
+static bool IsFinished(ScriptJob* job) {
+    int state = SDL_AtomicGet(&job->State);
+    return state == JOB_DONE || state == JOB_CANCELLED;
+}
+static void QueueCallback(ScriptJob* job) {
+    if (job->Pending)
+        return;
+
+    job->Pending = true;
+    SDL_AtomicAdd(&job->References, 1);
+    Finished.push_back(job);
+}
+static void FinishJob(ScriptJob* job, int state) {
+    SDL_AtomicSet(&job->State, state);
+    if (job->Abandoned) {
+        SDL_CondBroadcast(JobDone);
+        return;
+    }
+
+    QueueCallback(job);
+
+    Unclaimed.push_back(job->ID);
+    while (Unclaimed.size() > ScriptJobs::MaxFinished) {
+        ForgetJob(Unclaimed.front());
+        Unclaimed.pop_front();
+    }
+
+    SDL_CondBroadcast(JobDone);
+}
+
+static int GetWorkerLimit() {
+    int limit = ScriptJobs::MaxWorkers;
+    if (limit <= 0)
+        limit = WorkerPool::GetThreadCount() / 2;
+    if (limit < 1)
+        limit = 1;
+    if (limit > (int)THREAD_COUNT - 1)
+        limit = (int)THREAD_COUNT - 1;
+    return limit;
+}
+// There's never more workers than free threads, since the limit leaves
+// one for the main thread. Has to be called with Lock held.
+static VMThread* ClaimThread() {
+    for (size_t i = 1; i < THREAD_COUNT; i++) {
+        if (!ThreadUsed[i]) {
+            ThreadUsed[i] = true;
+            return &ScriptManager::Threads[i];
+        }
+    }
+    return NULL;
+}
+
+// Calls a function or bound method on thread, which might be in the middle
+// of running something else, and returns what it returned.
+static VMValue CallFunction(VMThread* thread, VMValue callback, VMValue* args, int argCount) {
+    VMValue* lastStackTop = thread->StackTop;
+
+    thread->InterpretResult = NULL_VAL;
+    thread->Push(callback);
+    for (int i = 0; i < argCount; i++)
+        thread->Push(args[i]);
+    thread->InvokeForEntity(callback, argCount);
+
+    thread->StackTop = lastStackTop;
+    return thread->InterpretResult;
+}
+static void RunJob(ScriptJob* job, VMThread* thread) {
+    ScriptJob* lastJob = CurrentJob;
+    CurrentJob = job;
+    VMValue result = CallFunction(thread, job->Callback, job->Args.data(), (int)job->Args.size());
+    CurrentJob = lastJob;
+
+    SDL_LockMutex(Lock);
+    job->Result = result;
+    FinishJob(job, SDL_AtomicGet(&job->CancelRequested) ? JOB_CANCELLED : JOB_DONE);
+    SDL_UnlockMutex(Lock);
+}
+// Runs queued jobs until there are none left.
+static void WorkerJob(void* data) {
+    SDL_LockMutex(Lock);
+    VMThread* thread = ClaimThread();
+    for (;;) {
+        if (Queue.empty() || !thread) {
+            if (thread)
+                ThreadUsed[thread->ID] = false;
+            ActiveWorkers--;
+            break;
+        }
+
+        ScriptJob* job = Queue.front();
+        Queue.pop_front();
+        SDL_UnlockMutex(Lock);
+
+        // It could have been cancelled, or run by Wait, in the meantime
+        if (SDL_AtomicCAS(&job->State, JOB_QUEUED, JOB_RUNNING)) {
+            // Garbage collection holds the script lock, so this waits for
+            // it to finish
+            ScriptManager::Lock();
+            SDL_AtomicAdd(&Running, 1);
+            ScriptManager::Unlock();
+
+            RunJob(job, thread);
+
+            SDL_AtomicAdd(&Running, -1);
+
+            thread->FrameCount = 0;
+            thread->ResetStack();
+        }
+        ReleaseJob(job);
+
+        SDL_LockMutex(Lock);
+    }
+    SDL_UnlockMutex(Lock);
+}
+
+// Queues a call to a function or bound method with the given arguments, and
+// returns its handle. Without workers, it runs right away on the calling
+// thread instead.
+PUBLIC STATIC Uint32 ScriptJobs::Start(VMValue callback, VMValue* args, int argCount, Uint32 threadID) {
+    if (!Lock) {
+        Lock = SDL_CreateMutex();
+        JobDone = SDL_CreateCond();
+        SDL_AtomicSet(&Running, 0);
+    }
+
+    ScriptJob* job = new ScriptJob();
+    job->Callback = callback;
+    job->Args.assign(args, args + argCount);
+    job->Result = NULL_VAL;
+    job->OnComplete = NULL_VAL;
+    job->OnCancel = NULL_VAL;
+    job->Pending = false;
+    job->Abandoned = false;
+    SDL_AtomicSet(&job->State, JOB_QUEUED);
+    SDL_AtomicSet(&job->CancelRequested, 0);
+    SDL_AtomicSet(&job->References, 2);
+
+    SDL_LockMutex(Lock);
+    Uint32 id = job->ID = NextID++;
+    Jobs[id] = job;
+
+    bool startWorker = false;
+    bool runNow = WorkerPool::GetThreadCount() == 0;
+    if (!runNow) {
+        Queue.push_back(job);
+        if (ActiveWorkers < GetWorkerLimit()) {
+            ActiveWorkers++;
+            startWorker = true;
+        }
+    }
+    SDL_UnlockMutex(Lock);
+
+    if (runNow) {
+        SDL_AtomicSet(&job->State, JOB_RUNNING);
+        RunJob(job, &ScriptManager::Threads[threadID]);
+        ReleaseJob(job);
+    }
+    else if (startWorker && !WorkerPool::QueueJob(WorkerJob, NULL)) {
+        // The pool went away in the meantime
+        WorkerJob(NULL);
+    }
+    return id;
+}
+
+// Jobs that were forgotten count as done.
+PUBLIC STATIC bool ScriptJobs::IsDone(Uint32 id) {
+    if (!Lock)
+        return true;
+
+    SDL_LockMutex(Lock);
+    ScriptJob* job = FindJob(id);
+    bool done = !job || IsFinished(job);
+    SDL_UnlockMutex(Lock);
+    return done;
+}
+
+// Takes the result of a job that finished. Once taken, the job is
+// forgotten.
+PUBLIC STATIC bool ScriptJobs::GetResult(Uint32 id, VMValue* result) {
+    if (!Lock)
+        return false;
+
+    SDL_LockMutex(Lock);
+    ScriptJob* job = FindJob(id);
+    bool done = job && IsFinished(job);
+    if (done) {
+        *result = SDL_AtomicGet(&job->State) == JOB_DONE ? job->Result : NULL_VAL;
+        ForgetJob(id);
+    }
+    SDL_UnlockMutex(Lock);
+    return done;
+}
+
+// Waits for a job to finish and takes its result. A job that hasn't started
+// yet runs on the calling thread instead of waiting for a worker.
+PUBLIC STATIC VMValue ScriptJobs::Wait(Uint32 id, Uint32 threadID) {
+    if (!Lock)
+        return NULL_VAL;
+
+    SDL_LockMutex(Lock);
+    ScriptJob* job = FindJob(id);
+    if (job)
+        SDL_AtomicAdd(&job->References, 1);
+    SDL_UnlockMutex(Lock);
+
+    if (!job)
+        return NULL_VAL;
+
+    if (job == CurrentJob) {
+        ScriptManager::Threads[threadID].ThrowRuntimeError(false, "Job %u cannot wait for itself.", id);
+        ReleaseJob(job);
+        return NULL_VAL;
+    }
+
+    if (SDL_AtomicCAS(&job->State, JOB_QUEUED, JOB_RUNNING)) {
+        RunJob(job, &ScriptManager::Threads[threadID]);
+    }
+    else {
+        // The job can't run any script while this thread holds the lock
+        int lockDepth = ScriptManager::UnlockAll();
+
+        SDL_LockMutex(Lock);
+        while (!IsFinished(job))
+            SDL_CondWait(JobDone, Lock);
+        SDL_UnlockMutex(Lock);
+
+        ScriptManager::Relock(lockDepth);
+    }
+
+    SDL_LockMutex(Lock);
+    VMValue result = SDL_AtomicGet(&job->State) == JOB_DONE ? job->Result : NULL_VAL;
+    ForgetJob(id);
+    SDL_UnlockMutex(Lock);
+
+    ReleaseJob(job);
+    return result;
+}
+
+// Stops a job from starting. A job that's running already can't be stopped,
+// but it can check IsCancelled, and its result is thrown away. Returns false
+// if the job had finished.
+PUBLIC STATIC bool ScriptJobs::Cancel(Uint32 id) {
+    if (!Lock)
+        return false;
+
+    bool cancelled = false;
+    SDL_LockMutex(Lock);
+    ScriptJob* job = FindJob(id);
+    if (job) {
+        if (SDL_AtomicCAS(&job->State, JOB_QUEUED, JOB_CANCELLED)) {
+            FinishJob(job, JOB_CANCELLED);
+            cancelled = true;
+        }
+        else if (SDL_AtomicGet(&job->State) == JOB_RUNNING) {
+            SDL_AtomicSet(&job->CancelRequested, 1);
+            cancelled = true;
+        }
+    }
+    SDL_UnlockMutex(Lock);
+    return cancelled;
+}
+
+// Whether the job running on the calling thread was cancelled.
+PUBLIC STATIC bool ScriptJobs::IsCancelled() {
+    return CurrentJob && SDL_AtomicGet(&CurrentJob->CancelRequested);
+}
+
+// Sets the function that gets called with the job's result once it's done,
+// or with nothing once it's cancelled. If the job is done already, it's
+// called at the end of this frame.
+PUBLIC STATIC bool ScriptJobs::SetCallback(Uint32 id, VMValue callback, bool onCancel) {
+    if (!Lock)
+        return false;
+
+    SDL_LockMutex(Lock);
+    ScriptJob* job = FindJob(id);
+    if (job) {
+        if (onCancel)
+            job->OnCancel = callback;
+        else
+            job->OnComplete = callback;
+
+        if (IsFinished(job))
+            QueueCallback(job);
+    }
+    SDL_UnlockMutex(Lock);
+    return job != NULL;
+}
+
+// Runs the callbacks of jobs that finished since the last call. Once a
+// job's result has been handed to its callback, the job is forgotten.
+PUBLIC STATIC void ScriptJobs::Update() {
+    if (!Lock)
+        return;
+
+    vector<ScriptJob*> finished;
+    SDL_LockMutex(Lock);
+    finished.swap(Finished);
+    for (size_t i = 0; i < finished.size(); i++)
+        finished[i]->Pending = false;
+    SDL_UnlockMutex(Lock);
+
+    VMThread* thread = &ScriptManager::Threads[0];
+    for (size_t i = 0; i < finished.size(); i++) {
+        ScriptJob* job = finished[i];
+        bool cancelled = SDL_AtomicGet(&job->State) == JOB_CANCELLED;
+        VMValue callback = cancelled ? job->OnCancel : job->OnComplete;
+        if (!IS_NULL(callback)) {
+            CallFunction(thread, callback, &job->Result, cancelled ? 0 : 1);
+
+            SDL_LockMutex(Lock);
+            ForgetJob(job->ID);
+            SDL_UnlockMutex(Lock);
+        }
+        ReleaseJob(job);
+    }
+}
+
+PUBLIC STATIC int ScriptJobs::GetRunningCount() {
+    if (!Lock)
+        return 0;
+    return SDL_AtomicGet(&Running);
+}
+
+PUBLIC STATIC void ScriptJobs::GrayValues() {
+    if (!Lock)
+        return;
+
+    SDL_LockMutex(Lock);
+    for (auto& it : Jobs) {
+        ScriptJob* job = it.second;
+        GarbageCollector::GrayValue(job->Callback);
+        for (size_t i = 0; i < job->Args.size(); i++)
+            GarbageCollector::GrayValue(job->Args[i]);
+        GarbageCollector::GrayValue(job->Result);
+        GarbageCollector::GrayValue(job->OnComplete);
+        GarbageCollector::GrayValue(job->OnCancel);
+    }
+    for (size_t i = 0; i < Finished.size(); i++) {
+        GarbageCollector::GrayValue(Finished[i]->Result);
+        GarbageCollector::GrayValue(Finished[i]->OnComplete);
+        GarbageCollector::GrayValue(Finished[i]->OnCancel);
+    }
+    SDL_UnlockMutex(Lock);
+}
+
+// Cancels every job, and waits up to DisposeTimeout for the ones that are
+// running. Their callbacks don't get called. Jobs that are still running
+// after that are left to finish on their own.
+PUBLIC STATIC void ScriptJobs::Dispose() {
+    if (!Lock)
+        return;
+
+    SDL_LockMutex(Lock);
+    for (auto& it : Jobs) {
+        ScriptJob* job = it.second;
+        if (!SDL_AtomicCAS(&job->State, JOB_QUEUED, JOB_CANCELLED))
+            SDL_AtomicSet(&job->CancelRequested, 1);
+    }
+    for (size_t i = 0; i < Queue.size(); i++)
+        ReleaseJob(Queue[i]);
+    Queue.clear();
+
+    Uint32 deadline = SDL_GetTicks() + ScriptJobs::DisposeTimeout;
+    for (;;) {
+        bool running = false;
+        for (auto& it : Jobs) {
+            if (SDL_AtomicGet(&it.second->State) == JOB_RUNNING)
+                running = true;
+        }
+        if (!running)
+            break;
+
+        Sint32 remaining = (Sint32)(deadline - SDL_GetTicks());
+        if (remaining <= 0) {
+            for (auto& it : Jobs) {
+                ScriptJob* job = it.second;
+                if (SDL_AtomicGet(&job->State) != JOB_RUNNING)
+                    continue;
+
+                job->Abandoned = true;
+                Log::Print(Log::LOG_WARN, "Script job %u is still running after %u ms, and was not waited for. Jobs that run for a long time should check Thread.IsCancelled.", job->ID, ScriptJobs::DisposeTimeout);
+            }
+            Log::Print(Log::LOG_WARN, "Garbage collection is paused until the jobs above return.");
+            break;
+        }
+        SDL_CondWaitTimeout(JobDone, Lock, (Uint32)remaining);
+    }
+
+    for (size_t i = 0; i < Finished.size(); i++)
+        ReleaseJob(Finished[i]);
+    Finished.clear();
+    for (auto& it : Jobs)
+        ReleaseJob(it.second);
+    Jobs.clear();
+    Unclaimed.clear();
+    SDL_UnlockMutex(Lock);
+
+    // Lock stays, since workers can still be holding cancelled jobs
+}
@@ -20,7 +20,8 @@ public:
 
     static std::set<Obj*>              FreedGlobals;
 
-    static VMThread                    Threads[8];
+    // The main thread's, and one for each worker running a script job
+    static VMThread                    Threads[9];
     static Uint32                      ThreadCount;
 
     static vector<ObjModule*>          ModuleList;
@@ -38,6 +39,7 @@ public:
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/ScriptJobs.h>
 #include <Engine/Bytecode/StandardLibrary.h>
 #include <Engine/Bytecode/SourceFileMap.h>
 #include <Engine/Bytecode/Values.h>
@@ -57,7 +59,7 @@ public:
 
 bool                        ScriptManager::LoadAllClasses = false;
 
-VMThread                    ScriptManager::Threads[8];
+VMThread                    ScriptManager::Threads[9];
 Uint32                      ScriptManager::ThreadCount = 1;
 
 HashMap<VMValue>*           ScriptManager::Globals = NULL;
@@ -75,6 +77,13 @@ vector<ObjClass*>           ScriptManager::ClassImplList;
 
 SDL_mutex*                  ScriptManager::GlobalLock = NULL;
 
+// Images of scripts that were reloaded, or that were run without being in
+// Sources. Functions still point into them.
+static vector<BytecodeContainer> RetiredSources;
+
+// How many times the calling thread holds GlobalLock
+static thread_local int          LockDepth = 0;
+
 // #define DEBUG_STRESS_GC
 
 PUBLIC STATIC void    ScriptManager::RequestGarbageCollection() {
@@ -92,7 +101,7 @@ PUBLIC STATIC void    ScriptManager::RequestGarbageCollection() {
 }
 PUBLIC STATIC void    ScriptManager::ForceGarbageCollection() {
     if (ScriptManager::Lock()) {
-        if (ScriptManager::ThreadCount > 1) {
+        if (ScriptJobs::GetRunningCount() > 0) {
             ScriptManager::Unlock();
             return;
         }
@@ -142,7 +151,7 @@ PUBLIC STATIC void    ScriptManager::Init() {
         Threads[i].ID = i;
         Threads[i].StackTop = Threads[i].Stack;
     }
-    ThreadCount = 1;
+    ThreadCount = sizeof(Threads) / sizeof(VMThread);
 }
 PUBLIC STATIC void    ScriptManager::DisposeGlobalValueTable(HashMap<VMValue>* globals) {
     globals->ForAll(FreeGlobalValue);
@@ -150,6 +159,8 @@ PUBLIC STATIC void    ScriptManager::DisposeGlobalValueTable(HashMap<VMValue>* g
     delete globals;
 }
 PUBLIC STATIC void    ScriptManager::Dispose() {
+    ScriptJobs::Dispose();
+
     // NOTE: Remove GC-able values from these tables so they may be cleaned up.
     if (Globals)
         Globals->ForAll(RemoveNonGlobalableValue);
@@ -189,6 +200,9 @@ PUBLIC STATIC void    ScriptManager::Dispose() {
         delete Sources;
         Sources = NULL;
     }
+    for (size_t i = 0; i < RetiredSources.size(); i++)
+        Memory::Free(RetiredSources[i].Data);
+    RetiredSources.clear();
     if (Classes) {
         Classes->Clear();
         delete Classes;
@@ -584,11 +598,27 @@ PUBLIC STATIC void    ScriptManager::FreeValue(VMValue value) {
 
 // #region GlobalFuncs
 PUBLIC STATIC bool    ScriptManager::Lock() {
-    return (SDL_LockMutex(GlobalLock) == 0);
+    if (SDL_LockMutex(GlobalLock) != 0)
+        return false;
+    LockDepth++;
+    return true;
 }
 PUBLIC STATIC void    ScriptManager::Unlock() {
+    LockDepth--;
     SDL_UnlockMutex(GlobalLock);
 }
+// Lets go of GlobalLock entirely, for waiting on another thread that needs
+// it. Returns how many times to take it again with Relock.
+PUBLIC STATIC int     ScriptManager::UnlockAll() {
+    int depth = LockDepth;
+    while (LockDepth > 0)
+        Unlock();
+    return depth;
+}
+PUBLIC STATIC void    ScriptManager::Relock(int depth) {
+    while (depth-- > 0)
+        Lock();
+}
 
 PUBLIC STATIC void    ScriptManager::DefineMethod(VMThread* thread, ObjFunction* function, Uint32 hash) {
     VMValue methodValue = OBJECT_VAL(function);
@@ -692,7 +722,17 @@ PUBLIC STATIC bool    ScriptManager::RunBytecode(BytecodeContainer bytecodeConta
         return false;
     }
 
+    // The functions only need the image Read made, so it replaces the file
+    if (Sources->Exists(filenameHash) && Sources->Get(filenameHash).Data == bytecodeContainer.Data) {
+        Sources->Put(filenameHash, bytecode->Image);
+        Memory::Free(bytecodeContainer.Data);
+    }
+    else
+        RetiredSources.push_back(bytecode->Image);
+    bytecode->Image.Data = NULL;
+
     ObjModule* module = NewModule();
+    module->FilenameHash = filenameHash;
 
     for (size_t i = 0; i < bytecode->Functions.size(); i++) {
         ObjFunction* function = bytecode->Functions[i];
@@ -805,6 +845,20 @@ PUBLIC STATIC bool    ScriptManager::LoadScript(Uint32 hash) {
 
     return true;
 }
+// Runs new bytecode for a script that's already loaded, taking ownership of
+// it. Classes the script defines get its new methods, so their instances
+// pick them up and keep their fields. Returns false if the script wasn't
+// loaded, and leaves the bytecode alone.
+PUBLIC STATIC bool    ScriptManager::ReloadScript(Uint32 filenameHash, BytecodeContainer bytecode) {
+    BytecodeContainer old;
+    if (!Sources->GetIfExists(filenameHash, &old))
+        return false;
+
+    RetiredSources.push_back(old);
+    Sources->Put(filenameHash, bytecode);
+
+    return RunBytecode(bytecode, filenameHash);
+}
 PUBLIC STATIC bool    ScriptManager::LoadObjectClass(const char* objectName, bool addNativeFunctions) {
     if (!objectName || !*objectName)
         return false;
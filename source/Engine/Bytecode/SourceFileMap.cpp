@@ -17,13 +17,20 @@ public:
 
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
 #include <Engine/IO/FileStream.h>
 #include <Engine/IO/ResourceStream.h>
 #include <Engine/Filesystem/Directory.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Hashing/FNV1A.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+#include <time.h>
 
 bool                      SourceFileMap::Initialized = false;
 HashMap<Uint32>*          SourceFileMap::Checksums = NULL;
@@ -33,6 +40,98 @@ Uint32                    SourceFileMap::Magic = *(Uint32*)"HMAP";
 
 bool                      SourceFileMap::DoLogging = false;
 
+// The size and modified time a script had when it was last hashed
+struct SourceFileStamp {
+    size_t Size;
+    Sint64 ModifiedTime;
+    Uint32 Checksum;
+};
+
+struct CompileJob {
+    const char*     Filename;
+    Uint32          FilenameHash;
+    char*           Source;
+    char            OutFile[35];
+    bool            Compiled;
+    vector<Uint32>  ClassHashes;
+    vector<Uint32>  ClassExtended;
+    DetachedObjects Objects;
+};
+
+#define STAMPS_FILENAME "SourceFileStamps.bin"
+#define STAMPS_MAGIC    0x50545348 // "HSTP"
+// Two seconds, in nanoseconds
+#define STAMPS_MIN_AGE  2000000000LL
+
+static map<Uint32, SourceFileStamp> Stamps;
+static bool                         StampsChanged = false;
+
+static void LoadStamps() {
+    Stamps.clear();
+    StampsChanged = false;
+
+    FileStream* stream = FileStream::New(STAMPS_FILENAME, FileStream::READ_ACCESS);
+    if (!stream)
+        return;
+
+    if (stream->ReadUInt32() == STAMPS_MAGIC) {
+        Uint32 count = stream->ReadUInt32();
+        for (Uint32 i = 0; i < count; i++) {
+            Uint32 filenameHash = stream->ReadUInt32();
+            SourceFileStamp stamp;
+            stamp.Size = (size_t)stream->ReadUInt64();
+            stamp.ModifiedTime = stream->ReadInt64();
+            stamp.Checksum = stream->ReadUInt32();
+            Stamps[filenameHash] = stamp;
+        }
+    }
+    stream->Close();
+}
+static void SaveStamps() {
+    if (!StampsChanged)
+        return;
+
+    FileStream* stream = FileStream::New(STAMPS_FILENAME, FileStream::WRITE_ACCESS);
+    if (!stream)
+        return;
+
+    stream->WriteUInt32(STAMPS_MAGIC);
+    stream->WriteUInt32((Uint32)Stamps.size());
+    for (auto& it : Stamps) {
+        stream->WriteUInt32(it.first);
+        stream->WriteUInt64((Uint64)it.second.Size);
+        stream->WriteInt64(it.second.ModifiedTime);
+        stream->WriteUInt32(it.second.Checksum);
+    }
+    stream->Close();
+    StampsChanged = false;
+}
+
+static void CompileFile(CompileJob* job, bool exitOnError) {
+    // The compiler makes strings and functions, which the garbage collector
+    // may only be handed on the main thread
+    DetachObjectAllocations(&job->Objects);
+    Compiler::ExitOnError = exitOnError;
+    Compiler::LogErrors = exitOnError;
+    Compiler::PrepareCompiling();
+
+    Compiler* compiler = new Compiler;
+    job->Compiled = compiler->Compile(job->Filename, job->Source, job->OutFile);
+    job->ClassHashes = compiler->ClassHashList;
+    job->ClassExtended = compiler->ClassExtendedList;
+    delete compiler;
+
+    Compiler::FinishCompiling();
+    Compiler::ExitOnError = true;
+    Compiler::LogErrors = true;
+    DetachObjectAllocations(NULL);
+}
+static void CompileJobs(void* data, Uint32 start, Uint32 end) {
+    CompileJob* jobs = (CompileJob*)data;
+    for (Uint32 i = start; i < end; i++)
+        CompileFile(&jobs[i], false);
+}
+
 PUBLIC STATIC void SourceFileMap::CheckInit() {
     if (SourceFileMap::Initialized) return;
 
@@ -88,6 +187,8 @@ PUBLIC STATIC void SourceFileMap::CheckInit() {
         Memory::Free(bytes);
     }
 
+    LoadStamps();
+
     #endif
 
     Application::Settings->GetBool("compiler", "log", &SourceFileMap::DoLogging);
@@ -121,6 +222,12 @@ PUBLIC STATIC void SourceFileMap::CheckForUpdate() {
         return;
     }
 
+    // The order files are listed in depends on the file system, but the
+    // output shouldn't
+    std::sort(list.begin(), list.end(), [](const char* a, const char* b) -> bool {
+        return strcmp(a, b) < 0;
+    });
+
     if (!Directory::Exists("Resources/Objects")) {
         Directory::Create("Resources/Objects");
         anyChanges = true;
@@ -153,38 +260,76 @@ PUBLIC STATIC void SourceFileMap::CheckForUpdate() {
     const char* scriptFolderPath = scriptFolderPathStr.c_str();
     size_t scriptFolderPathLen = strlen(scriptFolderPath);
 
+    double ticks = Clock::GetTicks();
+    size_t readCount = 0;
+
+    vector<CompileJob> jobs;
     for (size_t i = 0; i < list.size(); i++) {
         char* filename = strrchr(list[i], '/');
         Uint32 filenameHash = 0;
         if (filename)
             filenameHash = ScriptManager::MakeFilenameHash(list[i] + scriptFolderNameLen + 1);
-        if (!filenameHash) {
-            Memory::Free(list[i]);
+        if (!filenameHash)
             continue;
-        }
 
         Uint32 newChecksum = 0;
         Uint32 oldChecksum = 0;
         bool doRecompile = false;
 
-        char*  source;
-        File::ReadAllBytes(list[i], &source);
-        newChecksum = Murmur::EncryptString(source);
-
-        Memory::Track(source, "SourceFileMap::SourceText");
-
         if (SourceFileMap::Checksums->Exists(filenameHash)) {
             oldChecksum = SourceFileMap::Checksums->Get(filenameHash);
         }
+
+        // Files that are the same size and were last modified at the same
+        // time as when they were hashed aren't read again
+        size_t size = 0;
+        Sint64 modifiedTime = 0;
+        bool hasInfo = File::GetInfo(list[i], &size, &modifiedTime);
+
+        char*  source = NULL;
+        auto stamp = Stamps.find(filenameHash);
+        if (hasInfo && stamp != Stamps.end()
+            && stamp->second.Size == size
+            && stamp->second.ModifiedTime == modifiedTime
+            && stamp->second.Checksum == oldChecksum) {
+            newChecksum = oldChecksum;
+        }
+        else {
+            File::ReadAllBytes(list[i], &source);
+            if (!source)
+                continue;
+            newChecksum = Murmur::EncryptString(source);
+            readCount++;
+
+            Memory::Track(source, "SourceFileMap::SourceText");
+
+            SourceFileStamp newStamp;
+            newStamp.Size = size;
+            newStamp.ModifiedTime = modifiedTime;
+            newStamp.Checksum = newChecksum;
+            // A file modified this recently could change again without its
+            // modified time changing, so it's hashed next time too
+            if (hasInfo && (Sint64)time(NULL) * 1000000000 - modifiedTime > STAMPS_MIN_AGE)
+                Stamps[filenameHash] = newStamp;
+            else
+                Stamps.erase(filenameHash);
+            StampsChanged = true;
+        }
+
         doRecompile = newChecksum != oldChecksum;
         anyChanges |= doRecompile;
 
-        char outFile[35];
-        snprintf(outFile, sizeof outFile, "Resources/Objects/%08X.ibc", filenameHash);
+        CompileJob job;
+        snprintf(job.OutFile, sizeof job.OutFile, "Resources/Objects/%08X.ibc", filenameHash);
 
         // If changed, then compile.
-        if (doRecompile || !File::Exists(outFile)) {
-            Compiler::PrepareCompiling();
+        if (doRecompile || !File::Exists(job.OutFile)) {
+            if (!source) {
+                File::ReadAllBytes(list[i], &source);
+                if (!source)
+                    continue;
+                Memory::Track(source, "SourceFileMap::SourceText");
+            }
 
             char* scriptFilename = list[i];
             if (StringUtils::StartsWith(scriptFilename, scriptFolderPath))
@@ -197,33 +342,14 @@ PUBLIC STATIC void SourceFileMap::CheckForUpdate() {
                     Log::Print(Log::LOG_VERBOSE, "Compiling %s...", scriptFilename);
             }
 
-            Compiler* compiler = new Compiler;
-            compiler->Compile(scriptFilename, source, outFile);
-
-            // Add this file to the list
-            // Log::Print(Log::LOG_INFO, "filename: %s (0x%08X)", filename, filenameHash);
-            for (size_t h = 0; h < compiler->ClassHashList.size(); h++) {
-                Uint32 classHash = compiler->ClassHashList[h];
-                Uint32 classExtended = compiler->ClassExtendedList[h];
-                if (SourceFileMap::ClassMap->Exists(classHash)) {
-                    vector<Uint32>* filenameHashList = SourceFileMap::ClassMap->Get(classHash);
-                    if (std::count(filenameHashList->begin(), filenameHashList->end(), filenameHash) == 0) {
-                        // NOTE: We need a better way of sorting
-                        if (classExtended == 0)
-                            filenameHashList->insert(filenameHashList->begin(), filenameHash);
-                        else if (classExtended == 1)
-                            filenameHashList->push_back(filenameHash);
-                    }
-                }
-                else {
-                    vector<Uint32>* filenameHashList = new vector<Uint32>();
-                    filenameHashList->push_back(filenameHash);
-                    SourceFileMap::ClassMap->Put(classHash, filenameHashList);
-                }
-            }
-
-            delete compiler;
-            Compiler::FinishCompiling();
+            job.Filename = scriptFilename;
+            job.FilenameHash = filenameHash;
+            job.Source = source;
+            job.Compiled = false;
+            job.Objects.First = NULL;
+            job.Objects.Size = 0;
+            jobs.push_back(job);
+            source = NULL;
         }
 
         Memory::Free(source);
@@ -231,50 +357,121 @@ PUBLIC STATIC void SourceFileMap::CheckForUpdate() {
         // Log::Print(Log::LOG_INFO, "List: %s (%08X) (old: %08X, new: %08X) %d", list[i], filenameHash, oldChecksum, newChecksum, false);
 
         SourceFileMap::Checksums->Put(filenameHash, newChecksum);
-        Memory::Free(list[i]);
     }
 
-    if (anyChanges) {
-        FileStream* stream;
-        // SourceFileMap.bin
-        stream = FileStream::New("SourceFileMap.bin", FileStream::WRITE_ACCESS);
-        if (stream) {
-            Uint8* data = SourceFileMap::Checksums->GetBytes(true);
-            stream->WriteBytes(data, SourceFileMap::Checksums->Count * (sizeof(Uint32) + sizeof(Uint32)));
-            Memory::Free(data);
+    if (jobs.size()) {
+        double compileTicks = Clock::GetTicks();
+        WorkerPool::ParallelFor(CompileJobs, jobs.data(), (Uint32)jobs.size(), 1);
+        compileTicks = Clock::GetTicks() - compileTicks;
 
-            stream->WriteUInt32(SourceFileMap::DirectoryChecksum);
+        // Classes are added in the order the files are listed in, not the
+        // order they finished compiling in
+        for (size_t i = 0; i < jobs.size(); i++) {
+            CompileJob* job = &jobs[i];
 
-            stream->Close();
-        }
+            // Compile it again here to report the error like it would have
+            // been before compiling in parallel. The workers don't log
+            // errors, so it's only reported once.
+            if (!job->Compiled)
+                CompileFile(job, true);
+            AttachObjects(&job->Objects);
 
-        // Objects.hcm
-        stream = FileStream::New("Resources/Objects/Objects.hcm", FileStream::WRITE_ACCESS);
-        if (stream) {
-            stream->WriteUInt32(SourceFileMap::Magic);
-            stream->WriteByte(0x00); // Version
-            stream->WriteByte(0x01); // Version
-            stream->WriteByte(0x02); // Version
-            stream->WriteByte(0x03); // Version
-
-            stream->WriteUInt32((Uint32)SourceFileMap::ClassMap->Count); // Count
-            SourceFileMap::ClassMap->WithAll([stream](Uint32 hash, vector<Uint32>* list) -> void {
-                stream->WriteUInt32(hash); // ClassHash
-                stream->WriteUInt32((Uint32)list->size()); // Count
-                for (size_t fn = 0; fn < list->size(); fn++) {
-                    stream->WriteUInt32((*list)[fn]);
-                }
-            });
+            // The data folder was indexed before this file was written
+            if (job->Compiled)
+                ResourceManager::AddToDataFolderIndex(job->OutFile);
 
-            stream->Close();
+            // Add this file to the list
+            SourceFileMap::AddClasses(job->FilenameHash, job->ClassHashes, job->ClassExtended);
+
+            Memory::Free(job->Source);
         }
+
+        Log::Print(Log::LOG_VERBOSE, "Compiled %d script(s) in %.3f ms on %d thread(s)", (int)jobs.size(), compileTicks, WorkerPool::GetThreadCount() + 1);
     }
 
+    Log::Print(Log::LOG_VERBOSE, "Checked %d script(s) for changes in %.3f ms, reading %d of them", (int)list.size(), Clock::GetTicks() - ticks, (int)readCount);
+
+    for (size_t i = 0; i < list.size(); i++)
+        Memory::Free(list[i]);
+
+    if (anyChanges)
+        SourceFileMap::Save();
+    else
+        SaveStamps();
+
     list.clear();
     list.shrink_to_fit();
 
     #endif
 }
+// Records which classes a compiled file defines or extends.
+PUBLIC STATIC void SourceFileMap::AddClasses(Uint32 filenameHash, vector<Uint32>& classHashes, vector<Uint32>& classExtended) {
+    for (size_t h = 0; h < classHashes.size(); h++) {
+        Uint32 classHash = classHashes[h];
+        if (SourceFileMap::ClassMap->Exists(classHash)) {
+            vector<Uint32>* filenameHashList = SourceFileMap::ClassMap->Get(classHash);
+            if (std::count(filenameHashList->begin(), filenameHashList->end(), filenameHash) == 0) {
+                // NOTE: We need a better way of sorting
+                if (classExtended[h] == 0)
+                    filenameHashList->insert(filenameHashList->begin(), filenameHash);
+                else if (classExtended[h] == 1)
+                    filenameHashList->push_back(filenameHash);
+            }
+        }
+        else {
+            vector<Uint32>* filenameHashList = new vector<Uint32>();
+            filenameHashList->push_back(filenameHash);
+            SourceFileMap::ClassMap->Put(classHash, filenameHashList);
+        }
+    }
+}
+// Writes the checksums and the class map.
+PUBLIC STATIC void SourceFileMap::Save() {
+    FileStream* stream;
+    // SourceFileMap.bin
+    stream = FileStream::New("SourceFileMap.bin", FileStream::WRITE_ACCESS);
+    if (stream) {
+        Uint8* data = SourceFileMap::Checksums->GetBytes(true);
+        stream->WriteBytes(data, SourceFileMap::Checksums->Count * (sizeof(Uint32) + sizeof(Uint32)));
+        Memory::Free(data);
+
+        stream->WriteUInt32(SourceFileMap::DirectoryChecksum);
+
+        stream->Close();
+    }
+
+    // Objects.hcm
+    stream = FileStream::New("Resources/Objects/Objects.hcm", FileStream::WRITE_ACCESS);
+    if (stream) {
+        stream->WriteUInt32(SourceFileMap::Magic);
+        stream->WriteByte(0x00); // Version
+        stream->WriteByte(0x01); // Version
+        stream->WriteByte(0x02); // Version
+        stream->WriteByte(0x03); // Version
+
+        // Sorted by class, so that the file only changes when the classes do
+        vector<std::pair<Uint32, vector<Uint32>*>> classes;
+        SourceFileMap::ClassMap->WithAll([&classes](Uint32 hash, vector<Uint32>* list) -> void {
+            classes.push_back(std::make_pair(hash, list));
+        });
+        std::sort(classes.begin(), classes.end());
+
+        stream->WriteUInt32((Uint32)classes.size()); // Count
+        for (size_t c = 0; c < classes.size(); c++) {
+            vector<Uint32>* list = classes[c].second;
+            stream->WriteUInt32(classes[c].first); // ClassHash
+            stream->WriteUInt32((Uint32)list->size()); // Count
+            for (size_t fn = 0; fn < list->size(); fn++) {
+                stream->WriteUInt32((*list)[fn]);
+            }
+        }
+
+        stream->Close();
+        ResourceManager::AddToDataFolderIndex("Resources/Objects/Objects.hcm");
+    }
+
+    SaveStamps();
+}
 
 PUBLIC STATIC void SourceFileMap::Dispose() {
     if (SourceFileMap::Checksums) {
@@ -289,6 +486,8 @@ PUBLIC STATIC void SourceFileMap::Dispose() {
         delete SourceFileMap::ClassMap;
     }
 
+    Stamps.clear();
+
     SourceFileMap::Initialized = false;
     SourceFileMap::Checksums = NULL;
     SourceFileMap::ClassMap = NULL;
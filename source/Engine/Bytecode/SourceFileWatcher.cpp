@@ -0,0 +1,378 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class SourceFileWatcher {
+public:
+    static bool Enabled;
+    // How often the Scripts folder is checked for changes where it can't be
+    // watched, in milliseconds
+    static int  PollInterval;
+};
+#endif
+
+#include <Engine/Bytecode/SourceFileWatcher.h>
+#include <Engine/Application.h>
+#include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/SourceFileMap.h>
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Filesystem/File.h>
+#include <Engine/Hashing/Murmur.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Utilities/StringUtils.h>
+
+#if LINUX
+    #define USING_INOTIFY
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+// Recompiles scripts as they're saved, so that changes show up without
+// restarting the game. Compiling happens on a thread of its own; the new
+// bytecode is run at the end of the frame, after every object has updated,
+// which merges it into the classes that are already loaded. Instances keep
+// their fields and call the new methods from then on. A script that doesn't
+// compile is left as it was.
+
+#define SCRIPT_FOLDER "Scripts"
+
+// Changes that come in this close together are compiled together, since
+// editors often write a file more than once when saving it
+#define SETTLE_TIME 50
+
+struct ReloadedScript {
+    char*             Filename;
+    Uint32            FilenameHash;
+    Uint32            Checksum;
+    // NULL if the script didn't compile
+    Uint8*            Bytecode;
+    size_t            BytecodeSize;
+    vector<Uint32>    ClassHashes;
+    vector<Uint32>    ClassExtended;
+    DetachedObjects   Objects;
+};
+
+bool SourceFileWatcher::Enabled = true;
+int  SourceFileWatcher::PollInterval = 500;
+
+static SDL_Thread*              Thread = NULL;
+static SDL_atomic_t             Quit;
+static SDL_mutex*               Lock = NULL;
+static vector<ReloadedScript*>  Reloaded;
+
+// Only touched by the thread once it's started
+static map<Uint32, Uint32>      Checksums;
+static map<string, Sint64>      ModifiedTimes;
+
+static void FreeScript(ReloadedScript* script) {
+    Memory::Free(script->Bytecode);
+    Memory::Free(script->Filename);
+    delete script;
+}
+
+static void CompileScript(const char* path) {
+    if (!StringUtils::StartsWith(path, SCRIPT_FOLDER "/"))
+        return;
+
+    const char* scriptFilename = path + strlen(SCRIPT_FOLDER "/");
+    Uint32 filenameHash = ScriptManager::MakeFilenameHash((char*)scriptFilename);
+    if (!filenameHash)
+        return;
+
+    char* source = NULL;
+    File::ReadAllBytes(path, &source);
+    if (!source)
+        return;
+
+    // Saving without changing anything doesn't need a reload
+    Uint32 checksum = Murmur::EncryptString(source);
+    auto it = Checksums.find(filenameHash);
+    if (it != Checksums.end() && it->second == checksum) {
+        Memory::Free(source);
+        return;
+    }
+    Checksums[filenameHash] = checksum;
+
+    double ticks = Clock::GetTicks();
+
+    char outFile[35];
+    char tempFile[40];
+    snprintf(outFile, sizeof outFile, "Resources/Objects/%08X.ibc", filenameHash);
+    snprintf(tempFile, sizeof tempFile, "%s.tmp", outFile);
+
+    ReloadedScript* script = new ReloadedScript();
+    script->Filename = StringUtils::Duplicate(scriptFilename);
+    script->FilenameHash = filenameHash;
+    script->Checksum = checksum;
+    script->Bytecode = NULL;
+    script->BytecodeSize = 0;
+    script->Objects.First = NULL;
+    script->Objects.Size = 0;
+
+    // The compiler makes strings and functions, which the garbage collector
+    // must not find until the main thread is ready for them
+    DetachObjectAllocations(&script->Objects);
+    Compiler::PrepareCompiling();
+
+    // Half-written scripts are common while editing, so errors are only
+    // logged
+    Compiler::ExitOnError = false;
+
+    Compiler* compiler = new Compiler;
+    bool compiled = compiler->Compile(script->Filename, source, tempFile);
+    script->ClassHashes = compiler->ClassHashList;
+    script->ClassExtended = compiler->ClassExtendedList;
+    delete compiler;
+
+    Compiler::FinishCompiling();
+    Compiler::ExitOnError = true;
+    DetachObjectAllocations(NULL);
+    Memory::Free(source);
+
+    // The old bytecode stays on the disk until the new one is good
+    if (compiled) {
+        remove(outFile);
+        compiled = rename(tempFile, outFile) == 0;
+        if (compiled)
+            ResourceManager::AddToDataFolderIndex(outFile);
+    }
+    if (!compiled)
+        remove(tempFile);
+
+    if (compiled) {
+        FileStream* stream = FileStream::New(outFile, FileStream::READ_ACCESS);
+        if (stream) {
+            script->BytecodeSize = stream->Length();
+            script->Bytecode = (Uint8*)Memory::TrackedMalloc("Bytecode::Data", script->BytecodeSize);
+            stream->ReadBytes(script->Bytecode, script->BytecodeSize);
+            stream->Close();
+        }
+        Log::Print(Log::LOG_VERBOSE, "Compiled %s in %.3f ms", script->Filename, Clock::GetTicks() - ticks);
+    }
+    else {
+        Log::Print(Log::LOG_WARN, "Could not compile %s, keeping the version that's running.", script->Filename);
+    }
+
+    SDL_LockMutex(Lock);
+    Reloaded.push_back(script);
+    SDL_UnlockMutex(Lock);
+}
+static void CompileScripts(vector<string>& paths) {
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    for (size_t i = 0; i < paths.size(); i++)
+        CompileScript(paths[i].c_str());
+    paths.clear();
+}
+
+#ifdef USING_INOTIFY
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR)
+
+static map<int, string> WatchedFolders;
+
+static void AddWatches(int fd, const char* path) {
+    int wd = inotify_add_watch(fd, path, WATCH_MASK);
+    if (wd >= 0)
+        WatchedFolders[wd] = path;
+
+    // Directory::GetDirectories doesn't recurse into folders of folders
+    vector<char*> folders;
+    Directory::GetDirectories(&folders, path, "*", false);
+    for (size_t i = 0; i < folders.size(); i++) {
+        AddWatches(fd, folders[i]);
+        free(folders[i]);
+    }
+}
+// Reads what changed into paths. Returns false if nothing did before the
+// timeout.
+static bool ReadEvents(int fd, int timeout, vector<string>& paths) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout) <= 0)
+        return false;
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof buffer)) > 0) {
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            struct inotify_event* event = (struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            auto folder = WatchedFolders.find(event->wd);
+            if (folder == WatchedFolders.end() || !event->len)
+                continue;
+
+            string path = folder->second + "/" + event->name;
+            if (event->mask & IN_ISDIR) {
+                AddWatches(fd, path.c_str());
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                if (StringUtils::WildcardMatch(event->name, "*.hsl"))
+                    paths.push_back(path);
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+// Finds scripts whose size or modified time changed since the last call.
+// The first call only takes note of them.
+static void CheckModifiedTimes(vector<string>& paths, bool firstCheck) {
+    vector<char*> list;
+    Directory::GetFiles(&list, SCRIPT_FOLDER, "*.hsl", true);
+    for (size_t i = 0; i < list.size(); i++) {
+        size_t size;
+        Sint64 modifiedTime;
+        if (File::GetInfo(list[i], &size, &modifiedTime)) {
+            Sint64 stamp = modifiedTime ^ (Sint64)size;
+            auto it = ModifiedTimes.find(list[i]);
+            if (it == ModifiedTimes.end()) {
+                ModifiedTimes[list[i]] = stamp;
+                if (!firstCheck)
+                    paths.push_back(list[i]);
+            }
+            else if (it->second != stamp) {
+                it->second = stamp;
+                paths.push_back(list[i]);
+            }
+        }
+        free(list[i]);
+    }
+}
+
+static int WatchThread(void* data) {
+    vector<string> paths;
+
+#ifdef USING_INOTIFY
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0) {
+        AddWatches(fd, SCRIPT_FOLDER);
+        while (!SDL_AtomicGet(&Quit)) {
+            if (!ReadEvents(fd, 250, paths))
+                continue;
+            while (ReadEvents(fd, SETTLE_TIME, paths));
+            CompileScripts(paths);
+        }
+        close(fd);
+        WatchedFolders.clear();
+        return 0;
+    }
+    Log::Print(Log::LOG_WARN, "Could not watch \"%s\" for changes, checking it every %d ms instead.", SCRIPT_FOLDER, SourceFileWatcher::PollInterval);
+#endif
+
+    CheckModifiedTimes(paths, true);
+    while (!SDL_AtomicGet(&Quit)) {
+        for (int waited = 0; waited < SourceFileWatcher::PollInterval && !SDL_AtomicGet(&Quit); waited += SETTLE_TIME)
+            SDL_Delay(SETTLE_TIME);
+
+        CheckModifiedTimes(paths, false);
+        if (paths.size()) {
+            SDL_Delay(SETTLE_TIME);
+            CompileScripts(paths);
+        }
+    }
+    ModifiedTimes.clear();
+    return 0;
+}
+
+// Starts watching the Scripts folder, if there is one.
+PUBLIC STATIC void SourceFileWatcher::Init() {
+    #ifndef NO_SCRIPT_COMPILING
+    Application::Settings->GetBool("compiler", "hotReload", &SourceFileWatcher::Enabled);
+    Application::Settings->GetInteger("compiler", "hotReloadPollInterval", &SourceFileWatcher::PollInterval);
+    if (SourceFileWatcher::PollInterval < SETTLE_TIME)
+        SourceFileWatcher::PollInterval = SETTLE_TIME;
+
+    if (!SourceFileWatcher::Enabled || Thread)
+        return;
+    if (!Directory::Exists(SCRIPT_FOLDER) || !SourceFileMap::Checksums)
+        return;
+
+    Checksums.clear();
+    SourceFileMap::Checksums->WithAll([](Uint32 hash, Uint32 checksum) -> void {
+        Checksums[hash] = checksum;
+    });
+
+    if (!Lock)
+        Lock = SDL_CreateMutex();
+
+    SDL_AtomicSet(&Quit, 0);
+    Thread = SDL_CreateThread(WatchThread, "ScriptWatcher", NULL);
+    if (!Thread) {
+        Log::Print(Log::LOG_WARN, "Could not start watching scripts for changes: %s", SDL_GetError());
+        return;
+    }
+    Log::Print(Log::LOG_VERBOSE, "Watching \"%s\" for changes.", SCRIPT_FOLDER);
+    #endif
+}
+
+// Runs the scripts that were recompiled since the last call. Must be called
+// on the main thread while no script is running.
+PUBLIC STATIC void SourceFileWatcher::Update() {
+    if (!Thread)
+        return;
+
+    vector<ReloadedScript*> scripts;
+    SDL_LockMutex(Lock);
+    scripts.swap(Reloaded);
+    SDL_UnlockMutex(Lock);
+
+    bool anyChanges = false;
+    for (size_t i = 0; i < scripts.size(); i++) {
+        ReloadedScript* script = scripts[i];
+
+        AttachObjects(&script->Objects);
+
+        if (script->Bytecode) {
+            SourceFileMap::AddClasses(script->FilenameHash, script->ClassHashes, script->ClassExtended);
+            SourceFileMap::Checksums->Put(script->FilenameHash, script->Checksum);
+            anyChanges = true;
+
+            BytecodeContainer bytecode;
+            bytecode.Data = script->Bytecode;
+            bytecode.Size = script->BytecodeSize;
+
+            // Scripts that aren't loaded yet will be read from the disk when
+            // they are
+            if (ScriptManager::ReloadScript(script->FilenameHash, bytecode)) {
+                script->Bytecode = NULL;
+                Log::Print(Log::LOG_INFO, "Reloaded %s", script->Filename);
+            }
+        }
+
+        FreeScript(script);
+    }
+
+    if (anyChanges)
+        SourceFileMap::Save();
+}
+
+PUBLIC STATIC void SourceFileWatcher::Dispose() {
+    if (Thread) {
+        SDL_AtomicSet(&Quit, 1);
+        SDL_WaitThread(Thread, NULL);
+        Thread = NULL;
+    }
+
+    for (size_t i = 0; i < Reloaded.size(); i++) {
+        AttachObjects(&Reloaded[i]->Objects);
+        FreeScript(Reloaded[i]);
+    }
+    Reloaded.clear();
+    Checksums.clear();
+
+    if (Lock) {
+        SDL_DestroyMutex(Lock);
+        Lock = NULL;
+    }
+}
@@ -16,6 +16,7 @@ public:
 #include <Engine/Scene.h>
 #include <Engine/Audio/AudioManager.h>
 #include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Bytecode/ScriptJobs.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Compiler.h>
 #include <Engine/Bytecode/Values.h>
@@ -42,6 +43,8 @@ public:
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/SceneFormats/RSDKSceneReader.h>
+#include <Engine/ResourceTypes/AsyncLoader.h>
+#include <Engine/ResourceTypes/ResourceCache.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/ResourceTypes/ResourceType.h>
 #include <Engine/Scene/SceneEnums.h>
@@ -49,6 +52,7 @@ public:
 #include <Engine/TextFormats/JSON/jsmn.h>
 #include <Engine/Utilities/ColorUtils.h>
 #include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
 
 
 #ifdef USING_FREETYPE
@@ -5428,7 +5432,7 @@ struct _HTTP_Bundle {
     char* filename;
     ObjBoundMethod callback;
 };
-int _HTTP_GetToFile(void* opaque) {
+void _HTTP_GetToFile(void* opaque) {
     _HTTP_Bundle* bundle = (_HTTP_Bundle*)opaque;
 
     size_t length;
@@ -5446,7 +5450,6 @@ int _HTTP_GetToFile(void* opaque) {
         Memory::Free(data);
     }
     free(bundle);
-    return 0;
 }
 
 /***
@@ -5498,12 +5501,9 @@ VMValue HTTP_GetToFile(int argCount, VMValue* args, Uint32 threadID) {
     strcpy(bundle->url, url);
     strcpy(bundle->filename, filename);
 
-    if (blocking) {
+    // Without workers, it can't be done in the background
+    if (blocking || !WorkerPool::QueueJob(_HTTP_GetToFile, bundle))
         _HTTP_GetToFile(bundle);
-    }
-    else {
-        SDL_CreateThread(_HTTP_GetToFile, "HTTP.GetToFile", bundle);
-    }
     return NULL_VAL;
 }
 // #endregion
@@ -8405,6 +8405,8 @@ VMValue Resources_LoadSprite(int argCount, VMValue* args, Uint32 threadID) {
     vector<ResourceType*>* list = &Scene::SpriteList;
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
+    if (ResourceCache::Revive(ResourceCache::CACHE_SPRITE, resource))
+        return INTEGER_VAL((int)index);
 
     resource->AsSprite = new (std::nothrow) ISprite(filename);
     if (resource->AsSprite->LoadFailed) {
@@ -8435,6 +8437,8 @@ VMValue Resources_LoadImage(int argCount, VMValue* args, Uint32 threadID) {
     vector<ResourceType*>* list = &Scene::ImageList;
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
+    if (ResourceCache::Revive(ResourceCache::CACHE_IMAGE, resource))
+        return INTEGER_VAL((int)index);
 
     resource->AsImage = new (std::nothrow) Image(filename);
     if (!resource->AsImage->TexturePtr) {
@@ -8468,6 +8472,8 @@ VMValue Resources_LoadFont(int argCount, VMValue* args, Uint32 threadID) {
     vector<ResourceType*>* list = &Scene::SpriteList;
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
+    if (ResourceCache::Revive(ResourceCache::CACHE_SPRITE, resource))
+        return INTEGER_VAL((int)index);
 
     ResourceStream* stream = ResourceStream::New(filename);
     if (!stream) {
@@ -8500,6 +8506,8 @@ VMValue Resources_LoadModel(int argCount, VMValue* args, Uint32 threadID) {
     vector<ResourceType*>* list = &Scene::ModelList;
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
+    if (ResourceCache::Revive(ResourceCache::CACHE_MODEL, resource))
+        return INTEGER_VAL((int)index);
 
     ResourceStream* stream = ResourceStream::New(filename);
     if (!stream) {
@@ -8571,6 +8579,8 @@ VMValue Resources_LoadSound(int argCount, VMValue* args, Uint32 threadID) {
     vector<ResourceType*>* list = &Scene::SoundList;
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
+    if (ResourceCache::Revive(ResourceCache::CACHE_SOUND, resource))
+        return INTEGER_VAL((int)index);
 
     resource->AsSound = new (std::nothrow) ISound(filename);
     if (resource->AsSound->LoadFailed) {
@@ -8581,6 +8591,208 @@ VMValue Resources_LoadSound(int argCount, VMValue* args, Uint32 threadID) {
     }
     return INTEGER_VAL((int)index);
 }
+/***
+ * Resources.LoadSpriteAsync
+ * \desc Starts loading a Sprite resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Sprite index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadSpriteAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* filename = GET_ARG(0, GetString);
+    int unloadPolicy = GET_ARG(1, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_SPRITE, filename, unloadPolicy, 0));
+}
+/***
+ * Resources.LoadImageAsync
+ * \desc Starts loading a Image resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Image index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadImageAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* filename = GET_ARG(0, GetString);
+    int unloadPolicy = GET_ARG(1, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_IMAGE, filename, unloadPolicy, 0));
+}
+/***
+ * Resources.LoadFontAsync
+ * \desc Starts loading a Font resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Font index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param pixelSize (Number):
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadFontAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(3);
+    char* filename = GET_ARG(0, GetString);
+    int pixelSize = (int)GET_ARG(1, GetDecimal);
+    int unloadPolicy = GET_ARG(2, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_FONT, filename, unloadPolicy, pixelSize));
+}
+/***
+ * Resources.LoadModelAsync
+ * \desc Starts loading a Model resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Model index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadModelAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* filename = GET_ARG(0, GetString);
+    int unloadPolicy = GET_ARG(1, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_MODEL, filename, unloadPolicy, 0));
+}
+/***
+ * Resources.LoadMusicAsync
+ * \desc Starts loading a Music resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Music index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadMusicAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* filename = GET_ARG(0, GetString);
+    int unloadPolicy = GET_ARG(1, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_MUSIC, filename, unloadPolicy, 0));
+}
+/***
+ * Resources.LoadSoundAsync
+ * \desc Starts loading a Sound resource in the background, and returns right away. Use <linkto ref="Resources.GetAsyncLoadResult">Resources.GetAsyncLoadResult</linkto> to get its Sound index once it's done.
+ * \param filename (String): Filename of the resource.
+ * \param unloadPolicy (Integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return Returns a handle for the load.
+ * \ns Resources
+ */
+VMValue Resources_LoadSoundAsync(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* filename = GET_ARG(0, GetString);
+    int unloadPolicy = GET_ARG(1, GetInteger);
+    return INTEGER_VAL(AsyncLoader::Load(AsyncLoader::LOAD_SOUND, filename, unloadPolicy, 0));
+}
+/***
+ * Resources.GetAsyncLoadProgress
+ * \desc Gets how far along a background load is. Without a handle, gets how far along every background load started since the last time none were left is.
+ * \paramOpt handle (Integer): The handle returned by a <code>Resources.Load*Async</code> function.
+ * \return Returns a Decimal value between <code>0.0</code> and <code>1.0</code>.
+ * \ns Resources
+ */
+VMValue Resources_GetAsyncLoadProgress(int argCount, VMValue* args, Uint32 threadID) {
+    if (argCount == 0)
+        return DECIMAL_VAL(AsyncLoader::GetProgress());
+
+    CHECK_ARGCOUNT(1);
+    int handle = GET_ARG(0, GetInteger);
+    return DECIMAL_VAL(AsyncLoader::GetProgress(handle));
+}
+/***
+ * Resources.GetAsyncLoadResult
+ * \desc Gets the resource index of a finished background load. Loading the same resource again before it's finished returns the same handle, which then has to be read once for each time it was returned. After its last read, the handle stays valid until the next frame, after which another load may get it; reading it then throws an error.
+ * \param handle (Integer): The handle returned by a <code>Resources.Load*Async</code> function.
+ * \return Returns the index of the Resource, <code>-1</code> if it couldn't be loaded, or <code>null</code> if it's still loading.
+ * \ns Resources
+ */
+VMValue Resources_GetAsyncLoadResult(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int handle = GET_ARG(0, GetInteger);
+
+    int index;
+    switch (AsyncLoader::GetResult(handle, &index)) {
+        case AsyncLoader::RESULT_LOADING:
+            return NULL_VAL;
+        case AsyncLoader::RESULT_INVALID:
+            THROW_ERROR("Background load handle %d is not valid.", handle);
+            return NULL_VAL;
+    }
+    return INTEGER_VAL(index);
+}
+/***
+ * Resources.GetPendingAsyncLoads
+ * \desc Gets how many background loads haven't finished yet.
+ * \return Returns an Integer value.
+ * \ns Resources
+ */
+VMValue Resources_GetPendingAsyncLoads(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    return INTEGER_VAL(AsyncLoader::GetPendingCount());
+}
+static void Resources_PutCacheStat(ObjMap* map, const char* key, Uint64 value) {
+    // Sizes of 2 GB and up don't fit in an integer
+    if (value > INT_MAX)
+        value = INT_MAX;
+
+    Uint32 keyHash = map->Keys->HashFunction(key, strlen(key));
+    map->Keys->Put(keyHash, StringUtils::Duplicate(key));
+    map->Values->Put(keyHash, INTEGER_VAL((int)value));
+}
+/***
+ * Resources.GetCacheStats
+ * \desc Gets statistics about the cache of unloaded resources. The map has the keys <code>budget</code>, <code>bytes</code>, <code>count</code>, <code>hits</code>, <code>misses</code>, <code>evictions</code>, <code>spriteBytes</code>, <code>imageBytes</code>, <code>soundBytes</code> and <code>modelBytes</code>. Hits, misses and evictions are counted since the game started. Values too big for an Integer are clamped to the largest Integer.
+ * \return Returns a Map value.
+ * \ns Resources
+ */
+VMValue Resources_GetCacheStats(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    if (ScriptManager::Lock()) {
+        ObjMap* map = NewMap();
+        Resources_PutCacheStat(map, "budget", ResourceCache::Budget);
+        Resources_PutCacheStat(map, "bytes", ResourceCache::GetSize());
+        Resources_PutCacheStat(map, "count", ResourceCache::GetCount());
+        Resources_PutCacheStat(map, "hits", ResourceCache::Hits);
+        Resources_PutCacheStat(map, "misses", ResourceCache::Misses);
+        Resources_PutCacheStat(map, "evictions", ResourceCache::Evictions);
+        Resources_PutCacheStat(map, "spriteBytes", ResourceCache::GetSize(ResourceCache::CACHE_SPRITE));
+        Resources_PutCacheStat(map, "imageBytes", ResourceCache::GetSize(ResourceCache::CACHE_IMAGE));
+        Resources_PutCacheStat(map, "soundBytes", ResourceCache::GetSize(ResourceCache::CACHE_SOUND));
+        Resources_PutCacheStat(map, "modelBytes", ResourceCache::GetSize(ResourceCache::CACHE_MODEL));
+        ScriptManager::Unlock();
+        return OBJECT_VAL(map);
+    }
+    return NULL_VAL;
+}
+/***
+ * Resources.SetCacheBudget
+ * \desc Sets how many bytes the cache of unloaded resources can hold. Resources with a scene unload policy are kept in the cache when the scene changes, and loading them again takes them back out. A budget of <code>0</code> disables the cache.
+ * \param bytes (Integer): The budget, in bytes.
+ * \ns Resources
+ */
+VMValue Resources_SetCacheBudget(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int bytes = GET_ARG(0, GetInteger);
+    if (bytes < 0) {
+        OUT_OF_RANGE_ERROR("Budget", bytes, 0, INT_MAX);
+        return NULL_VAL;
+    }
+    ResourceCache::SetBudget((size_t)bytes);
+    return NULL_VAL;
+}
+/***
+ * Resources.ClearCache
+ * \desc Disposes every resource in the cache of unloaded resources.
+ * \ns Resources
+ */
+VMValue Resources_ClearCache(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    ResourceCache::Clear();
+    return NULL_VAL;
+}
+/***
+ * Resources.RefreshIndex
+ * \desc Lists the Resources folder again, so that files added, removed or renamed in it since the game started can be found. This is only needed on platforms where the engine can't notice those changes by itself.
+ * \ns Resources
+ */
+VMValue Resources_RefreshIndex(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    ResourceManager::RefreshDataFolderIndex();
+    return NULL_VAL;
+}
 /***
  * Resources.LoadVideo
  * \desc Loads a Video resource, returning its Video index.
@@ -11843,6 +12055,8 @@ VMValue SocketClient_Open(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(1);
     char* url = GET_ARG(0, GetString);
 
+    if (client)
+        WebSocketClient::CloseAndDelete(client);
     client = WebSocketClient::New(url);
     if (!client)
         return INTEGER_VAL(false);
@@ -11860,7 +12074,8 @@ VMValue SocketClient_Close(int argCount, VMValue* args, Uint32 threadID) {
     if (!client)
         return NULL_VAL;
 
-    client->Close();
+    // The client is deleted once the close has been sent
+    WebSocketClient::CloseAndDelete(client);
     client = NULL;
 
     return NULL_VAL;
@@ -11873,7 +12088,7 @@ VMValue SocketClient_Close(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue SocketClient_IsOpen(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(0);
-    if (!client || client->readyState != WebSocketClient::OPEN)
+    if (!client || client->GetReadyState() != WebSocketClient::OPEN)
         return INTEGER_VAL(false);
 
     return INTEGER_VAL(true);
@@ -12331,6 +12546,36 @@ VMValue Sound_IsChannelFree(int argCount, VMValue* args, Uint32 threadID) {
     }
     return INTEGER_VAL(AudioManager::AudioIsPlaying(channel % AudioManager::SoundArrayLength));
 }
+/***
+ * Sound.SetMaxInstances
+ * \desc Limits how many channels can play a sound at once. Playing it past the limit replaces the channel that has been playing it the longest.
+ * \param sound (Integer): The sound index.
+ * \param count (Integer): The most channels that can play it, or <code>0</code> for no limit.
+ * \ns Sound
+ */
+VMValue Sound_SetMaxInstances(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    ISound* audio = GET_ARG(0, GetSound);
+    int count = GET_ARG(1, GetInteger);
+    if (audio)
+        audio->MaxInstances = count < 0 ? 0 : count;
+    return NULL_VAL;
+}
+/***
+ * Sound.SetPriority
+ * \desc Sets the priority of a sound. When too many sounds are playing, a new one replaces the oldest sound with the lowest priority, and is dropped if every sound playing has a higher priority than it.
+ * \param sound (Integer): The sound index.
+ * \param priority (Integer): The priority. (0 is the default.)
+ * \ns Sound
+ */
+VMValue Sound_SetPriority(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    ISound* audio = GET_ARG(0, GetSound);
+    int priority = GET_ARG(1, GetInteger);
+    if (audio)
+        audio->Priority = priority;
+    return NULL_VAL;
+}
 // #endregion
 
 // #region Sprite
@@ -13865,77 +14110,113 @@ VMValue TileInfo_IsCeiling(int argCount, VMValue* args, Uint32 threadID) {
 // #endregion
 
 // #region Thread
-struct _Thread_Bundle {
-    ObjFunction    Callback;
-    int            ArgCount;
-    int            ThreadIndex;
-};
-
-int     _Thread_RunEvent(void* op) {
-    _Thread_Bundle* bundle;
-    bundle = (_Thread_Bundle*)op;
-
-    VMValue*  args = (VMValue*)(bundle + 1);
-    VMThread* thread = ScriptManager::Threads + bundle->ThreadIndex;
-    VMValue   callbackVal = OBJECT_VAL(&bundle->Callback);
-
-    // if (bundle->Callback.Method == NULL) {
-    //     Log::Print(Log::LOG_ERROR, "No callback.");
-    //     ScriptManager::ThreadCount--;
-    //     free(bundle);
-    //     return 0;
-    // }
-
-    thread->Push(callbackVal);
-    for (int i = 0; i < bundle->ArgCount; i++) {
-        thread->Push(args[i]);
-    }
-    thread->RunValue(callbackVal, bundle->ArgCount);
+static bool Thread_GetCallback(VMValue* args, int index, Uint32 threadID) {
+    if (IS_BOUND_METHOD(args[index]) || IS_FUNCTION(args[index]))
+        return true;
 
-    free(bundle);
-
-    ScriptManager::ThreadCount--;
-    Log::Print(Log::LOG_IMPORTANT, "Thread %d closed.", ScriptManager::ThreadCount);
-    return 0;
+    THROW_ERROR("Expected argument %d to be of type %s instead of %s.", index + 1, GetObjectTypeString(OBJ_FUNCTION), GetValueTypeString(args[index]));
+    return false;
 }
 /***
  * Thread.RunEvent
- * \desc
- * \return
+ * \desc Calls a function on a background thread, and returns right away. The function shouldn't change anything the main thread might be using at the same time.
+ * \param callback (Function): The function or method to call.
+ * \paramOpt args (Value): Arguments to call it with.
+ * \return Returns a handle for the call, to use with the other Thread functions.
  * \ns Thread
  */
 VMValue Thread_RunEvent(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_AT_LEAST_ARGCOUNT(1);
-
-    ObjFunction* callback = NULL;
-    if (IS_BOUND_METHOD(args[0])) {
-        callback = GET_ARG(0, GetBoundMethod)->Method;
-    }
-    else if (IS_FUNCTION(args[0])) {
-        callback = AS_FUNCTION(args[0]);
-    }
-
-    if (callback == NULL) {
-        Values::PrintValue(args[0]);
-        printf("\n");
-        Log::Print(Log::LOG_ERROR, "No callback.");
+    if (!Thread_GetCallback(args, 0, threadID))
         return NULL_VAL;
-    }
-
-    int subArgCount = argCount - 1;
-
-    _Thread_Bundle* bundle = (_Thread_Bundle*)malloc(sizeof(_Thread_Bundle) + subArgCount * sizeof(VMValue));
-    bundle->Callback = *callback;
-    bundle->Callback.Object.Next = NULL;
-    bundle->ArgCount = subArgCount;
-    bundle->ThreadIndex = ScriptManager::ThreadCount++;
-    if (subArgCount > 0)
-        memcpy(bundle + 1, args + 1, subArgCount * sizeof(VMValue));
-
-    // SDL_DetachThread
-    SDL_CreateThread(_Thread_RunEvent, "_Thread_RunEvent", bundle);
 
-    return NULL_VAL;
+    return INTEGER_VAL((int)ScriptJobs::Start(args[0], args + 1, argCount - 1, threadID));
+}
+/***
+ * Thread.IsDone
+ * \desc Checks whether a call started by <linkto ref="Thread.RunEvent"></linkto> has finished, or was cancelled.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \return Returns a Boolean value.
+ * \ns Thread
+ */
+VMValue Thread_IsDone(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    return INTEGER_VAL(ScriptJobs::IsDone(GET_ARG(0, GetInteger)));
+}
+/***
+ * Thread.GetResult
+ * \desc Gets what the function started by <linkto ref="Thread.RunEvent"></linkto> returned. A result can only be gotten once, and is only kept until 256 more calls have finished.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \return Returns the result, or <code>null</code> if the call hasn't finished or was cancelled.
+ * \ns Thread
+ */
+VMValue Thread_GetResult(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    VMValue result = NULL_VAL;
+    ScriptJobs::GetResult(GET_ARG(0, GetInteger), &result);
+    return result;
+}
+/***
+ * Thread.Wait
+ * \desc Waits for a call started by <linkto ref="Thread.RunEvent"></linkto> to finish. If it hasn't started yet, it's run right away instead.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \return Returns what the function returned, or <code>null</code> if the call was cancelled.
+ * \ns Thread
+ */
+VMValue Thread_Wait(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    return ScriptJobs::Wait(GET_ARG(0, GetInteger), threadID);
+}
+/***
+ * Thread.Cancel
+ * \desc Cancels a call started by <linkto ref="Thread.RunEvent"></linkto>. If it's running already, it carries on, but <linkto ref="Thread.IsCancelled"></linkto> returns <code>true</code> inside of it, and its result is thrown away.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \return Returns <code>true</code> if the call was cancelled, or <code>false</code> if it had finished.
+ * \ns Thread
+ */
+VMValue Thread_Cancel(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    return INTEGER_VAL(ScriptJobs::Cancel(GET_ARG(0, GetInteger)));
+}
+/***
+ * Thread.IsCancelled
+ * \desc Checks whether the call running on this thread was cancelled, so that it can stop early.
+ * \return Returns a Boolean value.
+ * \ns Thread
+ */
+VMValue Thread_IsCancelled(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    return INTEGER_VAL(ScriptJobs::IsCancelled());
+}
+/***
+ * Thread.OnComplete
+ * \desc Sets a function to call on the main thread, at the end of the frame, once a call started by <linkto ref="Thread.RunEvent"></linkto> has finished. It's called with the result, which isn't kept afterwards.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \param callback (Function): The function or method to call.
+ * \return Returns <code>false</code> if the handle isn't known anymore.
+ * \ns Thread
+ */
+VMValue Thread_OnComplete(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    int handle = GET_ARG(0, GetInteger);
+    if (!Thread_GetCallback(args, 1, threadID))
+        return NULL_VAL;
+    return INTEGER_VAL(ScriptJobs::SetCallback(handle, args[1], false));
+}
+/***
+ * Thread.OnCancel
+ * \desc Sets a function to call on the main thread, at the end of the frame, once a call started by <linkto ref="Thread.RunEvent"></linkto> has been cancelled. It's called without arguments.
+ * \param handle (Integer): The handle returned by <linkto ref="Thread.RunEvent"></linkto>.
+ * \param callback (Function): The function or method to call.
+ * \return Returns <code>false</code> if the handle isn't known anymore.
+ * \ns Thread
+ */
+VMValue Thread_OnCancel(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    int handle = GET_ARG(0, GetInteger);
+    if (!Thread_GetCallback(args, 1, threadID))
+        return NULL_VAL;
+    return INTEGER_VAL(ScriptJobs::SetCallback(handle, args[1], true));
 }
 /***
  * Thread.Sleep
@@ -15284,6 +15565,11 @@ PUBLIC STATIC void StandardLibrary::Link() {
     * \desc App quit keybind. (dev)
     */
     DEF_ENUM_CLASS(KeyBind, DevQuit);
+    /***
+    * \enum KeyBind_DevTrace
+    * \desc Trace recording keybind. (dev)
+    */
+    DEF_ENUM_CLASS(KeyBind, DevTrace);
     // #endregion
 
     // #region Audio
@@ -16592,6 +16878,19 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Resources, LoadMusic);
     DEF_NATIVE(Resources, LoadSound);
     DEF_NATIVE(Resources, LoadVideo);
+    DEF_NATIVE(Resources, LoadSpriteAsync);
+    DEF_NATIVE(Resources, LoadImageAsync);
+    DEF_NATIVE(Resources, LoadFontAsync);
+    DEF_NATIVE(Resources, LoadModelAsync);
+    DEF_NATIVE(Resources, LoadMusicAsync);
+    DEF_NATIVE(Resources, LoadSoundAsync);
+    DEF_NATIVE(Resources, GetAsyncLoadProgress);
+    DEF_NATIVE(Resources, GetAsyncLoadResult);
+    DEF_NATIVE(Resources, GetPendingAsyncLoads);
+    DEF_NATIVE(Resources, GetCacheStats);
+    DEF_NATIVE(Resources, SetCacheBudget);
+    DEF_NATIVE(Resources, ClearCache);
+    DEF_NATIVE(Resources, RefreshIndex);
     DEF_NATIVE(Resources, FileExists);
     DEF_NATIVE(Resources, ReadAllText);
 
@@ -16881,6 +17180,8 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Sound, AlterChannel);
     DEF_NATIVE(Sound, GetFreeChannel);
     DEF_NATIVE(Sound, IsChannelFree);
+    DEF_NATIVE(Sound, SetMaxInstances);
+    DEF_NATIVE(Sound, SetPriority);
     // #endregion
 
     // #region Sprite
@@ -17028,6 +17329,13 @@ PUBLIC STATIC void StandardLibrary::Link() {
     // #region Thread
     INIT_CLASS(Thread);
     DEF_NATIVE(Thread, RunEvent);
+    DEF_NATIVE(Thread, IsDone);
+    DEF_NATIVE(Thread, GetResult);
+    DEF_NATIVE(Thread, Wait);
+    DEF_NATIVE(Thread, Cancel);
+    DEF_NATIVE(Thread, IsCancelled);
+    DEF_NATIVE(Thread, OnComplete);
+    DEF_NATIVE(Thread, OnCancel);
     DEF_NATIVE(Thread, Sleep);
     // #endregion
 
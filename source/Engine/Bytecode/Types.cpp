@@ -17,19 +17,54 @@
 
 #define GROW_CAPACITY(val) ((val) < 8 ? 8 : val * 2)
 
-static Obj*       AllocateObject(size_t size, ObjType type) {
-    // Only do this when allocating more memory
-    GarbageCollector::GarbageSize += size;
+// Set on a thread whose objects the garbage collector can't see yet
+static thread_local DetachedObjects* DetachedList = NULL;
 
+static Obj*       AllocateObject(size_t size, ObjType type) {
     Obj* object = (Obj*)Memory::TrackedMalloc("AllocateObject", size);
     object->Type = type;
     object->Class = nullptr;
     object->IsDark = false;
+
+    if (DetachedList) {
+        DetachedList->Size += size;
+        object->Next = DetachedList->First;
+        DetachedList->First = object;
+        return object;
+    }
+
+    // Only do this when allocating more memory
+    GarbageCollector::GarbageSize += size;
+
     object->Next = GarbageCollector::RootObject;
     GarbageCollector::RootObject = object;
 
     return object;
 }
+
+// Puts objects made by this thread on the list instead of giving them to the
+// garbage collector, which only the main thread may touch. NULL goes back to
+// normal.
+void              DetachObjectAllocations(DetachedObjects* list) {
+    DetachedList = list;
+}
+// Hands detached objects to the garbage collector. Must be called on the
+// main thread.
+void              AttachObjects(DetachedObjects* list) {
+    if (!list->First)
+        return;
+
+    Obj* last = list->First;
+    while (last->Next)
+        last = last->Next;
+
+    last->Next = GarbageCollector::RootObject;
+    GarbageCollector::RootObject = list->First;
+    GarbageCollector::GarbageSize += list->Size;
+
+    list->First = NULL;
+    list->Size = 0;
+}
 static ObjString* AllocateString(char* chars, size_t length, Uint32 hash) {
     ObjString* string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
     Memory::Track(string, "NewString");
@@ -191,6 +226,7 @@ ObjModule*        NewModule() {
     module->Functions = new vector<ObjFunction*>();
     module->Locals = new vector<VMValue>();
     module->SourceFilename = NULL;
+    module->FilenameHash = 0;
     return module;
 }
 
@@ -266,6 +302,8 @@ void              Chunk::Init() {
     Code = NULL;
     Lines = NULL;
     Constants = new vector<VMValue>();
+    EncodedConstants = NULL;
+    LinesOffset = 0;
 }
 void              Chunk::Alloc() {
     if (!Code)
@@ -293,6 +331,12 @@ void              Chunk::Free() {
             Lines = NULL;
         }
     }
+    // Line numbers read after loading are the only part of a loaded
+    // function's memory that it owns
+    else if (Lines && LinesOffset) {
+        Memory::Free(Lines);
+        Lines = NULL;
+    }
 
     if (Constants) {
         Constants->clear();
@@ -314,3 +358,41 @@ int               Chunk::AddConstant(VMValue value) {
     Constants->push_back(value);
     return (int)Constants->size() - 1;
 }
+void              Chunk::DecodeConstants() {
+    if (!EncodedConstants)
+        return;
+
+    Uint8* data = EncodedConstants;
+    Sint32 count;
+    memcpy(&count, data, sizeof(count));
+    data += sizeof(count);
+
+    Constants->reserve(count);
+    for (Sint32 c = 0; c < count; c++) {
+        Uint8 type = *data++;
+        switch (type) {
+            case VAL_INTEGER: {
+                int value;
+                memcpy(&value, data, sizeof(value));
+                data += sizeof(value);
+                AddConstant(INTEGER_VAL(value));
+                break;
+            }
+            case VAL_DECIMAL: {
+                float value;
+                memcpy(&value, data, sizeof(value));
+                data += sizeof(value);
+                AddConstant(DECIMAL_VAL(value));
+                break;
+            }
+            case VAL_OBJECT: {
+                size_t length = strlen((char*)data);
+                AddConstant(OBJECT_VAL(CopyString((char*)data, length)));
+                data += length + 1;
+                break;
+            }
+        }
+    }
+
+    EncodedConstants = NULL;
+}
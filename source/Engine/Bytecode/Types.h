@@ -48,12 +48,17 @@ struct Chunk {
     int*             Lines;
     vector<VMValue>* Constants;
     bool             OwnsMemory;
+    // Constants of a function read from bytecode, until it's first called
+    Uint8*           EncodedConstants;
+    // Where its line numbers are in the bytecode file, until they're needed
+    Uint32           LinesOffset;
 
     void Init();
     void Alloc();
     void Free();
     void Write(Uint8 byte, int line);
     int  AddConstant(VMValue value);
+    void DecodeConstants();
 };
 
 struct BytecodeContainer {
@@ -174,6 +179,7 @@ struct ObjModule {
     vector<struct ObjFunction*>* Functions;
     vector<VMValue>*             Locals;
     ObjString*                   SourceFilename;
+    Uint32                       FilenameHash;
 };
 struct ObjFunction {
     Obj          Object;
@@ -258,6 +264,13 @@ struct ObjEnum {
     Table*     Fields;
 };
 
+// Objects made on a thread other than the main one, kept from the garbage
+// collector until the main thread hands them over with AttachObjects
+struct DetachedObjects {
+    Obj*   First;
+    size_t Size;
+};
+
 ObjString*         TakeString(char* chars, size_t length);
 ObjString*         TakeString(char* chars);
 ObjString*         CopyString(const char* chars, size_t length);
@@ -277,6 +290,8 @@ ObjStream*         NewStream(Stream* streamPtr, bool writable);
 ObjNamespace*      NewNamespace(Uint32 hash);
 ObjEnum*           NewEnum(Uint32 hash);
 ObjModule*         NewModule();
+void               DetachObjectAllocations(DetachedObjects* list);
+void               AttachObjects(DetachedObjects* list);
 
 #define FREE_OBJ(obj, type) \
     assert(GarbageCollector::GarbageSize >= sizeof(type)); \
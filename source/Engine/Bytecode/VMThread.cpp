@@ -35,6 +35,7 @@ public:
 #include <Engine/Bytecode/VMThread.h>
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/Bytecode.h>
 #include <Engine/Bytecode/Compiler.h>
 #include <Engine/Bytecode/Values.h>
 #include <Engine/Diagnostics/Clock.h>
@@ -142,6 +143,12 @@ PRIVATE void    VMThread::PrintStackTrace(PrintBuffer* buffer, const char* error
     int line;
     char* source;
 
+    // Line numbers aren't loaded until something needs them
+    for (Uint32 i = 0; i < FrameCount; i++) {
+        if (Frames[i].Function)
+            Bytecode::LoadLines(Frames[i].Function->Module);
+    }
+
     CallFrame* frame = &Frames[FrameCount - 1];
     ObjFunction* function = frame->Function;
 
@@ -172,7 +179,8 @@ PRIVATE void    VMThread::PrintStackTrace(PrintBuffer* buffer, const char* error
         line = -1;
         if (i > 0) {
             CallFrame* fr2 = &Frames[i - 1];
-            line = fr2->Function->Chunk.Lines[fr2->IPLast - fr2->IPStart] & 0xFFFF;
+            if (fr2->Function->Chunk.Lines)
+                line = fr2->Function->Chunk.Lines[fr2->IPLast - fr2->IPStart] & 0xFFFF;
         }
         std::string functionName = GetFunctionName(function);
         if (source)
@@ -2084,6 +2092,15 @@ PUBLIC bool    VMThread::Call(ObjFunction* function, int argCount) {
         return false;
     }
 
+    // Functions read from bytecode get their constants on their first call
+    if (function->Chunk.EncodedConstants && ScriptManager::Lock()) {
+        if (function->Chunk.EncodedConstants) {
+            function->Chunk.DecodeConstants();
+            Bytecode::DecodedFunctionCount++;
+        }
+        ScriptManager::Unlock();
+    }
+
     CallFrame* frame = &Frames[FrameCount++];
     frame->IP = function->Chunk.Code;
     frame->IPStart = frame->IP;
@@ -2150,6 +2167,10 @@ PRIVATE bool   VMThread::DoClassExtension(VMValue value, VMValue originalValue,
     if (clearSrc)
         src->Methods->Clear();
 
+    // A constructor in the new definition replaces the old one, as methods do
+    if (HasInitializer(src))
+        dst->Initializer = src->Initializer;
+
     src->Fields->WithAll([dst](Uint32 hash, VMValue value) -> void {
         dst->Fields->Put(hash, value);
     });
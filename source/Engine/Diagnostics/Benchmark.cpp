@@ -0,0 +1,1379 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class Benchmark {
+public:
+};
+#endif
+
+#include <Engine/Diagnostics/Benchmark.h>
+#include <Engine/Audio/AudioManager.h>
+#include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/SourceFileMap.h>
+#include <Engine/Bytecode/SourceFileWatcher.h>
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Hashing/Murmur.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/IO/Compression/LZ4.h>
+#include <Engine/IO/Compression/ZLibStream.h>
+#include <Engine/IO/Compression/Zstd.h>
+#include <Engine/Math/Matrix4x4.h>
+#include <Engine/Network/WebSocketClient.h>
+#include <Engine/Network/WebSocketIncludes.h>
+#include <Engine/Rendering/Mesh.h>
+#include <Engine/Rendering/PolygonRenderer.h>
+#include <Engine/Rendering/VertexTransform.h>
+#include <Engine/ResourceTypes/DataPackFormat.h>
+#include <Engine/ResourceTypes/DataPackWriter.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Scene.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+#include <filesystem>
+
+#ifdef MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+// Microbenchmarks for engine internals, run with "--benchmark <name>" on
+// the command line. Each one logs its own results, and the ones that replace
+// a scalar path with an optimized one also check that the results match.
+// They return false if a check failed.
+
+typedef bool (*BenchmarkFunction)();
+
+struct BenchmarkEntry {
+    const char*       Name;
+    BenchmarkFunction Function;
+};
+
+static Uint32 BenchmarkSeed = 0x1234567;
+static Uint32 BenchmarkRandom() {
+    // xorshift32, so that every run uses the same data
+    BenchmarkSeed ^= BenchmarkSeed << 13;
+    BenchmarkSeed ^= BenchmarkSeed >> 17;
+    BenchmarkSeed ^= BenchmarkSeed << 5;
+    return BenchmarkSeed;
+}
+
+static bool Benchmark_FaceSort() {
+    const Uint32 faceCounts[] = { 1000, 10000, 50000, 200000 };
+    const int iterations = 20;
+
+    bool passed = true;
+    for (size_t c = 0; c < sizeof(faceCounts) / sizeof(faceCounts[0]); c++) {
+        Uint32 count = faceCounts[c];
+        FaceInfo* source = (FaceInfo*)Memory::Calloc(count, sizeof(FaceInfo));
+        FaceInfo* faces = (FaceInfo*)Memory::Calloc(count, sizeof(FaceInfo));
+
+        // Depths between 1 and 1024 units in 16.16, coarse enough that the
+        // radix sort doesn't need to quantize them
+        for (Uint32 f = 0; f < count; f++)
+            source[f].Depth = 0x10000 + (int)(BenchmarkRandom() % (1023 * 0x400)) * 0x40;
+
+        double qsortTime = 0.0, radixTime = 0.0, bucketTime = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            memcpy(faces, source, count * sizeof(FaceInfo));
+            double start = Clock::GetTicks();
+            qsort(faces, count, sizeof(FaceInfo), PolygonRenderer::FaceSortFunction);
+            qsortTime += Clock::GetTicks() - start;
+
+            PolygonRenderer::FaceSortBuckets = 0;
+            start = Clock::GetTicks();
+            PolygonRenderer::SortFaces(source, count, false);
+            radixTime += Clock::GetTicks() - start;
+
+            PolygonRenderer::FaceSortBuckets = 1024;
+            start = Clock::GetTicks();
+            PolygonRenderer::SortFaces(source, count, false);
+            bucketTime += Clock::GetTicks() - start;
+        }
+        PolygonRenderer::FaceSortBuckets = 0;
+
+        // Check the radix sort against qsort's order
+        Uint32* order = PolygonRenderer::SortFaces(source, count, false);
+        bool matches = true;
+        for (Uint32 f = 0; f < count && matches; f++)
+            matches = source[order[f]].Depth == faces[f].Depth;
+
+        Log::Print(Log::LOG_INFO, "Face sort, %6u faces: qsort %8.3f ms, radix %8.3f ms (%s), 1024 buckets %8.3f ms",
+            count, qsortTime / iterations, radixTime / iterations, matches ? "same order" : "DIFFERENT ORDER", bucketTime / iterations);
+        passed &= matches;
+
+        Memory::Free(source);
+        Memory::Free(faces);
+    }
+    return passed;
+}
+
+static void Benchmark_MultiplyScalar(Matrix4x4* out, Matrix4x4* a, Matrix4x4* b) {
+    for (int i = 0; i < 16; i += 4) {
+        for (int j = 0; j < 4; j++)
+            out->Values[i + j] = b->Values[i] * a->Values[j] + b->Values[i + 1] * a->Values[4 + j]
+                + b->Values[i + 2] * a->Values[8 + j] + b->Values[i + 3] * a->Values[12 + j];
+    }
+}
+static bool Benchmark_Transform() {
+    // Matrix multiplication, compared to the scalar version
+    Matrix4x4 a, b, simdOut, scalarOut;
+    float maxMatrixError = 0.0f;
+    for (int t = 0; t < 1000; t++) {
+        for (int i = 0; i < 16; i++) {
+            a.Values[i] = (int)(BenchmarkRandom() % 2001 - 1000) / 100.0f;
+            b.Values[i] = (int)(BenchmarkRandom() % 2001 - 1000) / 100.0f;
+        }
+        Matrix4x4::Multiply(&simdOut, &a, &b);
+        Benchmark_MultiplyScalar(&scalarOut, &a, &b);
+        for (int i = 0; i < 16; i++) {
+            float error = fabs(simdOut.Values[i] - scalarOut.Values[i]);
+            if (maxMatrixError < error)
+                maxMatrixError = error;
+        }
+    }
+    Log::Print(Log::LOG_INFO, "Matrix4x4::Multiply: max difference from scalar %g (%s)",
+        maxMatrixError, maxMatrixError <= 1e-4f ? "ok" : "FAILED");
+
+    // Batched vertex transform, compared to APPLY_MAT4X4
+    const Uint32 count = 100000;
+    const int iterations = 20;
+    Vector3* input = (Vector3*)Memory::Malloc(count * sizeof(Vector3));
+    Vector4* simdOutput = (Vector4*)Memory::Malloc(count * sizeof(Vector4));
+    Vector4* scalarOutput = (Vector4*)Memory::Malloc(count * sizeof(Vector4));
+    Uint8* simdOutcodes = (Uint8*)Memory::Malloc(count);
+    Uint8* scalarOutcodes = (Uint8*)Memory::Malloc(count);
+
+    for (Uint32 i = 0; i < count; i++) {
+        input[i].X = (Sint64)(BenchmarkRandom() % (200 << 16)) - (100 << 16);
+        input[i].Y = (Sint64)(BenchmarkRandom() % (200 << 16)) - (100 << 16);
+        input[i].Z = (Sint64)(BenchmarkRandom() % (200 << 16)) - (100 << 16);
+    }
+
+    Matrix4x4 model, view, projection, mvp;
+    Matrix4x4::IdentityRotationXYZ(&model, 0.3f, 1.1f, -0.2f);
+    Matrix4x4::Identity(&view);
+    Matrix4x4::Translate(&view, &view, 0.0f, 0.0f, -150.0f);
+    Matrix4x4::Perspective(&projection, 60.0f * M_PI / 180.0f, 4.0f / 3.0f, 1.0f, 1000.0f);
+    Matrix4x4::Multiply(&mvp, &model, &view);
+    Matrix4x4::Multiply(&mvp, &mvp, &projection);
+    Matrix4x4::Transpose(&mvp);
+
+    double simdTime = 0.0, scalarTime = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = Clock::GetTicks();
+        VertexTransform::TransformPositionsScalar(&mvp, input, sizeof(Vector3), scalarOutput, scalarOutcodes, count);
+        scalarTime += Clock::GetTicks() - start;
+
+        start = Clock::GetTicks();
+        VertexTransform::TransformPositions(&mvp, input, sizeof(Vector3), simdOutput, simdOutcodes, count);
+        simdTime += Clock::GetTicks() - start;
+    }
+
+    Sint64 maxError = 0;
+    Uint32 outcodeMismatches = 0;
+    for (Uint32 i = 0; i < count; i++) {
+        Sint64* simdValues = &simdOutput[i].X;
+        Sint64* scalarValues = &scalarOutput[i].X;
+        for (int c = 0; c < 4; c++) {
+            Sint64 error = simdValues[c] - scalarValues[c];
+            if (error < 0)
+                error = -error;
+            if (maxError < error)
+                maxError = error;
+        }
+        if (simdOutcodes[i] != scalarOutcodes[i])
+            outcodeMismatches++;
+    }
+
+    Log::Print(Log::LOG_INFO, "Transform, %u vertices: scalar %8.3f ms, batched %8.3f ms", count, scalarTime / iterations, simdTime / iterations);
+    Log::Print(Log::LOG_INFO, "Transform: max difference from scalar %d (16.16), %u outcode mismatches (%s)",
+        (int)maxError, outcodeMismatches, maxError <= 4 && outcodeMismatches == 0 ? "ok" : "FAILED");
+
+    Memory::Free(input);
+    Memory::Free(simdOutput);
+    Memory::Free(scalarOutput);
+    Memory::Free(simdOutcodes);
+    Memory::Free(scalarOutcodes);
+
+    return maxMatrixError <= 1e-4f && maxError <= 4 && outcodeMismatches == 0;
+}
+
+static bool Benchmark_Skinning() {
+    const Uint32 vertexCount = 50000;
+    const Uint32 boneCount = 32;
+    const int iterations = 20;
+
+    // Every vertex is weighted to two bones
+    Skeleton* skeleton = new Skeleton;
+    skeleton->NumVertices = vertexCount;
+    skeleton->NumBones = boneCount;
+    skeleton->Bones = new MeshBone*[boneCount];
+    skeleton->VertexWeights = (Uint32*)Memory::Calloc(vertexCount, sizeof(Uint32));
+    skeleton->PositionBuffer = (Vector3*)Memory::Malloc(vertexCount * sizeof(Vector3));
+    skeleton->NormalBuffer = (Vector3*)Memory::Malloc(vertexCount * sizeof(Vector3));
+    skeleton->PrepareTransform();
+
+    for (Uint32 b = 0; b < boneCount; b++) {
+        MeshBone* bone = new MeshBone;
+        Matrix4x4::IdentityRotationXYZ(bone->FinalTransform, b * 0.1f, b * 0.2f, b * 0.05f);
+        Matrix4x4::Translate(bone->FinalTransform, bone->FinalTransform, b * 0.5f, 0.0f, -(b * 0.25f));
+        skeleton->Bones[b] = bone;
+    }
+    for (Uint32 v = 0; v < vertexCount; v++) {
+        skeleton->PositionBuffer[v].X = (Sint64)(BenchmarkRandom() % (20 << 16)) - (10 << 16);
+        skeleton->PositionBuffer[v].Y = (Sint64)(BenchmarkRandom() % (20 << 16)) - (10 << 16);
+        skeleton->PositionBuffer[v].Z = (Sint64)(BenchmarkRandom() % (20 << 16)) - (10 << 16);
+        skeleton->NormalBuffer[v].X = 0;
+        skeleton->NormalBuffer[v].Y = 0x10000;
+        skeleton->NormalBuffer[v].Z = 0;
+
+        for (int w = 0; w < 2; w++) {
+            BoneWeight weight;
+            weight.VertexID = v;
+            weight.Weight = 0x4000 + (BenchmarkRandom() % 0x8000);
+            skeleton->Bones[BenchmarkRandom() % boneCount]->Weights.push_back(weight);
+            skeleton->VertexWeights[v] += weight.Weight;
+        }
+    }
+
+    Vector3* serialPositions = (Vector3*)Memory::Malloc(vertexCount * sizeof(Vector3));
+    Vector3* serialNormals = (Vector3*)Memory::Malloc(vertexCount * sizeof(Vector3));
+
+    Skeleton::SkinJob job;
+    job.Source = skeleton;
+    job.OutPositions = serialPositions;
+    job.OutNormals = serialNormals;
+    skeleton->BuildInfluences();
+
+    double serialTime = 0.0, poolTime = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = Clock::GetTicks();
+        Skeleton::TransformRange(&job, 0, vertexCount);
+        serialTime += Clock::GetTicks() - start;
+
+        start = Clock::GetTicks();
+        skeleton->Transform();
+        poolTime += Clock::GetTicks() - start;
+    }
+
+    bool matches = !memcmp(serialPositions, skeleton->TransformedPositions, vertexCount * sizeof(Vector3))
+        && !memcmp(serialNormals, skeleton->TransformedNormals, vertexCount * sizeof(Vector3));
+
+    Log::Print(Log::LOG_INFO, "Skinning, %u vertices: 1 thread %8.3f ms, %d worker(s) %8.3f ms (%s)",
+        vertexCount, serialTime / iterations, WorkerPool::GetThreadCount(), poolTime / iterations, matches ? "ok" : "FAILED");
+
+    Memory::Free(serialPositions);
+    Memory::Free(serialNormals);
+    Memory::Free(skeleton->PositionBuffer);
+    Memory::Free(skeleton->NormalBuffer);
+    delete skeleton;
+
+    return matches;
+}
+
+struct ResourceLoadJob {
+    vector<Uint32>* Hashes;
+    Uint32*         Checksums;
+    Uint32          Offset;
+    Uint32          Loaded;
+    Uint32          Mismatches;
+};
+
+static int Benchmark_ResourceLoadThread(void* data) {
+    ResourceLoadJob* job = (ResourceLoadJob*)data;
+    size_t count = job->Hashes->size();
+
+    // Every thread starts at a different entry, so that they read from all
+    // over the pack at the same time
+    for (size_t i = 0; i < count; i++) {
+        size_t index = (i + job->Offset) % count;
+
+        Uint8* memory;
+        size_t size;
+        if (!ResourceManager::LoadResource((*job->Hashes)[index], &memory, &size)) {
+            job->Mismatches++;
+            continue;
+        }
+
+        if (CRC32::EncryptData(memory, size) != job->Checksums[index])
+            job->Mismatches++;
+        job->Loaded++;
+
+        Memory::Free(memory);
+    }
+
+    return 0;
+}
+
+static bool Benchmark_ResourceLoad() {
+    const int threadCount = 8;
+
+    vector<Uint32> hashes = ResourceManager::GetResourceHashes();
+    if (hashes.size() == 0) {
+        Log::Print(Log::LOG_INFO, "No data pack loaded, nothing to read.");
+        return true;
+    }
+
+    // Reference checksums, read one at a time
+    Uint32* checksums = (Uint32*)Memory::Calloc(hashes.size(), sizeof(Uint32));
+    double start = Clock::GetTicks();
+    for (size_t i = 0; i < hashes.size(); i++) {
+        Uint8* memory;
+        size_t size;
+        if (ResourceManager::LoadResource(hashes[i], &memory, &size)) {
+            checksums[i] = CRC32::EncryptData(memory, size);
+            Memory::Free(memory);
+        }
+    }
+    double serialTime = Clock::GetTicks() - start;
+
+    ResourceLoadJob jobs[threadCount];
+    SDL_Thread* threads[threadCount];
+
+    start = Clock::GetTicks();
+    for (int t = 0; t < threadCount; t++) {
+        jobs[t].Hashes = &hashes;
+        jobs[t].Checksums = checksums;
+        jobs[t].Offset = (Uint32)((hashes.size() * t) / threadCount);
+        jobs[t].Loaded = 0;
+        jobs[t].Mismatches = 0;
+        threads[t] = SDL_CreateThread(Benchmark_ResourceLoadThread, "ResourceLoad", &jobs[t]);
+        if (!threads[t])
+            Benchmark_ResourceLoadThread(&jobs[t]);
+    }
+
+    Uint32 loaded = 0, mismatches = 0;
+    for (int t = 0; t < threadCount; t++) {
+        if (threads[t])
+            SDL_WaitThread(threads[t], NULL);
+        loaded += jobs[t].Loaded;
+        mismatches += jobs[t].Mismatches;
+    }
+    double threadedTime = Clock::GetTicks() - start;
+
+    Log::Print(Log::LOG_INFO, "Resource loads, %u entries: 1 thread %8.3f ms, %d threads %8.3f ms (%u loads, %u mismatches, %s)",
+        (Uint32)hashes.size(), serialTime, threadCount, threadedTime, loaded, mismatches, mismatches ? "FAILED" : "ok");
+
+    Memory::Free(checksums);
+
+    return mismatches == 0;
+}
+
+struct CompressionSample {
+    Uint8* Data;
+    size_t Size;
+    Uint8* Compressed;
+    size_t CompressedSize;
+};
+enum {
+    COMPRESSION_ZLIB,
+    COMPRESSION_LZ4,
+    COMPRESSION_ZSTD,
+    COMPRESSION_ZSTD_DICTIONARY,
+};
+
+static size_t Benchmark_CompressSample(int codec, CompressionSample* sample, Uint8* out, size_t outSize, void* dictionary, size_t dictionarySize) {
+    switch (codec) {
+        case COMPRESSION_ZLIB:
+            return ZLibStream::Compress(out, outSize, sample->Data, sample->Size, 9);
+        case COMPRESSION_LZ4:
+            return LZ4::Compress(sample->Data, sample->Size, out, outSize);
+        case COMPRESSION_ZSTD:
+            return Zstd::Compress(sample->Data, sample->Size, out, outSize, 19);
+        case COMPRESSION_ZSTD_DICTIONARY:
+            return Zstd::Compress(sample->Data, sample->Size, out, outSize, 19, dictionary, dictionarySize);
+    }
+    return 0;
+}
+static bool Benchmark_DecompressSample(int codec, CompressionSample* sample, Uint8* out, void* dictionary) {
+    switch (codec) {
+        case COMPRESSION_ZLIB:
+            return ZLibStream::Decompress(out, sample->Size, sample->Compressed, sample->CompressedSize);
+        case COMPRESSION_LZ4:
+            return LZ4::Decompress(sample->Compressed, sample->CompressedSize, out, sample->Size);
+        case COMPRESSION_ZSTD:
+            return Zstd::Decompress(sample->Compressed, sample->CompressedSize, out, sample->Size);
+        case COMPRESSION_ZSTD_DICTIONARY:
+            return Zstd::Decompress(sample->Compressed, sample->CompressedSize, out, sample->Size, dictionary);
+    }
+    return false;
+}
+static bool Benchmark_CompressionRun(const char* name, int codec, vector<CompressionSample>& samples, void* dictionary, size_t dictionarySize) {
+    const int passes = 5;
+
+    void* decompressDictionary = NULL;
+    if (dictionary)
+        decompressDictionary = Zstd::CreateDictionary(dictionary, dictionarySize);
+
+    size_t totalSize = 0, totalCompressed = 0, largest = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        CompressionSample* sample = &samples[i];
+        size_t bound = sample->Size + (sample->Size >> 2) + 64;
+        bound = std::max(bound, ZLibStream::CompressBound(sample->Size));
+        bound = std::max(bound, LZ4::CompressBound(sample->Size));
+        bound = std::max(bound, Zstd::CompressBound(sample->Size));
+
+        sample->Compressed = (Uint8*)Memory::Malloc(bound);
+        sample->CompressedSize = Benchmark_CompressSample(codec, sample, sample->Compressed, bound, dictionary, dictionarySize);
+
+        totalSize += sample->Size;
+        totalCompressed += sample->CompressedSize;
+        largest = std::max(largest, sample->Size);
+    }
+
+    Uint8* buffer = (Uint8*)Memory::Malloc(largest + 1);
+    Uint32 failures = 0;
+    double start = Clock::GetTicks();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i < samples.size(); i++) {
+            CompressionSample* sample = &samples[i];
+            if (!sample->CompressedSize || !Benchmark_DecompressSample(codec, sample, buffer, decompressDictionary)) {
+                failures++;
+                continue;
+            }
+            if (pass == 0 && memcmp(buffer, sample->Data, sample->Size))
+                failures++;
+        }
+    }
+    double elapsed = (Clock::GetTicks() - start) / passes;
+
+    Log::Print(Log::LOG_INFO, "%-16s %10u -> %10u bytes (%5.1f%%), decompress %8.3f ms (%8.1f MB/s, %s)",
+        name, (Uint32)totalSize, (Uint32)totalCompressed, totalSize ? totalCompressed * 100.0 / totalSize : 0.0,
+        elapsed, elapsed > 0.0 ? (totalSize / 1048576.0) / (elapsed / 1000.0) : 0.0, failures ? "FAILED" : "ok");
+
+    Memory::Free(buffer);
+    for (size_t i = 0; i < samples.size(); i++)
+        Memory::Free(samples[i].Compressed);
+    if (decompressDictionary)
+        Zstd::FreeDictionary(decompressDictionary);
+
+    return failures == 0;
+}
+static bool Benchmark_Compression() {
+    // Small files are where a dictionary helps
+    const size_t smallFileSize = 16 * 1024;
+    const size_t dictionaryCapacity = 112 * 1024;
+
+    vector<Uint32> hashes = ResourceManager::GetResourceHashes();
+    if (hashes.size() == 0) {
+        Log::Print(Log::LOG_INFO, "No data pack loaded, nothing to compress.");
+        return true;
+    }
+
+    vector<CompressionSample> samples;
+    vector<CompressionSample> smallSamples;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        CompressionSample sample;
+        if (!ResourceManager::LoadResource(hashes[i], &sample.Data, &sample.Size))
+            continue;
+        if (sample.Size == 0) {
+            Memory::Free(sample.Data);
+            continue;
+        }
+
+        sample.Compressed = NULL;
+        sample.CompressedSize = 0;
+        samples.push_back(sample);
+        if (sample.Size <= smallFileSize)
+            smallSamples.push_back(sample);
+    }
+
+    bool passed = true;
+    passed &= Benchmark_CompressionRun("zlib (level 9)", COMPRESSION_ZLIB, samples, NULL, 0);
+    passed &= Benchmark_CompressionRun("LZ4", COMPRESSION_LZ4, samples, NULL, 0);
+    passed &= Benchmark_CompressionRun("Zstd (level 19)", COMPRESSION_ZSTD, samples, NULL, 0);
+
+    // Compare a trained dictionary against plain Zstd on the small files
+    if (smallSamples.size() >= 8) {
+        size_t totalSmall = 0;
+        for (size_t i = 0; i < smallSamples.size(); i++)
+            totalSmall += smallSamples[i].Size;
+
+        Uint8* sampleData = (Uint8*)Memory::Malloc(totalSmall);
+        size_t* sampleSizes = (size_t*)Memory::Malloc(smallSamples.size() * sizeof(size_t));
+        size_t offset = 0;
+        for (size_t i = 0; i < smallSamples.size(); i++) {
+            memcpy(sampleData + offset, smallSamples[i].Data, smallSamples[i].Size);
+            sampleSizes[i] = smallSamples[i].Size;
+            offset += smallSamples[i].Size;
+        }
+
+        Uint8* dictionary = (Uint8*)Memory::Malloc(dictionaryCapacity);
+        size_t dictionarySize = Zstd::TrainDictionary(sampleData, sampleSizes, (Uint32)smallSamples.size(), dictionary, dictionaryCapacity);
+        if (dictionarySize) {
+            Log::Print(Log::LOG_INFO, "%u files of %u KB or less, %u byte dictionary:",
+                (Uint32)smallSamples.size(), (Uint32)(smallFileSize / 1024), (Uint32)dictionarySize);
+            passed &= Benchmark_CompressionRun("Zstd", COMPRESSION_ZSTD, smallSamples, NULL, 0);
+            passed &= Benchmark_CompressionRun("Zstd + dictionary", COMPRESSION_ZSTD_DICTIONARY, smallSamples, dictionary, dictionarySize);
+        }
+        else
+            Log::Print(Log::LOG_INFO, "Could not train a dictionary on %u small files.", (Uint32)smallSamples.size());
+
+        Memory::Free(dictionary);
+        Memory::Free(sampleSizes);
+        Memory::Free(sampleData);
+    }
+
+    for (size_t i = 0; i < samples.size(); i++)
+        Memory::Free(samples[i].Data);
+
+    return passed;
+}
+
+struct DataPackTestFile {
+    string        Name;
+    vector<Uint8> Data;
+};
+
+static void Benchmark_AddText(vector<Uint8>& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof line, format, args);
+    va_end(args);
+    out.insert(out.end(), line, line + length);
+}
+
+static bool Benchmark_WriteTestFile(const std::filesystem::path& folder, DataPackTestFile& file) {
+    std::filesystem::path path = folder / file.Name;
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    FILE* f = fopen(path.string().c_str(), "wb");
+    if (!f)
+        return false;
+    bool success = fwrite(file.Data.data(), 1, file.Data.size(), f) == file.Data.size();
+    success &= fclose(f) == 0;
+    return success;
+}
+
+// Packs a folder of made-up files the way hatchpack does, with a mix of
+// codecs, duplicates and a load order, then loads every file back out of the
+// pack and checks that it's what went in.
+static bool Benchmark_DataPack() {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "HatchDataPackBenchmark";
+    std::filesystem::path folder = root / "Resources";
+    std::filesystem::path packPath = root / "Test.hatch";
+    std::error_code error;
+    std::filesystem::remove_all(root, error);
+
+    vector<DataPackTestFile> files;
+    files.reserve(64);
+    auto addFile = [&files](const char* name) -> vector<Uint8>& {
+        files.push_back({ string("DataPackTest/") + name, {} });
+        return files.back().Data;
+    };
+    char name[64];
+
+    // Already compressed, so these are stored, and aligned
+    for (int i = 0; i < 3; i++) {
+        snprintf(name, sizeof name, "Sprites/Sprite%d.png", i);
+        vector<Uint8>& data = addFile(name);
+        data.resize(i == 2 ? 1 : 5000 * (i + 1));
+        for (Uint8& byte : data)
+            byte = (Uint8)BenchmarkRandom();
+    }
+    // LZ4 by default, but random data doesn't compress, so it's stored too
+    vector<Uint8>& noise = addFile("Noise.bin");
+    noise.resize(20000);
+    for (Uint8& byte : noise)
+        byte = (Uint8)BenchmarkRandom();
+    // Small scripts that share a Zstd dictionary
+    for (int i = 0; i < 32; i++) {
+        snprintf(name, sizeof name, "Scripts/Script%d.txt", i);
+        vector<Uint8>& data = addFile(name);
+        int lines = 40 + (int)(BenchmarkRandom() % 80);
+        for (int l = 0; l < lines; l++)
+            Benchmark_AddText(data, "    this.value%u = Math.Clamp(other.value%u + %u, 0, %u);\n",
+                BenchmarkRandom() % 16, BenchmarkRandom() % 16, BenchmarkRandom() % 1000, BenchmarkRandom() % 100000);
+    }
+    // Too big for the dictionary, so it's plain Zstd
+    vector<Uint8>& level = addFile("Level.json");
+    Benchmark_AddText(level, "{\n    \"objects\": [\n");
+    for (int i = 0; i < 2000; i++)
+        Benchmark_AddText(level, "        { \"type\": \"Ring\", \"x\": %u, \"y\": %u, \"layer\": %u },\n",
+            BenchmarkRandom() % 16384, BenchmarkRandom() % 2048, BenchmarkRandom() % 4);
+    Benchmark_AddText(level, "    ]\n}\n");
+    // Tile data, LZ4 by default
+    vector<Uint8>& tiles = addFile("Tiles.bin");
+    for (int i = 0; i < 4096; i++) {
+        Uint32 tile = BenchmarkRandom() % 8 == 0 ? BenchmarkRandom() : 0x00010203 * (i % 7);
+        for (int b = 0; b < 16; b++)
+            tiles.push_back((Uint8)(tile >> ((b & 3) * 8)));
+    }
+    // zlib, by a rule that's added below
+    vector<Uint8>& palette = addFile("Palette.dat");
+    for (int i = 0; i < 8192; i++)
+        palette.push_back((Uint8)((i / 24) ^ (i % 3)));
+    addFile("Empty.txt");
+    // Same contents as files above, so they're only written once
+    files.push_back({ "DataPackTest/Copies/Sprite0.png", files[0].Data });
+    files.push_back({ "DataPackTest/Copies/Script3.txt", files[4 + 3].Data });
+    const Uint32 expectedDuplicates = 2;
+
+    const char* loadOrder[] = {
+        "DataPackTest/Sprites/Sprite2.png",
+        "DataPackTest/Tiles.bin",
+        "DataPackTest/Scripts/Script5.txt",
+    };
+    const int loadOrderCount = sizeof(loadOrder) / sizeof(loadOrder[0]);
+
+    for (DataPackTestFile& file : files) {
+        if (!Benchmark_WriteTestFile(folder, file)) {
+            Log::Print(Log::LOG_ERROR, "Could not write \"%s\" in \"%s\"!", file.Name.c_str(), folder.string().c_str());
+            std::filesystem::remove_all(root, error);
+            return false;
+        }
+    }
+
+    DataPackWriter writer;
+    writer.UseDictionary = true;
+    writer.AddCodecRule("dat=zlib");
+    for (int i = 0; i < loadOrderCount; i++)
+        writer.LoadOrder[loadOrder[i]] = i;
+
+    double start = Clock::GetTicks();
+    bool written = writer.Write(folder.string().c_str(), packPath.string().c_str());
+    double packTime = Clock::GetTicks() - start;
+    if (!written) {
+        Log::Print(Log::LOG_ERROR, "Could not pack the test files: %s", writer.Error.c_str());
+        std::filesystem::remove_all(root, error);
+        return false;
+    }
+
+    Uint32 failures = 0;
+
+    // Stored entries have to start on a page to be read in place
+    bool usedCodecs[DataPackCodec::ZSTD_DICTIONARY + 2] = {};
+    Uint64 firstUnordered = UINT64_MAX;
+    for (DataPackWriter::Entry& entry : writer.Entries) {
+        if (entry.Original || entry.Size == 0)
+            continue;
+
+        usedCodecs[entry.Codec + 1] = true;
+        if (entry.Codec == DataPackWriter::CODEC_NONE && entry.Offset % writer.Alignment) {
+            Log::Print(Log::LOG_WARN, "\"%s\" is stored at %llu, which isn't aligned to %llu.",
+                entry.Path.c_str(), (unsigned long long)entry.Offset, (unsigned long long)writer.Alignment);
+            failures++;
+        }
+        if (entry.LoadOrder == INT_MAX && firstUnordered > entry.Offset)
+            firstUnordered = entry.Offset;
+    }
+    for (int codec = DataPackWriter::CODEC_NONE; codec <= DataPackCodec::ZSTD_DICTIONARY; codec++) {
+        if (!usedCodecs[codec + 1]) {
+            Log::Print(Log::LOG_WARN, "Nothing was packed with %s.", DataPackWriter::GetCodecName(codec));
+            failures++;
+        }
+    }
+
+    if (writer.DuplicateCount != expectedDuplicates) {
+        Log::Print(Log::LOG_WARN, "Found %u duplicates, expected %u.", writer.DuplicateCount, expectedDuplicates);
+        failures++;
+    }
+
+    // Files in the load order come first, in that order
+    Uint64 lastOffset = 0;
+    for (int i = 0; i < loadOrderCount; i++) {
+        DataPackWriter::Entry& entry = writer.Entries[i];
+        if (entry.Path != loadOrder[i] || entry.Offset < lastOffset || entry.Offset >= firstUnordered) {
+            Log::Print(Log::LOG_WARN, "\"%s\" is out of load order.", loadOrder[i]);
+            failures++;
+        }
+        lastOffset = entry.Offset;
+    }
+
+    // Read with a registry of its own, so that the game's resources (and
+    // its dictionary, which has the same name) are left alone
+    map<Uint32, DataPackTestFile*> unread;
+    for (DataPackTestFile& file : files)
+        unread[CRC32::EncryptString(file.Name.c_str())] = &file;
+
+    Uint32 missing = 0, mismatches = 0;
+    size_t totalSize = 0;
+    start = Clock::GetTicks();
+    bool opened = ResourceManager::ReadDataPack(packPath.string().c_str(), [&](Uint32 hash, Uint8* packed, size_t packedSize) -> void {
+        auto it = unread.find(hash);
+        // The dictionary isn't one of the files
+        if (it == unread.end()) {
+            Memory::Free(packed);
+            return;
+        }
+
+        DataPackTestFile* file = it->second;
+        unread.erase(it);
+        if (!packed) {
+            Log::Print(Log::LOG_WARN, "\"%s\" could not be read from the data pack.", file->Name.c_str());
+            mismatches++;
+            return;
+        }
+
+        if (packedSize != file->Data.size() || (packedSize && memcmp(packed, file->Data.data(), packedSize))) {
+            Log::Print(Log::LOG_WARN, "\"%s\" doesn't match what was packed.", file->Name.c_str());
+            mismatches++;
+        }
+        totalSize += packedSize;
+        Memory::Free(packed);
+    });
+    double loadTime = Clock::GetTicks() - start;
+
+    if (!opened) {
+        Log::Print(Log::LOG_WARN, "Could not open \"%s\".", packPath.string().c_str());
+        failures++;
+    }
+    for (auto& it : unread) {
+        Log::Print(Log::LOG_WARN, "\"%s\" is not in the data pack.", it.second->Name.c_str());
+        missing++;
+    }
+
+    Log::Print(Log::LOG_INFO, "%u files (%u duplicates), %u bytes packed into %u in %.3f ms",
+        (Uint32)files.size(), writer.DuplicateCount, (Uint32)writer.TotalSize, (Uint32)writer.PackSize, packTime);
+    Log::Print(Log::LOG_INFO, "%u bytes read and checked in %.3f ms: %u missing, %u mismatches, %u other problems (%s)",
+        (Uint32)totalSize, loadTime, missing, mismatches, failures, missing || mismatches || failures ? "FAILED" : "ok");
+
+    std::filesystem::remove_all(root, error);
+
+    return !missing && !mismatches && !failures;
+}
+
+static bool Benchmark_Mixer() {
+    // 64 channels into a stereo, 16-bit callback buffer, the way the audio
+    // callback used to mix them and the way it does now
+    const int channelCount = 64;
+    const int frames = 2048;
+    const int iterations = 200;
+    const double speed = 1.07;
+
+    Sint16* sources = (Sint16*)Memory::Malloc((size_t)channelCount * (frames * 2 + 8) * 2 * sizeof(Sint16));
+    float* panL = (float*)Memory::Malloc(channelCount * sizeof(float));
+    float* panR = (float*)Memory::Malloc(channelCount * sizeof(float));
+    float* gainL = (float*)Memory::Malloc(channelCount * sizeof(float));
+    float* gainR = (float*)Memory::Malloc(channelCount * sizeof(float));
+    int* volumes = (int*)Memory::Malloc(channelCount * sizeof(int));
+    Sint16* panned = (Sint16*)Memory::Malloc(frames * 2 * sizeof(Sint16));
+    Sint16* scalarOut = (Sint16*)Memory::Malloc(frames * 2 * sizeof(Sint16));
+    Sint16* busOut = (Sint16*)Memory::Malloc(frames * 2 * sizeof(Sint16));
+    float* bus = (float*)Memory::Malloc(frames * 2 * sizeof(float));
+    float* source = (float*)Memory::Malloc((frames * 2 + 8) * 2 * sizeof(float));
+
+    // Quiet enough that 64 of them can't clip, so both mixes should agree
+    size_t sourceSamples = (size_t)(frames * 2 + 8) * 2;
+    for (size_t i = 0; i < channelCount * sourceSamples; i++)
+        sources[i] = (Sint16)((int)(BenchmarkRandom() % 801) - 400);
+    for (int c = 0; c < channelCount; c++) {
+        // SDL mixes with volumes out of 128, so use those for both
+        volumes[c] = 32 + (int)(BenchmarkRandom() % 97);
+        float pan = (c % 3) == 0 ? ((int)(BenchmarkRandom() % 201) - 100) / 100.0f : 0.0f;
+        panL[c] = pan > 0.0f ? 1.0f - pan : 1.0f;
+        panR[c] = pan < 0.0f ? 1.0f + pan : 1.0f;
+        gainL[c] = panL[c] * volumes[c] / 128.0f;
+        gainR[c] = panR[c] * volumes[c] / 128.0f;
+    }
+
+    double scalarTime = 0.0, busTime = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = Clock::GetTicks();
+        memset(scalarOut, 0, frames * 2 * sizeof(Sint16));
+        for (int c = 0; c < channelCount; c++) {
+            Sint16* src = sources + c * sourceSamples;
+            if (panL[c] != 1.0f || panR[c] != 1.0f) {
+                for (int f = 0; f < frames; f++) {
+                    panned[f * 2 + 0] = (Sint16)(src[f * 2 + 0] * panL[c]);
+                    panned[f * 2 + 1] = (Sint16)(src[f * 2 + 1] * panR[c]);
+                }
+                src = panned;
+            }
+            SDL_MixAudioFormat((Uint8*)scalarOut, (Uint8*)src, AUDIO_S16SYS, frames * 2 * sizeof(Sint16), volumes[c]);
+        }
+        scalarTime += Clock::GetTicks() - start;
+
+        start = Clock::GetTicks();
+        memset(bus, 0, frames * 2 * sizeof(float));
+        for (int c = 0; c < channelCount; c++) {
+            AudioManager::ConvertToFloat((Uint8*)(sources + c * sourceSamples), source, frames * 2, AUDIO_S16SYS);
+            AudioManager::MixFramesToBus(bus, source, frames, 2, gainL[c], gainR[c]);
+        }
+        AudioManager::ConvertFromFloat(bus, (Uint8*)busOut, frames * 2, AUDIO_S16SYS);
+        busTime += Clock::GetTicks() - start;
+    }
+
+    // SDL rounds every channel down to an integer before adding it
+    int maxError = 0;
+    for (int i = 0; i < frames * 2; i++) {
+        int error = abs(scalarOut[i] - busOut[i]);
+        if (maxError < error)
+            maxError = error;
+    }
+
+    Log::Print(Log::LOG_INFO, "Mix, %d channels: SDL_MixAudioFormat %8.3f ms, float bus %8.3f ms", channelCount, scalarTime / iterations, busTime / iterations);
+    Log::Print(Log::LOG_INFO, "Mix: max difference %d (%s)", maxError, maxError <= channelCount ? "ok" : "FAILED");
+
+    // Every channel playing at another speed. The old path mixed one frame
+    // at a time with no interpolation.
+    double stepTime = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = Clock::GetTicks();
+        memset(scalarOut, 0, frames * 2 * sizeof(Sint16));
+        for (int c = 0; c < channelCount; c++) {
+            Sint16* src = sources + c * sourceSamples;
+            unsigned step = (unsigned)(speed * 0x10000), accumulator = 0, index = 0;
+            for (int f = 0; f < frames; f++) {
+                SDL_MixAudioFormat((Uint8*)(scalarOut + f * 2), (Uint8*)(src + index * 2), AUDIO_S16SYS, 2 * sizeof(Sint16), volumes[c]);
+                accumulator += step;
+                index += accumulator >> 16;
+                accumulator &= 0xFFFF;
+            }
+        }
+        stepTime += Clock::GetTicks() - start;
+    }
+    Log::Print(Log::LOG_INFO, "Resample, %d channels at %.2fx: old stepping %8.3f ms", channelCount, speed, stepTime / iterations);
+
+    const char* qualityNames[] = { "nearest", "linear", "cubic" };
+    for (int quality = AudioManager::RESAMPLE_NEAREST; quality <= AudioManager::RESAMPLE_CUBIC; quality++) {
+        double time = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            double start = Clock::GetTicks();
+            memset(bus, 0, frames * 2 * sizeof(float));
+            for (int c = 0; c < channelCount; c++) {
+                size_t sourceFrames = (size_t)(frames * speed) + 4;
+                AudioManager::ConvertToFloat((Uint8*)(sources + c * sourceSamples), source, sourceFrames * 2, AUDIO_S16SYS);
+
+                double position = 0.0;
+                AudioManager::ResampleToBus(bus, source, sourceFrames - 2, &position, speed, frames, 2, gainL[c], gainR[c], quality);
+            }
+            AudioManager::ConvertFromFloat(bus, (Uint8*)busOut, frames * 2, AUDIO_S16SYS);
+            time += Clock::GetTicks() - start;
+        }
+        Log::Print(Log::LOG_INFO, "Resample, %d channels at %.2fx: float bus, %-7s %8.3f ms", channelCount, speed, qualityNames[quality], time / iterations);
+    }
+
+    Memory::Free(sources);
+    Memory::Free(panL);
+    Memory::Free(panR);
+    Memory::Free(gainL);
+    Memory::Free(gainR);
+    Memory::Free(volumes);
+    Memory::Free(panned);
+    Memory::Free(scalarOut);
+    Memory::Free(busOut);
+    Memory::Free(bus);
+    Memory::Free(source);
+
+    return maxError <= channelCount;
+}
+
+// A WebSocket server on the loopback interface that sends back whatever it
+// gets, for the "websocket" benchmark. It takes one connection, and doesn't
+// check the handshake; the client doesn't check the reply either.
+struct EchoServer {
+    socket_t Listener;
+    Uint32   Frames;
+};
+
+static bool Benchmark_SendAll(socket_t sock, const Uint8* data, size_t size) {
+    while (size) {
+        int ret = (int)send(sock, (const char*)data, (int)size, SEND_FLAGS);
+        if (ret <= 0)
+            return false;
+        data += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+static int Benchmark_EchoServer(void* data) {
+    EchoServer* server = (EchoServer*)data;
+
+    // Don't wait forever if the client never connects
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(server->Listener, &readable);
+    struct timeval timeout = { 5, 0 };
+    if (select((int)server->Listener + 1, &readable, NULL, NULL, &timeout) <= 0)
+        return 0;
+
+    socket_t sock = accept(server->Listener, NULL, NULL);
+    if (sock == INVALID_SOCKET)
+        return 0;
+
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(flag));
+
+    vector<Uint8> in, out;
+    char buffer[65536];
+    bool handshaken = false, closed = false;
+    while (!closed) {
+        int got = (int)recv(sock, buffer, sizeof buffer, 0);
+        if (got <= 0)
+            break;
+        in.insert(in.end(), (Uint8*)buffer, (Uint8*)buffer + got);
+
+        if (!handshaken) {
+            const char* end = "\r\n\r\n";
+            auto headerEnd = std::search(in.begin(), in.end(), end, end + 4);
+            if (headerEnd == in.end())
+                continue;
+            in.erase(in.begin(), headerEnd + 4);
+
+            const char* reply = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n";
+            out.insert(out.end(), reply, reply + strlen(reply));
+            handshaken = true;
+        }
+
+        size_t position = 0;
+        while (!closed && in.size() - position >= 2) {
+            Uint8* frame = in.data() + position;
+            size_t available = in.size() - position;
+            int opcode = frame[0] & 0x0F;
+            bool masked = frame[1] & 0x80;
+            Uint64 length = frame[1] & 0x7F;
+            size_t headerSize = 2;
+            if (length == 126) {
+                headerSize = 4;
+                if (available < headerSize)
+                    break;
+                length = (frame[2] << 8) | frame[3];
+            }
+            else if (length == 127) {
+                headerSize = 10;
+                if (available < headerSize)
+                    break;
+                length = 0;
+                for (int i = 0; i < 8; i++)
+                    length = (length << 8) | frame[2 + i];
+            }
+            Uint8* mask = frame + headerSize;
+            if (masked)
+                headerSize += 4;
+            if (available < headerSize + length)
+                break;
+
+            Uint8* payload = frame + headerSize;
+            if (masked) {
+                for (Uint64 i = 0; i < length; i++)
+                    payload[i] ^= mask[i & 3];
+            }
+
+            // Servers don't mask what they send. Pings get a pong, and a
+            // close gets a close back.
+            out.push_back((frame[0] & 0x80) | (opcode == 0x9 ? 0xA : opcode));
+            if (length < 126)
+                out.push_back((Uint8)length);
+            else if (length < 0x10000) {
+                out.push_back(126);
+                out.push_back((Uint8)(length >> 8));
+                out.push_back((Uint8)length);
+            }
+            else {
+                out.push_back(127);
+                for (int i = 7; i >= 0; i--)
+                    out.push_back((Uint8)(length >> (i * 8)));
+            }
+            out.insert(out.end(), payload, payload + length);
+
+            server->Frames++;
+            position += headerSize + length;
+            closed = opcode == 0x8;
+        }
+        in.erase(in.begin(), in.begin() + position);
+
+        if (out.size() && !Benchmark_SendAll(sock, out.data(), out.size()))
+            break;
+        out.clear();
+    }
+
+    closesocket(sock);
+    return 0;
+}
+
+struct EchoMessage {
+    Uint32 Index;
+    double SentAt;
+};
+
+// Takes the next echo the client has, if any. Anything that isn't the size
+// of an EchoMessage comes back with an index that can't match.
+static bool Benchmark_ReceiveEcho(WebSocketClient* client, EchoMessage* message) {
+    size_t size = client->BytesToRead();
+    if (!size)
+        return false;
+
+    if (size != sizeof(EchoMessage)) {
+        vector<Uint8> discard(size);
+        client->ReadBytes(discard.data(), size);
+        message->Index = UINT32_MAX;
+        return true;
+    }
+    client->ReadBytes(message, sizeof(EchoMessage));
+    return true;
+}
+
+// Sends messages to an echo server on this machine, and checks that every
+// one comes back, in order. Measures the round trip time of one message at
+// a time, the latency at a steady 10,000 messages per second (more than a
+// game sends), and how many messages can go back and forth per second.
+static bool Benchmark_WebSocket() {
+    const int rttCount = 1000;
+    const int pacedRate = 10000;
+    const int pacedDuration = 1000;
+    const int throughputCount = 100000;
+    // How long to wait for echoes before giving up
+    const double timeout = 5000.0;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        Log::Print(Log::LOG_ERROR, "WSAStartup failed.");
+        return false;
+    }
+#endif
+
+    EchoServer server = {};
+    server.Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server.Listener == INVALID_SOCKET) {
+        Log::Print(Log::LOG_ERROR, "Could not create a socket for the echo server.");
+        return false;
+    }
+
+    // Any free port will do
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server.Listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || listen(server.Listener, 1) == SOCKET_ERROR
+        || getsockname(server.Listener, (struct sockaddr*)&address, &addressLength) == SOCKET_ERROR) {
+        Log::Print(Log::LOG_ERROR, "Could not start the echo server.");
+        closesocket(server.Listener);
+        return false;
+    }
+
+    SDL_Thread* serverThread = SDL_CreateThread(Benchmark_EchoServer, "EchoServer", &server);
+    if (!serverThread) {
+        Log::Print(Log::LOG_ERROR, "Could not start the echo server thread.");
+        closesocket(server.Listener);
+        return false;
+    }
+
+    char url[64];
+    snprintf(url, sizeof url, "ws://127.0.0.1:%d", (int)ntohs(address.sin_port));
+    WebSocketClient* client = WebSocketClient::New(url);
+    if (!client) {
+        Log::Print(Log::LOG_ERROR, "Could not connect to the echo server at %s.", url);
+        SDL_WaitThread(serverThread, NULL);
+        closesocket(server.Listener);
+        return false;
+    }
+
+    bool passed = true;
+    EchoMessage message;
+    Uint32 received = 0;
+
+    // One message at a time
+    double rttTotal = 0.0, rttMax = 0.0;
+    for (int i = 0; i < rttCount && passed; i++) {
+        EchoMessage sent = { (Uint32)i, Clock::GetTicks() };
+        client->SendBinary(&sent, sizeof sent);
+
+        bool echoed;
+        while (!(echoed = Benchmark_ReceiveEcho(client, &message))) {
+            if (Clock::GetTicks() - sent.SentAt > timeout || client->GetReadyState() != WebSocketClient::OPEN)
+                break;
+            client->Poll(100);
+        }
+
+        double rtt = Clock::GetTicks() - sent.SentAt;
+        if (!echoed || message.Index != sent.Index) {
+            Log::Print(Log::LOG_WARN, "Message %d %s.", i, echoed ? "came back different" : "never came back");
+            passed = false;
+        }
+        rttTotal += rtt;
+        if (rttMax < rtt)
+            rttMax = rtt;
+    }
+    if (passed) {
+        Log::Print(Log::LOG_INFO, "Round trip, %d messages one at a time: avg %.3f ms, max %.3f ms",
+            rttCount, rttTotal / rttCount, rttMax);
+    }
+
+    // A steady stream, read as it comes back
+    if (passed) {
+        Uint32 total = (Uint32)pacedRate * pacedDuration / 1000;
+        Uint32 sent = 0;
+        double latencyTotal = 0.0, latencyMax = 0.0;
+        double start = Clock::GetTicks();
+        received = 0;
+        while (received < total && passed) {
+            double elapsed = Clock::GetTicks() - start;
+            Uint32 due = std::min(total, (Uint32)(elapsed * pacedRate / 1000.0));
+            for (; sent < due; sent++) {
+                EchoMessage outgoing = { sent, Clock::GetTicks() };
+                client->SendBinary(&outgoing, sizeof outgoing);
+            }
+
+            bool any = false;
+            while (Benchmark_ReceiveEcho(client, &message)) {
+                if (message.Index != received) {
+                    Log::Print(Log::LOG_WARN, "Expected message %u, got %u.", received, message.Index);
+                    passed = false;
+                    break;
+                }
+                double latency = Clock::GetTicks() - message.SentAt;
+                latencyTotal += latency;
+                if (latencyMax < latency)
+                    latencyMax = latency;
+                received++;
+                any = true;
+            }
+
+            if (elapsed > pacedDuration + timeout || client->GetReadyState() != WebSocketClient::OPEN) {
+                Log::Print(Log::LOG_WARN, "Only %u of %u messages came back.", received, total);
+                passed = false;
+            }
+            else if (!any)
+                client->Poll(1);
+        }
+        if (passed) {
+            Log::Print(Log::LOG_INFO, "Round trip, %d messages/s for %d ms: avg %.3f ms, max %.3f ms",
+                pacedRate, pacedDuration, latencyTotal / total, latencyMax);
+        }
+    }
+
+    // As fast as they go
+    if (passed) {
+        double start = Clock::GetTicks();
+        received = 0;
+        for (Uint32 i = 0; i < (Uint32)throughputCount || received < (Uint32)throughputCount; ) {
+            if (i < (Uint32)throughputCount) {
+                EchoMessage outgoing = { i++, 0.0 };
+                client->SendBinary(&outgoing, sizeof outgoing);
+            }
+            else if (Clock::GetTicks() - start > timeout || client->GetReadyState() != WebSocketClient::OPEN) {
+                Log::Print(Log::LOG_WARN, "Only %u of %d messages came back.", received, throughputCount);
+                passed = false;
+                break;
+            }
+            else
+                client->Poll(100);
+
+            while (Benchmark_ReceiveEcho(client, &message)) {
+                if (message.Index != received) {
+                    Log::Print(Log::LOG_WARN, "Expected message %u, got %u.", received, message.Index);
+                    passed = false;
+                    break;
+                }
+                received++;
+            }
+            if (!passed)
+                break;
+        }
+        double elapsed = Clock::GetTicks() - start;
+        if (passed) {
+            Log::Print(Log::LOG_INFO, "Throughput, %d messages: %8.3f ms, %.0f round trips/s",
+                throughputCount, elapsed, throughputCount / (elapsed / 1000.0));
+        }
+    }
+
+    // Closing shouldn't hold up the caller
+    double closeStart = Clock::GetTicks();
+    WebSocketClient::CloseAndDelete(client);
+    double closeTime = Clock::GetTicks() - closeStart;
+    WebSocketClient::DeleteClosed(true);
+
+    SDL_WaitThread(serverThread, NULL);
+    closesocket(server.Listener);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    Log::Print(Log::LOG_INFO, "Close: returned in %.3f ms, %u frames echoed (%s)",
+        closeTime, server.Frames, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+#define HOTRELOAD_SCRIPT "Scripts/HotReloadBenchmark.hsl"
+
+static bool Benchmark_WriteScript(int value) {
+    // Different lengths, so that the change shows up where only sizes and
+    // modified times are checked
+    char source[256];
+    snprintf(source, sizeof source,
+        "class HotReloadBenchmark {\n"
+        "    event Value() {\n"
+        "        return %d;\n"
+        "    }\n"
+        "}\n", value);
+
+    FILE* f = fopen(HOTRELOAD_SCRIPT, "wb");
+    if (!f)
+        return false;
+    bool success = fwrite(source, 1, strlen(source), f) == strlen(source);
+    success &= fclose(f) == 0;
+    return success;
+}
+
+static bool Benchmark_CallValue(ObjInstance* instance, Uint32 hash, int* out) {
+    VMValue method = ScriptManager::GetClassMethod(instance->Object.Class, hash);
+    if (!IS_FUNCTION(method))
+        return false;
+
+    VMThread* thread = ScriptManager::Threads + 0;
+    VMValue* stackTop = thread->StackTop;
+    thread->Push(OBJECT_VAL(instance));
+    VMValue result = thread->RunEntityFunction(AS_FUNCTION(method), 0);
+    thread->StackTop = stackTop;
+
+    if (!IS_INTEGER(result))
+        return false;
+    *out = AS_INTEGER(result);
+    return true;
+}
+
+// Writes a script, loads it and makes an instance of its class, then saves
+// a new version of it while frames go by. Passes once the instance's
+// method returns the new value at the end of a frame, the way it would in
+// a game.
+static bool Benchmark_HotReload() {
+#ifdef NO_SCRIPT_COMPILING
+    Log::Print(Log::LOG_INFO, "This build can't compile scripts, so there's nothing to reload.");
+    return true;
+#else
+    const int oldValue = 1;
+    const int newValue = 1234;
+    const double frameTime = 1000.0 / 60.0;
+    const double timeout = 5000.0;
+
+    bool createdFolder = false;
+    if (!Directory::Exists("Scripts")) {
+        Directory::Create("Scripts");
+        createdFolder = true;
+    }
+    if (!Benchmark_WriteScript(oldValue)) {
+        Log::Print(Log::LOG_ERROR, "Could not write \"%s\"!", HOTRELOAD_SCRIPT);
+        return false;
+    }
+
+    // What Scene::Init does for scripts
+    GarbageCollector::Init();
+    Compiler::Init();
+    SourceFileMap::CheckForUpdate();
+    SourceFileWatcher::Init();
+    ScriptManager::Init();
+    ScriptManager::ResetStack();
+    ScriptManager::LinkStandardLibrary();
+    ScriptManager::LinkExtensions();
+
+    Uint32 filenameHash = ScriptManager::MakeFilenameHash((char*)"HotReloadBenchmark.hsl");
+    Uint32 valueHash = Murmur::EncryptString("Value");
+    bool passed = false;
+    int value = 0;
+    double elapsed = 0.0;
+    int frames = 0;
+
+    ObjClass* klass = NULL;
+    if (ScriptManager::LoadScript(filenameHash))
+        klass = ScriptManager::GetObjectClass("HotReloadBenchmark");
+
+    if (!SourceFileWatcher::Enabled)
+        Log::Print(Log::LOG_ERROR, "Hot reloading is turned off in the settings.");
+    else if (!klass)
+        Log::Print(Log::LOG_ERROR, "Could not load \"%s\"!", HOTRELOAD_SCRIPT);
+    else {
+        // Kept in a global, so that the garbage collector leaves it alone
+        ObjInstance* instance = NewInstance(klass);
+        ScriptManager::Globals->Put("HotReloadBenchmarkInstance", OBJECT_VAL(instance));
+
+        if (!Benchmark_CallValue(instance, valueHash, &value) || value != oldValue)
+            Log::Print(Log::LOG_ERROR, "The script returned %d before it was changed, expected %d.", value, oldValue);
+        else {
+            // Give the watcher a moment to start
+            SDL_Delay(100);
+
+            double start = Clock::GetTicks();
+            if (Benchmark_WriteScript(newValue)) {
+                while (elapsed < timeout) {
+                    SDL_Delay((Uint32)frameTime);
+                    Scene::AfterScene();
+                    frames++;
+                    elapsed = Clock::GetTicks() - start;
+
+                    if (!Benchmark_CallValue(instance, valueHash, &value))
+                        break;
+                    if (value != oldValue)
+                        break;
+                }
+            }
+            passed = value == newValue;
+
+            if (value == oldValue)
+                Log::Print(Log::LOG_WARN, "The script wasn't reloaded after %.0f ms.", elapsed);
+            else if (value != newValue)
+                Log::Print(Log::LOG_WARN, "The reloaded script returned %d, expected %d.", value, newValue);
+        }
+
+        ScriptManager::Globals->Remove("HotReloadBenchmarkInstance");
+    }
+
+    // What Scene::Dispose does for scripts
+    SourceFileWatcher::Dispose();
+    ScriptManager::Dispose();
+    SourceFileMap::Dispose();
+    Compiler::Dispose();
+
+    char bytecodeFile[64];
+    snprintf(bytecodeFile, sizeof bytecodeFile, "Resources/Objects/%08X.ibc", filenameHash);
+    remove(bytecodeFile);
+    remove(HOTRELOAD_SCRIPT);
+    if (createdFolder) {
+        std::error_code error;
+        std::filesystem::remove("Scripts", error);
+    }
+
+    Log::Print(Log::LOG_INFO, "Changed script: %d frames, %.3f ms until it returned %d (%s)",
+        frames, elapsed, value, passed ? "ok" : "FAILED");
+    return passed;
+#endif
+}
+
+static BenchmarkEntry Benchmarks[] = {
+    { "facesort", Benchmark_FaceSort },
+    { "transform", Benchmark_Transform },
+    { "skinning", Benchmark_Skinning },
+    { "resourceload", Benchmark_ResourceLoad },
+    { "compression", Benchmark_Compression },
+    { "datapack", Benchmark_DataPack },
+    { "mixer", Benchmark_Mixer },
+    { "websocket", Benchmark_WebSocket },
+    { "hotreload", Benchmark_HotReload },
+};
+
+// Returns false if there's no benchmark with that name, or if one of its
+// checks failed.
+PUBLIC STATIC bool Benchmark::Run(const char* name) {
+    bool found = false;
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++) {
+        if (!strcmp(name, "all") || !strcmp(name, Benchmarks[i].Name)) {
+            Log::Print(Log::LOG_IMPORTANT, "Benchmark \"%s\":", Benchmarks[i].Name);
+            if (!Benchmarks[i].Function()) {
+                Log::Print(Log::LOG_ERROR, "Benchmark \"%s\" failed!", Benchmarks[i].Name);
+                passed = false;
+            }
+            found = true;
+        }
+    }
+
+    if (!found)
+        Log::Print(Log::LOG_ERROR, "No benchmark named \"%s\"!", name);
+
+    return found && passed;
+}
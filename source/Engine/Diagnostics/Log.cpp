@@ -12,6 +12,9 @@ public:
     static int         LogLevel;
     static const char* LogFilename;
     static bool        WriteToFile;
+    // The log file is moved aside once it's this big, in kilobytes. 0 lets
+    // it grow forever.
+    static int         MaxFileSize;
 };
 #endif
 
@@ -27,7 +30,6 @@ extern "C" {
     #include <Engine/Platforms/MacOS/Filesystem.h>
 }
 #include <Engine/Filesystem/Directory.h>
-#include <Engine/Includes/StandardSDL2.h>
 #include <unistd.h>
 #endif
 
@@ -35,18 +37,211 @@ extern "C" {
     #include <android/log.h>
 #endif
 
+#include <Engine/Includes/StandardSDL2.h>
 #include <stdarg.h>
+#include <signal.h>
 
 int         Log::LogLevel = -1;
 bool        Log::WriteToFile = false;
 const char* Log::LogFilename = TARGET_NAME ".log";
+int         Log::MaxFileSize = 8192;
 
 bool        Log_Initialized = false;
 
+// Messages are formatted by the thread printing them into a ring, and
+// written out by the log thread, so printing never waits on the console or
+// the file system. When the ring is full, messages are dropped and counted.
+// Before the log thread starts and after it stops, messages are written
+// right away.
+
+// Must be a power of two
+#define LOG_RING_SIZE 1024
+// Longer messages are allocated separately
+#define LOG_RECORD_TEXT_SIZE 240
+// Rotated log files kept, as <LogFilename>.1 and so on
+#define LOG_ROTATE_COUNT 3
+// How often the log thread writes out messages, in milliseconds
+#define LOG_FLUSH_INTERVAL 100
+
+struct LogRecord {
+    // Equal to the record's position once it's free to write to, and one
+    // more than that once it's ready to be read
+    SDL_atomic_t Sequence;
+    int          Severity;
+    char*        LongText;
+    char         Text[LOG_RECORD_TEXT_SIZE];
+};
+
+static LogRecord     Log_Ring[LOG_RING_SIZE];
+static SDL_atomic_t  Log_WritePos;
+static Uint32        Log_ReadPos = 0;
+// Dropped messages not yet mentioned in the log, and since the start
+static SDL_atomic_t  Log_Dropped;
+static SDL_atomic_t  Log_DroppedTotal;
+static SDL_atomic_t  Log_Running;
+static SDL_atomic_t  Log_Quit;
+static SDL_Thread*   Log_Thread = NULL;
+static SDL_sem*      Log_Wake = NULL;
+// Held while writing out messages: emptying the ring, which the log thread
+// and Log::Flush can both do, or writing one right away without the thread
+static SDL_SpinLock  Log_OutputLock = 0;
+
+static FILE*         Log_File = NULL;
+
 #if WIN32 || LINUX
 #define USING_COLOR_CODES 1
 #endif
 
+static void Log_WriteConsole(int sev, const char* string) {
+    #ifdef USING_COLOR_CODES
+    int ColorCode = 0;
+    #endif
+
+    #if defined(WIN32)
+        switch (sev) {
+            case Log::LOG_VERBOSE:   ColorCode = 0xD; break;
+            case Log::LOG_INFO:      ColorCode = 0x8; break;
+            case Log::LOG_WARN:      ColorCode = 0xE; break;
+            case Log::LOG_ERROR:     ColorCode = 0xC; break;
+            case Log::LOG_IMPORTANT: ColorCode = 0xB; break;
+        }
+        CONSOLE_SCREEN_BUFFER_INFO csbi;
+        HANDLE hStdOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (GetConsoleScreenBufferInfo(hStdOut, &csbi)) {
+            WORD wColor = (csbi.wAttributes & 0xF0) + ColorCode;
+            SetConsoleTextAttribute(hStdOut, wColor);
+        }
+    #elif USING_COLOR_CODES
+        switch (sev) {
+            case Log::LOG_VERBOSE:   ColorCode = 94; break;
+            case Log::LOG_INFO:      ColorCode = 00; break;
+            case Log::LOG_WARN:      ColorCode = 93; break;
+            case Log::LOG_ERROR:     ColorCode = 91; break;
+            case Log::LOG_IMPORTANT: ColorCode = 96; break;
+        }
+        printf("\x1b[%d;1m", ColorCode);
+    #endif
+
+    printf("%s", Log::GetSeverityText(sev));
+
+    #if WIN32
+        // Flush before changing the color back, or it applies to the
+        // buffered text too
+        fflush(stdout);
+		WORD wColor = (csbi.wAttributes & 0xF0) | 0x07;
+        SetConsoleTextAttribute(hStdOut, wColor);
+    #elif USING_COLOR_CODES
+        printf("\x1b[0m");
+    #endif
+
+    printf("%s\n", string);
+}
+
+// Moves the log file to <LogFilename>.1, and older ones along, once it's
+// over the size limit.
+static void Log_RotateFile() {
+    if (!Log_File || Log::MaxFileSize <= 0)
+        return;
+    if (ftell(Log_File) < (long)Log::MaxFileSize * 1024)
+        return;
+
+    fclose(Log_File);
+    Log_File = NULL;
+
+    char from[4096];
+    char to[4096];
+    for (int i = LOG_ROTATE_COUNT; i > 0; i--) {
+        snprintf(to, sizeof to, "%s.%d", Log::LogFilename, i);
+        if (i > 1)
+            snprintf(from, sizeof from, "%s.%d", Log::LogFilename, i - 1);
+        else
+            snprintf(from, sizeof from, "%s", Log::LogFilename);
+        remove(to);
+        rename(from, to);
+    }
+}
+static void Log_WriteFile(int sev, const char* string) {
+    if (!Log::WriteToFile)
+        return;
+
+    if (!Log_File) {
+        Log_File = fopen(Log::LogFilename, "a");
+        if (!Log_File)
+            return;
+        setvbuf(Log_File, NULL, _IOFBF, 64 * 1024);
+    }
+
+    fprintf(Log_File, "%s%s\n", Log::GetSeverityText(sev), string);
+}
+static void Log_WriteMessage(int sev, const char* string) {
+    Log_WriteConsole(sev, string);
+    Log_WriteFile(sev, string);
+}
+static void Log_FlushOutput() {
+    fflush(stdout);
+    if (Log_File) {
+        fflush(Log_File);
+        Log_RotateFile();
+    }
+}
+
+// Writes out every message that's ready. Only one thread can do this at a
+// time.
+static void Log_Drain() {
+    int dropped = SDL_AtomicSet(&Log_Dropped, 0);
+    if (dropped > 0) {
+        char message[64];
+        snprintf(message, sizeof message, "%d log message(s) were dropped.", dropped);
+        Log_WriteMessage(Log::LOG_WARN, message);
+    }
+
+    for (;;) {
+        LogRecord* record = &Log_Ring[Log_ReadPos & (LOG_RING_SIZE - 1)];
+        if ((Uint32)SDL_AtomicGet(&record->Sequence) != Log_ReadPos + 1)
+            break;
+
+        Log_WriteMessage(record->Severity, record->LongText ? record->LongText : record->Text);
+        if (record->LongText) {
+            free(record->LongText);
+            record->LongText = NULL;
+        }
+
+        SDL_AtomicSet(&record->Sequence, (int)(Log_ReadPos + LOG_RING_SIZE));
+        Log_ReadPos++;
+    }
+
+    Log_FlushOutput();
+}
+
+static int Log_ThreadFunc(void* data) {
+    for (;;) {
+        SDL_SemWaitTimeout(Log_Wake, LOG_FLUSH_INTERVAL);
+
+        SDL_AtomicLock(&Log_OutputLock);
+        Log_Drain();
+        SDL_AtomicUnlock(&Log_OutputLock);
+
+        if (SDL_AtomicGet(&Log_Quit))
+            break;
+    }
+    return 0;
+}
+
+static void Log_AtExit() {
+    Log::Flush();
+}
+static void Log_CrashHandler(int sig) {
+    Log::Flush();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+#ifdef WIN32
+static LONG WINAPI Log_ExceptionFilter(EXCEPTION_POINTERS* info) {
+    Log::Flush();
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
 PUBLIC STATIC void Log::Init() {
     if (Log_Initialized)
         return;
@@ -68,6 +263,11 @@ PUBLIC STATIC void Log::Init() {
     WriteToFile = true;
     #endif
 
+    if (Log_File) {
+        fclose(Log_File);
+        Log_File = NULL;
+    }
+
     FILE* f = NULL;
 
     if (WriteToFile) {
@@ -82,56 +282,59 @@ PUBLIC STATIC void Log::Init() {
     }
 
     Log_Initialized = true;
+
+    #ifndef ANDROID
+    for (int i = 0; i < LOG_RING_SIZE; i++) {
+        SDL_AtomicSet(&Log_Ring[i].Sequence, i);
+        Log_Ring[i].LongText = NULL;
+    }
+    SDL_AtomicSet(&Log_WritePos, 0);
+    SDL_AtomicSet(&Log_Quit, 0);
+    Log_ReadPos = 0;
+
+    Log_Wake = SDL_CreateSemaphore(0);
+    Log_Thread = Log_Wake ? SDL_CreateThread(Log_ThreadFunc, "Log", NULL) : NULL;
+    if (Log_Thread)
+        SDL_AtomicSet(&Log_Running, 1);
+
+    // Whatever happens, messages still in the ring get written
+    atexit(Log_AtExit);
+    signal(SIGSEGV, Log_CrashHandler);
+    signal(SIGABRT, Log_CrashHandler);
+    signal(SIGFPE, Log_CrashHandler);
+    signal(SIGILL, Log_CrashHandler);
+    #ifdef WIN32
+    SetUnhandledExceptionFilter(Log_ExceptionFilter);
+    #endif
+    #endif
 }
 
 PUBLIC STATIC void Log::SetLogLevel(int sev) {
     Log::LogLevel = sev;
 }
 
-PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
-    #ifdef USING_COLOR_CODES
-    int ColorCode = 0;
-    #endif
+PUBLIC STATIC const char* Log::GetSeverityText(int sev) {
+    switch (sev) {
+        case   LOG_VERBOSE: return "  VERBOSE: ";
+        case      LOG_INFO: return "     INFO: ";
+        case      LOG_WARN: return "  WARNING: ";
+        case     LOG_ERROR: return "    ERROR: ";
+        case LOG_IMPORTANT: return "IMPORTANT: ";
+    }
+    return "";
+}
 
+PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
     if (sev < Log::LogLevel)
         return;
 
-    static char* stringBuffer = NULL;
-    static size_t stringBufferSize = 0;
-    const char* severityText = NULL;
-
-    va_list args;
-    va_start(args, format);
-    int written_chars = vsnprintf(stringBuffer, stringBufferSize, format, args);
-    va_end(args);
-
-    if (written_chars <= 0)
-        return;
-    else if (written_chars + 1 >= stringBufferSize) {
-        stringBufferSize = written_chars + 1024;
-
-        char* newStringBuffer = (char*)realloc(stringBuffer, stringBufferSize * sizeof(char));
-
-        // If the reallocation failed, try again with a smaller buffer size
-        if (!newStringBuffer) {
-            stringBufferSize = 1024;
-            newStringBuffer = (char*)realloc(stringBuffer, stringBufferSize * sizeof(char));
-
-            // If THAT failed too, just give up
-            if (!newStringBuffer)
-                return;
-        }
-        else
-            stringBuffer = newStringBuffer;
-
+    #if defined(ANDROID)
+        char string[1024];
+        va_list args;
         va_start(args, format);
-        vsnprintf(stringBuffer, stringBufferSize, format, args);
+        vsnprintf(string, sizeof string, format, args);
         va_end(args);
-    }
 
-    const char *string = stringBuffer;
-
-    #if defined(ANDROID)
         switch (sev) {
             case   LOG_VERBOSE: __android_log_print(ANDROID_LOG_VERBOSE, TARGET_NAME, "%s", string); return;
             case      LOG_INFO: __android_log_print(ANDROID_LOG_INFO,    TARGET_NAME, "%s", string); return;
@@ -139,62 +342,129 @@ PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
             case     LOG_ERROR: __android_log_print(ANDROID_LOG_ERROR,   TARGET_NAME, "%s", string); return;
             case LOG_IMPORTANT: __android_log_print(ANDROID_LOG_FATAL,   TARGET_NAME, "%s", string); return;
         }
+        return;
     #endif
 
-    FILE* f = NULL;
-    if (WriteToFile) {
-        f = fopen(LogFilename, "a");
-    }
+    // Without the log thread, write it out now
+    if (!SDL_AtomicGet(&Log_Running)) {
+        char buffer[LOG_RECORD_TEXT_SIZE];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof buffer, format, args);
+        va_end(args);
+        if (length < 0)
+            return;
 
-    #if defined(WIN32)
-        switch (sev) {
-            case   LOG_VERBOSE: ColorCode = 0xD; break;
-            case      LOG_INFO: ColorCode = 0x8; break;
-            case      LOG_WARN: ColorCode = 0xE; break;
-            case     LOG_ERROR: ColorCode = 0xC; break;
-            case LOG_IMPORTANT: ColorCode = 0xB; break;
+        char* string = buffer;
+        if (length >= (int)sizeof buffer) {
+            string = (char*)malloc(length + 1);
+            if (!string)
+                return;
+            va_start(args, format);
+            vsnprintf(string, length + 1, format, args);
+            va_end(args);
         }
-        CONSOLE_SCREEN_BUFFER_INFO csbi;
-        HANDLE hStdOut = GetStdHandle(STD_OUTPUT_HANDLE);
-        if (GetConsoleScreenBufferInfo(hStdOut, &csbi)) {
-            WORD wColor = (csbi.wAttributes & 0xF0) + ColorCode;
-            SetConsoleTextAttribute(hStdOut, wColor);
+
+        SDL_AtomicLock(&Log_OutputLock);
+        Log_WriteMessage(sev, string);
+        Log_FlushOutput();
+        SDL_AtomicUnlock(&Log_OutputLock);
+        if (string != buffer)
+            free(string);
+        return;
+    }
+
+    // Claim the next free record
+    LogRecord* record;
+    Uint32 position;
+    for (;;) {
+        position = (Uint32)SDL_AtomicGet(&Log_WritePos);
+        record = &Log_Ring[position & (LOG_RING_SIZE - 1)];
+
+        int difference = (int)((Uint32)SDL_AtomicGet(&record->Sequence) - position);
+        if (difference == 0) {
+            if (SDL_AtomicCAS(&Log_WritePos, (int)position, (int)(position + 1)))
+                break;
         }
-    #elif USING_COLOR_CODES
-        switch (sev) {
-            case   LOG_VERBOSE: ColorCode = 94; break;
-            case      LOG_INFO: ColorCode = 00; break;
-            case      LOG_WARN: ColorCode = 93; break;
-            case     LOG_ERROR: ColorCode = 91; break;
-            case LOG_IMPORTANT: ColorCode = 96; break;
+        else if (difference < 0) {
+            SDL_AtomicAdd(&Log_Dropped, 1);
+            SDL_AtomicAdd(&Log_DroppedTotal, 1);
+            return;
         }
-        printf("\x1b[%d;1m", ColorCode);
-    #endif
+    }
 
-    switch (sev) {
-        case   LOG_VERBOSE: severityText = "  VERBOSE: "; break;
-        case      LOG_INFO: severityText = "     INFO: "; break;
-        case      LOG_WARN: severityText = "  WARNING: "; break;
-        case     LOG_ERROR: severityText = "    ERROR: "; break;
-        case LOG_IMPORTANT: severityText = "IMPORTANT: "; break;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record->Text, sizeof record->Text, format, args);
+    va_end(args);
+
+    if (length < 0)
+        record->Text[0] = 0;
+    else if (length >= (int)sizeof record->Text) {
+        record->LongText = (char*)malloc(length + 1);
+        if (record->LongText) {
+            va_start(args, format);
+            vsnprintf(record->LongText, length + 1, format, args);
+            va_end(args);
+        }
     }
+    record->Severity = sev;
 
-    printf("%s", severityText);
-    if (WriteToFile && f)
-        fprintf(f, "%s", severityText);
+    SDL_AtomicSet(&record->Sequence, (int)(position + 1));
 
-    #if WIN32
-		WORD wColor = (csbi.wAttributes & 0xF0) | 0x07;
-        SetConsoleTextAttribute(hStdOut, wColor);
-    #elif USING_COLOR_CODES
-        printf("\x1b[0m");
-    #endif
+    // Get errors out quickly, in case they're followed by a crash
+    if (sev >= LOG_ERROR)
+        SDL_SemPost(Log_Wake);
+}
 
-    printf("%s\n", string);
-    fflush(stdout);
+// Writes out every message printed so far, and waits until it's done. Safe
+// to call while crashing, mostly.
+PUBLIC STATIC void Log::Flush() {
+    // If the thread that's writing is the one crashing, it may never let go
+    bool locked = false;
+    for (int i = 0; i < 100 && !locked; i++) {
+        locked = SDL_AtomicTryLock(&Log_OutputLock);
+        if (!locked)
+            SDL_Delay(1);
+    }
 
-    if (WriteToFile && f) {
-        fprintf(f, "%s\n", string);
-        fclose(f);
+    // Only the thread holding the lock may read the ring
+    if (!locked) {
+        Log_FlushOutput();
+        return;
     }
+
+    if (SDL_AtomicGet(&Log_Running))
+        Log_Drain();
+    else
+        Log_FlushOutput();
+
+    SDL_AtomicUnlock(&Log_OutputLock);
+}
+
+// The number of messages dropped because too many were printed at once.
+PUBLIC STATIC int Log::GetDroppedCount() {
+    return SDL_AtomicGet(&Log_DroppedTotal);
+}
+
+// Stops the log thread. Messages printed afterward are written right away.
+PUBLIC STATIC void Log::Dispose() {
+    if (!Log_Thread)
+        return;
+
+    // From here on, messages are written right away, and the ones already in
+    // the ring are written below, after the thread's last pass
+    SDL_AtomicSet(&Log_Running, 0);
+
+    SDL_AtomicSet(&Log_Quit, 1);
+    SDL_SemPost(Log_Wake);
+    SDL_WaitThread(Log_Thread, NULL);
+    Log_Thread = NULL;
+
+    SDL_AtomicLock(&Log_OutputLock);
+    Log_Drain();
+    SDL_AtomicUnlock(&Log_OutputLock);
+
+    SDL_DestroySemaphore(Log_Wake);
+    Log_Wake = NULL;
 }
@@ -15,6 +15,7 @@ public:
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Includes/StandardSDL2.h>
 
 // #if defined(ANDROID)
 // #define NOTRACK
@@ -26,6 +27,10 @@ vector<const char*>  Memory::TrackedMemoryNames;
 size_t               Memory::MemoryUsage = 0;
 bool                 Memory::IsTracking = false;
 
+// Resources can be loaded from other threads, so the tracking lists are
+// guarded by a spinlock.
+static SDL_SpinLock  TrackingLock = 0;
+
 PUBLIC STATIC void   Memory::Memset4(void* dst, Uint32 val, size_t dwords) {
     #if defined(__GNUC__) && defined(i386)
         int u0, u1, u2;
@@ -57,11 +62,13 @@ PUBLIC STATIC void*  Memory::Malloc(size_t size) {
     void* mem = malloc(size);
     if (Memory::IsTracking) {
         if (mem) {
+            SDL_AtomicLock(&TrackingLock);
             MemoryUsage += size;
 
             TrackedMemory.push_back(mem);
             TrackedSizes.push_back(size);
             TrackedMemoryNames.push_back(NULL);
+            SDL_AtomicUnlock(&TrackingLock);
         }
         else {
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for Malloc!");
@@ -73,11 +80,13 @@ PUBLIC STATIC void*  Memory::Calloc(size_t count, size_t size) {
     void* mem = calloc(count, size);
     if (Memory::IsTracking) {
         if (mem) {
+            SDL_AtomicLock(&TrackingLock);
             MemoryUsage += count * size;
 
             TrackedMemory.push_back(mem);
             TrackedSizes.push_back(count * size);
             TrackedMemoryNames.push_back(NULL);
+            SDL_AtomicUnlock(&TrackingLock);
         }
         else {
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for Calloc!");
@@ -89,15 +98,17 @@ PUBLIC STATIC void*  Memory::Realloc(void* pointer, size_t size) {
     void* mem = realloc(pointer, size);
     if (Memory::IsTracking) {
         if (mem) {
+            SDL_AtomicLock(&TrackingLock);
             for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
                 if (TrackedMemory[i] == pointer) {
                     MemoryUsage += size - TrackedSizes[i];
 
                     TrackedMemory[i] = mem;
                     TrackedSizes[i] = size;
-                    return mem;
+                    break;
                 }
             }
+            SDL_AtomicUnlock(&TrackingLock);
         }
         else {
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for Realloc!");
@@ -110,11 +121,13 @@ PUBLIC STATIC void*  Memory::TrackedMalloc(const char* identifier, size_t size)
     void* mem = malloc(size);
     if (Memory::IsTracking) {
         if (mem) {
+            SDL_AtomicLock(&TrackingLock);
             MemoryUsage += size;
 
             TrackedMemory.push_back(mem);
             TrackedSizes.push_back(size);
             TrackedMemoryNames.push_back(identifier);
+            SDL_AtomicUnlock(&TrackingLock);
         }
         else {
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedMalloc!");
@@ -129,11 +142,13 @@ PUBLIC STATIC void*  Memory::TrackedCalloc(const char* identifier, size_t count,
     void* mem = calloc(count, size);
     if (Memory::IsTracking) {
         if (mem) {
+            SDL_AtomicLock(&TrackingLock);
             MemoryUsage += count * size;
 
             TrackedMemory.push_back(mem);
             TrackedSizes.push_back(count * size);
             TrackedMemoryNames.push_back(identifier);
+            SDL_AtomicUnlock(&TrackingLock);
         }
         else {
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedCalloc!");
@@ -143,20 +158,24 @@ PUBLIC STATIC void*  Memory::TrackedCalloc(const char* identifier, size_t count,
 }
 PUBLIC STATIC void   Memory::Track(void* pointer, const char* identifier) {
     if (Memory::IsTracking) {
+        SDL_AtomicLock(&TrackingLock);
         for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
             if (TrackedMemory[i] == pointer) {
                 TrackedMemoryNames[i] = identifier;
-                return;
+                break;
             }
         }
+        SDL_AtomicUnlock(&TrackingLock);
     }
 }
 PUBLIC STATIC void   Memory::Track(void* pointer, size_t size, const char* identifier) {
     if (Memory::IsTracking) {
+        SDL_AtomicLock(&TrackingLock);
         for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
             if (TrackedMemory[i] == pointer) {
                 TrackedSizes[i] = size;
                 TrackedMemoryNames[i] = identifier;
+                SDL_AtomicUnlock(&TrackingLock);
                 return;
             }
         }
@@ -164,17 +183,13 @@ PUBLIC STATIC void   Memory::Track(void* pointer, size_t size, const char* ident
         TrackedMemory.push_back(pointer);
         TrackedSizes.push_back(size);
         TrackedMemoryNames.push_back(identifier);
-    }
-}
-PUBLIC STATIC void   Memory::TrackLast(const char* identifier) {
-    if (Memory::IsTracking) {
-        if (TrackedMemoryNames.size() == 0) return;
-        TrackedMemoryNames[TrackedMemoryNames.size() - 1] = identifier;
+        SDL_AtomicUnlock(&TrackingLock);
     }
 }
 PUBLIC STATIC void   Memory::Free(void* pointer) {
     if (Memory::IsTracking) {
         #ifdef DEBUG
+        SDL_AtomicLock(&TrackingLock);
         for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
             if (TrackedMemory[i] == pointer) {
                 // 32-bit
@@ -195,6 +210,7 @@ PUBLIC STATIC void   Memory::Free(void* pointer) {
                 break;
             }
         }
+        SDL_AtomicUnlock(&TrackingLock);
         #endif
     }
     Memory::Remove(pointer);
@@ -205,6 +221,7 @@ PUBLIC STATIC void   Memory::Free(void* pointer) {
 PUBLIC STATIC void   Memory::Remove(void* pointer) {
     if (!pointer) return;
     if (Memory::IsTracking) {
+        SDL_AtomicLock(&TrackingLock);
         for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
             if (TrackedMemory[i] == pointer) {
                 MemoryUsage -= TrackedSizes[i];
@@ -213,41 +230,57 @@ PUBLIC STATIC void   Memory::Remove(void* pointer) {
                 TrackedMemoryNames.erase(TrackedMemoryNames.begin() + i);
                 TrackedMemory.erase(TrackedMemory.begin() + i);
                 TrackedSizes.erase(TrackedSizes.begin() + i);
-                return;
+                break;
             }
         }
+        SDL_AtomicUnlock(&TrackingLock);
     }
 }
 
 PUBLIC STATIC const char* Memory::GetName(void* pointer) {
+    const char* name = NULL;
     if (Memory::IsTracking) {
+        SDL_AtomicLock(&TrackingLock);
         for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
             if (TrackedMemory[i] == pointer) {
-                return TrackedMemoryNames[i];
+                name = TrackedMemoryNames[i];
+                break;
             }
         }
+        SDL_AtomicUnlock(&TrackingLock);
     }
-    return NULL;
+    return name;
 }
 
 PUBLIC STATIC void   Memory::ClearTrackedMemory() {
+    SDL_AtomicLock(&TrackingLock);
     TrackedMemoryNames.clear();
     TrackedMemory.clear();
     TrackedSizes.clear();
+    SDL_AtomicUnlock(&TrackingLock);
 }
 PUBLIC STATIC size_t Memory::CheckLeak() {
     size_t total = 0;
+    SDL_AtomicLock(&TrackingLock);
     for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
         total += TrackedSizes[i];
     }
+    SDL_AtomicUnlock(&TrackingLock);
     return total;
 }
 PUBLIC STATIC void   Memory::PrintLeak() {
+    // Copied so that the lock isn't held while logging
+    SDL_AtomicLock(&TrackingLock);
+    vector<void*>       memory = TrackedMemory;
+    vector<size_t>      sizes = TrackedSizes;
+    vector<const char*> names = TrackedMemoryNames;
+    SDL_AtomicUnlock(&TrackingLock);
+
     size_t total = 0;
-    Log::Print(Log::LOG_VERBOSE, "Printing unfreed memory... (%u count)", TrackedMemory.size());
-    for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-        Log::Print(Log::LOG_VERBOSE, " : %p [%u bytes] (%s)", TrackedMemory[i], TrackedSizes[i], TrackedMemoryNames[i] ? TrackedMemoryNames[i] : "no name");
-        total += TrackedSizes[i];
+    Log::Print(Log::LOG_VERBOSE, "Printing unfreed memory... (%u count)", memory.size());
+    for (Uint32 i = 0; i < memory.size(); i++) {
+        Log::Print(Log::LOG_VERBOSE, " : %p [%u bytes] (%s)", memory[i], sizes[i], names[i] ? names[i] : "no name");
+        total += sizes[i];
     }
     Log::Print(Log::LOG_VERBOSE, "Total: %u bytes (%.3f MB)", total, total / 1024 / 1024.0);
 }
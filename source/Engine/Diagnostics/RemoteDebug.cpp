@@ -1,25 +1,382 @@
 #if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Diagnostics/PerformanceTypes.h>
+
 class RemoteDebug {
 public:
     static bool        Initialized;
     static bool        UsingRemoteDebug;
+    static int         Port;
 };
 #endif
 
 #include <Engine/Includes/Standard.h>
 #include <Engine/Diagnostics/RemoteDebug.h>
+#include <Engine/Diagnostics/RemoteDebugFormat.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Includes/HashMap.h>
+#include <Engine/Network/WebSocketIncludes.h>
+#include <Engine/Scene.h>
+#include <Engine/Utilities/StringUtils.h>
+
+// Streams the timings of every frame to programs connected over TCP, such
+// as tools/remotedebug. Only connections from this machine are accepted.
+// Nothing is measured or sent while no one is connected, and a connection
+// that can't keep up misses frames instead of holding the game up.
+
+#ifdef MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+// How much can wait to be sent to a connection before frames are skipped
+#define MAX_PENDING_SIZE (256 * 1024)
+#define MAX_CLIENTS 4
 
 bool        RemoteDebug::Initialized = false;
 bool        RemoteDebug::UsingRemoteDebug = false;
+int         RemoteDebug::Port = REMOTEDEBUG_DEFAULT_PORT;
+
+struct RemoteDebugClient {
+    socket_t      Socket;
+    vector<Uint8> Pending;
+};
+
+static socket_t                  Listener = INVALID_SOCKET;
+static vector<RemoteDebugClient> Clients;
+// Names of object lists and layers, by the id they're sent with
+static HashMap<char*>*           Names = NULL;
+static vector<Uint32>            NewNames;
+static vector<Uint8>             NamesPacket;
+static vector<Uint8>             FramePacket;
+static double                    LastCollectTime = 0.0;
+
+static void Write8(vector<Uint8>& out, Uint8 value) {
+    out.push_back(value);
+}
+static void Write16(vector<Uint8>& out, Uint16 value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+static void Write32(vector<Uint8>& out, Uint32 value) {
+    out.push_back(value & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back(value >> 24);
+}
+static void WriteFloat(vector<Uint8>& out, double value) {
+    float f = (float)value;
+    Uint32 bits;
+    memcpy(&bits, &f, sizeof bits);
+    Write32(out, bits);
+}
+static void Patch16(vector<Uint8>& out, size_t at, Uint16 value) {
+    out[at] = value & 0xFF;
+    out[at + 1] = value >> 8;
+}
+static size_t BeginPacket(vector<Uint8>& out, Uint8 type) {
+    size_t start = out.size();
+    Write32(out, 0);
+    Write8(out, type);
+    return start;
+}
+static void EndPacket(vector<Uint8>& out, size_t start) {
+    Uint32 size = (Uint32)(out.size() - start - REMOTEDEBUG_HEADER_SIZE);
+    out[start] = size & 0xFF;
+    out[start + 1] = (size >> 8) & 0xFF;
+    out[start + 2] = (size >> 16) & 0xFF;
+    out[start + 3] = size >> 24;
+}
+
+static void SetNonBlocking(socket_t sock) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+#endif
+}
+
+static void WriteNames(vector<Uint8>& out, vector<Uint32>& ids) {
+    size_t start = BeginPacket(out, RemoteDebugPacket::NAMES);
+    Write16(out, (Uint16)ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        char* name = Names->Get(ids[i]);
+        size_t length = strlen(name);
+        Write32(out, ids[i]);
+        Write16(out, (Uint16)length);
+        out.insert(out.end(), name, name + length);
+    }
+    EndPacket(out, start);
+}
+// Returns the id a name is sent with, and makes sure its connections know it.
+static Uint32 NameID(Uint32 id, const char* name) {
+    if (!Names->Exists(id)) {
+        Names->Put(id, StringUtils::Duplicate(name));
+        NewNames.push_back(id);
+    }
+    return id;
+}
+
+// Sends as much as the connection takes without waiting. Returns false if
+// it was closed.
+static bool Flush(RemoteDebugClient* client) {
+    // Nothing is expected from the other end, but reading tells when it
+    // has gone away.
+    char discard[256];
+    int got;
+    while ((got = (int)recv(client->Socket, discard, sizeof discard, 0)) > 0);
+    if (got == 0)
+        return false;
+
+    size_t sent = 0;
+    while (sent < client->Pending.size()) {
+        int ret = (int)send(client->Socket, (char*)client->Pending.data() + sent, (int)(client->Pending.size() - sent), SEND_FLAGS);
+        if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS))
+            break;
+        else if (ret <= 0)
+            return false;
+        sent += ret;
+    }
+    client->Pending.erase(client->Pending.begin(), client->Pending.begin() + sent);
+    return true;
+}
 
 PUBLIC STATIC void RemoteDebug::Init() {
     if (RemoteDebug::Initialized)
         return;
 
     RemoteDebug::Initialized = true;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        Log::Print(Log::LOG_ERROR, "Could not start remote debugging: WSAStartup failed.");
+        return;
+    }
+#endif
+
+    Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (Listener == INVALID_SOCKET) {
+        Log::Print(Log::LOG_ERROR, "Could not start remote debugging: could not create socket.");
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((Uint16)RemoteDebug::Port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(Listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || listen(Listener, MAX_CLIENTS) == SOCKET_ERROR) {
+        Log::Print(Log::LOG_ERROR, "Could not start remote debugging: port %d is in use.", RemoteDebug::Port);
+        closesocket(Listener);
+        Listener = INVALID_SOCKET;
+        return;
+    }
+    SetNonBlocking(Listener);
+
+    Names = new HashMap<char*>(NULL, 64);
+
+    Log::Print(Log::LOG_INFO, "Remote debugging on port %d.", RemoteDebug::Port);
 }
 
 PUBLIC STATIC bool RemoteDebug::AwaitResponse() {
     // To be used inside a for loop while awaiting a response from the remote debugger
     return true;
 }
+
+PRIVATE STATIC void RemoteDebug::AcceptClients() {
+    while (true) {
+        socket_t sock = accept(Listener, NULL, NULL);
+        if (sock == INVALID_SOCKET)
+            return;
+
+        if (Clients.size() >= MAX_CLIENTS) {
+            closesocket(sock);
+            continue;
+        }
+
+        SetNonBlocking(sock);
+
+        int flag = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(flag));
+#ifdef SO_NOSIGPIPE
+        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, (char*)&flag, sizeof(flag));
+#endif
+
+        RemoteDebugClient client;
+        client.Socket = sock;
+
+        size_t start = BeginPacket(client.Pending, RemoteDebugPacket::HELLO);
+        client.Pending.insert(client.Pending.end(), REMOTEDEBUG_MAGIC, REMOTEDEBUG_MAGIC + 4);
+        Write16(client.Pending, REMOTEDEBUG_VERSION);
+        EndPacket(client.Pending, start);
+
+        vector<Uint32> ids;
+        Names->WithAll([&ids](Uint32 id, char*) -> void {
+            ids.push_back(id);
+        });
+        if (ids.size())
+            WriteNames(client.Pending, ids);
+
+        Clients.push_back(client);
+        Log::Print(Log::LOG_VERBOSE, "Remote debugger connected.");
+    }
+}
+PRIVATE STATIC void RemoteDebug::WriteFrame(Perf_Application* perf, double fps) {
+    vector<Uint8>& out = FramePacket;
+    out.clear();
+
+    size_t start = BeginPacket(out, RemoteDebugPacket::FRAME);
+    Write32(out, (Uint32)Scene::Frame);
+
+    double phases[REMOTEDEBUG_PHASE_COUNT] = {
+        perf->EventTime,
+        perf->AfterSceneTime,
+        perf->PollTime,
+        perf->UpdateTime,
+        perf->ClearTime,
+        perf->RenderTime,
+        perf->FPSCounterTime,
+        perf->PresentTime,
+        perf->FrameTime,
+    };
+    for (int i = 0; i < REMOTEDEBUG_PHASE_COUNT; i++)
+        WriteFloat(out, phases[i]);
+    WriteFloat(out, fps);
+
+    Write32(out, GarbageCollector::CollectCount);
+    WriteFloat(out, GarbageCollector::CollectTime - LastCollectTime);
+    Write32(out, (Uint32)GarbageCollector::GarbageSize);
+    Write8(out, Memory::IsTracking);
+    Write32(out, (Uint32)Memory::MemoryUsage);
+
+    // Views
+    size_t countAt = out.size();
+    Uint8 viewCount = 0;
+    Write8(out, 0);
+    for (int i = 0; i < MAX_SCENE_VIEWS; i++) {
+        if (!Scene::Views[i].Active)
+            continue;
+
+        Perf_ViewRender* view = &Scene::PERF_ViewRender[i];
+        Write8(out, (Uint8)i);
+        WriteFloat(out, view->RenderSetupTime);
+        WriteFloat(out, view->ProjectionSetupTime);
+        WriteFloat(out, view->ObjectRenderEarlyTime);
+        WriteFloat(out, view->ObjectRenderTime);
+        WriteFloat(out, view->ObjectRenderLateTime);
+        WriteFloat(out, view->RenderFinishTime);
+        WriteFloat(out, view->RenderTime);
+
+        size_t layerCount = Scene::Layers.size();
+        if (layerCount > 32)
+            layerCount = 32;
+        Write8(out, (Uint8)layerCount);
+        for (size_t li = 0; li < layerCount; li++) {
+            const char* name = Scene::Layers[li].Name;
+            Write32(out, NameID(CRC32::EncryptString(name), name));
+            WriteFloat(out, view->LayerTileRenderTime[li]);
+        }
+        viewCount++;
+    }
+    out[countAt] = viewCount;
+
+    // Object lists that did anything this frame
+    countAt = out.size();
+    Uint16 listCount = 0;
+    Write16(out, 0);
+    if (Scene::ObjectLists) {
+        Scene::ObjectLists->WithAll([&out, &listCount](Uint32 hash, ObjectList* list) -> void {
+            ObjectListPerformanceStats* stats[REMOTEDEBUG_OBJECT_STAT_COUNT] = {
+                &list->Performance.EarlyUpdate,
+                &list->Performance.Update,
+                &list->Performance.LateUpdate,
+                &list->Performance.Render,
+            };
+            bool ran = false;
+            for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++)
+                ran |= stats[i]->AverageItemCount > 0;
+            if (!ran || listCount == 0xFFFF)
+                return;
+
+            Write32(out, NameID(hash, list->ObjectName));
+            for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++) {
+                double count = stats[i]->AverageItemCount;
+                WriteFloat(out, stats[i]->GetTotalAverageTime());
+                Write16(out, count > 0xFFFF ? 0xFFFF : (Uint16)count);
+            }
+            listCount++;
+        });
+    }
+    Patch16(out, countAt, listCount);
+
+    EndPacket(out, start);
+}
+
+// Sends this frame's timings to everything connected.
+PUBLIC STATIC void RemoteDebug::Update(Perf_Application* perf, double fps) {
+    if (Listener == INVALID_SOCKET)
+        return;
+
+    AcceptClients();
+
+    if (Clients.size()) {
+        WriteFrame(perf, fps);
+
+        NamesPacket.clear();
+        if (NewNames.size()) {
+            WriteNames(NamesPacket, NewNames);
+            NewNames.clear();
+        }
+
+        for (size_t i = 0; i < Clients.size(); ) {
+            RemoteDebugClient* client = &Clients[i];
+            // Names are never skipped, since later frames need them
+            client->Pending.insert(client->Pending.end(), NamesPacket.begin(), NamesPacket.end());
+            if (client->Pending.size() < MAX_PENDING_SIZE)
+                client->Pending.insert(client->Pending.end(), FramePacket.begin(), FramePacket.end());
+
+            if (!Flush(client)) {
+                closesocket(client->Socket);
+                Clients.erase(Clients.begin() + i);
+                Log::Print(Log::LOG_VERBOSE, "Remote debugger disconnected.");
+                continue;
+            }
+            i++;
+        }
+    }
+
+    LastCollectTime = GarbageCollector::CollectTime;
+}
+
+PUBLIC STATIC void RemoteDebug::Dispose() {
+    for (size_t i = 0; i < Clients.size(); i++)
+        closesocket(Clients[i].Socket);
+    Clients.clear();
+
+    if (Listener != INVALID_SOCKET) {
+        closesocket(Listener);
+        Listener = INVALID_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    if (Names) {
+        Names->ForAll([](Uint32, char* name) -> void {
+            Memory::Free(name);
+        });
+        delete Names;
+        Names = NULL;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ENGINE_DIAGNOSTICS_REMOTEDEBUGFORMAT_H
+#define ENGINE_DIAGNOSTICS_REMOTEDEBUGFORMAT_H
+
+// What RemoteDebug sends to the programs connected to it. Every packet
+// starts with a 5-byte header: the size of what follows as a Uint32, then
+// the packet type. All numbers are little-endian; floats are 32-bit.
+//
+// HELLO, sent once on connecting:
+//     "HDBG", Uint16 version
+// NAMES, sent before the first packet that uses the names:
+//     Uint16 count, then for each: Uint32 id, Uint16 length, characters
+// FRAME, sent after every frame:
+//     Uint32 frame number
+//     float  time of each phase, in milliseconds (REMOTEDEBUG_PHASE_COUNT)
+//     float  FPS
+//     Uint32 garbage collections so far
+//     float  time spent collecting garbage during the frame, in milliseconds
+//     Uint32 script garbage size, in bytes
+//     Uint8  whether memory is tracked
+//     Uint32 tracked memory, in bytes
+//     Uint8  view count, then for each view:
+//         Uint8  view index
+//         float  time of each view phase, in milliseconds (REMOTEDEBUG_VIEW_PHASE_COUNT)
+//         Uint8  layer count, then for each: Uint32 name id, float milliseconds
+//     Uint16 object list count, then for each list that ran:
+//         Uint32 name id
+//         for each of EarlyUpdate, Update, LateUpdate and Render:
+//             float  total time, in microseconds
+//             Uint16 number of entities
+
+#define REMOTEDEBUG_DEFAULT_PORT 6510
+#define REMOTEDEBUG_MAGIC "HDBG"
+#define REMOTEDEBUG_VERSION 1
+#define REMOTEDEBUG_HEADER_SIZE 5
+
+namespace RemoteDebugPacket { enum {
+    HELLO,
+    NAMES,
+    FRAME,
+}; };
+
+// Same order as Perf_Application
+namespace RemoteDebugPhase { enum {
+    EVENT,
+    AFTER_SCENE,
+    POLL,
+    UPDATE,
+    CLEAR,
+    RENDER,
+    FPS_COUNTER,
+    PRESENT,
+    FRAME,
+}; };
+#define REMOTEDEBUG_PHASE_COUNT 9
+
+namespace RemoteDebugViewPhase { enum {
+    SETUP,
+    PROJECTION,
+    OBJECT_RENDER_EARLY,
+    OBJECT_RENDER,
+    OBJECT_RENDER_LATE,
+    FINISH,
+    TOTAL,
+}; };
+#define REMOTEDEBUG_VIEW_PHASE_COUNT 7
+
+#define REMOTEDEBUG_OBJECT_STAT_COUNT 4
+
+#endif /* ENGINE_DIAGNOSTICS_REMOTEDEBUGFORMAT_H */
@@ -0,0 +1,241 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Diagnostics/Clock.h>
+
+class Tracer {
+public:
+    static bool Enabled;
+    static int  FrameCount;
+    static int  BufferSize;
+};
+
+// Records something that just finished, which took elapsed milliseconds.
+#define TRACE_ELAPSED(category, name, elapsed) \
+    do { if (Tracer::Enabled) { double _traceElapsed = (elapsed); Tracer::Record(category, name, Clock::GetTicks() - _traceElapsed, _traceElapsed); } } while (0)
+#endif
+
+#include <Engine/Diagnostics/Tracer.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+#include <time.h>
+
+// Records how long things took on every thread for a range of frames, and
+// writes them out as Chrome trace event JSON, which chrome://tracing and
+// Perfetto can open. While no range is being recorded, TRACE_ELAPSED costs
+// a single check.
+//
+// Each thread writes to a ring of its own, so recording doesn't lock.
+// Rings are never cleared; when a range ends, only the events inside it
+// are written out. If a ring fills up during a range, its oldest events
+// are lost.
+
+bool Tracer::Enabled = false;
+// How many frames Start records for
+int  Tracer::FrameCount = 120;
+// How many events each thread keeps
+int  Tracer::BufferSize = 1 << 17;
+
+struct TraceEvent {
+    double      Start;
+    double      Duration;
+    const char* Category;
+    char        Name[40];
+};
+struct TraceBuffer {
+    TraceEvent*  Events;
+    Uint32       Capacity;
+    // How many events were ever written; the newest is at (Written - 1) % Capacity
+    SDL_atomic_t Written;
+    SDL_threadID ThreadID;
+};
+
+static SDL_SpinLock                    BuffersLock = 0;
+static vector<TraceBuffer*>            Buffers;
+static thread_local TraceBuffer*       CurrentBuffer = NULL;
+static SDL_threadID                    MainThreadID = 0;
+
+static int    FrameNumber = 0;
+// The frame to start recording at, or -1
+static int    StartFrame = -1;
+static int    EndFrame = -1;
+static double RangeStart = 0.0;
+
+PUBLIC STATIC void Tracer::Init() {
+    MainThreadID = SDL_ThreadID();
+}
+
+// Takes "--trace <first frame> <frame count>" out of the command line,
+// and returns how many arguments are left.
+PUBLIC STATIC int  Tracer::ParseArguments(int argc, char* args[]) {
+    for (int i = 1; i + 2 < argc; i++) {
+        if (strcmp(args[i], "--trace"))
+            continue;
+
+        Tracer::StartAt(atoi(args[i + 1]), atoi(args[i + 2]));
+        for (int j = i; j + 3 < argc; j++)
+            args[j] = args[j + 3];
+        return argc - 3;
+    }
+    return argc;
+}
+
+// Records frameCount frames, starting at the given frame.
+PUBLIC STATIC void Tracer::StartAt(int frame, int frameCount) {
+    if (frameCount <= 0)
+        return;
+
+    StartFrame = frame;
+    EndFrame = frame + frameCount;
+}
+// Records the next FrameCount frames.
+PUBLIC STATIC void Tracer::Start() {
+    if (Tracer::Enabled || StartFrame >= 0)
+        return;
+
+    Log::Print(Log::LOG_INFO, "Tracing the next %d frames...", Tracer::FrameCount);
+    Tracer::StartAt(FrameNumber + 1, Tracer::FrameCount);
+}
+
+// Called at the start of every frame.
+PUBLIC STATIC void Tracer::BeginFrame() {
+    FrameNumber++;
+
+    if (FrameNumber == StartFrame) {
+        RangeStart = Clock::GetTicks();
+        Tracer::Enabled = true;
+    }
+    else if (FrameNumber == EndFrame && Tracer::Enabled) {
+        Tracer::Enabled = false;
+        StartFrame = EndFrame = -1;
+        Tracer::Export(RangeStart, Clock::GetTicks());
+    }
+}
+
+PUBLIC STATIC void Tracer::Record(const char* category, const char* name, double start, double duration) {
+    TraceBuffer* buffer = CurrentBuffer;
+    if (!buffer) {
+        buffer = (TraceBuffer*)Memory::Calloc(1, sizeof(TraceBuffer));
+        buffer->Capacity = (Uint32)Tracer::BufferSize;
+        buffer->Events = (TraceEvent*)Memory::Malloc(buffer->Capacity * sizeof(TraceEvent));
+        buffer->ThreadID = SDL_ThreadID();
+        if (!buffer->Events)
+            buffer->Capacity = 0;
+
+        SDL_AtomicLock(&BuffersLock);
+        Buffers.push_back(buffer);
+        SDL_AtomicUnlock(&BuffersLock);
+
+        CurrentBuffer = buffer;
+    }
+    if (!buffer->Capacity)
+        return;
+
+    Uint32 written = (Uint32)SDL_AtomicGet(&buffer->Written);
+    TraceEvent* event = &buffer->Events[written % buffer->Capacity];
+    event->Start = start;
+    event->Duration = duration;
+    event->Category = category;
+    strncpy(event->Name, name, sizeof(event->Name) - 1);
+    event->Name[sizeof(event->Name) - 1] = 0;
+    SDL_AtomicSet(&buffer->Written, (int)(written + 1));
+}
+
+static void WriteEscaped(string& out, const char* text) {
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        }
+        else if ((Uint8)*c < 0x20)
+            out += ' ';
+        else
+            out += *c;
+    }
+}
+
+// Writes the events between start and end to a file named after the time.
+PRIVATE STATIC void Tracer::Export(double start, double end) {
+    char filename[64];
+    time_t now = time(NULL);
+    strftime(filename, sizeof filename, "trace-%Y%m%d-%H%M%S.json", localtime(&now));
+
+    FileStream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+    if (!stream) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" to write the trace to!", filename);
+        return;
+    }
+
+    SDL_AtomicLock(&BuffersLock);
+    vector<TraceBuffer*> buffers = Buffers;
+    SDL_AtomicUnlock(&BuffersLock);
+
+    string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t eventCount = 0;
+    bool lostEvents = false;
+    char line[128];
+    for (size_t b = 0; b < buffers.size(); b++) {
+        TraceBuffer* buffer = buffers[b];
+        if (!buffer->Capacity)
+            continue;
+
+        Uint32 written = (Uint32)SDL_AtomicGet(&buffer->Written);
+        Uint32 first = written > buffer->Capacity ? written - buffer->Capacity : 0;
+        unsigned long tid = (unsigned long)buffer->ThreadID;
+
+        bool any = false;
+        for (Uint32 i = first; i < written; i++) {
+            TraceEvent* event = &buffer->Events[i % buffer->Capacity];
+            if (event->Start < start || event->Start >= end)
+                continue;
+
+            // Times are in microseconds
+            out += "{\"ph\":\"X\",\"pid\":1,\"cat\":\"";
+            WriteEscaped(out, event->Category);
+            out += "\",\"name\":\"";
+            WriteEscaped(out, event->Name);
+            snprintf(line, sizeof line, "\",\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f},\n",
+                tid, (event->Start - start) * 1000.0, event->Duration * 1000.0);
+            out += line;
+            eventCount++;
+            any = true;
+        }
+        if (any && first > 0) {
+            TraceEvent* oldest = &buffer->Events[first % buffer->Capacity];
+            if (oldest->Start > start)
+                lostEvents = true;
+        }
+
+        if (buffer->ThreadID == MainThreadID)
+            snprintf(line, sizeof line, "{\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"name\":\"thread_name\",\"args\":{\"name\":\"Main\"}},\n", tid);
+        else
+            snprintf(line, sizeof line, "{\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"name\":\"thread_name\",\"args\":{\"name\":\"Thread %lu\"}},\n", tid, tid);
+        out += line;
+
+        if (out.size() > 1024 * 1024) {
+            stream->WriteBytes((void*)out.data(), out.size());
+            out.clear();
+        }
+    }
+    out += "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"" TARGET_NAME "\"}}\n]}\n";
+    stream->WriteBytes((void*)out.data(), out.size());
+    stream->Close();
+
+    Log::Print(Log::LOG_INFO, "Wrote %u trace events (%.1f ms) to \"%s\".", (Uint32)eventCount, end - start, filename);
+    if (lostEvents)
+        Log::Print(Log::LOG_WARN, "Some threads recorded more than %d events, so the trace is missing their earliest ones.", Tracer::BufferSize);
+}
+
+PUBLIC STATIC void Tracer::Dispose() {
+    Tracer::Enabled = false;
+
+    SDL_AtomicLock(&BuffersLock);
+    for (size_t i = 0; i < Buffers.size(); i++) {
+        Memory::Free(Buffers[i]->Events);
+        Memory::Free(Buffers[i]);
+    }
+    Buffers.clear();
+    SDL_AtomicUnlock(&BuffersLock);
+}
@@ -0,0 +1,251 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Includes/HashMap.h>
+
+class DirectoryIndex {
+public:
+    struct Entry {
+        char* Path;
+        // Another file has the same name in a different case
+        bool  Ambiguous;
+    };
+
+    enum LookupResult {
+        INDEX_MISSING,
+        INDEX_FOUND,
+        // The index can't tell; look on the disk instead
+        INDEX_UNKNOWN,
+    };
+
+    char            Root[4096];
+    HashMap<Entry>* Entries = NULL;
+    SDL_mutex*      Lock = NULL;
+    Uint32          FileCount = 0;
+    int             WatchDescriptor = -1;
+};
+#endif
+
+#include <Engine/Filesystem/DirectoryIndex.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Utilities/StringUtils.h>
+
+#if LINUX
+    #define USING_INOTIFY
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+// Every file in a folder and its subfolders, so that checking whether one
+// exists doesn't have to touch the disk. Names are matched without regard to
+// case, which lets content made on Windows work on case sensitive file
+// systems. On Linux, the index refreshes itself when files are added,
+// removed or renamed; elsewhere, Refresh has to be called. Files the engine
+// writes itself are added to it with Add.
+
+// Hashes a path relative to the root, ignoring case and slash direction.
+// Returns false for paths the index can't vouch for.
+static inline char FoldChar(char ch) {
+    if (ch == '\\')
+        return '/';
+    if (ch >= 'A' && ch <= 'Z')
+        return ch + ('a' - 'A');
+    return ch;
+}
+static bool HashPath(const char* path, Uint32* hash) {
+    char lower[4096];
+    size_t length = 0;
+    for (const char* c = path; *c; c++) {
+        if (length + 1 >= sizeof lower)
+            return false;
+        lower[length++] = FoldChar(*c);
+    }
+    lower[length] = 0;
+
+    if (length == 0 || lower[0] == '/' || strstr(lower, "..") || strstr(lower, "//") || strstr(lower, "./"))
+        return false;
+
+    *hash = CRC32::EncryptData(lower, length);
+    return true;
+}
+static bool PathsMatch(const char* a, const char* b) {
+    for (; *a && *b; a++, b++) {
+        if (FoldChar(*a) != FoldChar(*b))
+            return false;
+    }
+    return *a == *b;
+}
+static void FreeEntries(HashMap<DirectoryIndex::Entry>* entries) {
+    if (!entries)
+        return;
+    entries->ForAll([](Uint32, DirectoryIndex::Entry entry) -> void {
+        Memory::Free(entry.Path);
+    });
+    delete entries;
+}
+
+PUBLIC DirectoryIndex::DirectoryIndex(const char* root) {
+    StringUtils::Copy(Root, root, sizeof Root);
+    Lock = SDL_CreateMutex();
+}
+
+// Lists the folder again. Lookups from other threads can carry on while it
+// does, with the old list.
+PUBLIC void DirectoryIndex::Refresh() {
+    double ticks = Clock::GetTicks();
+
+    HashMap<DirectoryIndex::Entry>* entries = new HashMap<DirectoryIndex::Entry>(NULL, 1024);
+    size_t rootLength = strlen(Root);
+
+    vector<char*> files;
+    Directory::GetFiles(&files, Root, "*", true);
+    for (size_t i = 0; i < files.size(); i++) {
+        const char* path = files[i] + rootLength;
+        while (*path == '/')
+            path++;
+
+        Uint32 hash;
+        if (HashPath(path, &hash)) {
+            DirectoryIndex::Entry entry;
+            if (entries->GetIfExists(hash, &entry)) {
+                entry.Ambiguous = true;
+                entries->Put(hash, entry);
+            }
+            else {
+                entry.Path = StringUtils::Duplicate(path);
+                entry.Ambiguous = false;
+                entries->Put(hash, entry);
+            }
+        }
+        free(files[i]);
+    }
+
+    SDL_LockMutex(Lock);
+    HashMap<DirectoryIndex::Entry>* old = Entries;
+    Entries = entries;
+    FileCount = (Uint32)files.size();
+    SDL_UnlockMutex(Lock);
+
+    FreeEntries(old);
+    Watch();
+
+    Log::Print(Log::LOG_VERBOSE, "Indexed %u files in \"%s\" in %.3f ms", FileCount, Root, Clock::GetTicks() - ticks);
+}
+
+// Looks up a path relative to the root. If it's there, out gets its path
+// with the case it has on the disk.
+PUBLIC int DirectoryIndex::Find(const char* path, char* out, size_t outSize) {
+    Uint32 hash;
+    if (!HashPath(path, &hash))
+        return INDEX_UNKNOWN;
+
+    int result = INDEX_MISSING;
+    SDL_LockMutex(Lock);
+    DirectoryIndex::Entry entry;
+    if (!Entries)
+        result = INDEX_UNKNOWN;
+    else if (Entries->GetIfExists(hash, &entry)) {
+        // Paths that differ only in case are left to the file system
+        if (entry.Ambiguous)
+            result = INDEX_UNKNOWN;
+        else if (!PathsMatch(entry.Path, path))
+            result = INDEX_UNKNOWN;
+        else {
+            result = INDEX_FOUND;
+            if (out)
+                StringUtils::Copy(out, entry.Path, outSize);
+        }
+    }
+    SDL_UnlockMutex(Lock);
+    return result;
+}
+
+// Adds a file that was just written, relative to the root, so that it can be
+// found before the index is next refreshed.
+PUBLIC void DirectoryIndex::Add(const char* path) {
+    Uint32 hash;
+    if (!HashPath(path, &hash))
+        return;
+
+    SDL_LockMutex(Lock);
+    DirectoryIndex::Entry entry;
+    if (!Entries) {
+        // Nothing to add to until the first Refresh
+    }
+    else if (Entries->GetIfExists(hash, &entry)) {
+        if (!entry.Ambiguous && !PathsMatch(entry.Path, path)) {
+            entry.Ambiguous = true;
+            Entries->Put(hash, entry);
+        }
+    }
+    else {
+        entry.Path = StringUtils::Duplicate(path);
+        entry.Ambiguous = false;
+        Entries->Put(hash, entry);
+        FileCount++;
+    }
+    SDL_UnlockMutex(Lock);
+}
+
+#ifdef USING_INOTIFY
+static void AddWatches(int fd, const char* path, Uint32 mask) {
+    inotify_add_watch(fd, path, mask);
+
+    // Directory::GetDirectories doesn't recurse into folders of folders
+    vector<char*> folders;
+    Directory::GetDirectories(&folders, path, "*", false);
+    for (size_t i = 0; i < folders.size(); i++) {
+        AddWatches(fd, folders[i], mask);
+        free(folders[i]);
+    }
+}
+#endif
+
+// Starts watching every folder in the index for changes.
+PRIVATE void DirectoryIndex::Watch() {
+#ifdef USING_INOTIFY
+    if (WatchDescriptor >= 0)
+        close(WatchDescriptor);
+
+    WatchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (WatchDescriptor < 0)
+        return;
+
+    AddWatches(WatchDescriptor, Root, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+#endif
+}
+
+// Refreshes the index if anything changed since the last call. Returns true
+// if it did.
+PUBLIC bool DirectoryIndex::Update() {
+#ifdef USING_INOTIFY
+    if (WatchDescriptor < 0)
+        return false;
+
+    bool changed = false;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (read(WatchDescriptor, buffer, sizeof buffer) > 0)
+        changed = true;
+
+    if (changed) {
+        Log::Print(Log::LOG_VERBOSE, "Files changed in \"%s\", refreshing its index.", Root);
+        Refresh();
+    }
+    return changed;
+#else
+    return false;
+#endif
+}
+
+PUBLIC DirectoryIndex::~DirectoryIndex() {
+#ifdef USING_INOTIFY
+    if (WatchDescriptor >= 0)
+        close(WatchDescriptor);
+#endif
+    FreeEntries(Entries);
+    SDL_DestroyMutex(Lock);
+}
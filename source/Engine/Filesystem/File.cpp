@@ -12,6 +12,9 @@ private:
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/IO/FileStream.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #if WIN32
     #include <io.h>
 #else
@@ -60,6 +63,30 @@ PUBLIC STATIC bool File::Exists(const char* path) {
     #endif
 }
 
+// Gets the size of a file on the disk, and when it was last modified, in
+// nanoseconds since 1970. Only Linux has finer than second precision.
+PUBLIC STATIC bool   File::GetInfo(const char* path, size_t* size, Sint64* modifiedTime) {
+    #if WIN32
+        struct _stat64 info;
+        if (_stat64(path, &info) != 0)
+            return false;
+    #else
+        struct stat info;
+        if (stat(path, &info) != 0)
+            return false;
+    #endif
+
+    if (size)
+        *size = (size_t)info.st_size;
+    if (modifiedTime) {
+        *modifiedTime = (Sint64)info.st_mtime * 1000000000;
+    #if LINUX
+        *modifiedTime += info.st_mtim.tv_nsec;
+    #endif
+    }
+    return true;
+}
+
 PUBLIC STATIC size_t File::ReadAllBytes(const char* path, char** out) {
     FileStream* stream;
     if ((stream = FileStream::New(path, FileStream::READ_ACCESS))) {
@@ -0,0 +1,75 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class MappedFile {
+public:
+    Uint8* Data;
+    size_t Size;
+};
+#endif
+
+#include <Engine/Filesystem/MappedFile.h>
+
+#if LINUX || MACOSX
+    #define USING_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// A read-only memory mapping of a whole file. Reads from it are paged in by
+// the OS as they're touched, and never use the heap.
+
+PUBLIC STATIC bool        MappedFile::IsSupported() {
+#ifdef USING_MMAP
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Returns NULL if the file can't be mapped (because it doesn't exist, is
+// empty, or the platform doesn't support it.)
+PUBLIC STATIC MappedFile* MappedFile::Open(const char* filename) {
+#ifdef USING_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    MappedFile* file = new (std::nothrow) MappedFile;
+    if (!file) {
+        munmap(data, (size_t)fileStat.st_size);
+        return NULL;
+    }
+
+    file->Data = (Uint8*)data;
+    file->Size = (size_t)fileStat.st_size;
+    return file;
+#else
+    return NULL;
+#endif
+}
+
+PUBLIC        void        MappedFile::Close() {
+#ifdef USING_MMAP
+    munmap(Data, Size);
+#endif
+    Data = NULL;
+    Size = 0;
+    delete this;
+}
@@ -101,6 +101,7 @@ public:
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Math/Math.h>
 
+#include <Engine/Rendering/VertexTransform.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 #ifdef USING_OPENGL
     #include <Engine/Rendering/GL/GLRenderer.h>
@@ -335,6 +336,8 @@ PUBLIC STATIC void     Graphics::Dispose() {
 
     if (Graphics::FramebufferPixels)
         Memory::Free(Graphics::FramebufferPixels);
+
+    VertexTransform::Dispose();
 }
 
 PUBLIC STATIC Point    Graphics::ProjectToScreen(float x, float y, float z) {
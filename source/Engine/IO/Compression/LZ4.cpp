@@ -0,0 +1,175 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+class LZ4 {
+public:
+
+};
+#endif
+
+#include <Engine/IO/Compression/LZ4.h>
+
+// The LZ4 block format: every sequence is a token, its literals, and a
+// match with a 16-bit offset. The token's high nibble is the literal
+// length and its low nibble is the match length minus 4; a nibble of 15
+// is followed by extra length bytes, until one isn't 255. The last
+// sequence only has literals.
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_MAX_OFFSET    0xFFFF
+// The last match has to start this many bytes before the end of the input,
+// and the last bytes are always literals, as the reference decoder expects.
+#define LZ4_MF_LIMIT      12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_HASH_BITS     12
+
+static inline Uint32 LZ4_Read32(const uint8_t* p) {
+    Uint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+static inline Uint32 LZ4_Hash(Uint32 sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+static inline uint8_t* LZ4_WriteLength(uint8_t* out, size_t length) {
+    for (; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = (uint8_t)length;
+    return out;
+}
+static uint8_t* LZ4_WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    uint8_t* token = out++;
+    *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15)
+        out = LZ4_WriteLength(out, literalLength - 15);
+
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+
+    if (matchLength) {
+        *out++ = (uint8_t)(offset & 0xFF);
+        *out++ = (uint8_t)(offset >> 8);
+
+        matchLength -= LZ4_MIN_MATCH;
+        *token |= (uint8_t)(matchLength >= 15 ? 15 : matchLength);
+        if (matchLength >= 15)
+            out = LZ4_WriteLength(out, matchLength - 15);
+    }
+    return out;
+}
+
+PUBLIC STATIC size_t LZ4::CompressBound(size_t in_sz) {
+    return in_sz + (in_sz / 255) + 16;
+}
+
+// Compresses in into out, which must be at least CompressBound(in_sz) bytes.
+// Returns the compressed size.
+PUBLIC STATIC size_t LZ4::Compress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz) {
+    if (out_sz < LZ4::CompressBound(in_sz))
+        return 0;
+
+    Uint32 table[1 << LZ4_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint8_t* out_head = out;
+    size_t   anchor = 0;
+
+    if (in_sz > LZ4_MF_LIMIT) {
+        size_t matchStartLimit = in_sz - LZ4_MF_LIMIT;
+        size_t matchEndLimit = in_sz - LZ4_LAST_LITERALS;
+        size_t pos = 0;
+        while (pos < matchStartLimit) {
+            Uint32 sequence = LZ4_Read32(in + pos);
+            Uint32 hash = LZ4_Hash(sequence);
+            size_t ref = table[hash];
+            table[hash] = (Uint32)pos;
+
+            if (ref >= pos || pos - ref > LZ4_MAX_OFFSET || LZ4_Read32(in + ref) != sequence) {
+                // Skip ahead faster through data that doesn't compress
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = LZ4_MIN_MATCH;
+            while (pos + length < matchEndLimit && in[ref + length] == in[pos + length])
+                length++;
+
+            out_head = LZ4_WriteSequence(out_head, in + anchor, pos - anchor, pos - ref, length);
+            pos += length;
+            anchor = pos;
+
+            if (pos < matchStartLimit)
+                table[LZ4_Hash(LZ4_Read32(in + pos - 2))] = (Uint32)(pos - 2);
+        }
+    }
+
+    out_head = LZ4_WriteSequence(out_head, in + anchor, in_sz - anchor, 0, 0);
+    return out_head - out;
+}
+
+// Decompresses exactly out_sz bytes. Returns false if the data is corrupt.
+PUBLIC STATIC bool LZ4::Decompress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz) {
+    const uint8_t* in_head = in;
+    const uint8_t* in_end = in + in_sz;
+    uint8_t*       out_head = out;
+    uint8_t*       out_end = out + out_sz;
+
+    while (in_head < in_end) {
+        uint8_t token = *in_head++;
+
+        size_t length = token >> 4;
+        if (length == 15) {
+            uint8_t extra;
+            do {
+                if (in_head >= in_end)
+                    return false;
+                extra = *in_head++;
+                length += extra;
+            } while (extra == 255);
+        }
+
+        if (length > (size_t)(in_end - in_head) || length > (size_t)(out_end - out_head))
+            return false;
+        memcpy(out_head, in_head, length);
+        in_head += length;
+        out_head += length;
+
+        // The last sequence has no match
+        if (in_head == in_end)
+            break;
+
+        if (in_end - in_head < 2)
+            return false;
+        size_t offset = in_head[0] | (in_head[1] << 8);
+        in_head += 2;
+        if (offset == 0 || offset > (size_t)(out_head - out))
+            return false;
+
+        length = token & 0xF;
+        if (length == 15) {
+            uint8_t extra;
+            do {
+                if (in_head >= in_end)
+                    return false;
+                extra = *in_head++;
+                length += extra;
+            } while (extra == 255);
+        }
+        length += LZ4_MIN_MATCH;
+
+        if (length > (size_t)(out_end - out_head))
+            return false;
+
+        const uint8_t* match = out_head - offset;
+        if (offset >= length) {
+            memcpy(out_head, match, length);
+            out_head += length;
+        }
+        else {
+            // Overlapping copies repeat the last offset bytes
+            while (length--)
+                *out_head++ = *match++;
+        }
+    }
+
+    return out_head == out_end;
+}
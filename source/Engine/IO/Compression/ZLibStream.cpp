@@ -90,7 +90,7 @@ PUBLIC        size_t      ZLibStream::WriteBytes(void* data, size_t n) {
     return n;
 }
 
-PUBLIC STATIC void        ZLibStream::Decompress(void* dst, size_t dstLen, void* src, size_t srcLen) {
+PUBLIC STATIC bool        ZLibStream::Decompress(void* dst, size_t dstLen, void* src, size_t srcLen) {
     z_stream infstream;
     infstream.zalloc = Z_NULL;
     infstream.zfree = Z_NULL;
@@ -102,8 +102,20 @@ PUBLIC STATIC void        ZLibStream::Decompress(void* dst, size_t dstLen, void*
     infstream.avail_out = (int)dstLen;
 
     inflateInit(&infstream);
-    inflate(&infstream, Z_NO_FLUSH);
+    int result = inflate(&infstream, Z_NO_FLUSH);
     inflateEnd(&infstream);
+
+    return result == Z_STREAM_END || (result == Z_OK && infstream.avail_out == 0);
+}
+PUBLIC STATIC size_t      ZLibStream::CompressBound(size_t srcLen) {
+    return (size_t)compressBound((mz_ulong)srcLen);
+}
+// Returns the compressed size, or 0 if it didn't fit in dstLen bytes.
+PUBLIC STATIC size_t      ZLibStream::Compress(void* dst, size_t dstLen, void* src, size_t srcLen, int level) {
+    mz_ulong compressedLen = (mz_ulong)dstLen;
+    if (compress2((Bytef*)dst, &compressedLen, (const Bytef*)src, (mz_ulong)srcLen, level) != Z_OK)
+        return 0;
+    return (size_t)compressedLen;
 }
 
 PRIVATE       void        ZLibStream::Decompress(void* in, size_t inLen) {
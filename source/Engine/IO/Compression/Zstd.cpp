@@ -0,0 +1,87 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+class Zstd {
+public:
+
+};
+#endif
+
+#include <Engine/IO/Compression/Zstd.h>
+
+#include <Libraries/zstd/zstd.h>
+#include <Libraries/zstd/zdict.h>
+
+// Zstandard, from the vendored library in Libraries/zstd. Dictionaries are
+// passed around as void pointers so that the library's headers stay here.
+
+// Decompression contexts are reused, one per thread
+static thread_local ZSTD_DCtx* DecompressContext = NULL;
+
+static ZSTD_DCtx* GetDecompressContext() {
+    if (!DecompressContext)
+        DecompressContext = ZSTD_createDCtx();
+    return DecompressContext;
+}
+
+PUBLIC STATIC size_t Zstd::CompressBound(size_t in_sz) {
+    return ZSTD_compressBound(in_sz);
+}
+
+// Compresses in into out, which should be at least CompressBound(in_sz)
+// bytes. Returns the compressed size, or 0 if it failed.
+PUBLIC STATIC size_t Zstd::Compress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz, int level) {
+    size_t result = ZSTD_compress(out, out_sz, in, in_sz, level);
+    if (ZSTD_isError(result))
+        return 0;
+    return result;
+}
+PUBLIC STATIC size_t Zstd::Compress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz, int level, void* dictionary, size_t dictionary_sz) {
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    if (!context)
+        return 0;
+
+    size_t result = ZSTD_compress_usingDict(context, out, out_sz, in, in_sz, dictionary, dictionary_sz, level);
+    ZSTD_freeCCtx(context);
+    if (ZSTD_isError(result))
+        return 0;
+    return result;
+}
+
+// Decompresses exactly out_sz bytes. Returns false if the data is corrupt.
+PUBLIC STATIC bool Zstd::Decompress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz) {
+    ZSTD_DCtx* context = GetDecompressContext();
+    if (!context)
+        return false;
+
+    size_t result = ZSTD_decompressDCtx(context, out, out_sz, in, in_sz);
+    return !ZSTD_isError(result) && result == out_sz;
+}
+// Same as Decompress, for data compressed with a dictionary made by
+// CreateDictionary.
+PUBLIC STATIC bool Zstd::Decompress(uint8_t* in, size_t in_sz, uint8_t* out, size_t out_sz, void* dictionary) {
+    ZSTD_DCtx* context = GetDecompressContext();
+    if (!context || !dictionary)
+        return false;
+
+    size_t result = ZSTD_decompress_usingDDict(context, out, out_sz, in, in_sz, (ZSTD_DDict*)dictionary);
+    return !ZSTD_isError(result) && result == out_sz;
+}
+
+// Prepares a dictionary for decompression. The data is copied, so it can be
+// freed afterwards.
+PUBLIC STATIC void* Zstd::CreateDictionary(void* data, size_t size) {
+    return ZSTD_createDDict(data, size);
+}
+PUBLIC STATIC void Zstd::FreeDictionary(void* dictionary) {
+    ZSTD_freeDDict((ZSTD_DDict*)dictionary);
+}
+
+// Builds a dictionary out of count samples that are stored one after the
+// other in samples. Works best with many small files of the same kind.
+// Returns the size of the dictionary, or 0 if one couldn't be made.
+PUBLIC STATIC size_t Zstd::TrainDictionary(void* samples, size_t* sampleSizes, Uint32 count, void* out, size_t out_sz) {
+    size_t result = ZDICT_trainFromBuffer(out, out_sz, samples, sampleSizes, count);
+    if (ZDICT_isError(result))
+        return 0;
+    return result;
+}
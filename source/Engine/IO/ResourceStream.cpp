@@ -6,6 +6,7 @@ public:
     Uint8* pointer = NULL;
     Uint8* pointer_start = NULL;
     size_t size = 0;
+    bool   mapped = false;
 };
 #endif
 
@@ -22,7 +23,10 @@ PUBLIC STATIC ResourceStream* ResourceStream::New(const char* filename) {
     if (!filename)
         goto FREE;
 
-    if (!ResourceManager::LoadResource(filename, &stream->pointer_start, &stream->size))
+    // Read resources stored as-is in a mapped data pack in place
+    if (ResourceManager::MapResource(filename, &stream->pointer_start, &stream->size))
+        stream->mapped = true;
+    else if (!ResourceManager::LoadResource(filename, &stream->pointer_start, &stream->size))
         goto FREE;
 
     stream->pointer = stream->pointer_start;
@@ -35,7 +39,10 @@ PUBLIC STATIC ResourceStream* ResourceStream::New(const char* filename) {
 }
 
 PUBLIC        void            ResourceStream::Close() {
-    Memory::Free(pointer_start);
+    if (mapped)
+        ResourceManager::ReleaseMappedResource();
+    else
+        Memory::Free(pointer_start);
     Stream::Close();
 }
 PUBLIC        void            ResourceStream::Seek(Sint64 offset) {
@@ -0,0 +1,267 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <Engine/Includes/Standard.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define USING_SIMD_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define USING_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+// Four signed 32-bit integer lanes.
+struct SIMDInt4 {
+#if defined(USING_SIMD_SSE2)
+    __m128i V;
+#elif defined(USING_SIMD_NEON)
+    int32x4_t V;
+#else
+    Sint32 V[4];
+#endif
+
+    static inline SIMDInt4 Set(Sint32 a, Sint32 b, Sint32 c, Sint32 d) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_set_epi32(d, c, b, a);
+#elif defined(USING_SIMD_NEON)
+        Sint32 tmp[4] = { a, b, c, d };
+        r.V = vld1q_s32(tmp);
+#else
+        r.V[0] = a; r.V[1] = b; r.V[2] = c; r.V[3] = d;
+#endif
+        return r;
+    }
+    static inline SIMDInt4 Splat(Sint32 a) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_set1_epi32(a);
+#elif defined(USING_SIMD_NEON)
+        r.V = vdupq_n_s32(a);
+#else
+        r.V[0] = r.V[1] = r.V[2] = r.V[3] = a;
+#endif
+        return r;
+    }
+    static inline SIMDInt4 Add(SIMDInt4 a, SIMDInt4 b) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_add_epi32(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vaddq_s32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] + b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDInt4 Or(SIMDInt4 a, SIMDInt4 b) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_or_si128(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vorrq_s32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] | b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDInt4 Min(SIMDInt4 a, SIMDInt4 b) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        __m128i lt = _mm_cmplt_epi32(a.V, b.V);
+        r.V = _mm_or_si128(_mm_and_si128(lt, a.V), _mm_andnot_si128(lt, b.V));
+#elif defined(USING_SIMD_NEON)
+        r.V = vminq_s32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] < b.V[i] ? a.V[i] : b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDInt4 Max(SIMDInt4 a, SIMDInt4 b) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        __m128i gt = _mm_cmpgt_epi32(a.V, b.V);
+        r.V = _mm_or_si128(_mm_and_si128(gt, a.V), _mm_andnot_si128(gt, b.V));
+#elif defined(USING_SIMD_NEON)
+        r.V = vmaxq_s32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] > b.V[i] ? a.V[i] : b.V[i];
+#endif
+        return r;
+    }
+    // Returns a 4-bit mask with bit N set if lane N is negative.
+    static inline int SignMask(SIMDInt4 a) {
+#if defined(USING_SIMD_SSE2)
+        return _mm_movemask_ps(_mm_castsi128_ps(a.V));
+#elif defined(USING_SIMD_NEON)
+        static const Sint32 shifts[4] = { 0, 1, 2, 3 };
+        uint32x4_t s = vshrq_n_u32(vreinterpretq_u32_s32(a.V), 31);
+        s = vshlq_u32(s, vld1q_s32(shifts));
+        uint32x2_t t = vorr_u32(vget_low_u32(s), vget_high_u32(s));
+        return (int)(vget_lane_u32(t, 0) | vget_lane_u32(t, 1));
+#else
+        return ((Uint32)a.V[0] >> 31)
+            | (((Uint32)a.V[1] >> 31) << 1)
+            | (((Uint32)a.V[2] >> 31) << 2)
+            | (((Uint32)a.V[3] >> 31) << 3);
+#endif
+    }
+    static inline void Store(Sint32* out, SIMDInt4 a) {
+#if defined(USING_SIMD_SSE2)
+        _mm_storeu_si128((__m128i*)out, a.V);
+#elif defined(USING_SIMD_NEON)
+        vst1q_s32(out, a.V);
+#else
+        out[0] = a.V[0]; out[1] = a.V[1]; out[2] = a.V[2]; out[3] = a.V[3];
+#endif
+    }
+    // Sets out[i] = base[i] + a[i] + b[i] + c[i], summing in 64 bits so that
+    // it can't overflow.
+    static inline void SumWidened(Sint64* out, const Sint64* base, SIMDInt4 a, SIMDInt4 b, SIMDInt4 c) {
+#if defined(USING_SIMD_SSE2)
+        __m128i lo = _mm_loadu_si128((const __m128i*)&base[0]);
+        __m128i hi = _mm_loadu_si128((const __m128i*)&base[2]);
+        __m128i lanes[3] = { a.V, b.V, c.V };
+        for (int i = 0; i < 3; i++) {
+            __m128i sign = _mm_srai_epi32(lanes[i], 31);
+            lo = _mm_add_epi64(lo, _mm_unpacklo_epi32(lanes[i], sign));
+            hi = _mm_add_epi64(hi, _mm_unpackhi_epi32(lanes[i], sign));
+        }
+        _mm_storeu_si128((__m128i*)&out[0], lo);
+        _mm_storeu_si128((__m128i*)&out[2], hi);
+#elif defined(USING_SIMD_NEON)
+        int64x2_t lo = vld1q_s64(&base[0]);
+        int64x2_t hi = vld1q_s64(&base[2]);
+        lo = vaddq_s64(lo, vaddq_s64(vmovl_s32(vget_low_s32(a.V)), vaddq_s64(vmovl_s32(vget_low_s32(b.V)), vmovl_s32(vget_low_s32(c.V)))));
+        hi = vaddq_s64(hi, vaddq_s64(vmovl_s32(vget_high_s32(a.V)), vaddq_s64(vmovl_s32(vget_high_s32(b.V)), vmovl_s32(vget_high_s32(c.V)))));
+        vst1q_s64(&out[0], lo);
+        vst1q_s64(&out[2], hi);
+#else
+        for (int i = 0; i < 4; i++)
+            out[i] = base[i] + (Sint64)a.V[i] + (Sint64)b.V[i] + (Sint64)c.V[i];
+#endif
+    }
+};
+
+// Four 32-bit float lanes.
+struct SIMDFloat4 {
+#if defined(USING_SIMD_SSE2)
+    __m128 V;
+#elif defined(USING_SIMD_NEON)
+    float32x4_t V;
+#else
+    float V[4];
+#endif
+
+    static inline SIMDFloat4 Set(float a, float b, float c, float d) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_set_ps(d, c, b, a);
+#elif defined(USING_SIMD_NEON)
+        float tmp[4] = { a, b, c, d };
+        r.V = vld1q_f32(tmp);
+#else
+        r.V[0] = a; r.V[1] = b; r.V[2] = c; r.V[3] = d;
+#endif
+        return r;
+    }
+    static inline SIMDFloat4 Splat(float a) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_set1_ps(a);
+#elif defined(USING_SIMD_NEON)
+        r.V = vdupq_n_f32(a);
+#else
+        r.V[0] = r.V[1] = r.V[2] = r.V[3] = a;
+#endif
+        return r;
+    }
+    static inline SIMDFloat4 Load(const float* in) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_loadu_ps(in);
+#elif defined(USING_SIMD_NEON)
+        r.V = vld1q_f32(in);
+#else
+        r.V[0] = in[0]; r.V[1] = in[1]; r.V[2] = in[2]; r.V[3] = in[3];
+#endif
+        return r;
+    }
+    static inline void Store(float* out, SIMDFloat4 a) {
+#if defined(USING_SIMD_SSE2)
+        _mm_storeu_ps(out, a.V);
+#elif defined(USING_SIMD_NEON)
+        vst1q_f32(out, a.V);
+#else
+        out[0] = a.V[0]; out[1] = a.V[1]; out[2] = a.V[2]; out[3] = a.V[3];
+#endif
+    }
+    static inline SIMDFloat4 Add(SIMDFloat4 a, SIMDFloat4 b) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_add_ps(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vaddq_f32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] + b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDFloat4 Mul(SIMDFloat4 a, SIMDFloat4 b) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_mul_ps(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vmulq_f32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] * b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDFloat4 Min(SIMDFloat4 a, SIMDFloat4 b) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_min_ps(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vminq_f32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] < b.V[i] ? a.V[i] : b.V[i];
+#endif
+        return r;
+    }
+    static inline SIMDFloat4 Max(SIMDFloat4 a, SIMDFloat4 b) {
+        SIMDFloat4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_max_ps(a.V, b.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vmaxq_f32(a.V, b.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = a.V[i] > b.V[i] ? a.V[i] : b.V[i];
+#endif
+        return r;
+    }
+    // Converts to integers, rounding towards zero like a cast does.
+    static inline SIMDInt4 Truncate(SIMDFloat4 a) {
+        SIMDInt4 r;
+#if defined(USING_SIMD_SSE2)
+        r.V = _mm_cvttps_epi32(a.V);
+#elif defined(USING_SIMD_NEON)
+        r.V = vcvtq_s32_f32(a.V);
+#else
+        for (int i = 0; i < 4; i++)
+            r.V[i] = (Sint32)a.V[i];
+#endif
+        return r;
+    }
+};
+
+#endif /* SIMD_H */
@@ -0,0 +1,57 @@
+#ifndef ENGINE_SPSCQUEUE_H
+#define ENGINE_SPSCQUEUE_H
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+// A fixed size queue that one thread pushes to and one other thread pops
+// from, without locking. The capacity has to be a power of two.
+template <typename T> class SPSCQueue {
+public:
+    T*           Items = NULL;
+    Uint32       Mask = 0;
+    // Only written to by the thread that pops
+    SDL_atomic_t Head;
+    // Only written to by the thread that pushes
+    SDL_atomic_t Tail;
+
+    SPSCQueue<T>(Uint32 capacity) {
+        Items = new T[capacity];
+        Mask = capacity - 1;
+        SDL_AtomicSet(&Head, 0);
+        SDL_AtomicSet(&Tail, 0);
+    }
+    ~SPSCQueue<T>() {
+        delete[] Items;
+    }
+
+    // Returns false if the queue is full.
+    bool Push(const T& item) {
+        Uint32 tail = (Uint32)SDL_AtomicGet(&Tail);
+        if (tail - (Uint32)SDL_AtomicGet(&Head) > Mask)
+            return false;
+
+        Items[tail & Mask] = item;
+        SDL_AtomicSet(&Tail, (int)(tail + 1));
+        return true;
+    }
+    // Returns false if the queue is empty.
+    bool Pop(T* item) {
+        Uint32 head = (Uint32)SDL_AtomicGet(&Head);
+        if (head == (Uint32)SDL_AtomicGet(&Tail))
+            return false;
+
+        *item = Items[head & Mask];
+        SDL_AtomicSet(&Head, (int)(head + 1));
+        return true;
+    }
+
+    bool IsEmpty() {
+        return SDL_AtomicGet(&Head) == SDL_AtomicGet(&Tail);
+    }
+    bool IsFull() {
+        return (Uint32)SDL_AtomicGet(&Tail) - (Uint32)SDL_AtomicGet(&Head) > Mask;
+    }
+};
+
+#endif /* ENGINE_SPSCQUEUE_H */
@@ -8,6 +8,7 @@ public:
 #include <Engine/Math/Matrix4x4.h>
 
 #include <Engine/Diagnostics/Log.h>
+#include <Engine/Includes/SIMD.h>
 #include <Engine/Math/Math.h>
 
 #include <math.h>
@@ -92,46 +93,28 @@ PUBLIC STATIC bool       Matrix4x4::Equals(Matrix4x4* a, Matrix4x4* b) {
 }
 
 PUBLIC STATIC void       Matrix4x4::Multiply(Matrix4x4* out, Matrix4x4* a, Matrix4x4* b) {
-    float a00 = a->Values[0], a01 = a->Values[1], a02 = a->Values[2], a03 = a->Values[3];
-    float a10 = a->Values[4], a11 = a->Values[5], a12 = a->Values[6], a13 = a->Values[7];
-    float a20 = a->Values[8], a21 = a->Values[9], a22 = a->Values[10], a23 = a->Values[11];
-    float a30 = a->Values[12], a31 = a->Values[13], a32 = a->Values[14], a33 = a->Values[15];
-
-    // Cache only the current line of the second matrix
-    float b0 = b->Values[0], b1 = b->Values[1], b2 = b->Values[2], b3 = b->Values[3];
-    out->Values[0]  = b0 * a00 + b1 * a10 + b2 * a20 + b3 * a30;
-    out->Values[1]  = b0 * a01 + b1 * a11 + b2 * a21 + b3 * a31;
-    out->Values[2]  = b0 * a02 + b1 * a12 + b2 * a22 + b3 * a32;
-    out->Values[3]  = b0 * a03 + b1 * a13 + b2 * a23 + b3 * a33;
-
-    b0 = b->Values[4]; b1 = b->Values[5]; b2 = b->Values[6]; b3 = b->Values[7];
-    out->Values[4]  = b0 * a00 + b1 * a10 + b2 * a20 + b3 * a30;
-    out->Values[5]  = b0 * a01 + b1 * a11 + b2 * a21 + b3 * a31;
-    out->Values[6]  = b0 * a02 + b1 * a12 + b2 * a22 + b3 * a32;
-    out->Values[7]  = b0 * a03 + b1 * a13 + b2 * a23 + b3 * a33;
-
-    b0 = b->Values[8]; b1 = b->Values[9]; b2 = b->Values[10]; b3 = b->Values[11];
-    out->Values[8]  = b0 * a00 + b1 * a10 + b2 * a20 + b3 * a30;
-    out->Values[9]  = b0 * a01 + b1 * a11 + b2 * a21 + b3 * a31;
-    out->Values[10] = b0 * a02 + b1 * a12 + b2 * a22 + b3 * a32;
-    out->Values[11] = b0 * a03 + b1 * a13 + b2 * a23 + b3 * a33;
-
-    b0 = b->Values[12]; b1 = b->Values[13]; b2 = b->Values[14]; b3 = b->Values[15];
-    out->Values[12] = b0 * a00 + b1 * a10 + b2 * a20 + b3 * a30;
-    out->Values[13] = b0 * a01 + b1 * a11 + b2 * a21 + b3 * a31;
-    out->Values[14] = b0 * a02 + b1 * a12 + b2 * a22 + b3 * a32;
-    out->Values[15] = b0 * a03 + b1 * a13 + b2 * a23 + b3 * a33;
+    // Every line of the result is the lines of the first matrix, weighted by
+    // the values in the same line of the second matrix
+    SIMDFloat4 a0 = SIMDFloat4::Load(&a->Values[0]);
+    SIMDFloat4 a1 = SIMDFloat4::Load(&a->Values[4]);
+    SIMDFloat4 a2 = SIMDFloat4::Load(&a->Values[8]);
+    SIMDFloat4 a3 = SIMDFloat4::Load(&a->Values[12]);
+
+    // Cache only the current line of the second matrix, so that out can be b
+    for (int i = 0; i < 16; i += 4) {
+        SIMDFloat4 line = SIMDFloat4::Mul(SIMDFloat4::Splat(b->Values[i]), a0);
+        line = SIMDFloat4::Add(line, SIMDFloat4::Mul(SIMDFloat4::Splat(b->Values[i + 1]), a1));
+        line = SIMDFloat4::Add(line, SIMDFloat4::Mul(SIMDFloat4::Splat(b->Values[i + 2]), a2));
+        line = SIMDFloat4::Add(line, SIMDFloat4::Mul(SIMDFloat4::Splat(b->Values[i + 3]), a3));
+        SIMDFloat4::Store(&out->Values[i], line);
+    }
 }
 PUBLIC STATIC void       Matrix4x4::Multiply(Matrix4x4* mat, float* a) {
-    float a0 = a[0];
-    float a1 = a[1];
-    float a2 = a[2];
-    float a3 = a[3];
-
-    a[0] = mat->Values[0] * a0 + mat->Values[4] * a1 + mat->Values[8] * a2 + mat->Values[12] * a3;
-    a[1] = mat->Values[1] * a0 + mat->Values[5] * a1 + mat->Values[9] * a2 + mat->Values[13] * a3;
-    a[2] = mat->Values[2] * a0 + mat->Values[6] * a1 + mat->Values[10] * a2 + mat->Values[14] * a3;
-    a[3] = mat->Values[3] * a0 + mat->Values[7] * a1 + mat->Values[11] * a2 + mat->Values[15] * a3;
+    SIMDFloat4 result = SIMDFloat4::Mul(SIMDFloat4::Load(&mat->Values[0]), SIMDFloat4::Splat(a[0]));
+    result = SIMDFloat4::Add(result, SIMDFloat4::Mul(SIMDFloat4::Load(&mat->Values[4]), SIMDFloat4::Splat(a[1])));
+    result = SIMDFloat4::Add(result, SIMDFloat4::Mul(SIMDFloat4::Load(&mat->Values[8]), SIMDFloat4::Splat(a[2])));
+    result = SIMDFloat4::Add(result, SIMDFloat4::Mul(SIMDFloat4::Load(&mat->Values[12]), SIMDFloat4::Splat(a[3])));
+    SIMDFloat4::Store(a, result);
 }
 
 PUBLIC STATIC void       Matrix4x4::Translate(Matrix4x4* out, Matrix4x4* a, float x, float y, float z) {
@@ -14,6 +14,7 @@ public:
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Utilities/WorkerPool.h>
 
 #ifdef USING_CURL
 
@@ -23,7 +24,23 @@ public:
 #endif
 #include <curl/curl.h>
 
-CURL*     curl = NULL;
+// Requests can come from several threads at once, so each gets its own
+// handle, which is cleaned up when the thread exits
+struct    CurlHandle {
+    CURL* Handle = NULL;
+
+    ~CurlHandle() {
+        if (Handle)
+            curl_easy_cleanup(Handle);
+    }
+};
+static thread_local CurlHandle ThreadCurl;
+
+CURL*     GetCurl() {
+    if (!ThreadCurl.Handle)
+        ThreadCurl.Handle = curl_easy_init();
+    return ThreadCurl.Handle;
+}
 
 struct    CurlData {
     Uint8* Ptr;
@@ -78,12 +95,14 @@ struct    _GET_Bundle {
     char* URL;
     ObjBoundMethod Callback;
 };
-int       _GET_FromThread(void* op) {
+void      _GET_FromThread(void* op) {
     _GET_Bundle* bundle = (_GET_Bundle*)op;
 
-    CurlData* data = CurlGET(curl, bundle->URL);
-    if (!data)
-        return false;
+    CurlData* data = CurlGET(GetCurl(), bundle->URL);
+    if (!data) {
+        free(bundle);
+        return;
+    }
 
     Uint8* ptr = data->Ptr;
     size_t length = data->Length;
@@ -102,9 +121,9 @@ int       _GET_FromThread(void* op) {
         ScriptManager::Unlock();
     }
 
+    free(data->Ptr);
     free(data);
     free(bundle);
-    return 0;
 }
 
 #endif
@@ -112,11 +131,9 @@ int       _GET_FromThread(void* op) {
 PUBLIC STATIC bool HTTP::GET(const char* url, Uint8** outBuf, size_t* outLen, ObjBoundMethod* callback) {
     #ifdef USING_CURL
 
-    if (!curl) {
-        curl = curl_easy_init();
-        if (!curl)
-            return false;
-    }
+    CURL* curl = GetCurl();
+    if (!curl)
+        return false;
 
     if (callback && false) {
         // NOTE: Mutex lock/unlock while using ScriptManager from other thread.
@@ -127,7 +144,8 @@ PUBLIC STATIC bool HTTP::GET(const char* url, Uint8** outBuf, size_t* outLen, Ob
         bundle->Callback = *callback;
         bundle->Callback.Object.Next = NULL;
         strcpy(bundle->URL, url);
-        SDL_CreateThread(_GET_FromThread, "_GET_FromThread", bundle);
+        if (!WorkerPool::QueueJob(_GET_FromThread, bundle))
+            _GET_FromThread(bundle);
         return false;
     }
 
@@ -1,5 +1,7 @@
 #if INTERFACE
 #include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Includes/SPSCQueue.h>
 #include <Engine/Network/WebSocketIncludes.h>
 
 #include <time.h>
@@ -13,18 +15,63 @@ public:
         OPEN = 3,
     };
 
+    struct Message {
+        Uint8* Data;
+        size_t Size;
+    };
+
+    // Only used by the I/O thread
     std::vector<uint8_t> rxbuf;
     std::vector<uint8_t> txbuf;
+    std::vector<uint8_t> fragment;
+
+    // Only used by the thread that owns the client
     std::vector<uint8_t> receivedData;
+    std::vector<uint8_t> pendingSends;
+
+    // Whole messages for the owner, and batches of frames to send
+    SPSCQueue<Message>*  incoming = NULL;
+    SPSCQueue<Message>*  outgoing = NULL;
 
     socket_t socket;
-    int readyState;
+    SDL_atomic_t readyState;
     bool useMask;
     bool isRxBad;
+
+    SDL_Thread*  thread = NULL;
+    SDL_mutex*   waitLock = NULL;
+    SDL_cond*    messageReady = NULL;
+    SDL_atomic_t waiting;
+    int          wakePipe[2] = { -1, -1 };
+    int          pollFD = -1;
+    Uint32       pollEvents = 0;
+
+    // Clients that are closing, to be deleted once their thread is done
+    static vector<WebSocketClient*> Closing;
 };
 #endif
 
 #include <Engine/Network/WebSocketClient.h>
+#include <Engine/Diagnostics/Clock.h>
+
+#if LINUX
+    #define USING_EPOLL
+    #include <sys/epoll.h>
+#endif
+#ifndef _WIN32
+    #include <poll.h>
+#endif
+
+// Reading from and writing to the socket happens on a thread of its own.
+// It parses and unmasks frames there, and hands whole messages to the
+// owner through a queue. Frames the owner sends go through another queue,
+// in batches, and are written out together.
+
+vector<WebSocketClient*> WebSocketClient::Closing;
+
+#define MESSAGE_QUEUE_SIZE 1024
+// How long a closing connection gets to send what it has left
+#define CLOSE_TIMEOUT 1000.0
 
 const char* BASE64_CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -232,7 +279,8 @@ size_t   socket_send_string(socket_t sockfd, const char* str, ...) {
     char line[1024];
     va_list args;
     va_start(args, str);
-    vsnprintf(line, sizeof 1024, str, args);
+    vsnprintf(line, sizeof line, str, args);
+    va_end(args);
 
     return send(sockfd, line, strlen(line), 0);
 }
@@ -347,9 +395,10 @@ PUBLIC STATIC WebSocketClient* WebSocketClient::New(const char* url) {
     #endif
 
     socket->socket = sockfd;
-    socket->readyState = OPEN;
     socket->useMask = false;
     socket->isRxBad = false;
+    if (!socket->StartThread())
+        goto FREE;
     return socket;
 
     FREE:
@@ -358,94 +407,243 @@ PUBLIC STATIC WebSocketClient* WebSocketClient::New(const char* url) {
     delete socket;
     return NULL;
 }
-PUBLIC        void             WebSocketClient::Poll(int timeout) {
-    if (readyState == WebSocketClient::CLOSED) {
-        if (timeout > 0) {
-            timeval tv = { timeout / 1000, (timeout % 1000) * 1000 };
-            select(0, NULL, NULL, NULL, &tv);
+
+PRIVATE       bool             WebSocketClient::StartThread() {
+    SDL_AtomicSet(&readyState, OPEN);
+    SDL_AtomicSet(&waiting, 0);
+
+#ifndef _WIN32
+    // Lets the owner wake the thread up when it has something to send
+    if (pipe(wakePipe) != 0) {
+        wakePipe[0] = wakePipe[1] = -1;
+        return false;
+    }
+    fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+#endif
+
+#ifdef USING_EPOLL
+    pollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (pollFD >= 0) {
+        epoll_event event;
+        memset(&event, 0, sizeof event);
+        event.events = EPOLLIN;
+        event.data.fd = wakePipe[0];
+        epoll_ctl(pollFD, EPOLL_CTL_ADD, wakePipe[0], &event);
+
+        pollEvents = EPOLLIN;
+        event.events = pollEvents;
+        event.data.fd = socket;
+        epoll_ctl(pollFD, EPOLL_CTL_ADD, socket, &event);
+    }
+#endif
+
+    incoming = new SPSCQueue<Message>(MESSAGE_QUEUE_SIZE);
+    outgoing = new SPSCQueue<Message>(MESSAGE_QUEUE_SIZE);
+    waitLock = SDL_CreateMutex();
+    messageReady = SDL_CreateCond();
+
+    thread = SDL_CreateThread(WebSocketClient::IOThread, "WebSocketClient", this);
+    if (!thread) {
+        // The socket gets closed by New
+        SDL_AtomicSet(&readyState, CLOSED);
+        return false;
+    }
+    return true;
+}
+
+// #region I/O thread
+PRIVATE STATIC int             WebSocketClient::IOThread(void* data) {
+    WebSocketClient* client = (WebSocketClient*)data;
+    double closeStarted = 0.0;
+    bool backedUp = false;
+
+    while (SDL_AtomicGet(&client->readyState) != CLOSED) {
+        bool closing = SDL_AtomicGet(&client->readyState) == CLOSING;
+        client->TakeOutgoing();
+
+        if (closing) {
+            if (closeStarted == 0.0)
+                closeStarted = Clock::GetTicks();
+            if (client->txbuf.empty() || Clock::GetTicks() - closeStarted > CLOSE_TIMEOUT) {
+                client->Disconnect(NULL);
+                break;
+            }
         }
+
+        // Frames left over from when the queue was full won't wake the
+        // thread up, so hand them over before waiting. Stop reading while
+        // the owner is behind; the server will slow down to match.
+        if (backedUp)
+            backedUp = !client->ParseFrames();
+        bool canReceive = !backedUp;
+        int timeout = -1;
+        if (!canReceive)
+            timeout = 1;
+        else if (closing)
+            timeout = 10;
+
+        client->WaitForSocket(canReceive, !client->txbuf.empty(), timeout);
+        client->DrainWakes();
+
+        if (canReceive && client->Receive())
+            backedUp = !client->ParseFrames();
+        client->Transmit();
+    }
+
+    // Wake up anything waiting in Poll
+    SDL_LockMutex(client->waitLock);
+    SDL_CondBroadcast(client->messageReady);
+    SDL_UnlockMutex(client->waitLock);
+    return 0;
+}
+// Waits until the socket is ready for what's asked of it, the owner wakes
+// the thread up, or timeout milliseconds pass.
+PRIVATE       void             WebSocketClient::WaitForSocket(bool read, bool write, int timeout) {
+#ifdef USING_EPOLL
+    if (pollFD >= 0) {
+        Uint32 events = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0);
+        if (events != pollEvents) {
+            epoll_event event;
+            memset(&event, 0, sizeof event);
+            event.events = events;
+            event.data.fd = socket;
+            epoll_ctl(pollFD, EPOLL_CTL_MOD, socket, &event);
+            pollEvents = events;
+        }
+
+        epoll_event ready[2];
+        epoll_wait(pollFD, ready, 2, timeout);
         return;
     }
+#endif
 
-    if (timeout != 0) {
-        fd_set rfds;
-        fd_set wfds;
-        timeval tv = { timeout / 1000, (timeout % 1000) * 1000 };
-        FD_ZERO(&rfds);
-        FD_ZERO(&wfds);
+#ifndef _WIN32
+    pollfd fds[2];
+    fds[0].fd = socket;
+    fds[0].events = (read ? POLLIN : 0) | (write ? POLLOUT : 0);
+    fds[0].revents = 0;
+    fds[1].fd = wakePipe[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    poll(fds, 2, timeout);
+#else
+    // Nothing can interrupt select here, so sends wait for the timeout
+    if (timeout < 0 || timeout > 5)
+        timeout = 5;
+
+    fd_set rfds;
+    fd_set wfds;
+    timeval tv = { 0, timeout * 1000 };
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    if (read)
         FD_SET(socket, &rfds);
-        if (txbuf.size())
-            FD_SET(socket, &wfds);
-
-        select(socket + 1, &rfds, &wfds, NULL, timeout > 0 ? &tv : NULL);
+    if (write)
+        FD_SET(socket, &wfds);
+    select(socket + 1, &rfds, &wfds, NULL, &tv);
+#endif
+}
+PRIVATE       void             WebSocketClient::DrainWakes() {
+#ifndef _WIN32
+    char buffer[64];
+    while (read(wakePipe[0], buffer, sizeof buffer) > 0);
+#endif
+}
+PRIVATE       void             WebSocketClient::Wake() {
+#ifndef _WIN32
+    if (wakePipe[1] >= 0) {
+        char byte = 0;
+        ssize_t ret = write(wakePipe[1], &byte, 1);
+        (void)ret;
     }
+#endif
+}
+PRIVATE       void             WebSocketClient::Disconnect(const char* error) {
+    if (error)
+        fputs(error, stderr);
 
+    closesocket(socket);
+    SDL_AtomicSet(&readyState, CLOSED);
+}
+// Moves every batch the owner queued onto the end of txbuf.
+PRIVATE       void             WebSocketClient::TakeOutgoing() {
+    Message batch;
+    while (outgoing->Pop(&batch)) {
+        txbuf.insert(txbuf.end(), batch.Data, batch.Data + batch.Size);
+        free(batch.Data);
+    }
+}
+// Reads everything that has arrived. Returns false if nothing had.
+PRIVATE       bool             WebSocketClient::Receive() {
+    bool received = false;
     while (true) {
-        // FD_ISSET(0, &rfds) will be true
-        int N = rxbuf.size();
+        size_t N = rxbuf.size();
         ssize_t ret;
         rxbuf.resize(N + 1500);
         ret = recv(socket, (char*)&rxbuf[0] + N, 1500, 0);
-        if (false) { }
-        else if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS)) {
+        if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS)) {
             rxbuf.resize(N);
             break;
         }
         else if (ret <= 0) {
             rxbuf.resize(N);
-            closesocket(socket);
-            readyState = CLOSED;
-            printf("readyState = CLOSED      0\n");
-            fputs(ret < 0 ? "Connection error!\n" : "Connection closed!\n", stderr);
+            Disconnect(ret < 0 ? "Connection error!\n" : "Connection closed!\n");
             break;
         }
         else {
             rxbuf.resize(N + ret);
+            received = true;
         }
     }
-    while (txbuf.size()) {
-        int ret = send(socket, (char*)&txbuf[0], txbuf.size(), 0);
-        if (false) { } // ??
-        else if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS)) {
+    return received;
+}
+PRIVATE       void             WebSocketClient::Transmit() {
+    size_t sent = 0;
+    while (sent < txbuf.size() && SDL_AtomicGet(&readyState) != CLOSED) {
+        int ret = send(socket, (char*)&txbuf[sent], txbuf.size() - sent, 0);
+        if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS)) {
             break;
         }
         else if (ret <= 0) {
-            closesocket(socket);
-            readyState = CLOSED;
-            printf("readyState = CLOSED      1\n");
-            fputs(ret < 0 ? "Connection error!\n" : "Connection closed!\n", stderr);
+            Disconnect(ret < 0 ? "Connection error!\n" : "Connection closed!\n");
             break;
         }
         else {
-            txbuf.erase(txbuf.begin(), txbuf.begin() + ret);
+            sent += ret;
         }
     }
-    if (!txbuf.size() && readyState == CLOSING) {
-        closesocket(socket);
-        readyState = CLOSED;
-        printf("readyState = CLOSED      2\n");
-    }
+    txbuf.erase(txbuf.begin(), txbuf.begin() + sent);
 }
-PUBLIC        void             WebSocketClient::Dispatch(void(*callback)(void* mem, size_t size)) {
-    // TODO: consider acquiring a lock on rxbuf...
-    if (isRxBad) {
-        printf("bad rx\n");
-        return;
-    }
+// Takes whole frames out of rxbuf, and queues up whole messages for the
+// owner. Returns false if it stopped early because the queue was full.
+PRIVATE       bool             WebSocketClient::ParseFrames() {
+    if (isRxBad)
+        return true;
+
+    bool queued = false;
+    bool full = false;
+    size_t offset = 0;
     while (true) {
+        if (incoming->IsFull()) {
+            full = true;
+            break;
+        }
+
         wsheader_type ws;
-        if (rxbuf.size() < 2)
-            return; /* Need at least 2 */
+        size_t available = rxbuf.size() - offset;
+        if (available < 2)
+            break; /* Need at least 2 */
 
-        const uint8_t* data = (uint8_t*)&rxbuf[0]; // peek, but don't consume
+        const uint8_t* data = (uint8_t*)&rxbuf[offset]; // peek, but don't consume
         ws.fin = (data[0] & 0x80) == 0x80;
         ws.opcode = (opcode_type) (data[0] & 0x0f);
         ws.mask = (data[1] & 0x80) == 0x80;
         ws.N0 = (data[1] & 0x7f);
         ws.header_size = 2 + (ws.N0 == 126? 2 : 0) + (ws.N0 == 127? 8 : 0) + (ws.mask? 4 : 0);
 
-        if (rxbuf.size() < ws.header_size)
-            return; /* Need: ws.header_size - rxbuf.size() */
+        if (available < ws.header_size)
+            break; /* Need: ws.header_size - available */
 
         int i = 0;
         if (ws.N0 < 126) {
@@ -476,12 +674,11 @@ PUBLIC        void             WebSocketClient::Dispatch(void(*callback)(void* m
                 // We can't drop the frame, because (1) we don't we don't
                 // know how much data to skip over to find the next header,
                 // and (2) this would be an impractically long length, even
-                // if it were valid. So just Close() and return immediately
+                // if it were valid. So just close and return immediately
                 // for now.
                 isRxBad = true;
-                fprintf(stderr, "ERROR: Frame has invalid frame length. Closing.\n");
-                Close();
-                return;
+                Disconnect("ERROR: Frame has invalid frame length. Closing.\n");
+                break;
             }
         }
 
@@ -500,166 +697,194 @@ PUBLIC        void             WebSocketClient::Dispatch(void(*callback)(void* m
 
         // Note: The checks above should hopefully ensure this addition
         //       cannot overflow:
-        if (rxbuf.size() < ws.header_size + ws.N)
-            return; /* Need: ws.header_size+ws.N - rxbuf.size() */
+        if (available < ws.header_size + ws.N)
+            break; /* Need: ws.header_size+ws.N - available */
 
-        // We got a whole message, now do something with it:
+        // We got a whole frame, now do something with it:
+        uint8_t* payload = &rxbuf[offset + ws.header_size];
+        if (ws.mask) {
+            for (size_t i = 0; i != ws.N; i++) {
+                payload[i] ^= ws.masking_key[i & 0x3];
+            }
+        }
 
         if (ws.opcode == opcode_type::TEXT_FRAME ||
             ws.opcode == opcode_type::BINARY_FRAME ||
             ws.opcode == opcode_type::CONTINUATION) {
-            if (ws.mask) {
-                for (size_t i = 0; i != ws.N; i++) {
-                    rxbuf[i + ws.header_size] ^= ws.masking_key[i & 0x3];
-                }
-            }
-
-            receivedData.insert(receivedData.end(), rxbuf.begin() + ws.header_size, rxbuf.begin() + ws.header_size + (size_t)ws.N); // just feed
+            fragment.insert(fragment.end(), payload, payload + (size_t)ws.N); // just feed
 
             if (ws.fin) {
-                if (callback)
-                    callback(receivedData.data(), receivedData.size());
-
-                receivedData.erase(receivedData.begin(), receivedData.end());
-                std::vector<uint8_t>().swap(receivedData); // free memory
+                Message message;
+                message.Size = fragment.size();
+                message.Data = (Uint8*)malloc(message.Size ? message.Size : 1);
+                memcpy(message.Data, fragment.data(), message.Size);
+                incoming->Push(message);
+                queued = true;
+
+                std::vector<uint8_t>().swap(fragment); // free memory
             }
         }
         else if (ws.opcode == opcode_type::PING) {
-            if (ws.mask) {
-                for (size_t i = 0; i != ws.N; ++i) {
-                    rxbuf[i + ws.header_size] ^= ws.masking_key[i & 0x3];
-                }
-            }
-            std::string data(rxbuf.begin() + ws.header_size, rxbuf.begin() + ws.header_size + (size_t)ws.N);
-            SendData(opcode_type::PONG, data.data(), data.size());
+            BuildFrame(txbuf, opcode_type::PONG, payload, (int64_t)ws.N, useMask);
         }
         else if (ws.opcode == opcode_type::PONG) { }
-        else if (ws.opcode == opcode_type::CLOSE) { Close(); }
-        else { fprintf(stderr, "ERROR: Got unexpected WebSocketClient message.\n"); Close(); }
+        else if (ws.opcode == opcode_type::CLOSE) {
+            if (SDL_AtomicCAS(&readyState, OPEN, CLOSING))
+                BuildCloseFrame(txbuf);
+        }
+        else {
+            fprintf(stderr, "ERROR: Got unexpected WebSocketClient message.\n");
+            if (SDL_AtomicCAS(&readyState, OPEN, CLOSING))
+                BuildCloseFrame(txbuf);
+        }
 
-        rxbuf.erase(rxbuf.begin(), rxbuf.begin() + ws.header_size + (size_t)ws.N);
+        offset += ws.header_size + (size_t)ws.N;
     }
-}
-
-PUBLIC        size_t           WebSocketClient::BytesToRead() {
-    if (readyState == WebSocketClient::CLOSED ||
-        readyState == WebSocketClient::CLOSING)
-        return 0;
+    rxbuf.erase(rxbuf.begin(), rxbuf.begin() + offset);
 
-    if (isRxBad) {
-        printf("bad rx\n");
-        return 0;
+    if (queued && SDL_AtomicGet(&waiting)) {
+        SDL_LockMutex(waitLock);
+        SDL_CondBroadcast(messageReady);
+        SDL_UnlockMutex(waitLock);
     }
-    while (true) {
-        wsheader_type ws;
-        /* Need at least 2 */
-        if (rxbuf.size() < 2)
-            return 0;
+    return !full;
+}
+// #endregion
 
-        // peek, but don't consume
-        const uint8_t* data = (uint8_t*)&rxbuf[0];
-        ws.fin = (data[0] & 0x80) == 0x80;
-        ws.opcode = (opcode_type) (data[0] & 0x0f);
-        ws.mask = (data[1] & 0x80) == 0x80;
-        ws.N0 = (data[1] & 0x7f);
-        ws.header_size = 2 + (ws.N0 == 126? 2 : 0) + (ws.N0 == 127? 8 : 0) + (ws.mask? 4 : 0);
+PRIVATE STATIC void            WebSocketClient::BuildFrame(std::vector<uint8_t>& out, int type, const void* message, int64_t message_size, bool useMask) {
+    // TODO:
+    // Masking key should (must) be derived from a high quality random
+    // number generator, to mitigate attacks on non-WebSocketClient friendly
+    // middleware:
+    const uint8_t masking_key[4] = { 0x12, 0x34, 0x56, 0x78 };
 
-        if (rxbuf.size() < ws.header_size)
-            return 0; /* Need: ws.header_size - rxbuf.size() */
+    std::vector<uint8_t> header;
+    header.assign(2 + (message_size >= 126 ? 2 : 0) + (message_size >= 65536 ? 6 : 0) + (useMask ? 4 : 0), 0x00);
+    header[0] = 0x80 | type;
 
-        int i = 0;
-        if (ws.N0 < 126) {
-            ws.N = ws.N0;
-            i = 2;
-        }
-        else if (ws.N0 == 126) {
-            ws.N = 0;
-            ws.N |= ((uint64_t) data[2]) << 8;
-            ws.N |= ((uint64_t) data[3]) << 0;
-            i = 4;
+    if (message_size < 126) {
+        header[1] = (message_size & 0xff) | (useMask ? 0x80 : 0);
+        if (useMask) {
+            header[2] = masking_key[0];
+            header[3] = masking_key[1];
+            header[4] = masking_key[2];
+            header[5] = masking_key[3];
         }
-        else if (ws.N0 == 127) {
-            ws.N = 0;
-            ws.N |= ((uint64_t) data[2]) << 56;
-            ws.N |= ((uint64_t) data[3]) << 48;
-            ws.N |= ((uint64_t) data[4]) << 40;
-            ws.N |= ((uint64_t) data[5]) << 32;
-            ws.N |= ((uint64_t) data[6]) << 24;
-            ws.N |= ((uint64_t) data[7]) << 16;
-            ws.N |= ((uint64_t) data[8]) << 8;
-            ws.N |= ((uint64_t) data[9]) << 0;
-            i = 10;
-            if (ws.N & 0x8000000000000000ull) {
-                // https://tools.ietf.org/html/rfc6455 writes the "the most
-                // significant bit MUST be 0."
-                //
-                // We can't drop the frame, because (1) we don't we don't
-                // know how much data to skip over to find the next header,
-                // and (2) this would be an impractically long length, even
-                // if it were valid. So just Close() and return immediately
-                // for now.
-                isRxBad = true;
-                fprintf(stderr, "ERROR: Frame has invalid frame length. Closing.\n");
-                Close();
-                return 0;
-            }
+    }
+    else if (message_size < 65536) {
+        header[1] = 126 | (useMask ? 0x80 : 0);
+        header[2] = (message_size >> 8) & 0xff;
+        header[3] = (message_size >> 0) & 0xff;
+        if (useMask) {
+            header[4] = masking_key[0];
+            header[5] = masking_key[1];
+            header[6] = masking_key[2];
+            header[7] = masking_key[3];
         }
-
-        if (ws.mask) {
-            ws.masking_key[0] = ((uint8_t) data[i+0]) << 0;
-            ws.masking_key[1] = ((uint8_t) data[i+1]) << 0;
-            ws.masking_key[2] = ((uint8_t) data[i+2]) << 0;
-            ws.masking_key[3] = ((uint8_t) data[i+3]) << 0;
+    }
+    else { // TODO: run coverage testing here
+        header[1] = 127 | (useMask ? 0x80 : 0);
+        header[2] = (message_size >> 56) & 0xff;
+        header[3] = (message_size >> 48) & 0xff;
+        header[4] = (message_size >> 40) & 0xff;
+        header[5] = (message_size >> 32) & 0xff;
+        header[6] = (message_size >> 24) & 0xff;
+        header[7] = (message_size >> 16) & 0xff;
+        header[8] = (message_size >>  8) & 0xff;
+        header[9] = (message_size >>  0) & 0xff;
+        if (useMask) {
+            header[10] = masking_key[0];
+            header[11] = masking_key[1];
+            header[12] = masking_key[2];
+            header[13] = masking_key[3];
         }
-        else {
-            ws.masking_key[0] = 0;
-            ws.masking_key[1] = 0;
-            ws.masking_key[2] = 0;
-            ws.masking_key[3] = 0;
+    }
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), (uint8_t*)message, (uint8_t*)message + message_size);
+    if (useMask) {
+        size_t message_offset = out.size() - message_size;
+        for (size_t i = 0; i != (size_t)message_size; i++) {
+            out[message_offset + i] ^= masking_key[i&0x3];
         }
+    }
+}
+PRIVATE STATIC void            WebSocketClient::BuildCloseFrame(std::vector<uint8_t>& out) {
+    uint8_t closeFrame[6] = { 0x88, 0x80, 0x00, 0x00, 0x00, 0x00 }; // last 4 bytes are a masking key
+    out.insert(out.end(), closeFrame, closeFrame + 6);
+}
 
-        // Note: The checks above should hopefully ensure this addition
-        //       cannot overflow:
-        if (rxbuf.size() < ws.header_size + ws.N)
-            return 0; /* Need: ws.header_size+ws.N - rxbuf.size() */
+// Hands the frames sent since the last call to the I/O thread, as one
+// batch. If its queue is full, they wait for the next call.
+PRIVATE       void             WebSocketClient::FlushSends() {
+    if (pendingSends.empty() || !outgoing)
+        return;
 
-        // We got a whole message, now do something with it:
+    Message batch;
+    batch.Size = pendingSends.size();
+    batch.Data = (Uint8*)malloc(batch.Size);
+    memcpy(batch.Data, pendingSends.data(), batch.Size);
+    if (!outgoing->Push(batch)) {
+        free(batch.Data);
+        return;
+    }
 
-        if (ws.opcode == opcode_type::TEXT_FRAME ||
-            ws.opcode == opcode_type::BINARY_FRAME ||
-            ws.opcode == opcode_type::CONTINUATION) {
-            if (ws.mask) {
-                for (size_t i = 0; i != ws.N; i++) {
-                    rxbuf[i + ws.header_size] ^= ws.masking_key[i & 0x3];
-                }
-            }
+    pendingSends.clear();
+    Wake();
+}
 
-            receivedData.insert(receivedData.end(), rxbuf.begin() + ws.header_size, rxbuf.begin() + ws.header_size + (size_t)ws.N); // just feed
+PUBLIC        int              WebSocketClient::GetReadyState() {
+    return SDL_AtomicGet(&readyState);
+}
+// Sends anything that's waiting, and waits up to timeout milliseconds for
+// a message to arrive (forever, if it's negative).
+PUBLIC        void             WebSocketClient::Poll(int timeout) {
+    FlushSends();
 
-            if (ws.fin) {
-                rxbuf.erase(rxbuf.begin(), rxbuf.begin() + ws.header_size + (size_t)ws.N);
-                return receivedData.size();
+    if (SDL_AtomicGet(&readyState) == WebSocketClient::CLOSED) {
+        if (timeout > 0)
+            SDL_Delay(timeout);
+        return;
+    }
 
-                // receivedData.erase(receivedData.begin(), receivedData.end());
-                // std::vector<uint8_t>().swap(receivedData); // free memory
-            }
-        }
-        else if (ws.opcode == opcode_type::PING) {
-            if (ws.mask) {
-                for (size_t i = 0; i != ws.N; ++i) {
-                    rxbuf[i + ws.header_size] ^= ws.masking_key[i & 0x3];
-                }
-            }
-            std::string data(rxbuf.begin() + ws.header_size, rxbuf.begin() + ws.header_size + (size_t)ws.N);
-            SendData(opcode_type::PONG, data.data(), data.size());
-        }
-        else if (ws.opcode == opcode_type::PONG) { }
-        else if (ws.opcode == opcode_type::CLOSE) { Close(); }
-        else { fprintf(stderr, "ERROR: Got unexpected WebSocketClient message.\n"); Close(); }
+    if (timeout == 0 || !incoming->IsEmpty())
+        return;
 
-        rxbuf.erase(rxbuf.begin(), rxbuf.begin() + ws.header_size + (size_t)ws.N);
+    SDL_LockMutex(waitLock);
+    SDL_AtomicSet(&waiting, 1);
+    if (incoming->IsEmpty() && SDL_AtomicGet(&readyState) != WebSocketClient::CLOSED) {
+        if (timeout > 0)
+            SDL_CondWaitTimeout(messageReady, waitLock, timeout);
+        else
+            SDL_CondWait(messageReady, waitLock);
+    }
+    SDL_AtomicSet(&waiting, 0);
+    SDL_UnlockMutex(waitLock);
+}
+PUBLIC        void             WebSocketClient::Dispatch(void(*callback)(void* mem, size_t size)) {
+    FlushSends();
+
+    Message message;
+    while (incoming->Pop(&message)) {
+        if (callback)
+            callback(message.Data, message.Size);
+        free(message.Data);
     }
-    return 0;
+}
+
+// Moves the next message that arrived to the end of the data to read.
+// Returns how much data there is to read then, or 0 if no message had
+// arrived. Messages that arrived before the connection closed can still
+// be read.
+PUBLIC        size_t           WebSocketClient::BytesToRead() {
+    FlushSends();
+
+    Message message;
+    if (!incoming || !incoming->Pop(&message))
+        return 0;
+
+    receivedData.insert(receivedData.end(), message.Data, message.Data + message.Size);
+    free(message.Data);
+    return receivedData.size();
 }
 PUBLIC        size_t           WebSocketClient::ReadBytes(void* data, size_t n) {
     memcpy(data, receivedData.data(), n);
@@ -699,65 +924,13 @@ PUBLIC        char*            WebSocketClient::ReadString() {
 }
 
 PUBLIC        void             WebSocketClient::SendData(int type, const void* message, int64_t message_size) {
-    // TODO:
-    // Masking key should (must) be derived from a high quality random
-    // number generator, to mitigate attacks on non-WebSocketClient friendly
-    // middleware:
-    const uint8_t masking_key[4] = { 0x12, 0x34, 0x56, 0x78 };
-    // TODO: consider acquiring a lock on txbuf...
-    if (readyState == WebSocketClient::CLOSING || readyState == WebSocketClient::CLOSED)
+    int state = SDL_AtomicGet(&readyState);
+    if (state == WebSocketClient::CLOSING || state == WebSocketClient::CLOSED)
         return;
 
-    std::vector<uint8_t> header;
-    header.assign(2 + (message_size >= 126 ? 2 : 0) + (message_size >= 65536 ? 6 : 0) + (useMask ? 4 : 0), 0x00);
-    header[0] = 0x80 | type;
-
-    if (message_size < 126) {
-        header[1] = (message_size & 0xff) | (useMask ? 0x80 : 0);
-        if (useMask) {
-            header[2] = masking_key[0];
-            header[3] = masking_key[1];
-            header[4] = masking_key[2];
-            header[5] = masking_key[3];
-        }
-    }
-    else if (message_size < 65536) {
-        header[1] = 126 | (useMask ? 0x80 : 0);
-        header[2] = (message_size >> 8) & 0xff;
-        header[3] = (message_size >> 0) & 0xff;
-        if (useMask) {
-            header[4] = masking_key[0];
-            header[5] = masking_key[1];
-            header[6] = masking_key[2];
-            header[7] = masking_key[3];
-        }
-    }
-    else { // TODO: run coverage testing here
-        header[1] = 127 | (useMask ? 0x80 : 0);
-        header[2] = (message_size >> 56) & 0xff;
-        header[3] = (message_size >> 48) & 0xff;
-        header[4] = (message_size >> 40) & 0xff;
-        header[5] = (message_size >> 32) & 0xff;
-        header[6] = (message_size >> 24) & 0xff;
-        header[7] = (message_size >> 16) & 0xff;
-        header[8] = (message_size >>  8) & 0xff;
-        header[9] = (message_size >>  0) & 0xff;
-        if (useMask) {
-            header[10] = masking_key[0];
-            header[11] = masking_key[1];
-            header[12] = masking_key[2];
-            header[13] = masking_key[3];
-        }
-    }
-    // N.B. - txbuf will keep growing until it can be transmitted over the socket:
-    txbuf.insert(txbuf.end(), header.begin(), header.end());
-    txbuf.insert(txbuf.end(), (uint8_t*)message, (uint8_t*)message + message_size);
-    if (useMask) {
-        size_t message_offset = txbuf.size() - message_size;
-        for (size_t i = 0; i != (size_t)message_size; i++) {
-            txbuf[message_offset + i] ^= masking_key[i&0x3];
-        }
-    }
+    // N.B. - pendingSends will keep growing until the I/O thread catches up:
+    BuildFrame(pendingSends, type, message, message_size, useMask);
+    FlushSends();
 }
 PUBLIC        void             WebSocketClient::SendBinary(const void* message, int64_t message_size) {
     SendData(opcode_type::BINARY_FRAME, message, message_size);
@@ -765,15 +938,77 @@ PUBLIC        void             WebSocketClient::SendBinary(const void* message,
 PUBLIC        void             WebSocketClient::SendText(const char* message) {
     SendData(opcode_type::TEXT_FRAME, message, (int64_t)strlen(message));
 }
+// Starts closing the connection. The I/O thread sends what's left, and
+// closes the socket.
 PUBLIC        void             WebSocketClient::Close() {
-    if (readyState == WebSocketClient::CLOSING || readyState == WebSocketClient::CLOSED)
+    if (SDL_AtomicGet(&readyState) != WebSocketClient::OPEN)
         return;
 
-    readyState = WebSocketClient::CLOSING;
-    printf("readyState = WebSocketClient::CLOSING\n");
-    uint8_t closeFrame[6] = { 0x88, 0x80, 0x00, 0x00, 0x00, 0x00 }; // last 4 bytes are a masking key
-    std::vector<uint8_t> header(closeFrame, closeFrame + 6);
-    txbuf.insert(txbuf.end(), header.begin(), header.end());
+    // The close frame has to be queued before the thread sees CLOSING
+    BuildCloseFrame(pendingSends);
+    while (!pendingSends.empty() && SDL_AtomicGet(&readyState) != WebSocketClient::CLOSED) {
+        FlushSends();
+        if (!pendingSends.empty())
+            SDL_Delay(1);
+    }
+
+    SDL_AtomicCAS(&readyState, OPEN, CLOSING);
+    Wake();
+}
+
+// Starts closing the client, and deletes it once its thread is done,
+// without waiting for that.
+PUBLIC STATIC void             WebSocketClient::CloseAndDelete(WebSocketClient* client) {
+    client->Close();
+    Closing.push_back(client);
+}
+// Deletes the clients passed to CloseAndDelete that are done closing. With
+// wait, it deletes all of them, waiting for the ones that aren't done.
+PUBLIC STATIC void             WebSocketClient::DeleteClosed(bool wait) {
+    for (size_t i = 0; i < Closing.size(); ) {
+        WebSocketClient* client = Closing[i];
+        if (!wait && SDL_AtomicGet(&client->readyState) != WebSocketClient::CLOSED) {
+            i++;
+            continue;
+        }
+
+        delete client;
+        Closing.erase(Closing.begin() + i);
+    }
+}
+
+PUBLIC        WebSocketClient::~WebSocketClient() {
+    if (thread) {
+        Close();
+        SDL_WaitThread(thread, NULL);
+    }
+
+    Message message;
+    if (incoming) {
+        while (incoming->Pop(&message))
+            free(message.Data);
+        delete incoming;
+    }
+    if (outgoing) {
+        while (outgoing->Pop(&message))
+            free(message.Data);
+        delete outgoing;
+    }
+    if (messageReady)
+        SDL_DestroyCond(messageReady);
+    if (waitLock)
+        SDL_DestroyMutex(waitLock);
+
+#ifdef USING_EPOLL
+    if (pollFD >= 0)
+        close(pollFD);
+#endif
+#ifndef _WIN32
+    if (wakePipe[0] >= 0)
+        close(wakePipe[0]);
+    if (wakePipe[1] >= 0)
+        close(wakePipe[1]);
+#endif
 
     #ifdef _WIN32
         WSACleanup();
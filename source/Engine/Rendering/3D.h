@@ -11,6 +11,14 @@ enum VertexType {
     VertexType_Color = 4,
 };
 
+enum {
+    VertexOutcode_X      = 1 << 0, // Outside of the left or right planes
+    VertexOutcode_Y      = 1 << 1, // Outside of the top or bottom planes
+    VertexOutcode_Behind = 1 << 2, // Behind the camera
+
+    VertexOutcode_All    = VertexOutcode_X | VertexOutcode_Y | VertexOutcode_Behind
+};
+
 enum FogEquation {
     FogEquation_Linear,
     FogEquation_Exp
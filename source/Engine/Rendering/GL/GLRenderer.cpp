@@ -532,7 +532,7 @@ void GL_PrepareVertexBufferUpdate(Scene3D* scene, VertexBuffer* vertexBuffer, Ui
             face->Depth = (Sint64)((depth * 0x10000) / face->NumVertices);
         }
 
-        qsort(vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount, sizeof(FaceInfo), PolygonRenderer::FaceSortFunction);
+        PolygonRenderer::SortFaceInfos(vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount, false);
     }
 }
 void GL_UpdateVertexBuffer(Scene3D* scene, VertexBuffer* vertexBuffer, Uint32 drawMode, bool useBatching) {
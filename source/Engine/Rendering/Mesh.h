@@ -7,6 +7,11 @@
 #include <Engine/Math/FixedPoint.h>
 #include <Engine/Math/Vector.h>
 #include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+// Skeletons with at least this many vertices are skinned by the worker pool
+#define SKIN_PARALLEL_MIN_VERTICES 4096
+#define SKIN_BATCH_SIZE 1024
 
 struct BoneWeight {
     Uint32 VertexID;
@@ -143,6 +148,11 @@ struct ModelAnim {
     }
 };
 
+struct SkinInfluence {
+    Uint32 Bone;
+    Sint64 Weight;
+};
+
 struct Skeleton {
     MeshBone**         Bones;
     size_t             NumBones;
@@ -158,6 +168,12 @@ struct Skeleton {
 
     Matrix4x4*         GlobalInverseMatrix; // Pointer to the model's GlobalInverseMatrix
 
+    // The bone weights, grouped by vertex, so that every vertex can be
+    // skinned on its own. Influences[InfluenceStart[v]] up to
+    // Influences[InfluenceStart[v + 1]] are the ones of vertex v.
+    Uint32*            InfluenceStart;
+    SkinInfluence*     Influences;
+
     Skeleton() {
         Bones = nullptr;
         NumBones = 0;
@@ -172,6 +188,9 @@ struct Skeleton {
         TransformedNormals = nullptr;
 
         GlobalInverseMatrix = nullptr;
+
+        InfluenceStart = nullptr;
+        Influences = nullptr;
     }
 
     void CalculateBones() {
@@ -208,41 +227,96 @@ struct Skeleton {
         return result;
     }
 
-    void Transform() {
-        Vector3* outPositions = TransformedPositions;
-        Vector3* outNormals = TransformedNormals;
-
-        memset(outPositions, 0x00, NumVertices * sizeof(Vector3));
-        if (outNormals)
-            memset(outNormals, 0x00, NumVertices * sizeof(Vector3));
+    void BuildInfluences() {
+        InfluenceStart = (Uint32*)Memory::Calloc(NumVertices + 1, sizeof(Uint32));
 
+        size_t numInfluences = 0;
         for (size_t i = 0; i < NumBones; i++) {
             MeshBone* bone = Bones[i];
+            for (size_t w = 0; w < bone->Weights.size(); w++)
+                InfluenceStart[bone->Weights[w].VertexID + 1]++;
+            numInfluences += bone->Weights.size();
+        }
+        for (size_t v = 0; v < NumVertices; v++)
+            InfluenceStart[v + 1] += InfluenceStart[v];
+
+        Influences = (SkinInfluence*)Memory::Malloc((numInfluences ? numInfluences : 1) * sizeof(SkinInfluence));
 
+        // Filled in bone order, so every vertex adds up its bones in the
+        // same order as before
+        Uint32* next = (Uint32*)Memory::Malloc(NumVertices * sizeof(Uint32));
+        memcpy(next, InfluenceStart, NumVertices * sizeof(Uint32));
+        for (size_t i = 0; i < NumBones; i++) {
+            MeshBone* bone = Bones[i];
             for (size_t w = 0; w < bone->Weights.size(); w++) {
                 BoneWeight& boneWeight = bone->Weights[w];
+                SkinInfluence& influence = Influences[next[boneWeight.VertexID]++];
+                influence.Bone = (Uint32)i;
+                influence.Weight = FP16_DIVIDE(boneWeight.Weight, VertexWeights[boneWeight.VertexID]);
+            }
+        }
+        Memory::Free(next);
+    }
 
-                Uint32 vertexID = boneWeight.VertexID;
-                Sint64 weight = FP16_DIVIDE(boneWeight.Weight, VertexWeights[vertexID]);
+    struct SkinJob {
+        Skeleton* Source;
+        Vector3*  OutPositions;
+        Vector3*  OutNormals;
+    };
 
-                Vector3 temp = Vector::Multiply(PositionBuffer[vertexID], bone->FinalTransform);
+    static void TransformRange(void* data, Uint32 start, Uint32 end) {
+        SkinJob* job = (SkinJob*)data;
+        Skeleton* skeleton = job->Source;
 
-                outPositions[vertexID].X += FP16_MULTIPLY(temp.X, weight);
-                outPositions[vertexID].Y += FP16_MULTIPLY(temp.Y, weight);
-                outPositions[vertexID].Z += FP16_MULTIPLY(temp.Z, weight);
+        for (Uint32 v = start; v < end; v++) {
+            Vector3 position = { 0, 0, 0 };
+            Vector3 normal = { 0, 0, 0 };
 
-                if (!outNormals)
+            for (Uint32 i = skeleton->InfluenceStart[v]; i < skeleton->InfluenceStart[v + 1]; i++) {
+                SkinInfluence& influence = skeleton->Influences[i];
+                Matrix4x4* transform = skeleton->Bones[influence.Bone]->FinalTransform;
+
+                Vector3 temp = Vector::Multiply(skeleton->PositionBuffer[v], transform);
+
+                position.X += FP16_MULTIPLY(temp.X, influence.Weight);
+                position.Y += FP16_MULTIPLY(temp.Y, influence.Weight);
+                position.Z += FP16_MULTIPLY(temp.Z, influence.Weight);
+
+                if (!job->OutNormals)
                     continue;
 
-                temp = Skeleton::MultiplyMatrix3x3(&NormalBuffer[vertexID], bone->FinalTransform);
+                temp = Skeleton::MultiplyMatrix3x3(&skeleton->NormalBuffer[v], transform);
 
-                outNormals[vertexID].X += FP16_MULTIPLY(temp.X, weight);
-                outNormals[vertexID].Y += FP16_MULTIPLY(temp.Y, weight);
-                outNormals[vertexID].Z += FP16_MULTIPLY(temp.Z, weight);
+                normal.X += FP16_MULTIPLY(temp.X, influence.Weight);
+                normal.Y += FP16_MULTIPLY(temp.Y, influence.Weight);
+                normal.Z += FP16_MULTIPLY(temp.Z, influence.Weight);
             }
+
+            job->OutPositions[v] = position;
+            if (job->OutNormals)
+                job->OutNormals[v] = normal;
         }
     }
 
+    void Transform(Vector3* outPositions, Vector3* outNormals) {
+        if (Influences == nullptr)
+            BuildInfluences();
+
+        SkinJob job;
+        job.Source = this;
+        job.OutPositions = outPositions;
+        job.OutNormals = NormalBuffer ? outNormals : nullptr;
+
+        if (NumVertices >= SKIN_PARALLEL_MIN_VERTICES)
+            WorkerPool::ParallelFor(Skeleton::TransformRange, &job, NumVertices, SKIN_BATCH_SIZE);
+        else
+            TransformRange(&job, 0, NumVertices);
+    }
+
+    void Transform() {
+        Transform(TransformedPositions, TransformedNormals);
+    }
+
     void PrepareTransform() {
         UseTransforms = true;
 
@@ -263,6 +337,8 @@ struct Skeleton {
         }
 
         Memory::Free(VertexWeights);
+        Memory::Free(InfluenceStart);
+        Memory::Free(Influences);
 
         for (size_t i = 0; i < NumBones; i++)
             delete Bones[i];
@@ -493,4 +569,20 @@ struct Armature {
     }
 };
 
+// A skinned pose of every skeleton in an armature, along with the node
+// transforms it was made from.
+struct ModelPose {
+    ModelAnim*         Animation;
+    Uint32             Frame;
+    Uint32             LastUsed;
+
+    size_t             NumSkeletons;
+    Vector3**          Positions;
+    Vector3**          Normals;
+
+    size_t             NumNodes;
+    Matrix4x4*         LocalTransforms;
+    Matrix4x4*         GlobalTransforms;
+};
+
 #endif /* MESH_H */
@@ -26,6 +26,7 @@ public:
     bool             DoProjection;
     bool             ClipFaces;
     Armature*        ArmaturePtr;
+    ModelPose*       PosePtr;
 
     Uint32           DrawMode;
     Uint8            FaceCullMode;
@@ -35,6 +36,7 @@ public:
 
 #include <Engine/Rendering/ModelRenderer.h>
 #include <Engine/Rendering/PolygonRenderer.h>
+#include <Engine/Rendering/VertexTransform.h>
 #include <Engine/Utilities/ColorUtils.h>
 
 PRIVATE void ModelRenderer::Init() {
@@ -43,6 +45,7 @@ PRIVATE void ModelRenderer::Init() {
 
     ClipFaces = false;
     ArmaturePtr = nullptr;
+    PosePtr = nullptr;
 }
 
 PUBLIC ModelRenderer::ModelRenderer(PolygonRenderer* polyRenderer) {
@@ -89,9 +92,8 @@ PRIVATE int ModelRenderer::ClipFace(int faceVertexCount) {
 
     Vertex = AttribBuffer;
 
-    if (!PolygonRenderer::CheckPolygonVisible(Vertex, faceVertexCount))
-        return 0;
-    else if (PolyRenderer && PolyRenderer->ClipPolygonsByFrustum) {
+    // Faces outside of the view were already rejected by their outcodes
+    if (PolyRenderer && PolyRenderer->ClipPolygonsByFrustum) {
         PolygonClipBuffer clipper;
 
         faceVertexCount = PolyRenderer->ClipPolygon(clipper, Vertex, faceVertexCount);
@@ -119,7 +121,11 @@ PRIVATE void ModelRenderer::DrawMesh(IModel* model, Mesh* mesh, Skeleton* skelet
     Vector3* normalBuffer = mesh->NormalBuffer;
     Vector2* uvBuffer = mesh->UVBuffer;
 
-    if (skeleton) {
+    if (PosePtr && mesh->SkeletonIndex < (int)PosePtr->NumSkeletons) {
+        positionBuffer = PosePtr->Positions[mesh->SkeletonIndex];
+        normalBuffer = PosePtr->Normals[mesh->SkeletonIndex];
+    }
+    else if (skeleton) {
         positionBuffer = skeleton->TransformedPositions;
         normalBuffer = skeleton->TransformedNormals;
     }
@@ -149,224 +155,74 @@ PRIVATE void ModelRenderer::DrawMesh(IModel* model, Mesh* mesh, Vector3* positio
     Sint32* modelVertexIndexPtr = mesh->VertexIndexBuffer;
 
     int vertexTypeMask = VertexType_Position | VertexType_Normal | VertexType_Color | VertexType_UV;
-    int color = CurrentColor;
-
-    Vector3* positionPtr;
-    Vector3* normalPtr;
-    Uint32* colorPtr;
-    Vector2* uvPtr;
-
-    switch (mesh->VertexFlag & vertexTypeMask) {
+    int vertexFlag = mesh->VertexFlag & vertexTypeMask;
+    switch (vertexFlag) {
         case VertexType_Position:
-            // For every face,
-            while (*modelVertexIndexPtr != -1) {
-                int faceVertexCount = model->VertexPerFace;
-
-                // For every vertex index,
-                int numVertices = faceVertexCount;
-                while (numVertices--) {
-                    positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                    APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                    Vertex->Color = color;
-                    modelVertexIndexPtr++;
-                    Vertex++;
-                }
-
-                if ((faceVertexCount = ClipFace(faceVertexCount)))
-                    AddFace(faceVertexCount, material);
-            }
-            break;
         case VertexType_Position | VertexType_Normal:
-            if (NormalMatrix) {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        // Calculate position
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        // Calculate normals
-                        APPLY_MAT4X4(Vertex->Normal, normalPtr[0], NormalMatrix->Values);
-                        Vertex->Color = color;
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            else {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        // Calculate position
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        COPY_NORMAL(Vertex->Normal, normalPtr[0]);
-                        Vertex->Color = color;
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            break;
         case VertexType_Position | VertexType_Normal | VertexType_Color:
-            if (NormalMatrix) {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        colorPtr = &mesh->ColorBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        APPLY_MAT4X4(Vertex->Normal, normalPtr[0], NormalMatrix->Values);
-                        Vertex->Color = ColorUtils::Tint(colorPtr[0], color);
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            else {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        colorPtr = &mesh->ColorBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        COPY_NORMAL(Vertex->Normal, normalPtr[0]);
-                        Vertex->Color = ColorUtils::Tint(colorPtr[0], color);
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            break;
         case VertexType_Position | VertexType_Normal | VertexType_UV:
-            if (NormalMatrix) {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        uvPtr = &uvBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        APPLY_MAT4X4(Vertex->Normal, normalPtr[0], NormalMatrix->Values);
-                        Vertex->Color = color;
-                        Vertex->UV = uvPtr[0];
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            else {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        uvPtr = &uvBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        COPY_NORMAL(Vertex->Normal, normalPtr[0]);
-                        Vertex->Color = color;
-                        Vertex->UV = uvPtr[0];
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
-            }
-            break;
         case VertexType_Position | VertexType_Normal | VertexType_UV | VertexType_Color:
-            if (NormalMatrix) {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        uvPtr = &uvBuffer[*modelVertexIndexPtr];
-                        colorPtr = &mesh->ColorBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        APPLY_MAT4X4(Vertex->Normal, normalPtr[0], NormalMatrix->Values);
-                        Vertex->Color = ColorUtils::Tint(colorPtr[0], color);
-                        Vertex->UV = uvPtr[0];
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
-                }
+            break;
+        default:
+            return;
+    }
+
+    // Transform every vertex of the mesh up front, instead of once for
+    // every face that uses it
+    Uint32 meshVertexCount = mesh->VertexCount;
+    VertexTransform::Reserve(meshVertexCount);
+
+    Vector4* positions = VertexTransform::Positions;
+    Vector4* normals = VertexTransform::Normals;
+    Uint32* colors = VertexTransform::Colors;
+    Uint8* outcodes = ClipFaces ? VertexTransform::Outcodes : nullptr;
+
+    VertexTransform::TransformPositions(&mvpMatrix, positionBuffer, sizeof(Vector3), positions, outcodes, meshVertexCount);
+
+    bool useNormals = vertexFlag & VertexType_Normal;
+    bool useColors = vertexFlag & VertexType_Color;
+    bool useUVs = vertexFlag & VertexType_UV;
+    if (useNormals && NormalMatrix)
+        VertexTransform::TransformPositions(NormalMatrix, normalBuffer, sizeof(Vector3), normals, nullptr, meshVertexCount);
+    if (useColors)
+        VertexTransform::TintColors(mesh->ColorBuffer, CurrentColor, colors, meshVertexCount);
+
+    // For every face,
+    while (*modelVertexIndexPtr != -1) {
+        int faceVertexCount = model->VertexPerFace;
+
+        // Skip the face if all of its vertices are outside of the same planes
+        if (outcodes) {
+            Uint8 faceOutcode = VertexOutcode_All;
+            for (int i = 0; i < faceVertexCount; i++)
+                faceOutcode &= outcodes[modelVertexIndexPtr[i]];
+            if (faceOutcode) {
+                modelVertexIndexPtr += faceVertexCount;
+                continue;
             }
-            else {
-                // For every face,
-                while (*modelVertexIndexPtr != -1) {
-                    int faceVertexCount = model->VertexPerFace;
-
-                    // For every vertex index,
-                    int numVertices = faceVertexCount;
-                    while (numVertices--) {
-                        positionPtr = &positionBuffer[*modelVertexIndexPtr];
-                        normalPtr = &normalBuffer[*modelVertexIndexPtr];
-                        uvPtr = &uvBuffer[*modelVertexIndexPtr];
-                        colorPtr = &mesh->ColorBuffer[*modelVertexIndexPtr];
-                        APPLY_MAT4X4(Vertex->Position, positionPtr[0], mvpMatrix.Values);
-                        COPY_NORMAL(Vertex->Normal, normalPtr[0]);
-                        Vertex->Color = ColorUtils::Tint(colorPtr[0], color);
-                        Vertex->UV = uvPtr[0];
-                        modelVertexIndexPtr++;
-                        Vertex++;
-                    }
-
-                    if ((faceVertexCount = ClipFace(faceVertexCount)))
-                        AddFace(faceVertexCount, material);
+        }
+
+        // For every vertex index,
+        int numVertices = faceVertexCount;
+        while (numVertices--) {
+            Sint32 index = *modelVertexIndexPtr;
+            Vertex->Position = positions[index];
+            if (useNormals) {
+                if (NormalMatrix)
+                    Vertex->Normal = normals[index];
+                else {
+                    COPY_NORMAL(Vertex->Normal, normalBuffer[index]);
                 }
             }
-            break;
+            Vertex->Color = useColors ? colors[index] : CurrentColor;
+            if (useUVs)
+                Vertex->UV = uvBuffer[index];
+            modelVertexIndexPtr++;
+            Vertex++;
+        }
+
+        if ((faceVertexCount = ClipFace(faceVertexCount)))
+            AddFace(faceVertexCount, material);
     }
 }
 
@@ -435,8 +291,13 @@ PUBLIC void ModelRenderer::DrawModel(IModel* model, Uint16 animation, Uint32 fra
         if (ArmaturePtr == nullptr)
             ArmaturePtr = model->BaseArmature;
 
-        if (numAnims > 0)
-            model->Animate(ArmaturePtr, model->Animations[animation], frame);
+        // Draw straight from the pose cache if possible, instead of
+        // copying the pose into the armature
+        if (numAnims > 0) {
+            PosePtr = model->GetPose(ArmaturePtr, model->Animations[animation], frame);
+            if (PosePtr == nullptr)
+                model->Animate(ArmaturePtr, model->Animations[animation], frame);
+        }
     }
 
     DrawModelInternal(model, animation, frame);
@@ -26,22 +26,146 @@ public:
     bool          ClipPolygonsByFrustum = false;
     int           NumFrustumPlanes = 0;
     Frustum       ViewFrustum[NUM_FRUSTUM_PLANES];
+
+    static int    FaceSortBuckets;
 };
 #endif
 
 #include <Engine/Rendering/PolygonRenderer.h>
 #include <Engine/Rendering/ModelRenderer.h>
+#include <Engine/Rendering/VertexTransform.h>
 #include <Engine/Math/Clipper.h>
 #include <Engine/Rendering/Texture.h>
 #include <Engine/Rendering/Material.h>
+#include <Engine/Diagnostics/Memory.h>
 #include <Engine/Graphics.h>
 
+int PolygonRenderer::FaceSortBuckets = 0;
+
+// Faces are sorted with a stable LSD radix sort on their depth, relative to
+// the nearest face and quantized to at most FACE_SORT_KEY_BITS bits. If
+// FaceSortBuckets is set, depths are instead quantized to that many buckets,
+// which takes a single counting pass but only roughly orders faces that are
+// close together.
+#define FACE_SORT_KEY_BITS 22
+#define FACE_SORT_RADIX_BITS 11
+#define FACE_SORT_RADIX_SIZE (1 << FACE_SORT_RADIX_BITS)
+
+static Uint64*   FaceSortItems = NULL;
+static Uint64*   FaceSortScratch = NULL;
+static Uint32*   FaceSortOrder = NULL;
+static FaceInfo* FaceSortInfos = NULL;
+static Uint32    FaceSortCapacity = 0;
+static Uint32    FaceSortInfoCapacity = 0;
+
+static int GetBitCount(Uint64 value) {
+    int bits = 0;
+    while (value) {
+        value >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
 PUBLIC STATIC int PolygonRenderer::FaceSortFunction(const void *a, const void *b) {
     const FaceInfo* faceA = (const FaceInfo *)a;
     const FaceInfo* faceB = (const FaceInfo *)b;
     return faceB->Depth - faceA->Depth;
 }
 
+// Returns the order in which the faces should be drawn, back to front
+// unless frontToBack is set. Faces with the same depth keep the order they
+// were added in. The returned array is reused by the next call.
+PUBLIC STATIC Uint32* PolygonRenderer::SortFaces(FaceInfo* faces, Uint32 count, bool frontToBack) {
+    if (count > FaceSortCapacity || !FaceSortOrder) {
+        FaceSortCapacity = count > 64 ? count : 64;
+        FaceSortItems = (Uint64*)Memory::Realloc(FaceSortItems, FaceSortCapacity * sizeof(Uint64));
+        FaceSortScratch = (Uint64*)Memory::Realloc(FaceSortScratch, FaceSortCapacity * sizeof(Uint64));
+        FaceSortOrder = (Uint32*)Memory::Realloc(FaceSortOrder, FaceSortCapacity * sizeof(Uint32));
+    }
+
+    if (count == 0)
+        return FaceSortOrder;
+
+    int minDepth = faces[0].Depth;
+    int maxDepth = faces[0].Depth;
+    for (Uint32 f = 1; f < count; f++) {
+        if (minDepth > faces[f].Depth)
+            minDepth = faces[f].Depth;
+        if (maxDepth < faces[f].Depth)
+            maxDepth = faces[f].Depth;
+    }
+
+    Uint64 range = (Uint64)((Sint64)maxDepth - minDepth);
+    if (range == 0) {
+        for (Uint32 f = 0; f < count; f++)
+            FaceSortOrder[f] = f;
+        return FaceSortOrder;
+    }
+
+    int keyBits = FACE_SORT_KEY_BITS;
+    if (FaceSortBuckets > 1)
+        keyBits = std::min(GetBitCount(FaceSortBuckets - 1), FACE_SORT_RADIX_BITS);
+
+    int rangeBits = GetBitCount(range);
+    int shift = rangeBits > keyBits ? rangeBits - keyBits : 0;
+    Uint32 maxKey = (Uint32)(range >> shift);
+
+    // The key goes in the upper half, and the face index in the lower half
+    for (Uint32 f = 0; f < count; f++) {
+        Uint32 key = (Uint32)((Uint64)((Sint64)faces[f].Depth - minDepth) >> shift);
+        if (!frontToBack)
+            key = maxKey - key;
+        FaceSortItems[f] = (Uint64)key << 32 | f;
+    }
+
+    Uint64* src = FaceSortItems;
+    Uint64* dst = FaceSortScratch;
+    Uint32 histogram[FACE_SORT_RADIX_SIZE];
+    int maxKeyBits = GetBitCount(maxKey);
+    for (int pass = 0; pass * FACE_SORT_RADIX_BITS < maxKeyBits; pass++) {
+        int digitShift = 32 + pass * FACE_SORT_RADIX_BITS;
+
+        memset(histogram, 0, sizeof(histogram));
+        for (Uint32 f = 0; f < count; f++)
+            histogram[(src[f] >> digitShift) & (FACE_SORT_RADIX_SIZE - 1)]++;
+
+        // Skip the pass if every key has the same digit
+        if (histogram[(src[0] >> digitShift) & (FACE_SORT_RADIX_SIZE - 1)] == count)
+            continue;
+
+        Uint32 offset = 0;
+        for (int i = 0; i < FACE_SORT_RADIX_SIZE; i++) {
+            Uint32 bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset += bucketCount;
+        }
+
+        for (Uint32 f = 0; f < count; f++)
+            dst[histogram[(src[f] >> digitShift) & (FACE_SORT_RADIX_SIZE - 1)]++] = src[f];
+
+        std::swap(src, dst);
+    }
+
+    for (Uint32 f = 0; f < count; f++)
+        FaceSortOrder[f] = (Uint32)src[f];
+
+    return FaceSortOrder;
+}
+// Sorts the faces themselves, for callers that walk them in buffer order.
+PUBLIC STATIC void PolygonRenderer::SortFaceInfos(FaceInfo* faces, Uint32 count, bool frontToBack) {
+    Uint32* order = SortFaces(faces, count, frontToBack);
+
+    if (count > FaceSortInfoCapacity || !FaceSortInfos) {
+        FaceSortInfoCapacity = count > 64 ? count : 64;
+        FaceSortInfos = (FaceInfo*)Memory::Realloc(FaceSortInfos, FaceSortInfoCapacity * sizeof(FaceInfo));
+    }
+
+    for (Uint32 f = 0; f < count; f++)
+        FaceSortInfos[f] = faces[order[f]];
+    memcpy(faces, FaceSortInfos, count * sizeof(FaceInfo));
+}
+
 PUBLIC void PolygonRenderer::BuildFrustumPlanes(float nearClippingPlane, float farClippingPlane) {
     // Near
     ViewFrustum[0].Plane.Z = nearClippingPlane * 0x10000;
@@ -405,19 +529,43 @@ PUBLIC void PolygonRenderer::DrawVertexBuffer() {
     VertexAttribute* arrayVertexBuffer = &destVertexBuffer->Vertices[arrayVertexCount];
     VertexAttribute* arrayVertexItem = arrayVertexBuffer;
 
+    // Transform all of the vertices at once
+    Uint32 srcVertexCount = VertexBuf->VertexCount;
+    VertexTransform::Reserve(srcVertexCount);
+
+    Vector4* positions = VertexTransform::Positions;
+    Vector4* normals = VertexTransform::Normals;
+    Uint8* outcodes = DoClipping ? VertexTransform::Outcodes : nullptr;
+
+    VertexTransform::TransformPositions(&mvpMatrix, &VertexBuf->Vertices[0].Position, sizeof(VertexAttribute), positions, outcodes, srcVertexCount);
+    if (NormalMatrix)
+        VertexTransform::TransformPositions(NormalMatrix, &VertexBuf->Vertices[0].Normal, sizeof(VertexAttribute), normals, nullptr, srcVertexCount);
+
     // Copy the vertices into the vertex buffer
-    VertexAttribute* srcVertexItem = &VertexBuf->Vertices[0];
+    Uint32 srcVertexIndex = 0;
 
     for (int f = 0; f < VertexBuf->FaceCount; f++) {
         FaceInfo* srcFaceInfoItem = &VertexBuf->FaceInfoBuffer[f];
         int vertexCount = srcFaceInfoItem->NumVertices;
-        int vertexCountPerFace = vertexCount;
-        while (vertexCountPerFace--) {
-            APPLY_MAT4X4(arrayVertexItem->Position, srcVertexItem->Position, mvpMatrix.Values);
+        Uint32 firstVertexIndex = srcVertexIndex;
+        srcVertexIndex += vertexCount;
 
-            if (NormalMatrix) {
-                APPLY_MAT4X4(arrayVertexItem->Normal, srcVertexItem->Normal, NormalMatrix->Values);
-            }
+        // Check if the polygon is at least partially inside the frustum
+        if (outcodes) {
+            Uint8 faceOutcode = VertexOutcode_All;
+            for (int i = 0; i < vertexCount; i++)
+                faceOutcode &= outcodes[firstVertexIndex + i];
+            if (faceOutcode)
+                continue;
+        }
+
+        VertexAttribute* srcVertexItem = &VertexBuf->Vertices[firstVertexIndex];
+        for (int i = 0; i < vertexCount; i++) {
+            Uint32 index = firstVertexIndex + i;
+            arrayVertexItem->Position = positions[index];
+
+            if (NormalMatrix)
+                arrayVertexItem->Normal = normals[index];
             else {
                 COPY_NORMAL(arrayVertexItem->Normal, srcVertexItem->Normal);
             }
@@ -430,28 +578,22 @@ PUBLIC void PolygonRenderer::DrawVertexBuffer() {
 
         arrayVertexItem = arrayVertexBuffer;
 
-        if (DoClipping) {
-            // Check if the polygon is at least partially inside the frustum
-            if (!CheckPolygonVisible(arrayVertexBuffer, vertexCount))
-                continue;
-
-            // Vertices are now in clip space, which means that the polygon can be frustum clipped
-            if (ClipPolygonsByFrustum) {
-                PolygonClipBuffer clipper;
-
-                vertexCount = ClipPolygon(clipper, arrayVertexBuffer, vertexCount);
-                if (vertexCount == 0)
-                    continue;
+        // Vertices are now in clip space, which means that the polygon can be frustum clipped
+        if (DoClipping && ClipPolygonsByFrustum) {
+            PolygonClipBuffer clipper;
 
-                Uint32 maxVertexCount = arrayVertexCount + vertexCount;
-                if (maxVertexCount > destVertexBuffer->Capacity) {
-                    destVertexBuffer->Resize(maxVertexCount + 256);
-                    faceInfoItem = &destVertexBuffer->FaceInfoBuffer[arrayFaceCount];
-                    arrayVertexBuffer = &destVertexBuffer->Vertices[arrayVertexCount];
-                }
+            vertexCount = ClipPolygon(clipper, arrayVertexBuffer, vertexCount);
+            if (vertexCount == 0)
+                continue;
 
-                CopyVertices(clipper.Buffer, arrayVertexBuffer, vertexCount);
+            Uint32 maxVertexCount = arrayVertexCount + vertexCount;
+            if (maxVertexCount > destVertexBuffer->Capacity) {
+                destVertexBuffer->Resize(maxVertexCount + 256);
+                faceInfoItem = &destVertexBuffer->FaceInfoBuffer[arrayFaceCount];
+                arrayVertexBuffer = &destVertexBuffer->Vertices[arrayVertexCount];
             }
+
+            CopyVertices(clipper.Buffer, arrayVertexBuffer, vertexCount);
         }
 
         faceInfoItem->DrawMode = DrawMode;
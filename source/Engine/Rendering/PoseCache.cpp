@@ -0,0 +1,178 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Mesh.h>
+
+class PoseCache {
+public:
+    static bool   Enabled;
+    static int    Capacity;
+    static int    InbetweenSteps;
+
+    static Uint64 Hits;
+    static Uint64 Misses;
+    static Uint64 Evictions;
+
+    ModelPose*    Poses;
+    size_t        PoseCount;
+    Uint32        UseCounter;
+};
+#endif
+
+#include <Engine/Rendering/PoseCache.h>
+#include <Engine/Diagnostics/Memory.h>
+
+// Skinned poses of a model, keyed by animation and frame. Every entity that
+// draws the same model with the same animation and frame shares one pose, so
+// it's only skinned once. When the cache is full, the least recently used
+// pose is replaced.
+
+bool   PoseCache::Enabled = true;
+int    PoseCache::Capacity = 16;
+int    PoseCache::InbetweenSteps = 256;
+
+Uint64 PoseCache::Hits = 0;
+Uint64 PoseCache::Misses = 0;
+Uint64 PoseCache::Evictions = 0;
+
+PUBLIC PoseCache::PoseCache() {
+    Poses = nullptr;
+    PoseCount = 0;
+    UseCounter = 0;
+}
+
+PRIVATE STATIC void PoseCache::FreePose(ModelPose* pose) {
+    for (size_t i = 0; i < pose->NumSkeletons; i++) {
+        Memory::Free(pose->Positions[i]);
+        Memory::Free(pose->Normals[i]);
+    }
+    Memory::Free(pose->Positions);
+    Memory::Free(pose->Normals);
+    Memory::Free(pose->LocalTransforms);
+    Memory::Free(pose->GlobalTransforms);
+}
+PUBLIC void PoseCache::Clear() {
+    for (size_t i = 0; i < PoseCount; i++)
+        FreePose(&Poses[i]);
+    Memory::Free(Poses);
+
+    Poses = nullptr;
+    PoseCount = 0;
+}
+
+// Rounds the in-between part of a 24.8 frame down to one of InbetweenSteps
+// steps, so that nearby frames can share a pose.
+PUBLIC STATIC Uint32 PoseCache::QuantizeFrame(Uint32 frame) {
+    if (InbetweenSteps <= 0 || InbetweenSteps >= 0x100)
+        return frame;
+
+    Uint32 step = ((frame & 0xFF) * InbetweenSteps) >> 8;
+    return (frame & ~0xFF) | ((step << 8) / InbetweenSteps);
+}
+
+PUBLIC ModelPose* PoseCache::Find(ModelAnim* animation, Uint32 frame) {
+    for (size_t i = 0; i < PoseCount; i++) {
+        ModelPose* pose = &Poses[i];
+        if (pose->Animation == animation && pose->Frame == frame) {
+            pose->LastUsed = ++UseCounter;
+            return pose;
+        }
+    }
+
+    return nullptr;
+}
+
+static size_t CountNodes(ModelNode* node) {
+    size_t count = 1;
+    for (size_t i = 0; i < node->Children.size(); i++)
+        count += CountNodes(node->Children[i]);
+    return count;
+}
+static void SaveNodes(ModelNode* node, ModelPose* pose, size_t& index) {
+    Matrix4x4::Copy(&pose->LocalTransforms[index], node->LocalTransform);
+    Matrix4x4::Copy(&pose->GlobalTransforms[index], node->GlobalTransform);
+    index++;
+
+    for (size_t i = 0; i < node->Children.size(); i++)
+        SaveNodes(node->Children[i], pose, index);
+}
+static void LoadNodes(ModelNode* node, ModelPose* pose, size_t& index) {
+    Matrix4x4::Copy(node->LocalTransform, &pose->LocalTransforms[index]);
+    Matrix4x4::Copy(node->GlobalTransform, &pose->GlobalTransforms[index]);
+    index++;
+
+    for (size_t i = 0; i < node->Children.size(); i++)
+        LoadNodes(node->Children[i], pose, index);
+}
+
+// Makes room for a new pose, and saves the node transforms of an armature
+// that was just posed. The caller skins the pose's skeletons.
+PUBLIC ModelPose* PoseCache::Store(ModelAnim* animation, Uint32 frame, Armature* armature) {
+    if (Capacity <= 0)
+        return nullptr;
+
+    if (Poses == nullptr)
+        Poses = (ModelPose*)Memory::TrackedCalloc("PoseCache::Poses", Capacity, sizeof(ModelPose));
+
+    ModelPose* pose;
+    if (PoseCount < (size_t)Capacity)
+        pose = &Poses[PoseCount++];
+    else {
+        pose = &Poses[0];
+        for (size_t i = 1; i < PoseCount; i++) {
+            if (pose->LastUsed > Poses[i].LastUsed)
+                pose = &Poses[i];
+        }
+        Evictions++;
+    }
+
+    // Every armature of a model is a copy of the base one, so the buffers
+    // of an evicted pose can be reused as they are
+    if (pose->Positions == nullptr) {
+        pose->NumSkeletons = armature->NumSkeletons;
+        pose->Positions = (Vector3**)Memory::Calloc(pose->NumSkeletons ? pose->NumSkeletons : 1, sizeof(Vector3*));
+        pose->Normals = (Vector3**)Memory::Calloc(pose->NumSkeletons ? pose->NumSkeletons : 1, sizeof(Vector3*));
+        for (size_t i = 0; i < pose->NumSkeletons; i++) {
+            Skeleton* skeleton = armature->Skeletons[i];
+            pose->Positions[i] = (Vector3*)Memory::Malloc(skeleton->NumVertices * sizeof(Vector3));
+            if (skeleton->NormalBuffer)
+                pose->Normals[i] = (Vector3*)Memory::Malloc(skeleton->NumVertices * sizeof(Vector3));
+        }
+
+        pose->NumNodes = CountNodes(armature->RootNode);
+        pose->LocalTransforms = (Matrix4x4*)Memory::Malloc(pose->NumNodes * sizeof(Matrix4x4));
+        pose->GlobalTransforms = (Matrix4x4*)Memory::Malloc(pose->NumNodes * sizeof(Matrix4x4));
+    }
+
+    pose->Animation = animation;
+    pose->Frame = frame;
+    pose->LastUsed = ++UseCounter;
+
+    size_t index = 0;
+    SaveNodes(armature->RootNode, pose, index);
+
+    return pose;
+}
+
+// Puts a cached pose into an armature, as if it was posed and skinned.
+PUBLIC STATIC void PoseCache::Apply(ModelPose* pose, Armature* armature) {
+    size_t index = 0;
+    LoadNodes(armature->RootNode, pose, index);
+
+    for (size_t i = 0; i < pose->NumSkeletons && i < armature->NumSkeletons; i++) {
+        Skeleton* skeleton = armature->Skeletons[i];
+        if (skeleton->TransformedPositions)
+            memcpy(skeleton->TransformedPositions, pose->Positions[i], skeleton->NumVertices * sizeof(Vector3));
+        if (skeleton->TransformedNormals && pose->Normals[i])
+            memcpy(skeleton->TransformedNormals, pose->Normals[i], skeleton->NumVertices * sizeof(Vector3));
+    }
+}
+
+PUBLIC STATIC void PoseCache::ResetStats() {
+    Hits = 0;
+    Misses = 0;
+    Evictions = 0;
+}
+
+PUBLIC PoseCache::~PoseCache() {
+    Clear();
+}
@@ -0,0 +1,530 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/3D.h>
+#include <Engine/Rendering/Texture.h>
+#include <Engine/Rendering/Material.h>
+
+class HalfSpaceRasterizer {
+public:
+    static bool Enabled;
+};
+#endif
+
+#include <Engine/Rendering/Software/HalfSpaceRasterizer.h>
+#include <Engine/Rendering/Software/PolygonRasterizer.h>
+#include <Engine/Rendering/Software/HierarchicalDepth.h>
+#include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/Software/SoftwareEnums.h>
+#include <Engine/Utilities/ColorUtils.h>
+#include <Engine/Includes/SIMD.h>
+
+bool HalfSpaceRasterizer::Enabled = false;
+
+// Triangles are rasterized by testing 8x8 pixel blocks against the three
+// edge functions of the triangle. Blocks entirely outside of an edge are
+// skipped, blocks entirely inside of all edges are filled without per-pixel
+// coverage tests, and the remaining blocks compute an 8-pixel coverage mask
+// per row. Vertex positions are snapped to 28.4 fixed point.
+
+#define BLOCK_SIZE 8
+#define BLOCK_MASK (BLOCK_SIZE - 1)
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE >> 1)
+
+// Edge function values must stay well within 32 bits, since they're stepped
+// per pixel in SIMD lanes. That holds as long as the polygon's bounds are
+// under MAX_POLYGON_EXTENT pixels; larger polygons are drawn by
+// PolygonRasterizer instead.
+#define EDGE_VALUE_LIMIT 0x3FFFFFFFLL
+#define MAX_POLYGON_EXTENT 1024
+
+enum {
+    HSR_COLORS      = 1 << 0,
+    HSR_TEXTURE     = 1 << 1,
+    HSR_PERSPECTIVE = 1 << 2,
+    HSR_DEPTH       = 1 << 3,
+
+    HSR_VARIANT_COUNT = 1 << 4
+};
+
+struct HSVertex {
+    int   X, Y; // 28.4 fixed point
+    float InvZ;
+    float R, G, B;
+    float U, V;
+};
+struct HSPlane {
+    float Value; // value at the center of the origin pixel
+    float DX;
+    float DY;
+};
+struct HSEdge {
+    Sint32 Origin; // value at the center of the origin pixel
+    Sint32 StepX;
+    Sint32 StepY;
+};
+struct HSState {
+    Uint32*       DstPx;
+    Uint32        DstStride;
+    Uint32*       SrcPx;
+    Uint32        SrcStride;
+    Texture*      Tex;
+    Uint32        Color;
+    bool          UseFog;
+    bool          UsePalette;
+    BlendState    Blend;
+    PixelFunction PixelFunc;
+    int*          MultTableAt;
+    int*          MultSubTableAt;
+    int           ClipX1, ClipY1, ClipX2, ClipY2;
+    bool          UseHierarchicalDepth;
+    Uint32        MinDepth, MaxDepth;
+};
+
+typedef void (*HSTriangleFunction)(HSState& state, HSVertex* v0, HSVertex* v1, HSVertex* v2);
+
+static void SetupPlane(HSPlane& plane, float a0, float a1, float a2, float dx1, float dy1, float dx2, float dy2, float invArea, float ox, float oy) {
+    float da1 = a1 - a0;
+    float da2 = a2 - a0;
+    plane.DX = (da1 * dy2 - da2 * dy1) * invArea;
+    plane.DY = (da2 * dx1 - da1 * dx2) * invArea;
+    plane.Value = a0 + plane.DX * ox + plane.DY * oy;
+}
+static bool SetupEdge(HSEdge& edge, HSVertex* a, HSVertex* b, int originX, int originY, int spanX, int spanY) {
+    Sint64 stepA = a->Y - b->Y;
+    Sint64 stepB = b->X - a->X;
+
+    // Top-left fill convention, so that shared edges are only drawn once
+    Sint64 bias = (stepA > 0 || (stepA == 0 && stepB > 0)) ? 0 : -1;
+
+    Sint64 px = ((Sint64)originX << SUBPIXEL_BITS) + SUBPIXEL_HALF - a->X;
+    Sint64 py = ((Sint64)originY << SUBPIXEL_BITS) + SUBPIXEL_HALF - a->Y;
+    Sint64 origin = stepA * px + stepB * py + bias;
+    Sint64 stepX = stepA << SUBPIXEL_BITS;
+    Sint64 stepY = stepB << SUBPIXEL_BITS;
+
+    // The edge function is linear, so its extremes are at the corners
+    Sint64 farX = stepX * spanX;
+    Sint64 farY = stepY * spanY;
+    Sint64 corners[4] = { origin, origin + farX, origin + farY, origin + farX + farY };
+    for (int i = 0; i < 4; i++) {
+        if (corners[i] > EDGE_VALUE_LIMIT || corners[i] < -EDGE_VALUE_LIMIT)
+            return false;
+    }
+
+    edge.Origin = (Sint32)origin;
+    edge.StepX = (Sint32)stepX;
+    edge.StepY = (Sint32)stepY;
+    return true;
+}
+
+template <int Flags>
+static void DrawSpan(HSState& state, int dst_x, int dst_y, Uint8 mask, HSPlane* planes, int originX, int originY, bool depthAccepted) {
+    float offX = (float)(dst_x - originX);
+    float offY = (float)(dst_y - originY);
+
+    float contZ = 0.0f, contR = 0.0f, contG = 0.0f, contB = 0.0f, contU = 0.0f, contV = 0.0f;
+    contZ = planes[0].Value + planes[0].DX * offX + planes[0].DY * offY;
+    if (Flags & HSR_COLORS) {
+        contR = planes[1].Value + planes[1].DX * offX + planes[1].DY * offY;
+        contG = planes[2].Value + planes[2].DX * offX + planes[2].DY * offY;
+        contB = planes[3].Value + planes[3].DX * offX + planes[3].DY * offY;
+    }
+    if (Flags & HSR_TEXTURE) {
+        contU = planes[4].Value + planes[4].DX * offX + planes[4].DY * offY;
+        contV = planes[5].Value + planes[5].DX * offX + planes[5].DY * offY;
+    }
+
+    Uint32* index = NULL;
+    if (Flags & HSR_TEXTURE) {
+        if (Graphics::UsePaletteIndexLines)
+            index = &Graphics::PaletteColors[Graphics::PaletteIndexLines[dst_y]][0];
+        else
+            index = &Graphics::PaletteColors[0][0];
+    }
+
+    int dst_strideY = dst_y * state.DstStride;
+    for (int i = 0; i < BLOCK_SIZE; i++, dst_x++, mask >>= 1) {
+        if (mask & 1) {
+            float mapZ = 0.0f;
+            Uint32 iz = 0;
+            if ((Flags & (HSR_PERSPECTIVE | HSR_DEPTH)) || state.UseFog) {
+                mapZ = 1.0f / contZ;
+                iz = mapZ * 65536;
+            }
+
+            Uint32* depth = NULL;
+            if (Flags & HSR_DEPTH) {
+                depth = &PolygonRasterizer::DepthBuffer[dst_x + dst_strideY];
+                if (!depthAccepted && iz >= *depth)
+                    goto NEXT_PIXEL;
+            }
+
+            Uint32 col = state.Color;
+            if (Flags & HSR_COLORS) {
+                Sint32 colR, colG, colB;
+                if (Flags & HSR_PERSPECTIVE) {
+                    colR = contR * mapZ;
+                    colG = contG * mapZ;
+                    colB = contB * mapZ;
+                }
+                else {
+                    colR = contR;
+                    colG = contG;
+                    colB = contB;
+                }
+                if (colR < 0) colR = 0; else if (colR > 0xFF0000) colR = 0xFF0000;
+                if (colG < 0) colG = 0; else if (colG > 0xFF0000) colG = 0xFF0000;
+                if (colB < 0) colB = 0; else if (colB > 0xFF0000) colB = 0xFF0000;
+                col = 0xFF000000U | (colR & 0xFF0000) | ((colG >> 8) & 0xFF00) | ((colB >> 16) & 0xFF);
+            }
+
+            if (Flags & HSR_TEXTURE) {
+                float mapU = contU, mapV = contV;
+                if (Flags & HSR_PERSPECTIVE) {
+                    mapU *= mapZ;
+                    mapV *= mapZ;
+                }
+
+                Texture* texture = state.Tex;
+                int texU = ((int)((mapU + 1) * texture->Width) >> 16) % texture->Width;
+                int texV = ((int)((mapV + 1) * texture->Height) >> 16) % texture->Height;
+                Uint32 texCol = state.SrcPx[(texV * state.SrcStride) + texU];
+                if (state.UsePalette) {
+                    if (!texCol || !(index[texCol] & 0xFF000000U))
+                        goto NEXT_PIXEL;
+                    texCol = index[texCol];
+                }
+                else if (!(texCol & 0xFF000000U))
+                    goto NEXT_PIXEL;
+
+                col = ColorUtils::Tint(col, texCol) | 0xFF000000U;
+            }
+            else
+                col |= 0xFF000000U;
+
+            if (state.UseFog)
+                col = PolygonRasterizer::ApplyFog(col, mapZ);
+
+            state.PixelFunc(&col, &state.DstPx[dst_x + dst_strideY], state.Blend, state.MultTableAt, state.MultSubTableAt);
+
+            if (Flags & HSR_DEPTH)
+                *depth = iz;
+        }
+
+        NEXT_PIXEL:
+        contZ += planes[0].DX;
+        if (Flags & HSR_COLORS) {
+            contR += planes[1].DX;
+            contG += planes[2].DX;
+            contB += planes[3].DX;
+        }
+        if (Flags & HSR_TEXTURE) {
+            contU += planes[4].DX;
+            contV += planes[5].DX;
+        }
+    }
+}
+
+template <int Flags>
+static void DrawTriangle(HSState& state, HSVertex* v0, HSVertex* v1, HSVertex* v2) {
+    // Pixel bounds of the triangle, sampled at pixel centers
+    int minSubX = std::min(v0->X, std::min(v1->X, v2->X));
+    int minSubY = std::min(v0->Y, std::min(v1->Y, v2->Y));
+    int maxSubX = std::max(v0->X, std::max(v1->X, v2->X));
+    int maxSubY = std::max(v0->Y, std::max(v1->Y, v2->Y));
+
+    int x1 = std::max((minSubX + SUBPIXEL_HALF - 1) >> SUBPIXEL_BITS, state.ClipX1);
+    int y1 = std::max((minSubY + SUBPIXEL_HALF - 1) >> SUBPIXEL_BITS, state.ClipY1);
+    int x2 = std::min((maxSubX - SUBPIXEL_HALF) >> SUBPIXEL_BITS, state.ClipX2 - 1);
+    int y2 = std::min((maxSubY - SUBPIXEL_HALF) >> SUBPIXEL_BITS, state.ClipY2 - 1);
+    if (x1 > x2 || y1 > y2)
+        return;
+
+    int originX = x1 & ~BLOCK_MASK;
+    int originY = y1 & ~BLOCK_MASK;
+    int spanX = ((x2 | BLOCK_MASK) - originX);
+    int spanY = ((y2 | BLOCK_MASK) - originY);
+
+    HSEdge edges[3];
+    if (!SetupEdge(edges[0], v1, v2, originX, originY, spanX, spanY)
+     || !SetupEdge(edges[1], v2, v0, originX, originY, spanX, spanY)
+     || !SetupEdge(edges[2], v0, v1, originX, originY, spanX, spanY))
+        return;
+
+    // Attribute planes
+    float fx0 = v0->X / (float)SUBPIXEL_ONE, fy0 = v0->Y / (float)SUBPIXEL_ONE;
+    float dx1 = (v1->X - v0->X) / (float)SUBPIXEL_ONE, dy1 = (v1->Y - v0->Y) / (float)SUBPIXEL_ONE;
+    float dx2 = (v2->X - v0->X) / (float)SUBPIXEL_ONE, dy2 = (v2->Y - v0->Y) / (float)SUBPIXEL_ONE;
+    float invArea = 1.0f / (dx1 * dy2 - dx2 * dy1);
+    float ox = originX + 0.5f - fx0;
+    float oy = originY + 0.5f - fy0;
+
+    HSPlane planes[6];
+    SetupPlane(planes[0], v0->InvZ, v1->InvZ, v2->InvZ, dx1, dy1, dx2, dy2, invArea, ox, oy);
+    if (Flags & HSR_COLORS) {
+        SetupPlane(planes[1], v0->R, v1->R, v2->R, dx1, dy1, dx2, dy2, invArea, ox, oy);
+        SetupPlane(planes[2], v0->G, v1->G, v2->G, dx1, dy1, dx2, dy2, invArea, ox, oy);
+        SetupPlane(planes[3], v0->B, v1->B, v2->B, dx1, dy1, dx2, dy2, invArea, ox, oy);
+    }
+    if (Flags & HSR_TEXTURE) {
+        SetupPlane(planes[4], v0->U, v1->U, v2->U, dx1, dy1, dx2, dy2, invArea, ox, oy);
+        SetupPlane(planes[5], v0->V, v1->V, v2->V, dx1, dy1, dx2, dy2, invArea, ox, oy);
+    }
+
+    // Offsets from a block's origin to its four corners, and to each column
+    SIMDInt4 cornerOffsets[3], columnsLo[3], columnsHi[3];
+    for (int e = 0; e < 3; e++) {
+        Sint32 sx = edges[e].StepX, sy = edges[e].StepY;
+        cornerOffsets[e] = SIMDInt4::Set(0, sx * BLOCK_MASK, sy * BLOCK_MASK, sx * BLOCK_MASK + sy * BLOCK_MASK);
+        columnsLo[e] = SIMDInt4::Set(0, sx, sx * 2, sx * 3);
+        columnsHi[e] = SIMDInt4::Set(sx * 4, sx * 5, sx * 6, sx * 7);
+    }
+
+    for (int blockY = originY; blockY <= y2; blockY += BLOCK_SIZE) {
+        int rowStart = std::max(blockY, y1);
+        int rowEnd = std::min(blockY + BLOCK_MASK, y2);
+
+        Sint32 rowEdge[3];
+        for (int e = 0; e < 3; e++)
+            rowEdge[e] = edges[e].Origin + edges[e].StepY * (blockY - originY);
+
+        for (int blockX = originX; blockX <= x2; blockX += BLOCK_SIZE) {
+            Sint32 blockEdge[3];
+            for (int e = 0; e < 3; e++)
+                blockEdge[e] = rowEdge[e] + edges[e].StepX * (blockX - originX);
+
+            SIMDInt4 c0 = SIMDInt4::Add(SIMDInt4::Splat(blockEdge[0]), cornerOffsets[0]);
+            SIMDInt4 c1 = SIMDInt4::Add(SIMDInt4::Splat(blockEdge[1]), cornerOffsets[1]);
+            SIMDInt4 c2 = SIMDInt4::Add(SIMDInt4::Splat(blockEdge[2]), cornerOffsets[2]);
+
+            // Trivial reject: every corner is outside of the same edge
+            if (SIMDInt4::SignMask(c0) == 0xF || SIMDInt4::SignMask(c1) == 0xF || SIMDInt4::SignMask(c2) == 0xF)
+                continue;
+
+            // Columns of this block that are within the clip bounds
+            int colStart = std::max(blockX, x1) - blockX;
+            int colEnd = std::min(blockX + BLOCK_MASK, x2) - blockX;
+            Uint8 clipMask = (Uint8)((0xFF << colStart) & (0xFF >> (BLOCK_MASK - colEnd)));
+
+            // Skip blocks that are entirely behind what's already drawn, and
+            // don't read depth in blocks that are entirely in front of it
+            bool depthAccepted = false;
+            if ((Flags & HSR_DEPTH) && state.UseHierarchicalDepth) {
+                if (HierarchicalDepth::IsBlockOccluded(blockX, blockY, state.MinDepth)) {
+                    HierarchicalDepth::AddRejectedBlock((rowEnd - rowStart + 1) * (colEnd - colStart + 1));
+                    continue;
+                }
+                depthAccepted = HierarchicalDepth::IsBlockVisible(blockX, blockY, state.MaxDepth);
+            }
+
+            // Trivial accept: every corner is inside of every edge
+            if (SIMDInt4::SignMask(SIMDInt4::Or(SIMDInt4::Or(c0, c1), c2)) == 0) {
+                for (int dst_y = rowStart; dst_y <= rowEnd; dst_y++)
+                    DrawSpan<Flags>(state, blockX, dst_y, clipMask, planes, originX, originY, depthAccepted);
+                continue;
+            }
+
+            for (int dst_y = rowStart; dst_y <= rowEnd; dst_y++) {
+                int dy = dst_y - blockY;
+                SIMDInt4 lo = SIMDInt4::Splat(0), hi = SIMDInt4::Splat(0);
+                for (int e = 0; e < 3; e++) {
+                    SIMDInt4 base = SIMDInt4::Splat(blockEdge[e] + edges[e].StepY * dy);
+                    lo = SIMDInt4::Or(lo, SIMDInt4::Add(base, columnsLo[e]));
+                    hi = SIMDInt4::Or(hi, SIMDInt4::Add(base, columnsHi[e]));
+                }
+
+                Uint8 mask = (Uint8)(~(SIMDInt4::SignMask(lo) | (SIMDInt4::SignMask(hi) << 4))) & clipMask;
+                if (mask)
+                    DrawSpan<Flags>(state, blockX, dst_y, mask, planes, originX, originY, depthAccepted);
+            }
+        }
+    }
+}
+
+static HSTriangleFunction TriangleFunctions[HSR_VARIANT_COUNT] = {
+    DrawTriangle<0>,  DrawTriangle<1>,  DrawTriangle<2>,  DrawTriangle<3>,
+    DrawTriangle<4>,  DrawTriangle<5>,  DrawTriangle<6>,  DrawTriangle<7>,
+    DrawTriangle<8>,  DrawTriangle<9>,  DrawTriangle<10>, DrawTriangle<11>,
+    DrawTriangle<12>, DrawTriangle<13>, DrawTriangle<14>, DrawTriangle<15>,
+};
+
+// Returns false if the polygon can't be handled here, in which case the
+// caller should draw it with PolygonRasterizer.
+PRIVATE STATIC bool HalfSpaceRasterizer::Rasterize(int flags, Texture* texture, Vector3* positions, Vector2* uvs, Uint32 color, int* colors, int count, BlendState blendState) {
+    if (!Graphics::CurrentRenderTarget)
+        return true;
+
+    if (count < 3 || count > MAX_POLYGON_VERTICES)
+        return count < 3;
+
+    int blendFlag = blendState.Mode;
+    int opacity = blendState.Opacity;
+    if (opacity == 0 && blendFlag == BlendFlag_TRANSPARENT)
+        return true;
+
+    // Perspective-correct attributes, fog and depth all need a valid 1/z.
+    bool needsZ = (flags & (HSR_PERSPECTIVE | HSR_DEPTH)) || PolygonRasterizer::UseFog;
+
+    HSVertex vertices[MAX_POLYGON_VERTICES];
+    for (int i = 0; i < count; i++) {
+        HSVertex& vertex = vertices[i];
+        Sint64 subX = positions[i].X >> (16 - SUBPIXEL_BITS);
+        Sint64 subY = positions[i].Y >> (16 - SUBPIXEL_BITS);
+        if (subX > INT_MAX / 2 || subX < INT_MIN / 2 || subY > INT_MAX / 2 || subY < INT_MIN / 2)
+            return false;
+
+        int z = (int)(positions[i].Z / 0x10000);
+        if (needsZ && z <= 0)
+            return false;
+
+        float invZ = z ? 1.0f / z : 0.0f;
+        float attribScale = (flags & HSR_PERSPECTIVE) ? invZ : 1.0f;
+
+        vertex.X = (int)subX;
+        vertex.Y = (int)subY;
+        vertex.InvZ = invZ;
+
+        if (flags & HSR_COLORS) {
+            vertex.R = (float)(colors[i] & 0xFF0000) * attribScale;
+            vertex.G = (float)((colors[i] & 0xFF00) << 8) * attribScale;
+            vertex.B = (float)((colors[i] & 0xFF) << 16) * attribScale;
+        }
+        if (flags & HSR_TEXTURE) {
+            vertex.U = (float)uvs[i].X * attribScale;
+            vertex.V = (float)uvs[i].Y * attribScale;
+        }
+    }
+
+    HSState state;
+    state.DstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
+    state.DstStride = Graphics::CurrentRenderTarget->Width;
+    state.Tex = texture;
+    state.SrcPx = texture ? (Uint32*)texture->Pixels : NULL;
+    state.SrcStride = texture ? texture->Width : 0;
+    state.Color = color | 0xFF000000U;
+    state.UseFog = PolygonRasterizer::UseFog;
+    state.UsePalette = texture && Graphics::UsePalettes && texture->Paletted;
+    state.Blend = blendState;
+    state.UseHierarchicalDepth = (flags & HSR_DEPTH) && HierarchicalDepth::IsActive()
+        && HierarchicalDepth::GetDepthRange(positions, count, state.MinDepth, state.MaxDepth);
+
+    if (Graphics::CurrentClip.Enabled) {
+        state.ClipX1 = std::max((int)Graphics::CurrentClip.X, 0);
+        state.ClipY1 = std::max((int)Graphics::CurrentClip.Y, 0);
+        state.ClipX2 = std::min((int)(Graphics::CurrentClip.X + Graphics::CurrentClip.Width), (int)Graphics::CurrentRenderTarget->Width);
+        state.ClipY2 = std::min((int)(Graphics::CurrentClip.Y + Graphics::CurrentClip.Height), (int)Graphics::CurrentRenderTarget->Height);
+        if (state.ClipX1 >= state.ClipX2 || state.ClipY1 >= state.ClipY2)
+            return true;
+    }
+    else {
+        state.ClipX1 = 0;
+        state.ClipY1 = 0;
+        state.ClipX2 = (int)Graphics::CurrentRenderTarget->Width;
+        state.ClipY2 = (int)Graphics::CurrentRenderTarget->Height;
+    }
+
+    // Orient every triangle of the fan the same way, and reject degenerate polygons
+    Sint64 area = 0;
+    for (int i = 1; i < count - 1; i++) {
+        Sint64 triArea = (Sint64)(vertices[i].X - vertices[0].X) * (vertices[i + 1].Y - vertices[0].Y)
+            - (Sint64)(vertices[i + 1].X - vertices[0].X) * (vertices[i].Y - vertices[0].Y);
+        area += triArea;
+    }
+    if (area == 0)
+        return true;
+
+    if (blendFlag & (BlendFlag_TINT_BIT | BlendFlag_FILTER_BIT))
+        SoftwareRenderer::SetTintFunction(blendFlag);
+
+    state.PixelFunc = SoftwareRenderer::GetPixelFunction(blendFlag);
+    state.MultTableAt = &SoftwareRenderer::MultTable[opacity << 8];
+    state.MultSubTableAt = &SoftwareRenderer::MultSubTable[opacity << 8];
+
+    HSTriangleFunction drawTriangle = TriangleFunctions[flags & (HSR_VARIANT_COUNT - 1)];
+    for (int i = 1; i < count - 1; i++) {
+        HSVertex* v0 = &vertices[0];
+        HSVertex* v1 = &vertices[i];
+        HSVertex* v2 = &vertices[i + 1];
+
+        Sint64 triArea = (Sint64)(v1->X - v0->X) * (v2->Y - v0->Y) - (Sint64)(v2->X - v0->X) * (v1->Y - v0->Y);
+        if (triArea == 0)
+            continue;
+        if (triArea < 0)
+            std::swap(v1, v2);
+
+        drawTriangle(state, v0, v1, v2);
+    }
+
+    return true;
+}
+
+PRIVATE STATIC bool HalfSpaceRasterizer::CanDrawTriangles(Vector3* positions, int count) {
+    Sint64 minX = positions[0].X, maxX = positions[0].X;
+    Sint64 minY = positions[0].Y, maxY = positions[0].Y;
+    for (int i = 1; i < count; i++) {
+        minX = std::min(minX, positions[i].X);
+        maxX = std::max(maxX, positions[i].X);
+        minY = std::min(minY, positions[i].Y);
+        maxY = std::max(maxY, positions[i].Y);
+    }
+
+    Sint64 width = (maxX - minX) >> (16 - SUBPIXEL_BITS);
+    Sint64 height = (maxY - minY) >> (16 - SUBPIXEL_BITS);
+    Sint64 limit = (Sint64)MAX_POLYGON_EXTENT << SUBPIXEL_BITS;
+    return width < limit && height < limit;
+}
+
+// Draws a polygon with lighting
+PUBLIC STATIC void HalfSpaceRasterizer::DrawShaded(Vector3* positions, Uint32 color, int count, BlendState blendState) {
+    if (!CanDrawTriangles(positions, count) || !Rasterize(0, NULL, positions, NULL, color, NULL, count, blendState))
+        PolygonRasterizer::DrawShaded(positions, color, count, blendState);
+}
+// Draws a blended polygon with lighting
+PUBLIC STATIC void HalfSpaceRasterizer::DrawBlendShaded(Vector3* positions, int* colors, int count, BlendState blendState) {
+    if (!CanDrawTriangles(positions, count) || !Rasterize(HSR_COLORS, NULL, positions, NULL, 0, colors, count, blendState))
+        PolygonRasterizer::DrawBlendShaded(positions, colors, count, blendState);
+}
+// Draws an affine texture mapped polygon
+PUBLIC STATIC void HalfSpaceRasterizer::DrawAffine(Texture* texture, Vector3* positions, Vector2* uvs, Uint32 color, int count, BlendState blendState) {
+    int flags = HSR_TEXTURE;
+    if (PolygonRasterizer::UseDepthBuffer)
+        flags |= HSR_DEPTH;
+    if (!CanDrawTriangles(positions, count) || !Rasterize(flags, texture, positions, uvs, color, NULL, count, blendState))
+        PolygonRasterizer::DrawAffine(texture, positions, uvs, color, count, blendState);
+}
+// Draws an affine texture mapped polygon with blending
+PUBLIC STATIC void HalfSpaceRasterizer::DrawBlendAffine(Texture* texture, Vector3* positions, Vector2* uvs, int* colors, int count, BlendState blendState) {
+    int flags = HSR_TEXTURE | HSR_COLORS;
+    if (PolygonRasterizer::UseDepthBuffer)
+        flags |= HSR_DEPTH;
+    if (!CanDrawTriangles(positions, count) || !Rasterize(flags, texture, positions, uvs, 0, colors, count, blendState))
+        PolygonRasterizer::DrawBlendAffine(texture, positions, uvs, colors, count, blendState);
+}
+// Draws a perspective-correct texture mapped polygon
+PUBLIC STATIC void HalfSpaceRasterizer::DrawPerspective(Texture* texture, Vector3* positions, Vector2* uvs, Uint32 color, int count, BlendState blendState) {
+    int flags = HSR_TEXTURE | HSR_PERSPECTIVE;
+    if (PolygonRasterizer::UseDepthBuffer)
+        flags |= HSR_DEPTH;
+    if (!CanDrawTriangles(positions, count) || !Rasterize(flags, texture, positions, uvs, color, NULL, count, blendState))
+        PolygonRasterizer::DrawPerspective(texture, positions, uvs, color, count, blendState);
+}
+// Draws a perspective-correct texture mapped polygon with blending
+PUBLIC STATIC void HalfSpaceRasterizer::DrawBlendPerspective(Texture* texture, Vector3* positions, Vector2* uvs, int* colors, int count, BlendState blendState) {
+    int flags = HSR_TEXTURE | HSR_COLORS | HSR_PERSPECTIVE;
+    if (PolygonRasterizer::UseDepthBuffer)
+        flags |= HSR_DEPTH;
+    if (!CanDrawTriangles(positions, count) || !Rasterize(flags, texture, positions, uvs, 0, colors, count, blendState))
+        PolygonRasterizer::DrawBlendPerspective(texture, positions, uvs, colors, count, blendState);
+}
+// Draws a polygon with depth testing
+PUBLIC STATIC void HalfSpaceRasterizer::DrawDepth(Vector3* positions, Uint32 color, int count, BlendState blendState) {
+    if (!CanDrawTriangles(positions, count) || !Rasterize(HSR_DEPTH, NULL, positions, NULL, color, NULL, count, blendState))
+        PolygonRasterizer::DrawDepth(positions, color, count, blendState);
+}
+// Draws a blended polygon with depth testing
+PUBLIC STATIC void HalfSpaceRasterizer::DrawBlendDepth(Vector3* positions, int* colors, int count, BlendState blendState) {
+    if (!CanDrawTriangles(positions, count) || !Rasterize(HSR_COLORS | HSR_DEPTH, NULL, positions, NULL, 0, colors, count, blendState))
+        PolygonRasterizer::DrawBlendDepth(positions, colors, count, blendState);
+}
@@ -0,0 +1,241 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Math/VectorTypes.h>
+
+class HierarchicalDepth {
+public:
+    static bool    Enabled;
+    static bool    FrontToBack;
+
+    static Uint64  TestedFaces;
+    static Uint64  RejectedFaces;
+    static Uint64  RejectedBlocks;
+    static Uint64  RejectedPixels;
+};
+#endif
+
+#include <Engine/Rendering/Software/HierarchicalDepth.h>
+#include <Engine/Rendering/Software/PolygonRasterizer.h>
+#include <Engine/Diagnostics/Memory.h>
+
+bool    HierarchicalDepth::Enabled = false;
+bool    HierarchicalDepth::FrontToBack = false;
+
+Uint64  HierarchicalDepth::TestedFaces = 0;
+Uint64  HierarchicalDepth::RejectedFaces = 0;
+Uint64  HierarchicalDepth::RejectedBlocks = 0;
+Uint64  HierarchicalDepth::RejectedPixels = 0;
+
+// The depth buffer is split into 8x8 pixel tiles (the same size as the
+// blocks HalfSpaceRasterizer walks), and each tile keeps a conservative
+// range of the depths stored in it:
+//  - Max is the farthest depth in the tile. Anything whose nearest depth is
+//    at or behind it fails the depth test everywhere in the tile.
+//  - Min is a lower bound of every depth in the tile. Anything whose
+//    farthest depth is in front of it passes the depth test everywhere.
+// Drawing a polygon lowers Min right away and marks the covered tiles as
+// dirty; Max is recomputed from the depth buffer the next time it's needed,
+// which also keeps it correct for pixels discarded by transparent texels.
+
+#define TILE_SHIFT 3
+#define TILE_SIZE (1 << TILE_SHIFT)
+
+struct DepthTile {
+    Uint32 Min;
+    Uint32 Max;
+    bool   Dirty;
+};
+
+static DepthTile* Tiles = NULL;
+static size_t     TilesSize = 0;
+static int        TilesW = 0;
+static int        TilesH = 0;
+static int        BufferW = 0;
+static int        BufferH = 0;
+static bool       Active = false;
+
+static void RefreshTile(DepthTile* tile, int tileX, int tileY) {
+    int x1 = tileX << TILE_SHIFT;
+    int y1 = tileY << TILE_SHIFT;
+    int x2 = std::min(x1 + TILE_SIZE, BufferW);
+    int y2 = std::min(y1 + TILE_SIZE, BufferH);
+
+    Uint32 maxDepth = 0;
+    for (int y = y1; y < y2; y++) {
+        Uint32* depth = &PolygonRasterizer::DepthBuffer[x1 + y * BufferW];
+        for (int x = x1; x < x2; x++, depth++) {
+            if (maxDepth < *depth)
+                maxDepth = *depth;
+        }
+    }
+
+    tile->Max = maxDepth;
+    tile->Dirty = false;
+}
+static inline DepthTile* GetTile(int tileX, int tileY) {
+    DepthTile* tile = &Tiles[tileX + tileY * TilesW];
+    if (tile->Dirty)
+        RefreshTile(tile, tileX, tileY);
+    return tile;
+}
+
+// Gets the pixel bounds of a polygon, padded by a pixel on each side, in
+// tile coordinates. Returns false if it's entirely off the depth buffer.
+static bool GetPolygonTileBounds(Vector3* positions, int count, int& tx1, int& ty1, int& tx2, int& ty2, Sint64& pixels) {
+    Sint64 minX = positions[0].X, maxX = positions[0].X;
+    Sint64 minY = positions[0].Y, maxY = positions[0].Y;
+    for (int i = 1; i < count; i++) {
+        minX = std::min(minX, positions[i].X);
+        maxX = std::max(maxX, positions[i].X);
+        minY = std::min(minY, positions[i].Y);
+        maxY = std::max(maxY, positions[i].Y);
+    }
+
+    Sint64 x1 = std::max((minX >> 16) - 1, (Sint64)0);
+    Sint64 y1 = std::max((minY >> 16) - 1, (Sint64)0);
+    Sint64 x2 = std::min((maxX >> 16) + 1, (Sint64)BufferW - 1);
+    Sint64 y2 = std::min((maxY >> 16) + 1, (Sint64)BufferH - 1);
+    if (x1 > x2 || y1 > y2)
+        return false;
+
+    tx1 = (int)(x1 >> TILE_SHIFT);
+    ty1 = (int)(y1 >> TILE_SHIFT);
+    tx2 = (int)(x2 >> TILE_SHIFT);
+    ty2 = (int)(y2 >> TILE_SHIFT);
+    pixels = (x2 - x1 + 1) * (y2 - y1 + 1);
+    return true;
+}
+
+// Called whenever the depth buffer is cleared.
+PUBLIC STATIC void HierarchicalDepth::Clear(int width, int height) {
+    Active = Enabled && PolygonRasterizer::DepthBuffer != NULL;
+    if (!Active)
+        return;
+
+    BufferW = width;
+    BufferH = height;
+    TilesW = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+    TilesH = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+
+    size_t tileCount = TilesW * TilesH;
+    if (Tiles == NULL || tileCount > TilesSize) {
+        TilesSize = tileCount;
+        Tiles = (DepthTile*)Memory::Realloc(Tiles, TilesSize * sizeof(DepthTile));
+    }
+
+    for (size_t i = 0; i < tileCount; i++) {
+        Tiles[i].Min = 0xFFFFFFFF;
+        Tiles[i].Max = 0xFFFFFFFF;
+        Tiles[i].Dirty = false;
+    }
+}
+PUBLIC STATIC void HierarchicalDepth::Dispose() {
+    Memory::Free(Tiles);
+    Tiles = NULL;
+    TilesSize = 0;
+    Active = false;
+}
+
+PUBLIC STATIC bool HierarchicalDepth::IsActive() {
+    return Active && Enabled && PolygonRasterizer::DepthTest;
+}
+
+// Computes the depth range the rasterizers can write for a polygon, with
+// some slack for their floating point interpolation. Returns false if the
+// polygon can't be tracked (depths that don't fit the depth buffer.)
+PUBLIC STATIC bool HierarchicalDepth::GetDepthRange(Vector3* positions, int count, Uint32& minDepth, Uint32& maxDepth) {
+    Sint64 minZ = positions[0].Z / 0x10000;
+    Sint64 maxZ = minZ;
+    for (int i = 1; i < count; i++) {
+        Sint64 z = positions[i].Z / 0x10000;
+        if (minZ > z)
+            minZ = z;
+        if (maxZ < z)
+            maxZ = z;
+    }
+
+    if (minZ <= 0 || maxZ >= 0xFFFF)
+        return false;
+
+    Sint64 nearDepth = minZ << 16;
+    Sint64 farDepth = maxZ << 16;
+    nearDepth -= (nearDepth >> 10) + 2;
+    farDepth += (farDepth >> 10) + 2;
+
+    minDepth = (Uint32)std::max(nearDepth, (Sint64)0);
+    maxDepth = (Uint32)std::min(farDepth, (Sint64)0xFFFFFFFF);
+    return true;
+}
+
+// Returns true if the polygon would fail the depth test everywhere it
+// could be drawn. Positions are in 16.16 screen space, like the ones
+// passed to PolygonRasterizer.
+PUBLIC STATIC bool HierarchicalDepth::IsPolygonOccluded(Vector3* positions, int count) {
+    if (!IsActive() || count < 1)
+        return false;
+
+    TestedFaces++;
+
+    Uint32 minDepth, maxDepth;
+    if (!GetDepthRange(positions, count, minDepth, maxDepth))
+        return false;
+
+    int tx1, ty1, tx2, ty2;
+    Sint64 pixels;
+    if (!GetPolygonTileBounds(positions, count, tx1, ty1, tx2, ty2, pixels))
+        return false;
+
+    for (int ty = ty1; ty <= ty2; ty++) {
+        for (int tx = tx1; tx <= tx2; tx++) {
+            if (minDepth < GetTile(tx, ty)->Max)
+                return false;
+        }
+    }
+
+    RejectedFaces++;
+    RejectedPixels += pixels;
+    return true;
+}
+// Updates the tiles that a polygon may have written depth to.
+PUBLIC STATIC void HierarchicalDepth::MarkPolygon(Vector3* positions, int count) {
+    if (!IsActive() || count < 1)
+        return;
+
+    int tx1, ty1, tx2, ty2;
+    Sint64 pixels;
+    if (!GetPolygonTileBounds(positions, count, tx1, ty1, tx2, ty2, pixels))
+        return;
+
+    Uint32 minDepth, maxDepth;
+    if (!GetDepthRange(positions, count, minDepth, maxDepth))
+        minDepth = 0;
+
+    for (int ty = ty1; ty <= ty2; ty++) {
+        DepthTile* tile = &Tiles[tx1 + ty * TilesW];
+        for (int tx = tx1; tx <= tx2; tx++, tile++) {
+            if (tile->Min > minDepth)
+                tile->Min = minDepth;
+            tile->Dirty = true;
+        }
+    }
+}
+
+// Block queries, for rasterizers that walk the screen in 8x8 blocks aligned
+// to the tile grid. The coordinates are those of the block's top-left pixel.
+PUBLIC STATIC bool HierarchicalDepth::IsBlockOccluded(int x, int y, Uint32 minDepth) {
+    return minDepth >= GetTile(x >> TILE_SHIFT, y >> TILE_SHIFT)->Max;
+}
+PUBLIC STATIC bool HierarchicalDepth::IsBlockVisible(int x, int y, Uint32 maxDepth) {
+    return maxDepth < Tiles[(x >> TILE_SHIFT) + (y >> TILE_SHIFT) * TilesW].Min;
+}
+PUBLIC STATIC void HierarchicalDepth::AddRejectedBlock(int pixels) {
+    RejectedBlocks++;
+    RejectedPixels += pixels;
+}
+
+PUBLIC STATIC void HierarchicalDepth::ResetStats() {
+    TestedFaces = 0;
+    RejectedFaces = 0;
+    RejectedBlocks = 0;
+    RejectedPixels = 0;
+}
@@ -23,6 +23,7 @@ public:
 
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 #include <Engine/Rendering/Software/PolygonRasterizer.h>
+#include <Engine/Rendering/Software/HierarchicalDepth.h>
 #include <Engine/Rendering/Software/SoftwareEnums.h>
 #include <Engine/Rendering/Software/Scanline.h>
 #include <Engine/Rendering/Software/Contour.h>
@@ -1352,10 +1353,14 @@ PUBLIC STATIC void     PolygonRasterizer::SetDepthTest(bool enabled) {
     }
 
     memset(DepthBuffer, 0xFF, dpSize * sizeof(*DepthBuffer));
+
+    HierarchicalDepth::Clear(Graphics::CurrentRenderTarget->Width, Graphics::CurrentRenderTarget->Height);
 }
 PUBLIC STATIC void     PolygonRasterizer::FreeDepthBuffer(void) {
     Memory::Free(DepthBuffer);
     DepthBuffer = NULL;
+
+    HierarchicalDepth::Dispose();
 }
 
 PUBLIC STATIC void     PolygonRasterizer::SetUseDepthBuffer(bool enabled) {
@@ -1392,6 +1397,9 @@ PUBLIC STATIC void     PolygonRasterizer::SetFogColor(float r, float g, float b)
     Graphics::ConvertFromARGBtoNative(&result, 1);
     FogColor = result;
 }
+PUBLIC STATIC Uint32   PolygonRasterizer::ApplyFog(Uint32 color, float fogCoord) {
+    return DoFogLighting(color, fogCoord);
+}
 PUBLIC STATIC void     PolygonRasterizer::SetFogSmoothness(float smoothness) {
     float value = Math::Clamp(1.0f - smoothness, 0.0f, 1.0f);
     if (value <= 0.0) {
@@ -28,6 +28,8 @@ public:
 
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 #include <Engine/Rendering/Software/PolygonRasterizer.h>
+#include <Engine/Rendering/Software/HalfSpaceRasterizer.h>
+#include <Engine/Rendering/Software/HierarchicalDepth.h>
 #include <Engine/Rendering/Software/SoftwareEnums.h>
 #include <Engine/Rendering/FaceInfo.h>
 #include <Engine/Rendering/Scene3D.h>
@@ -121,6 +123,10 @@ PUBLIC STATIC void     SoftwareRenderer::Init() {
     SetDotMask(0);
     SetDotMaskOffsetH(0);
     SetDotMaskOffsetV(0);
+
+    Application::Settings->GetBool("display", "halfSpaceRasterizer", &HalfSpaceRasterizer::Enabled);
+    Application::Settings->GetBool("display", "hierarchicalDepth", &HierarchicalDepth::Enabled);
+    Application::Settings->GetBool("display", "frontToBackSort", &HierarchicalDepth::FrontToBack);
 }
 PUBLIC STATIC Uint32   SoftwareRenderer::GetWindowFlags() {
     return Graphics::Internal.GetWindowFlags();
@@ -977,6 +983,17 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
         useDepthBuffer = doDepthTest; \
     PolygonRasterizer::SetUseDepthBuffer(useDepthBuffer)
 
+#define DRAW_POLYGON(func, ...) do { \
+    if (useDepthBuffer && HierarchicalDepth::IsPolygonOccluded(polygonVertex, vertexCount)) \
+        break; \
+    if (HalfSpaceRasterizer::Enabled) \
+        HalfSpaceRasterizer::func(__VA_ARGS__); \
+    else \
+        PolygonRasterizer::func(__VA_ARGS__); \
+    if (useDepthBuffer) \
+        HierarchicalDepth::MarkPolygon(polygonVertex, vertexCount); \
+} while (0)
+
     VertexBuffer* vertexBuffer = scene->Buffer;
     VertexAttribute* vertexAttribsPtr = vertexBuffer->Vertices; // R
     FaceInfo* faceInfoPtr = vertexBuffer->FaceInfoBuffer; // RW
@@ -985,6 +1002,13 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
     if (Graphics::TextureBlend)
         sortFaces = true;
 
+    // Every face is opaque when texture blending is off, so with depth
+    // testing they can be drawn front to back, which lets the nearest faces
+    // occlude the rest as early as possible.
+    bool sortFrontToBack = doDepthTest && !Graphics::TextureBlend && HierarchicalDepth::FrontToBack;
+    if (sortFrontToBack && vertexBuffer->FaceCount > 1)
+        sortFaces = true;
+
     // Convert vertex colors to native format
     if (Graphics::PreferredPixelFormat != SDL_PIXELFORMAT_ARGB8888) {
         VertexAttribute* vertex = vertexAttribsPtr;
@@ -1015,8 +1039,9 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
     }
 
     // Sort face infos by depth
+    Uint32* faceOrder = NULL;
     if (sortFaces)
-        qsort(vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount, sizeof(FaceInfo), PolygonRenderer::FaceSortFunction);
+        faceOrder = PolygonRenderer::SortFaces(vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount, sortFrontToBack);
 
     // sas
     for (Uint32 f = 0; f < vertexBuffer->FaceCount; f++) {
@@ -1025,7 +1050,7 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
         Uint32  polygonVertexIndex = 0;
         Uint32  numOutside = 0;
 
-        faceInfoPtr = &vertexBuffer->FaceInfoBuffer[f];
+        faceInfoPtr = &vertexBuffer->FaceInfoBuffer[faceOrder ? faceOrder[f] : f];
 
         bool doAffineMapping = faceInfoPtr->DrawMode & DrawMode_AFFINE;
         bool useDepthBuffer;
@@ -1219,15 +1244,15 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
 
                 if (texturePtr) {
                     if (!doAffineMapping)
-                        PolygonRasterizer::DrawPerspective(texturePtr, polygonVertex, polygonUV, vertexFirst->Color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawPerspective, texturePtr, polygonVertex, polygonUV, vertexFirst->Color, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawAffine(texturePtr, polygonVertex, polygonUV, vertexFirst->Color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawAffine, texturePtr, polygonVertex, polygonUV, vertexFirst->Color, vertexCount, blendState);
                 }
                 else {
                     if (useDepthBuffer)
-                        PolygonRasterizer::DrawDepth(polygonVertex, vertexFirst->Color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawDepth, polygonVertex, vertexFirst->Color, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawShaded(polygonVertex, vertexFirst->Color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawShaded, polygonVertex, vertexFirst->Color, vertexCount, blendState);
                 }
 
                 mrt_poly_solid_NEXT_FACE:
@@ -1281,15 +1306,15 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
 
                 if (texturePtr) {
                     if (!doAffineMapping)
-                        PolygonRasterizer::DrawPerspective(texturePtr, polygonVertex, polygonUV, color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawPerspective, texturePtr, polygonVertex, polygonUV, color, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawAffine(texturePtr, polygonVertex, polygonUV, color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawAffine, texturePtr, polygonVertex, polygonUV, color, vertexCount, blendState);
                 }
                 else {
                     if (useDepthBuffer)
-                        PolygonRasterizer::DrawDepth(polygonVertex, color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawDepth, polygonVertex, color, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawShaded(polygonVertex, color, vertexCount, blendState);
+                        DRAW_POLYGON(DrawShaded, polygonVertex, color, vertexCount, blendState);
                 }
 
                 mrt_poly_flat_NEXT_FACE:
@@ -1348,15 +1373,15 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
 
                 if (texturePtr) {
                     if (!doAffineMapping)
-                        PolygonRasterizer::DrawBlendPerspective(texturePtr, polygonVertex, polygonUV, polygonVertColor, vertexCount, blendState);
+                        DRAW_POLYGON(DrawBlendPerspective, texturePtr, polygonVertex, polygonUV, polygonVertColor, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawBlendAffine(texturePtr, polygonVertex, polygonUV, polygonVertColor, vertexCount, blendState);
+                        DRAW_POLYGON(DrawBlendAffine, texturePtr, polygonVertex, polygonUV, polygonVertColor, vertexCount, blendState);
                 }
                 else {
                     if (useDepthBuffer)
-                        PolygonRasterizer::DrawBlendDepth(polygonVertex, polygonVertColor, vertexCount, blendState);
+                        DRAW_POLYGON(DrawBlendDepth, polygonVertex, polygonVertColor, vertexCount, blendState);
                     else
-                        PolygonRasterizer::DrawBlendShaded(polygonVertex, polygonVertColor, vertexCount, blendState);
+                        DRAW_POLYGON(DrawBlendShaded, polygonVertex, polygonVertColor, vertexCount, blendState);
                 }
 
                 mrt_poly_smooth_NEXT_FACE:
@@ -1365,6 +1390,7 @@ PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 d
     }
 
 #undef SET_BLENDFLAG_AND_OPACITY
+#undef DRAW_POLYGON
 
 #undef PROJECT_X
 #undef PROJECT_Y
@@ -0,0 +1,105 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/3D.h>
+#include <Engine/Math/Matrix4x4.h>
+
+class VertexTransform {
+public:
+    static Vector4* Positions;
+    static Vector4* Normals;
+    static Uint32*  Colors;
+    static Uint8*   Outcodes;
+    static Uint32   Capacity;
+};
+#endif
+
+#include <Engine/Rendering/VertexTransform.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Includes/SIMD.h>
+#include <Engine/Math/FixedPoint.h>
+#include <Engine/Utilities/ColorUtils.h>
+
+// Scratch buffers for transforming a whole mesh at once, so that vertices
+// shared between faces are only transformed once.
+Vector4* VertexTransform::Positions = NULL;
+Vector4* VertexTransform::Normals = NULL;
+Uint32*  VertexTransform::Colors = NULL;
+Uint8*   VertexTransform::Outcodes = NULL;
+Uint32   VertexTransform::Capacity = 0;
+
+PUBLIC STATIC void VertexTransform::Reserve(Uint32 count) {
+    if (count <= Capacity && Positions)
+        return;
+
+    Capacity = count > 256 ? count : 256;
+    Positions = (Vector4*)Memory::Realloc(Positions, Capacity * sizeof(Vector4));
+    Normals = (Vector4*)Memory::Realloc(Normals, Capacity * sizeof(Vector4));
+    Colors = (Uint32*)Memory::Realloc(Colors, Capacity * sizeof(Uint32));
+    Outcodes = (Uint8*)Memory::Realloc(Outcodes, Capacity * sizeof(Uint8));
+}
+PUBLIC STATIC void VertexTransform::Dispose() {
+    Memory::Free(Positions);
+    Memory::Free(Normals);
+    Memory::Free(Colors);
+    Memory::Free(Outcodes);
+    Positions = NULL;
+    Normals = NULL;
+    Colors = NULL;
+    Outcodes = NULL;
+    Capacity = 0;
+}
+
+static inline Uint8 GetOutcode(Vector4& position) {
+    Uint8 outcode = 0;
+    if (position.X < -position.W || position.X > position.W)
+        outcode |= VertexOutcode_X;
+    if (position.Y < -position.W || position.Y > position.W)
+        outcode |= VertexOutcode_Y;
+    if (position.Z <= 0)
+        outcode |= VertexOutcode_Behind;
+    return outcode;
+}
+
+// Transforms count 16.16 fixed point positions with the same math as
+// APPLY_MAT4X4. Each input starts with its X, Y and Z values, and they are
+// inputStride bytes apart, so both Vector3 and Vector4 arrays can be
+// transformed. If outcodes isn't NULL, each vertex also gets the
+// VertexOutcode_* flags of the clip space position.
+PUBLIC STATIC void VertexTransform::TransformPositions(Matrix4x4* matrix, const void* input, size_t inputStride, Vector4* output, Uint8* outcodes, Uint32 count) {
+    float* M = matrix->Values;
+
+    // Matrix columns, so that every lane computes one output component
+    SIMDFloat4 column0 = SIMDFloat4::Set(M[0], M[4], M[8], M[12]);
+    SIMDFloat4 column1 = SIMDFloat4::Set(M[1], M[5], M[9], M[13]);
+    SIMDFloat4 column2 = SIMDFloat4::Set(M[2], M[6], M[10], M[14]);
+    Sint64 translation[4] = { FP16_TO(M[3]), FP16_TO(M[7]), FP16_TO(M[11]), FP16_TO(M[15]) };
+
+    const Uint8* in = (const Uint8*)input;
+    for (Uint32 i = 0; i < count; i++, in += inputStride) {
+        const Vector3* vec = (const Vector3*)in;
+        SIMDInt4 termX = SIMDFloat4::Truncate(SIMDFloat4::Mul(SIMDFloat4::Splat((float)vec->X), column0));
+        SIMDInt4 termY = SIMDFloat4::Truncate(SIMDFloat4::Mul(SIMDFloat4::Splat((float)vec->Y), column1));
+        SIMDInt4 termZ = SIMDFloat4::Truncate(SIMDFloat4::Mul(SIMDFloat4::Splat((float)vec->Z), column2));
+        SIMDInt4::SumWidened(&output[i].X, translation, termX, termY, termZ);
+    }
+
+    if (outcodes) {
+        for (Uint32 i = 0; i < count; i++)
+            outcodes[i] = GetOutcode(output[i]);
+    }
+}
+// Same as TransformPositions, one vertex at a time with APPLY_MAT4X4.
+PUBLIC STATIC void VertexTransform::TransformPositionsScalar(Matrix4x4* matrix, const void* input, size_t inputStride, Vector4* output, Uint8* outcodes, Uint32 count) {
+    const Uint8* in = (const Uint8*)input;
+    for (Uint32 i = 0; i < count; i++, in += inputStride) {
+        const Vector3* vec = (const Vector3*)in;
+        APPLY_MAT4X4(output[i], vec[0], matrix->Values);
+        if (outcodes)
+            outcodes[i] = GetOutcode(output[i]);
+    }
+}
+
+PUBLIC STATIC void VertexTransform::TintColors(Uint32* colors, Uint32 tint, Uint32* output, Uint32 count) {
+    for (Uint32 i = 0; i < count; i++)
+        output[i] = ColorUtils::Tint(colors[i], tint);
+}
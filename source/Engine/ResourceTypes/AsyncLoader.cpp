@@ -0,0 +1,576 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class AsyncLoader {
+public:
+    enum LoadType {
+        LOAD_SPRITE,
+        LOAD_IMAGE,
+        LOAD_FONT,
+        LOAD_MODEL,
+        LOAD_MUSIC,
+        LOAD_SOUND,
+    };
+
+    enum ResultState {
+        RESULT_LOADING,
+        RESULT_READY,
+        // The handle was never given out, or its slot was reused
+        RESULT_INVALID,
+    };
+
+    static double UploadBudget;
+};
+#endif
+
+#include <Engine/ResourceTypes/AsyncLoader.h>
+#include <Engine/FontFace.h>
+#include <Engine/Graphics.h>
+#include <Engine/Scene.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/MemoryStream.h>
+#include <Engine/ResourceTypes/ResourceCache.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/ResourceType.h>
+#include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+// Loads resources in the background for Resources.Load*Async. Reading,
+// decompressing and decoding happen on the worker pool. Anything that needs
+// the renderer (creating textures, and parsing models and fonts, which
+// create their own) is done by Update on the main thread, a bit every frame,
+// so that a loading screen can keep animating.
+
+enum {
+    ASYNC_QUEUED,
+    ASYNC_LOADING,
+    ASYNC_LOADED,
+    ASYNC_DONE,
+    ASYNC_FAILED,
+};
+
+struct AsyncImage {
+    char*    Filename;
+    Uint32*  Pixels;
+    Uint32   Width;
+    Uint32   Height;
+    Uint32*  PaletteColors;
+    unsigned NumPaletteColors;
+};
+
+struct AsyncRequest {
+    int                Handle;
+    int                Slot;
+    Uint32             Generation;
+    bool               Free;
+    // How many Load calls returned this handle, and how many times its
+    // result has been read
+    int                Holders;
+    int                Reads;
+    int                Type;
+    char*              Filename;
+    Uint32             FilenameHash;
+    int                UnloadPolicy;
+    int                PixelSize;
+
+    // Written by the worker until State becomes ASYNC_LOADED
+    vector<AsyncImage> Images;
+    Uint8*             FileData;
+    size_t             FileSize;
+    ISound*            Sound;
+
+    SDL_atomic_t       State;
+    SDL_atomic_t       StepsDone;
+    SDL_atomic_t       StepCount;
+    bool               RunOnMainThread;
+    bool               Completed;
+    size_t             NextUpload;
+    int                ResourceIndex;
+};
+
+double AsyncLoader::UploadBudget = 4.0;
+
+// A handle is a request's slot plus 1, with the slot's generation in the
+// bits above it. Slots are reused once the result has been read as many
+// times as the handle was given out, and the generation tells old handles
+// apart from the request that took their slot.
+#define HANDLE_SLOT_BITS       20
+#define HANDLE_SLOT_MASK       ((1 << HANDLE_SLOT_BITS) - 1)
+#define HANDLE_GENERATION_MASK 0x7FF
+
+static vector<AsyncRequest*> Requests;
+static vector<int>           FreeSlots;
+// Requests whose result was read by every holder, to be freed by the next
+// Update
+static vector<AsyncRequest*> ReadRequests;
+// Requests that aren't done yet, in the order they were made
+static vector<AsyncRequest*> Pending;
+static Uint32                BatchTotal = 0;
+static Uint32                BatchDone = 0;
+static SDL_atomic_t          Cancelling;
+
+static vector<ResourceType*>* GetResourceList(int type) {
+    switch (type) {
+        case AsyncLoader::LOAD_SPRITE:
+        case AsyncLoader::LOAD_FONT:
+            return &Scene::SpriteList;
+        case AsyncLoader::LOAD_IMAGE:
+            return &Scene::ImageList;
+        case AsyncLoader::LOAD_MODEL:
+            return &Scene::ModelList;
+        case AsyncLoader::LOAD_MUSIC:
+            return &Scene::MusicList;
+        case AsyncLoader::LOAD_SOUND:
+            return &Scene::SoundList;
+    }
+    return NULL;
+}
+// Music isn't cached
+static int GetCacheType(int type) {
+    switch (type) {
+        case AsyncLoader::LOAD_SPRITE:
+        case AsyncLoader::LOAD_FONT:
+            return ResourceCache::CACHE_SPRITE;
+        case AsyncLoader::LOAD_IMAGE:
+            return ResourceCache::CACHE_IMAGE;
+        case AsyncLoader::LOAD_MODEL:
+            return ResourceCache::CACHE_MODEL;
+        case AsyncLoader::LOAD_SOUND:
+            return ResourceCache::CACHE_SOUND;
+    }
+    return -1;
+}
+static AsyncRequest* GetRequest(int handle) {
+    int slot = (handle & HANDLE_SLOT_MASK) - 1;
+    if (handle <= 0 || slot < 0 || slot >= (int)Requests.size())
+        return NULL;
+
+    AsyncRequest* request = Requests[slot];
+    if (request->Free || request->Handle != handle)
+        return NULL;
+    return request;
+}
+static int FindResource(vector<ResourceType*>* list, Uint32 filenameHash) {
+    for (size_t i = 0; i < list->size(); i++) {
+        if ((*list)[i] && (*list)[i]->FilenameHash == filenameHash)
+            return (int)i;
+    }
+    return -1;
+}
+
+static void FreeImage(AsyncImage* image) {
+    Memory::Free(image->Filename);
+    Memory::Free(image->Pixels);
+    Memory::Free(image->PaletteColors);
+    image->Filename = NULL;
+    image->Pixels = NULL;
+    image->PaletteColors = NULL;
+}
+static void FreeResults(AsyncRequest* request) {
+    for (size_t i = 0; i < request->Images.size(); i++)
+        FreeImage(&request->Images[i]);
+    request->Images.clear();
+    request->Images.shrink_to_fit();
+
+    Memory::Free(request->FileData);
+    request->FileData = NULL;
+
+    if (request->Sound) {
+        request->Sound->Dispose();
+        delete request->Sound;
+        request->Sound = NULL;
+    }
+}
+
+static bool DecodeImage(const char* filename, AsyncImage* image) {
+    image->Filename = StringUtils::Duplicate(filename);
+    image->Pixels = Image::DecodeResource(filename, &image->Width, &image->Height, &image->PaletteColors, &image->NumPaletteColors);
+    return image->Pixels != NULL;
+}
+
+// Runs on a worker thread, or on the main thread if there are no workers.
+static void LoadJob(void* data) {
+    AsyncRequest* request = (AsyncRequest*)data;
+    bool success = false;
+
+    SDL_AtomicSet(&request->State, ASYNC_LOADING);
+    if (SDL_AtomicGet(&Cancelling)) {
+        SDL_AtomicSet(&request->State, ASYNC_FAILED);
+        return;
+    }
+
+    switch (request->Type) {
+        case AsyncLoader::LOAD_SPRITE: {
+            vector<string> filenames;
+            if (!ISprite::GetSpriteSheetFilenames(request->Filename, filenames))
+                break;
+
+            // Reading the sprite, then decoding and uploading each sheet
+            SDL_AtomicSet(&request->StepCount, 1 + (int)filenames.size() * 2);
+            SDL_AtomicAdd(&request->StepsDone, 1);
+
+            success = true;
+            request->Images.resize(filenames.size());
+            for (size_t i = 0; i < filenames.size(); i++) {
+                memset(&request->Images[i], 0, sizeof(AsyncImage));
+                if (!SDL_AtomicGet(&Cancelling) && !DecodeImage(filenames[i].c_str(), &request->Images[i]))
+                    Log::Print(Log::LOG_ERROR, "Couldn't load spritesheet \"%s\"!", filenames[i].c_str());
+                SDL_AtomicAdd(&request->StepsDone, 1);
+            }
+            break;
+        }
+        case AsyncLoader::LOAD_IMAGE:
+            request->Images.resize(1);
+            memset(&request->Images[0], 0, sizeof(AsyncImage));
+            success = DecodeImage(request->Filename, &request->Images[0]);
+            SDL_AtomicAdd(&request->StepsDone, 1);
+            break;
+        case AsyncLoader::LOAD_FONT:
+        case AsyncLoader::LOAD_MODEL:
+            success = ResourceManager::LoadResource(request->Filename, &request->FileData, &request->FileSize);
+            if (!success)
+                Log::Print(Log::LOG_ERROR, "Could not read resource \"%s\"!", request->Filename);
+            SDL_AtomicAdd(&request->StepsDone, 1);
+            break;
+        case AsyncLoader::LOAD_MUSIC:
+        case AsyncLoader::LOAD_SOUND:
+            request->Sound = new (std::nothrow) ISound(request->Filename);
+            success = request->Sound && !request->Sound->LoadFailed;
+            SDL_AtomicAdd(&request->StepsDone, 1);
+            break;
+    }
+
+    SDL_AtomicSet(&request->State, success ? ASYNC_LOADED : ASYNC_FAILED);
+}
+
+// Does one piece of main thread work for a loaded request. Returns true
+// once the request is finished.
+static bool FinishStep(AsyncRequest* request) {
+    vector<ResourceType*>* list = GetResourceList(request->Type);
+
+    // Sprite sheets are uploaded one per step, and shared with any sprite
+    // that loaded the same sheet first
+    if (request->Type == AsyncLoader::LOAD_SPRITE && request->NextUpload < request->Images.size()) {
+        AsyncImage* image = &request->Images[request->NextUpload++];
+        if (image->Pixels && !Graphics::SpriteSheetTextureMap->Exists(image->Filename)) {
+            Texture* texture = Image::CreateTexture(image->Filename, image->Pixels, image->Width, image->Height, image->PaletteColors, image->NumPaletteColors);
+            Graphics::SpriteSheetTextureMap->Put(image->Filename, texture);
+            image->Pixels = NULL;
+            image->PaletteColors = NULL;
+        }
+        FreeImage(image);
+        SDL_AtomicAdd(&request->StepsDone, 1);
+        return false;
+    }
+
+    ResourceType* resource = new (std::nothrow) ResourceType();
+    resource->FilenameHash = request->FilenameHash;
+    resource->UnloadPolicy = request->UnloadPolicy;
+
+    // It could've been loaded some other way in the meantime
+    size_t index = 0;
+    if (Scene::GetResource(list, resource, index)) {
+        delete resource;
+        request->ResourceIndex = (int)index;
+        return true;
+    }
+
+    bool success = false;
+    switch (request->Type) {
+        case AsyncLoader::LOAD_SPRITE:
+            // The sheets are in SpriteSheetTextureMap now, so this only
+            // reads the animations
+            resource->AsSprite = new (std::nothrow) ISprite(request->Filename);
+            success = !resource->AsSprite->LoadFailed;
+            if (!success)
+                delete resource->AsSprite;
+            break;
+        case AsyncLoader::LOAD_IMAGE: {
+            AsyncImage* image = &request->Images[0];
+            Texture* texture = Image::CreateTexture(request->Filename, image->Pixels, image->Width, image->Height, image->PaletteColors, image->NumPaletteColors);
+            resource->AsImage = new (std::nothrow) Image(request->Filename, texture);
+            image->Pixels = NULL;
+            image->PaletteColors = NULL;
+
+            success = resource->AsImage->TexturePtr != NULL;
+            if (!success)
+                delete resource->AsImage;
+            break;
+        }
+        case AsyncLoader::LOAD_FONT: {
+            MemoryStream* stream = MemoryStream::New(request->FileData, request->FileSize);
+            if (stream) {
+                stream->owns_memory = true;
+                request->FileData = NULL;
+                resource->AsSprite = FontFace::SpriteFromFont(stream, request->PixelSize, request->Filename);
+                stream->Close();
+            }
+            success = resource->AsSprite != NULL;
+            break;
+        }
+        case AsyncLoader::LOAD_MODEL: {
+            MemoryStream* stream = MemoryStream::New(request->FileData, request->FileSize);
+            if (stream) {
+                stream->owns_memory = true;
+                request->FileData = NULL;
+                resource->AsModel = new (std::nothrow) IModel();
+                success = resource->AsModel->Load(stream, request->Filename);
+                if (!success)
+                    delete resource->AsModel;
+                stream->Close();
+            }
+            break;
+        }
+        case AsyncLoader::LOAD_MUSIC:
+            resource->AsMusic = request->Sound;
+            request->Sound = NULL;
+            success = true;
+            break;
+        case AsyncLoader::LOAD_SOUND:
+            resource->AsSound = request->Sound;
+            request->Sound = NULL;
+            success = true;
+            break;
+    }
+
+    if (!success) {
+        delete resource;
+        (*list)[index] = NULL;
+        request->ResourceIndex = -1;
+        return true;
+    }
+
+    request->ResourceIndex = (int)index;
+    return true;
+}
+
+static void CompleteRequest(AsyncRequest* request, int state) {
+    FreeResults(request);
+    Memory::Free(request->Filename);
+    request->Filename = NULL;
+
+    SDL_AtomicSet(&request->StepsDone, SDL_AtomicGet(&request->StepCount));
+    SDL_AtomicSet(&request->State, state);
+    request->Completed = true;
+    BatchDone++;
+}
+
+// Starts loading a resource, and returns a handle for GetProgress and
+// GetResult. If the resource is already loaded, or already being loaded,
+// this doesn't load it again.
+PUBLIC STATIC int AsyncLoader::Load(int type, const char* filename, int unloadPolicy, int pixelSize) {
+    Uint32 filenameHash = CRC32::EncryptString(filename);
+    if (type == LOAD_FONT)
+        filenameHash = CRC32::EncryptData(&pixelSize, sizeof(int), filenameHash);
+
+    for (size_t i = 0; i < Pending.size(); i++) {
+        if (Pending[i]->Type == type && Pending[i]->FilenameHash == filenameHash) {
+            Pending[i]->Holders++;
+            return Pending[i]->Handle;
+        }
+    }
+
+    AsyncRequest* request;
+    if (FreeSlots.size()) {
+        request = Requests[FreeSlots.back()];
+        FreeSlots.pop_back();
+    }
+    else {
+        if (Requests.size() >= HANDLE_SLOT_MASK) {
+            Log::Print(Log::LOG_ERROR, "Too many background loads whose results haven't been read!");
+            return 0;
+        }
+        request = new (std::nothrow) AsyncRequest();
+        request->Slot = (int)Requests.size();
+        request->Generation = 0;
+        Requests.push_back(request);
+    }
+    request->Generation = (request->Generation + 1) & HANDLE_GENERATION_MASK;
+    request->Handle = (int)(request->Generation << HANDLE_SLOT_BITS) | (request->Slot + 1);
+    request->Free = false;
+    request->Holders = 1;
+    request->Reads = 0;
+    request->Type = type;
+    request->Filename = StringUtils::Duplicate(filename);
+    request->FilenameHash = filenameHash;
+    request->UnloadPolicy = unloadPolicy;
+    request->PixelSize = pixelSize;
+    request->FileData = NULL;
+    request->FileSize = 0;
+    request->Sound = NULL;
+    request->RunOnMainThread = false;
+    request->Completed = false;
+    request->NextUpload = 0;
+    request->ResourceIndex = -1;
+    SDL_AtomicSet(&request->State, ASYNC_QUEUED);
+    SDL_AtomicSet(&request->StepsDone, 0);
+    SDL_AtomicSet(&request->StepCount, 2);
+
+    if (Pending.size() == 0) {
+        BatchTotal = 0;
+        BatchDone = 0;
+    }
+    BatchTotal++;
+
+    int existing = FindResource(GetResourceList(type), filenameHash);
+    if (existing >= 0) {
+        request->ResourceIndex = existing;
+        CompleteRequest(request, ASYNC_DONE);
+        return request->Handle;
+    }
+
+    // Nothing to load if it's still in the cache
+    int cacheType = GetCacheType(type);
+    if (cacheType >= 0 && ResourceCache::Contains(cacheType, filenameHash)) {
+        ResourceType* resource = new (std::nothrow) ResourceType();
+        resource->FilenameHash = filenameHash;
+        resource->UnloadPolicy = unloadPolicy;
+
+        size_t index = 0;
+        Scene::GetResource(GetResourceList(type), resource, index);
+        ResourceCache::Revive(cacheType, resource);
+
+        request->ResourceIndex = (int)index;
+        CompleteRequest(request, ASYNC_DONE);
+        return request->Handle;
+    }
+
+    Pending.push_back(request);
+    if (!WorkerPool::QueueJob(LoadJob, request))
+        request->RunOnMainThread = true;
+
+    return request->Handle;
+}
+
+// Finishes loaded requests on the main thread. It stops once UploadBudget
+// milliseconds have passed, but always does at least one step.
+PUBLIC STATIC void AsyncLoader::Update() {
+    for (size_t i = 0; i < ReadRequests.size(); i++) {
+        ReadRequests[i]->Free = true;
+        FreeSlots.push_back(ReadRequests[i]->Slot);
+    }
+    ReadRequests.clear();
+
+    if (Pending.size() == 0)
+        return;
+
+    double start = Clock::GetTicks();
+    bool didStep = false;
+
+    for (size_t i = 0; i < Pending.size(); ) {
+        AsyncRequest* request = Pending[i];
+
+        if (didStep && Clock::GetTicks() - start >= UploadBudget)
+            break;
+
+        int state = SDL_AtomicGet(&request->State);
+        if (state == ASYNC_QUEUED && request->RunOnMainThread) {
+            LoadJob(request);
+            state = SDL_AtomicGet(&request->State);
+            didStep = true;
+        }
+
+        if (state == ASYNC_FAILED) {
+            CompleteRequest(request, ASYNC_FAILED);
+            Pending.erase(Pending.begin() + i);
+            continue;
+        }
+        if (state != ASYNC_LOADED) {
+            i++;
+            continue;
+        }
+
+        // Keep going on this request as long as there's time left
+        bool finished = false;
+        while (!finished && (!didStep || Clock::GetTicks() - start < UploadBudget)) {
+            finished = FinishStep(request);
+            didStep = true;
+        }
+
+        if (finished) {
+            CompleteRequest(request, request->ResourceIndex >= 0 ? ASYNC_DONE : ASYNC_FAILED);
+            Pending.erase(Pending.begin() + i);
+        }
+    }
+}
+
+// Returns how far along a request is, from 0.0 to 1.0. With no handle, it's
+// for every request made since the last time there were none left.
+PUBLIC STATIC float AsyncLoader::GetProgress(int handle) {
+    AsyncRequest* request = GetRequest(handle);
+    if (!request)
+        return 0.0f;
+
+    int stepCount = SDL_AtomicGet(&request->StepCount);
+    if (stepCount <= 0)
+        return 1.0f;
+
+    return (float)SDL_AtomicGet(&request->StepsDone) / stepCount;
+}
+PUBLIC STATIC float AsyncLoader::GetProgress() {
+    if (BatchTotal == 0)
+        return 1.0f;
+
+    // Count how far along the unfinished requests are, too
+    float done = (float)BatchDone;
+    for (size_t i = 0; i < Pending.size(); i++) {
+        AsyncRequest* request = Pending[i];
+        int stepCount = SDL_AtomicGet(&request->StepCount);
+        if (stepCount > 0)
+            done += (float)SDL_AtomicGet(&request->StepsDone) / stepCount;
+    }
+    return done / BatchTotal;
+}
+PUBLIC STATIC int AsyncLoader::GetPendingCount() {
+    return (int)Pending.size();
+}
+
+// Returns RESULT_READY once a request is finished, with the index of the
+// resource (or -1 if it couldn't be loaded) in index. Each read counts once
+// towards the number of times Load returned the handle; once they're equal,
+// the handle stays valid until the next Update, and is then reused.
+PUBLIC STATIC int AsyncLoader::GetResult(int handle, int* index) {
+    *index = -1;
+    AsyncRequest* request = GetRequest(handle);
+    if (!request)
+        return RESULT_INVALID;
+    if (!request->Completed)
+        return RESULT_LOADING;
+
+    if (request->Reads < request->Holders && ++request->Reads == request->Holders)
+        ReadRequests.push_back(request);
+    *index = request->ResourceIndex;
+    return RESULT_READY;
+}
+
+PUBLIC STATIC void AsyncLoader::Dispose() {
+    // Jobs that haven't started yet skip their work. The ones that have
+    // are waited on, since they could still be using resources.
+    SDL_AtomicSet(&Cancelling, 1);
+    for (size_t i = 0; i < Pending.size(); i++) {
+        AsyncRequest* request = Pending[i];
+        if (request->RunOnMainThread)
+            continue;
+
+        int state;
+        while ((state = SDL_AtomicGet(&request->State)) == ASYNC_QUEUED || state == ASYNC_LOADING)
+            SDL_Delay(1);
+    }
+
+    for (size_t i = 0; i < Requests.size(); i++) {
+        FreeResults(Requests[i]);
+        Memory::Free(Requests[i]->Filename);
+        delete Requests[i];
+    }
+    Requests.clear();
+    FreeSlots.clear();
+    ReadRequests.clear();
+    Pending.clear();
+    BatchTotal = 0;
+    BatchDone = 0;
+    SDL_AtomicSet(&Cancelling, 0);
+}
@@ -0,0 +1,26 @@
+#ifndef ENGINE_RESOURCETYPES_DATAPACKFORMAT_H
+#define ENGINE_RESOURCETYPES_DATAPACKFORMAT_H
+
+// Data pack (.hatch) entries have a 32-bit data flag. Its low byte says how
+// the entry is stored, and the byte above it which codec it's compressed
+// with. An entry is only compressed if its size and compressed size differ;
+// packs made before there was a choice of codec are all zlib, which is 0.
+
+#define DATAPACK_FLAG_ENCRYPTED 2
+
+#define DATAPACK_STORAGE(dataFlag) ((dataFlag) & 0xFF)
+#define DATAPACK_CODEC(dataFlag) (((dataFlag) >> 8) & 0xFF)
+#define DATAPACK_MAKE_FLAG(storage, codec) (((codec) << 8) | (storage))
+
+namespace DataPackCodec { enum {
+    ZLIB,
+    LZ4,
+    ZSTD,
+    // Zstd with the dictionary stored in the same pack
+    ZSTD_DICTIONARY,
+}; };
+
+// Filename of the entry that holds a pack's Zstd dictionary
+#define DATAPACK_DICTIONARY_NAME "HatchPack/Zstd.dict"
+
+#endif /* ENGINE_RESOURCETYPES_DATAPACKFORMAT_H */
@@ -0,0 +1,474 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class DataPackWriter {
+public:
+    // Codecs besides DataPackCodec's
+    enum {
+        CODEC_DEFAULT = -2,
+        CODEC_NONE = -1,
+    };
+
+    struct Entry {
+        string Path;
+        string SourcePath;
+        Uint32 Hash;
+        Uint64 Size;
+        Uint32 ContentHash;
+        int    Codec;
+        int    LoadOrder;
+
+        // Where the data ended up. Duplicates point at the entry whose data
+        // they share.
+        Entry* Original;
+        Uint64 Offset;
+        Uint32 DataFlag;
+        Uint64 CompressedSize;
+    };
+
+    std::unordered_map<string, int> CodecRules;
+    int    DefaultCodec;
+    int    ZstdLevel;
+    // Alignment of entries stored uncompressed
+    Uint64 Alignment;
+    bool   UseDictionary;
+    bool   Verbose;
+    // Position of each file that should go first, by name
+    std::unordered_map<string, int> LoadOrder;
+
+    // What the last Write did, in the order it was written
+    vector<Entry> Entries;
+    // The Zstd dictionary, if one was trained
+    Entry  DictionaryEntry;
+    Uint32 DuplicateCount;
+    Uint64 TotalSize;
+    Uint64 PackSize;
+    // Why the last Write failed
+    string Error;
+};
+#endif
+
+#include <Engine/ResourceTypes/DataPackWriter.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/Compression/LZ4.h>
+#include <Engine/IO/Compression/Zstd.h>
+#include <Engine/ResourceTypes/DataPackFormat.h>
+#include <Libraries/miniz.h>
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Builds data packs (.hatch) out of a folder, for hatchpack and for the
+// "datapack" benchmark. Whatever it writes is what ResourceManager reads.
+
+// Header: "HATCH", version (3 bytes), entry count (2 bytes)
+#define HEADER_SIZE 10
+// Entry: hash, offset, size, data flag, compressed size
+#define ENTRY_SIZE  32
+#define MAX_ENTRIES 0xFFFF
+
+// Files this small get a shared Zstd dictionary with UseDictionary
+#define DICTIONARY_SAMPLE_SIZE (16 * 1024)
+#define DICTIONARY_CAPACITY    (112 * 1024)
+#define DICTIONARY_MIN_SIZE    (1024)
+
+struct CodecRule {
+    const char* Extension;
+    int         Codec;
+};
+
+// Formats that are compressed already are stored as-is, which also lets the
+// engine read them straight out of the mapped pack. Text and bytecode
+// compress well with Zstd; everything else gets LZ4, which is the fastest to
+// decode.
+static CodecRule DefaultRules[] = {
+    { "png", DataPackWriter::CODEC_NONE },
+    { "jpg", DataPackWriter::CODEC_NONE },
+    { "jpeg", DataPackWriter::CODEC_NONE },
+    { "gif", DataPackWriter::CODEC_NONE },
+    { "ogg", DataPackWriter::CODEC_NONE },
+    { "mp3", DataPackWriter::CODEC_NONE },
+    { "wav", DataPackWriter::CODEC_NONE },
+    { "ogv", DataPackWriter::CODEC_NONE },
+    { "mp4", DataPackWriter::CODEC_NONE },
+    { "webm", DataPackWriter::CODEC_NONE },
+    { "ibc", DataPackCodec::ZSTD },
+    { "hcm", DataPackCodec::ZSTD },
+    { "tmx", DataPackCodec::ZSTD },
+    { "tsx", DataPackCodec::ZSTD },
+    { "xml", DataPackCodec::ZSTD },
+    { "json", DataPackCodec::ZSTD },
+    { "txt", DataPackCodec::ZSTD },
+    { "csv", DataPackCodec::ZSTD },
+    { "ini", DataPackCodec::ZSTD },
+    { "hsl", DataPackCodec::ZSTD },
+    { "glsl", DataPackCodec::ZSTD },
+};
+
+static void WriteUInt16(vector<Uint8>& out, Uint16 value) {
+    for (int i = 0; i < 2; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+static void WriteUInt32(vector<Uint8>& out, Uint32 value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+static void WriteUInt64(vector<Uint8>& out, Uint64 value) {
+    for (int i = 0; i < 8; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+
+PUBLIC DataPackWriter::DataPackWriter() {
+    for (CodecRule& rule : DefaultRules)
+        CodecRules[rule.Extension] = rule.Codec;
+
+    DefaultCodec = DataPackCodec::LZ4;
+    ZstdLevel = 19;
+    Alignment = 4096;
+    UseDictionary = false;
+    Verbose = false;
+
+    DictionaryEntry = {};
+    DuplicateCount = 0;
+    TotalSize = 0;
+    PackSize = 0;
+}
+
+PUBLIC STATIC int         DataPackWriter::ParseCodec(const char* name) {
+    if (!strcmp(name, "none"))
+        return CODEC_NONE;
+    if (!strcmp(name, "zlib"))
+        return DataPackCodec::ZLIB;
+    if (!strcmp(name, "lz4"))
+        return DataPackCodec::LZ4;
+    if (!strcmp(name, "zstd"))
+        return DataPackCodec::ZSTD;
+    return CODEC_DEFAULT;
+}
+PUBLIC STATIC const char* DataPackWriter::GetCodecName(int codec) {
+    switch (codec) {
+        case DataPackCodec::ZLIB: return "zlib";
+        case DataPackCodec::LZ4: return "lz4";
+        case DataPackCodec::ZSTD: return "zstd";
+        case DataPackCodec::ZSTD_DICTIONARY: return "zstd+dict";
+    }
+    return "none";
+}
+PUBLIC STATIC string      DataPackWriter::GetExtension(const string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return "";
+
+    string extension = path.substr(dot + 1);
+    for (char& c : extension)
+        c = tolower(c);
+    return extension;
+}
+PUBLIC STATIC bool        DataPackWriter::ReadFile(const string& path, vector<Uint8>& out) {
+    std::error_code error;
+    uintmax_t size = fs::file_size(path, error);
+    if (error)
+        return false;
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    out.resize((size_t)size);
+    bool success = fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return success;
+}
+
+// Takes a rule like "txt=zstd". "*" stands for files that have no other
+// rule. Returns false if the rule can't be parsed.
+PUBLIC bool               DataPackWriter::AddCodecRule(const char* rule) {
+    const char* equals = strchr(rule, '=');
+    int codec = equals ? ParseCodec(equals + 1) : CODEC_DEFAULT;
+    if (codec == CODEC_DEFAULT)
+        return false;
+
+    string extension(rule, equals - rule);
+    if (extension == "*")
+        DefaultCodec = codec;
+    else
+        CodecRules[GetExtension("." + extension)] = codec;
+    return true;
+}
+PUBLIC int                DataPackWriter::GetCodecForPath(const string& path) {
+    auto it = CodecRules.find(GetExtension(path));
+    if (it != CodecRules.end())
+        return it->second;
+    return DefaultCodec;
+}
+// Reads a list of resource names, one per line, as written with the
+// dev/recordLoadOrder setting.
+PUBLIC bool               DataPackWriter::ReadLoadOrder(const char* filename) {
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+        return false;
+
+    char line[4096];
+    while (fgets(line, sizeof line, f)) {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = 0;
+        if (length && !LoadOrder.count(line)) {
+            int index = (int)LoadOrder.size();
+            LoadOrder[line] = index;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+PRIVATE bool              DataPackWriter::Fail(const char* format, ...) {
+    char message[4096];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof message, format, args);
+    va_end(args);
+
+    Error = message;
+    return false;
+}
+
+// Compresses data with the given codec. Returns false if it didn't make the
+// data any smaller, in which case it should be stored.
+PRIVATE bool              DataPackWriter::CompressData(int codec, vector<Uint8>& data, vector<Uint8>& out, vector<Uint8>& dictionary) {
+    if (codec == CODEC_NONE || data.size() == 0)
+        return false;
+
+    size_t size = 0;
+    switch (codec) {
+        case DataPackCodec::ZLIB: {
+            mz_ulong compressedSize = mz_compressBound((mz_ulong)data.size());
+            out.resize(compressedSize);
+            if (mz_compress2(out.data(), &compressedSize, data.data(), (mz_ulong)data.size(), MZ_BEST_COMPRESSION) == MZ_OK)
+                size = compressedSize;
+            break;
+        }
+        case DataPackCodec::LZ4:
+            out.resize(LZ4::CompressBound(data.size()));
+            size = LZ4::Compress(data.data(), data.size(), out.data(), out.size());
+            break;
+        case DataPackCodec::ZSTD:
+            out.resize(Zstd::CompressBound(data.size()));
+            size = Zstd::Compress(data.data(), data.size(), out.data(), out.size(), ZstdLevel);
+            break;
+        case DataPackCodec::ZSTD_DICTIONARY:
+            out.resize(Zstd::CompressBound(data.size()));
+            size = Zstd::Compress(data.data(), data.size(), out.data(), out.size(), ZstdLevel, dictionary.data(), dictionary.size());
+            break;
+    }
+
+    // Not worth decompressing if it saves less than 1/32 of the size
+    if (size == 0 || size >= data.size() - (data.size() >> 5))
+        return false;
+
+    out.resize(size);
+    return true;
+}
+
+PRIVATE vector<Uint8>     DataPackWriter::TrainDictionary() {
+    vector<Uint8> samples;
+    vector<size_t> sampleSizes;
+    for (Entry& entry : Entries) {
+        if (entry.Original || entry.Codec != DataPackCodec::ZSTD || entry.Size == 0 || entry.Size > DICTIONARY_SAMPLE_SIZE)
+            continue;
+
+        vector<Uint8> data;
+        if (!ReadFile(entry.SourcePath, data))
+            continue;
+        samples.insert(samples.end(), data.begin(), data.end());
+        sampleSizes.push_back(data.size());
+    }
+
+    vector<Uint8> dictionary;
+    if (sampleSizes.size() < 8)
+        return dictionary;
+
+    // Bigger dictionaries than about a tenth of what they're made from stop
+    // paying for themselves
+    dictionary.resize(std::max((size_t)DICTIONARY_MIN_SIZE, std::min((size_t)DICTIONARY_CAPACITY, samples.size() / 10)));
+    size_t size = Zstd::TrainDictionary(samples.data(), sampleSizes.data(), (Uint32)sampleSizes.size(), dictionary.data(), dictionary.size());
+    dictionary.resize(size);
+    return dictionary;
+}
+
+// Packs every file in folder into a data pack named outputFilename. Files
+// are named the way the engine asks for them, relative to folder. Returns
+// false, with the reason in Error, if it couldn't.
+PUBLIC bool               DataPackWriter::Write(const char* folder, const char* outputFilename) {
+    Entries.clear();
+    DictionaryEntry = {};
+    DuplicateCount = 0;
+    TotalSize = 0;
+    PackSize = 0;
+    Error.clear();
+
+    if (Alignment == 0)
+        Alignment = 1;
+
+    // Gather every file, named the way the engine asks for them
+    fs::path resourceFolder = folder;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(resourceFolder, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file())
+            continue;
+
+        Entry entry = {};
+        entry.SourcePath = it->path().string();
+        entry.Path = it->path().lexically_relative(resourceFolder).generic_string();
+        entry.Hash = CRC32::EncryptString(entry.Path.c_str());
+        entry.Codec = GetCodecForPath(entry.Path);
+
+        auto order = LoadOrder.find(entry.Path);
+        entry.LoadOrder = order != LoadOrder.end() ? order->second : INT_MAX;
+        Entries.push_back(entry);
+    }
+    if (error)
+        return Fail("Could not read \"%s\": %s", folder, error.message().c_str());
+    if (Entries.size() > MAX_ENTRIES - 1)
+        return Fail("Too many files! (%u, at most %u)", (Uint32)Entries.size(), MAX_ENTRIES - 1);
+
+    // Files loaded first go first, so that a session reads the pack from
+    // front to back. Files that weren't recorded follow in name order.
+    std::sort(Entries.begin(), Entries.end(), [](const Entry& a, const Entry& b) -> bool {
+        if (a.LoadOrder != b.LoadOrder)
+            return a.LoadOrder < b.LoadOrder;
+        return a.Path < b.Path;
+    });
+
+    // Look for names that hash the same, and for files with the same contents
+    std::unordered_map<Uint32, Entry*> byName;
+    std::unordered_map<Uint64, vector<Entry*>> byContent;
+    for (Entry& entry : Entries) {
+        if (byName.count(entry.Hash))
+            return Fail("\"%s\" and \"%s\" have the same hash!", byName[entry.Hash]->Path.c_str(), entry.Path.c_str());
+        byName[entry.Hash] = &entry;
+
+        vector<Uint8> data;
+        if (!ReadFile(entry.SourcePath, data))
+            return Fail("Could not read \"%s\"!", entry.SourcePath.c_str());
+        entry.Size = data.size();
+        entry.ContentHash = CRC32::EncryptData(data.data(), data.size());
+
+        vector<Entry*>& candidates = byContent[((Uint64)entry.ContentHash << 32) ^ entry.Size];
+        for (Entry* candidate : candidates) {
+            vector<Uint8> other;
+            if (candidate->Size == entry.Size && ReadFile(candidate->SourcePath, other) && other == data) {
+                entry.Original = candidate;
+                DuplicateCount++;
+                break;
+            }
+        }
+        if (!entry.Original)
+            candidates.push_back(&entry);
+    }
+
+    vector<Uint8> dictionary;
+    if (UseDictionary)
+        dictionary = TrainDictionary();
+
+    Uint32 entryCount = (Uint32)Entries.size() + (dictionary.size() ? 1 : 0);
+
+    FILE* out = fopen(outputFilename, "wb");
+    if (!out)
+        return Fail("Could not open \"%s\" for writing!", outputFilename);
+
+    // The table goes first, but it's written last, once every offset is known
+    Uint64 position = HEADER_SIZE + (Uint64)entryCount * ENTRY_SIZE;
+    vector<Uint8> padding(position, 0);
+    fwrite(padding.data(), 1, padding.size(), out);
+
+    auto writeData = [&](vector<Uint8>& data, Uint64 alignment) -> Uint64 {
+        if (data.size() == 0)
+            return position;
+
+        Uint64 aligned = (position + alignment - 1) / alignment * alignment;
+        if (aligned != position) {
+            padding.assign(aligned - position, 0);
+            fwrite(padding.data(), 1, padding.size(), out);
+        }
+        fwrite(data.data(), 1, data.size(), out);
+        position = aligned + data.size();
+        return aligned;
+    };
+
+    if (dictionary.size()) {
+        DictionaryEntry.Path = DATAPACK_DICTIONARY_NAME;
+        DictionaryEntry.Hash = CRC32::EncryptString(DATAPACK_DICTIONARY_NAME);
+        DictionaryEntry.Size = DictionaryEntry.CompressedSize = dictionary.size();
+        DictionaryEntry.Codec = CODEC_NONE;
+        DictionaryEntry.Offset = writeData(dictionary, 1);
+    }
+
+    for (Entry& entry : Entries) {
+        TotalSize += entry.Size;
+        if (entry.Original)
+            continue;
+
+        vector<Uint8> data;
+        if (!ReadFile(entry.SourcePath, data) || data.size() != entry.Size) {
+            fclose(out);
+            return Fail("Could not read \"%s\"!", entry.SourcePath.c_str());
+        }
+
+        int codec = entry.Codec;
+        if (codec == DataPackCodec::ZSTD && dictionary.size() && entry.Size <= DICTIONARY_SAMPLE_SIZE)
+            codec = DataPackCodec::ZSTD_DICTIONARY;
+
+        vector<Uint8> compressed;
+        if (CompressData(codec, data, compressed, dictionary)) {
+            entry.Codec = codec;
+            entry.CompressedSize = compressed.size();
+            entry.Offset = writeData(compressed, 1);
+        }
+        else {
+            // Stored entries can be read in place from the mapped pack, so
+            // they start on a page
+            entry.Codec = CODEC_NONE;
+            entry.CompressedSize = entry.Size;
+            entry.Offset = writeData(data, Alignment);
+        }
+        entry.DataFlag = entry.Codec == CODEC_NONE ? 0 : DATAPACK_MAKE_FLAG(0, entry.Codec);
+    }
+
+    vector<Uint8> table;
+    for (const char* magic = "HATCH"; *magic; magic++)
+        table.push_back(*magic);
+    // Version 1.0, and padding
+    table.push_back(1);
+    table.push_back(0);
+    table.push_back(0);
+    WriteUInt16(table, (Uint16)entryCount);
+
+    auto writeEntry = [&](Entry& entry) -> void {
+        Entry* data = entry.Original ? entry.Original : &entry;
+        WriteUInt32(table, entry.Hash);
+        WriteUInt64(table, data->Offset);
+        WriteUInt64(table, data->Size);
+        WriteUInt32(table, data->DataFlag);
+        WriteUInt64(table, data->CompressedSize);
+
+        if (Verbose)
+            printf("%08X %10llu %10llu %-9s %s%s\n", entry.Hash, (unsigned long long)data->Offset, (unsigned long long)data->CompressedSize,
+                GetCodecName(data->CompressedSize != data->Size ? data->Codec : CODEC_NONE), entry.Path.c_str(), entry.Original ? " (duplicate)" : "");
+    };
+    if (dictionary.size())
+        writeEntry(DictionaryEntry);
+    for (Entry& entry : Entries)
+        writeEntry(entry);
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(table.data(), 1, table.size(), out);
+    bool success = !ferror(out);
+    success &= fclose(out) == 0;
+    if (!success)
+        return Fail("Could not write \"%s\"!", outputFilename);
+
+    PackSize = position;
+    return true;
+}
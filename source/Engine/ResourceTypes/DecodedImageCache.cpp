@@ -0,0 +1,258 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/ResourceTypes/ImageFormats/ImageFormat.h>
+
+class DecodedImageCache {
+public:
+    static bool         Enabled;
+    static char         Path[4096];
+
+    static SDL_atomic_t Hits;
+    static SDL_atomic_t Misses;
+};
+#endif
+
+#include <Engine/ResourceTypes/DecodedImageCache.h>
+#include <Engine/Graphics.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/Compression/LZ4.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/ResourceTypes/ImageCacheFormat.h>
+
+// Keeps decoded images on disk, so that the next launch can skip PNG
+// decoding. Entries are keyed by the CRC32 of the image file, and store
+// pixels as ARGB no matter what the renderer prefers; converting them is
+// much cheaper than decoding. The pack builder can write entries ahead of
+// time with --image-cache.
+
+bool         DecodedImageCache::Enabled = false;
+char         DecodedImageCache::Path[4096];
+
+SDL_atomic_t DecodedImageCache::Hits;
+SDL_atomic_t DecodedImageCache::Misses;
+
+static inline Uint32 ReadLE32(Uint8* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32)data[3] << 24);
+}
+static inline void WriteLE32(Uint8* data, Uint32 value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+}
+
+static void GetEntryPath(char* out, size_t outSize, Uint32 sourceHash, size_t sourceSize, bool paletted) {
+    char filename[32];
+    IMAGECACHE_FILENAME(filename, sizeof filename, sourceHash, sourceSize, paletted);
+    snprintf(out, outSize, "%s/%s", DecodedImageCache::Path, filename);
+}
+
+// Picks the folder entries go in, if the cache is enabled. Without a path
+// set, that's ImageCache in the user's preferences folder.
+PUBLIC STATIC void DecodedImageCache::Init() {
+    if (!Enabled)
+        return;
+
+    if (!Path[0]) {
+        char* prefPath = SDL_GetPrefPath("aknetk", TARGET_NAME);
+        if (!prefPath) {
+            Log::Print(Log::LOG_WARN, "Could not find a folder for the decoded image cache, disabling it.");
+            Enabled = false;
+            return;
+        }
+        snprintf(Path, sizeof Path, "%sImageCache", prefPath);
+        SDL_free(prefPath);
+    }
+
+    size_t length = strlen(Path);
+    while (length > 1 && (Path[length - 1] == '/' || Path[length - 1] == '\\'))
+        Path[--length] = 0;
+
+    if (!Directory::Exists(Path) && !Directory::Create(Path)) {
+        Log::Print(Log::LOG_WARN, "Could not create decoded image cache folder \"%s\", disabling the cache.", Path);
+        Enabled = false;
+        return;
+    }
+
+    Log::Print(Log::LOG_VERBOSE, "Decoded image cache: %s", Path);
+}
+
+// Fills in image with the cached version of the image file in source, if
+// there is one. paletted picks between the paletted and full color versions.
+PUBLIC STATIC bool DecodedImageCache::Load(ImageFormat* image, Uint8* source, size_t sourceSize, bool paletted) {
+    if (!Enabled)
+        return false;
+
+    char path[4096 + 32];
+    GetEntryPath(path, sizeof path, CRC32::EncryptData(source, sourceSize), sourceSize, paletted);
+
+    FileStream* stream = FileStream::New(path, FileStream::READ_ACCESS);
+    if (!stream) {
+        SDL_AtomicAdd(&Misses, 1);
+        return false;
+    }
+
+    size_t fileSize = stream->Length();
+    Uint8* file = (Uint8*)Memory::Malloc(fileSize);
+    bool valid = file && fileSize >= IMAGECACHE_HEADER_SIZE && stream->ReadBytes(file, fileSize) == fileSize;
+    stream->Close();
+
+    Uint32 width = 0, height = 0, numColors = 0, compressedSize = 0;
+    Uint16 flags = 0;
+    if (valid) {
+        flags = file[6] | (file[7] << 8);
+        width = ReadLE32(file + 8);
+        height = ReadLE32(file + 12);
+        numColors = ReadLE32(file + 16);
+        compressedSize = ReadLE32(file + 24);
+
+        valid = ReadLE32(file) == IMAGECACHE_MAGIC
+            && (file[4] | (file[5] << 8)) == IMAGECACHE_VERSION
+            && ReadLE32(file + 20) == (Uint32)sourceSize
+            && !!(flags & IMAGECACHE_FLAG_PALETTED) == paletted
+            && numColors <= IMAGECACHE_MAX_PALETTE_COLORS
+            && width > 0 && height > 0
+            && IMAGECACHE_HEADER_SIZE + (size_t)numColors * 4 + compressedSize == fileSize;
+    }
+
+    Uint32* data = NULL;
+    Uint32* colors = NULL;
+    if (valid) {
+        size_t pixelCount = (size_t)width * height;
+        size_t pixelSize = paletted ? 1 : 4;
+        Uint8* pixels = (Uint8*)Memory::Malloc(pixelCount * pixelSize);
+        Uint8* compressed = file + IMAGECACHE_HEADER_SIZE + numColors * 4;
+
+        data = (Uint32*)Memory::TrackedMalloc("DecodedImageCache::Data", pixelCount * sizeof(Uint32));
+        valid = pixels && data && LZ4::Decompress(compressed, compressedSize, pixels, pixelCount * pixelSize);
+
+        if (valid) {
+            if (paletted) {
+                for (size_t i = 0; i < pixelCount; i++)
+                    data[i] = pixels[i];
+
+                colors = (Uint32*)Memory::TrackedMalloc("DecodedImageCache::Colors", numColors * sizeof(Uint32));
+                for (Uint32 i = 0; i < numColors; i++)
+                    colors[i] = ReadLE32(file + IMAGECACHE_HEADER_SIZE + i * 4);
+                Graphics::ConvertFromARGBtoNative(colors, numColors);
+            }
+            else {
+                for (size_t i = 0; i < pixelCount; i++)
+                    data[i] = ReadLE32(pixels + i * 4);
+                Graphics::ConvertFromARGBtoNative(data, (int)pixelCount);
+            }
+        }
+        Memory::Free(pixels);
+    }
+    Memory::Free(file);
+
+    if (!valid) {
+        Log::Print(Log::LOG_WARN, "Decoded image cache entry \"%s\" is invalid, ignoring it.", path);
+        Memory::Free(data);
+        SDL_AtomicAdd(&Misses, 1);
+        return false;
+    }
+
+    image->Width = width;
+    image->Height = height;
+    image->Data = data;
+    image->Colors = colors;
+    image->Paletted = paletted;
+    image->NumPaletteColors = paletted ? numColors : 0;
+
+    SDL_AtomicAdd(&Hits, 1);
+    return true;
+}
+
+// Writes a freshly decoded image to the cache. The source is the image file
+// it was decoded from.
+PUBLIC STATIC void DecodedImageCache::Store(ImageFormat* image, Uint8* source, size_t sourceSize) {
+    if (!Enabled || !image->Data)
+        return;
+
+    bool paletted = image->Paletted;
+    if (paletted && (!image->Colors || image->NumPaletteColors > IMAGECACHE_MAX_PALETTE_COLORS))
+        return;
+
+    size_t pixelCount = (size_t)image->Width * image->Height;
+    size_t pixelSize = paletted ? 1 : 4;
+    Uint32 numColors = paletted ? image->NumPaletteColors : 0;
+
+    Uint8* pixels = (Uint8*)Memory::Malloc(pixelCount * pixelSize);
+    if (!pixels)
+        return;
+
+    if (paletted) {
+        for (size_t i = 0; i < pixelCount; i++)
+            pixels[i] = (Uint8)image->Data[i];
+    }
+    else {
+        memcpy(pixels, image->Data, pixelCount * 4);
+        Graphics::ConvertFromNativeToARGB((Uint32*)pixels, (int)pixelCount);
+        for (size_t i = 0; i < pixelCount; i++)
+            WriteLE32(pixels + i * 4, ((Uint32*)pixels)[i]);
+    }
+
+    size_t headerSize = IMAGECACHE_HEADER_SIZE + numColors * 4;
+    size_t fileSize = headerSize + LZ4::CompressBound(pixelCount * pixelSize);
+    Uint8* file = (Uint8*)Memory::Calloc(fileSize, 1);
+    if (!file) {
+        Memory::Free(pixels);
+        return;
+    }
+
+    size_t compressedSize = LZ4::Compress(pixels, pixelCount * pixelSize, file + headerSize, fileSize - headerSize);
+    Memory::Free(pixels);
+
+    WriteLE32(file, IMAGECACHE_MAGIC);
+    file[4] = IMAGECACHE_VERSION & 0xFF;
+    file[5] = IMAGECACHE_VERSION >> 8;
+    file[6] = paletted ? IMAGECACHE_FLAG_PALETTED : 0;
+    WriteLE32(file + 8, image->Width);
+    WriteLE32(file + 12, image->Height);
+    WriteLE32(file + 16, numColors);
+    WriteLE32(file + 20, (Uint32)sourceSize);
+    WriteLE32(file + 24, (Uint32)compressedSize);
+
+    if (paletted) {
+        Uint32* colors = (Uint32*)(file + IMAGECACHE_HEADER_SIZE);
+        memcpy(colors, image->Colors, numColors * sizeof(Uint32));
+        Graphics::ConvertFromNativeToARGB(colors, numColors);
+        for (Uint32 i = 0; i < numColors; i++)
+            WriteLE32(file + IMAGECACHE_HEADER_SIZE + i * 4, colors[i]);
+    }
+
+    // Images can be decoded on several threads at once, so each one writes
+    // to its own file first, and then moves it into place
+    char path[4096 + 32];
+    char tempPath[4096 + 64];
+    GetEntryPath(path, sizeof path, CRC32::EncryptData(source, sourceSize), sourceSize, paletted);
+    snprintf(tempPath, sizeof tempPath, "%s.%lu.tmp", path, (unsigned long)SDL_ThreadID());
+
+    bool written = false;
+    FileStream* stream = compressedSize ? FileStream::New(tempPath, FileStream::WRITE_ACCESS) : NULL;
+    if (stream) {
+        written = stream->WriteBytes(file, headerSize + compressedSize) == headerSize + compressedSize;
+        stream->Close();
+
+        if (written) {
+            remove(path);
+            written = rename(tempPath, path) == 0;
+        }
+        if (!written)
+            remove(tempPath);
+    }
+    Memory::Free(file);
+
+    if (!written)
+        Log::Print(Log::LOG_WARN, "Could not write decoded image cache entry \"%s\"!", path);
+}
+
+PUBLIC STATIC void DecodedImageCache::ResetStats() {
+    SDL_AtomicSet(&Hits, 0);
+    SDL_AtomicSet(&Misses, 0);
+}
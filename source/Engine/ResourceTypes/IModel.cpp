@@ -3,6 +3,7 @@
 #include <Engine/Rendering/3D.h>
 #include <Engine/Rendering/Mesh.h>
 #include <Engine/Rendering/Material.h>
+#include <Engine/Rendering/PoseCache.h>
 #include <Engine/Graphics.h>
 #include <Engine/IO/Stream.h>
 
@@ -29,6 +30,8 @@ public:
 
     Armature*           BaseArmature;
     Matrix4x4*          GlobalInverseMatrix;
+
+    PoseCache*          CachedPoses;
 };
 #endif
 
@@ -68,8 +71,12 @@ PUBLIC IModel::IModel() {
     BaseArmature = nullptr;
     GlobalInverseMatrix = nullptr;
     UseVertexAnimation = false;
+
+    CachedPoses = nullptr;
 }
 PUBLIC IModel::IModel(const char* filename) {
+    CachedPoses = nullptr;
+
     ResourceStream* resourceStream = ResourceStream::New(filename);
     if (!resourceStream) return;
 
@@ -376,6 +383,47 @@ PRIVATE void IModel::UpdateChannel(Matrix4x4* out, NodeAnim* channel, Uint32 fra
     }
 }
 
+// Gets the skinned pose of an animation frame from the pose cache, posing
+// and skinning the armature into it if it's not cached yet. The armature
+// itself is left unchanged on a cache hit. Returns nullptr if the pose
+// can't be cached.
+PUBLIC ModelPose* IModel::GetPose(Armature* armature, ModelAnim* animation, Uint32 frame) {
+    if (!PoseCache::Enabled || animation->Skeletal == nullptr)
+        return nullptr;
+
+    if (armature == nullptr)
+        armature = BaseArmature;
+
+    frame = PoseCache::QuantizeFrame(frame);
+
+    if (CachedPoses == nullptr)
+        CachedPoses = new PoseCache();
+
+    ModelPose* pose = CachedPoses->Find(animation, frame);
+    if (pose) {
+        PoseCache::Hits++;
+        return pose;
+    }
+
+    PoseCache::Misses++;
+
+    Pose(armature, animation->Skeletal, frame);
+
+    pose = CachedPoses->Store(animation, frame, armature);
+    if (pose == nullptr) {
+        armature->UpdateSkeletons();
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < armature->NumSkeletons; i++) {
+        Skeleton* skeleton = armature->Skeletons[i];
+        skeleton->CalculateBones();
+        skeleton->Transform(pose->Positions[i], pose->Normals[i]);
+    }
+
+    return pose;
+}
+
 PUBLIC void IModel::Animate(Armature* armature, ModelAnim* animation, Uint32 frame) {
     if (animation->Skeletal == nullptr)
         return;
@@ -383,6 +431,12 @@ PUBLIC void IModel::Animate(Armature* armature, ModelAnim* animation, Uint32 fra
     if (armature == nullptr)
         armature = BaseArmature;
 
+    ModelPose* pose = GetPose(armature, animation, frame);
+    if (pose) {
+        PoseCache::Apply(pose, armature);
+        return;
+    }
+
     Pose(armature, animation->Skeletal, frame);
 
     armature->UpdateSkeletons();
@@ -466,6 +520,7 @@ PUBLIC void IModel::Dispose() {
 
     delete BaseArmature;
     delete GlobalInverseMatrix;
+    delete CachedPoses;
 
     Meshes = nullptr;
     MeshCount = 0;
@@ -481,6 +536,7 @@ PUBLIC void IModel::Dispose() {
 
     BaseArmature = nullptr;
     GlobalInverseMatrix = nullptr;
+    CachedPoses = nullptr;
 }
 
 PUBLIC IModel::~IModel() {
@@ -16,6 +16,17 @@ public:
     char              Filename[256];
     bool              LoadFailed = false;
     bool              StreamFromFile = false;
+    bool              Decoded = false;
+
+    // Limits for playing it as a sound effect. With MaxInstances channels
+    // playing it already, the oldest one is replaced. 0 means no limit.
+    int               MaxInstances = 0;
+    // When every voice is in use, sounds only replace sounds with the same
+    // or a lower priority.
+    int               Priority = 0;
+
+    // Sounds up to this long (in milliseconds) are decoded when they load
+    static int        PreDecodeLimit;
 };
 #endif
 
@@ -29,6 +40,8 @@ public:
 #include <Engine/ResourceTypes/SoundFormats/OGG.h>
 #include <Engine/ResourceTypes/SoundFormats/WAV.h>
 
+int ISound::PreDecodeLimit = 5000;
+
 PUBLIC      ISound::ISound(const char* filename) {
     ISound::Load(filename, true);
 }
@@ -73,12 +86,13 @@ PUBLIC void ISound::Load(const char* filename, bool streamFromFile) {
         return;
     }
 
-    // If we're not streaming, then load all samples now
-    if (!StreamFromFile) {
+    // If we're not streaming, or the sound is short enough that it's likely
+    // to be played as a sound effect, then load all samples now
+    if (!StreamFromFile || SoundData->GetDuration() * 1000.0 <= PreDecodeLimit) {
         ticks = Clock::GetTicks();
 
-        SoundData->LoadSamples(SoundData->TotalPossibleSamples);
-        SoundData->Close();
+        size_t count;
+        ISound::GetDecodedSamples(&count);
 
         Log::Print(Log::LOG_VERBOSE, "Full sample load took %.3f ms", Clock::GetTicks() - ticks);
     }
@@ -97,6 +111,30 @@ PUBLIC AudioPlayback* ISound::CreatePlayer() {
     return playback;
 }
 
-PUBLIC void ISound::Dispose() {
+// Decodes the whole sound if it isn't already, and returns its samples. Every
+// channel playing it as a sound effect reads from these, so they must not be
+// changed, and stay valid until the sound is disposed.
+PUBLIC Uint8* ISound::GetDecodedSamples(size_t* count) {
+    *count = 0;
+    if (!SoundData)
+        return NULL;
+
+    if (!Decoded) {
+        if (SoundData->Samples.size() < (size_t)SoundData->TotalPossibleSamples)
+            SoundData->LoadAllSamples();
+        SoundData->Close();
+        Decoded = true;
+    }
+
+    // Both formats decode into one contiguous buffer
+    *count = SoundData->Samples.size();
+    return *count ? SoundData->Samples[0] : NULL;
+}
 
+PUBLIC void ISound::Dispose() {
+    if (SoundData) {
+        SoundData->Dispose();
+        delete SoundData;
+        SoundData = NULL;
+    }
 }
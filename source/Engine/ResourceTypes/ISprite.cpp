@@ -29,6 +29,7 @@ public:
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/ImageFormats/JPEG.h>
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
+#include <Engine/ResourceTypes/SpriteSheetPreloader.h>
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Clock.h>
@@ -64,13 +65,18 @@ PUBLIC STATIC Texture* ISprite::AddSpriteSheet(const char* filename) {
 
     const char* altered = filename;
 
+    SpriteSheetPreloader::Record(altered);
+
     if (Graphics::SpriteSheetTextureMap->Exists(altered)) {
         texture = Graphics::SpriteSheetTextureMap->Get(altered);
         return texture;
     }
 
     float loadDelta = 0.0f;
-    if (StringUtils::StrCaseStr(altered, ".png")) {
+    if (SpriteSheetPreloader::Take(altered, &data, &width, &height, &paletteColors, &numPaletteColors)) {
+        Log::Print(Log::LOG_VERBOSE, "Using preloaded sprite sheet (%s)", altered);
+    }
+    else if (StringUtils::StrCaseStr(altered, ".png")) {
         Clock::Start();
         PNG* png = PNG::Load(altered);
         loadDelta = Clock::End();
@@ -145,6 +151,13 @@ PUBLIC STATIC Texture* ISprite::AddSpriteSheet(const char* filename) {
         return texture;
     }
 
+    if (loadDelta > 0.0f) {
+        SpriteSheetPreloader::DecodeTime += loadDelta;
+        SpriteSheetPreloader::DecodedCount++;
+    }
+
+    double uploadTicks = Clock::GetTicks();
+
     bool forceSoftwareTextures = false;
     Application::Settings->GetBool("display", "forceSoftwareTextures", &forceSoftwareTextures);
     if (forceSoftwareTextures)
@@ -158,6 +171,8 @@ PUBLIC STATIC Texture* ISprite::AddSpriteSheet(const char* filename) {
 
     Memory::Free(data);
 
+    SpriteSheetPreloader::UploadTime += Clock::GetTicks() - uploadTicks;
+
     Graphics::SpriteSheetTextureMap->Put(altered, texture);
 
     return texture;
@@ -356,6 +371,31 @@ PUBLIC bool ISprite::LoadAnimation(const char* filename) {
 
     return true;
 }
+// Reads the names of the spritesheets a sprite uses, as they'd be passed to
+// AddSpriteSheet, without loading anything else.
+PUBLIC STATIC bool ISprite::GetSpriteSheetFilenames(const char* filename, vector<string>& filenames) {
+    Stream* reader = ResourceStream::New(filename);
+    if (!reader)
+        return false;
+
+    if (reader->ReadUInt32() != 0x00525053) {
+        reader->Close();
+        return false;
+    }
+
+    // Total frame count
+    reader->ReadUInt32();
+
+    int count = reader->ReadByte();
+    for (int i = 0; i < count && i < MAX_SPRITESHEETS; i++) {
+        char* str = reader->ReadHeaderedString();
+        filenames.push_back(string("Sprites/") + str);
+        Memory::Free(str);
+    }
+    reader->Close();
+
+    return true;
+}
 PUBLIC int  ISprite::FindAnimation(const char* animname) {
     for (Uint32 a = 0; a < Animations.size(); a++)
         if (Animations[a].Name[0] == animname[0] && !strcmp(Animations[a].Name, animname))
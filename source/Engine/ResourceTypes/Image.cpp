@@ -29,6 +29,10 @@ PUBLIC Image::Image(const char* filename) {
     strncpy(Filename, filename, 255);
     TexturePtr = Image::LoadTextureFromResource(Filename);
 }
+PUBLIC Image::Image(const char* filename, Texture* texture) {
+    strncpy(Filename, filename, 255);
+    TexturePtr = texture;
+}
 
 PUBLIC void Image::Dispose() {
     if (TexturePtr) {
@@ -42,13 +46,24 @@ PUBLIC Image::~Image() {
 }
 
 PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
-    Texture* texture = NULL;
-    Uint32*  data = NULL;
     Uint32   width = 0;
     Uint32   height = 0;
     Uint32*  paletteColors = NULL;
     unsigned numPaletteColors = 0;
 
+    Uint32* data = Image::DecodeResource(filename, &width, &height, &paletteColors, &numPaletteColors);
+    if (!data)
+        return NULL;
+
+    return Image::CreateTexture(filename, data, width, height, paletteColors, numPaletteColors);
+}
+
+// Reads and decodes an image into 32-bit pixels. It doesn't touch the
+// renderer, so it can be called from any thread; CreateTexture has to be
+// called on the main thread afterwards, which takes the pixels and palette.
+PUBLIC STATIC Uint32* Image::DecodeResource(const char* filename, Uint32* width, Uint32* height, Uint32** paletteColors, unsigned* numPaletteColors) {
+    Uint32* data = NULL;
+
     const char* altered = filename;
 
     Uint32 magic = 0x000000;
@@ -66,26 +81,30 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         return NULL;
     }
 
+    *paletteColors = NULL;
+    *numPaletteColors = 0;
+
     // 0x474E5089U PNG
     if (magic == 0x474E5089U) {
         Clock::Start();
         PNG* png = PNG::Load(altered);
         if (png) {
             Log::Print(Log::LOG_VERBOSE, "PNG load took %.3f ms (%s)", Clock::End(), altered);
-            width = (Uint32)png->Width;
-            height = (Uint32)png->Height;
+            *width = (Uint32)png->Width;
+            *height = (Uint32)png->Height;
 
             data = png->Data;
             Memory::Track(data, "Texture::Data");
 
             if (png->Paletted) {
-                paletteColors = png->GetPalette();
-                numPaletteColors = png->NumPaletteColors;
+                *paletteColors = png->GetPalette();
+                *numPaletteColors = png->NumPaletteColors;
             }
 
             delete png;
         }
         else {
+            Clock::End();
             Log::Print(Log::LOG_ERROR, "PNG could not be loaded!");
             return NULL;
         }
@@ -96,8 +115,8 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         JPEG* jpeg = JPEG::Load(altered);
         if (jpeg) {
             Log::Print(Log::LOG_VERBOSE, "JPEG load took %.3f ms (%s)", Clock::End(), altered);
-            width = (Uint32)jpeg->Width;
-            height = (Uint32)jpeg->Height;
+            *width = (Uint32)jpeg->Width;
+            *height = (Uint32)jpeg->Height;
 
             data = jpeg->Data;
             Memory::Track(data, "Texture::Data");
@@ -105,6 +124,7 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
             delete jpeg;
         }
         else {
+            Clock::End();
             Log::Print(Log::LOG_ERROR, "JPEG could not be loaded!");
             return NULL;
         }
@@ -114,20 +134,21 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         GIF* gif = GIF::Load(altered);
         if (gif) {
             Log::Print(Log::LOG_VERBOSE, "GIF load took %.3f ms (%s)", Clock::End(), altered);
-            width = (Uint32)gif->Width;
-            height = (Uint32)gif->Height;
+            *width = (Uint32)gif->Width;
+            *height = (Uint32)gif->Height;
 
             data = gif->Data;
             Memory::Track(data, "Texture::Data");
 
             if (gif->Paletted) {
-                paletteColors = gif->GetPalette();
-                numPaletteColors = 256;
+                *paletteColors = gif->GetPalette();
+                *numPaletteColors = 256;
             }
 
             delete gif;
         }
         else {
+            Clock::End();
             Log::Print(Log::LOG_ERROR, "GIF could not be loaded!");
             return NULL;
         }
@@ -137,13 +158,20 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         return NULL;
     }
 
+    return data;
+}
+
+// Creates a texture from pixels returned by DecodeResource, and frees them.
+PUBLIC STATIC Texture* Image::CreateTexture(const char* filename, Uint32* data, Uint32 width, Uint32 height, Uint32* paletteColors, unsigned numPaletteColors) {
+    Texture* texture = NULL;
+
     bool forceSoftwareTextures = false;
     Application::Settings->GetBool("display", "forceSoftwareTextures", &forceSoftwareTextures);
     if (forceSoftwareTextures)
         Graphics::NoInternalTextures = true;
 
     if (!forceSoftwareTextures && (width > Graphics::MaxTextureWidth || height > Graphics::MaxTextureHeight)) {
-		Log::Print(Log::LOG_WARN, "Image file \"%s\" of size %d x %d is larger than maximum size of %d x %d!", altered, width, height, Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
+		Log::Print(Log::LOG_WARN, "Image file \"%s\" of size %d x %d is larger than maximum size of %d x %d!", filename, width, height, Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
 		// return NULL;
 	}
 
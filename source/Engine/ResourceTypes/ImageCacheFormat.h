@@ -0,0 +1,28 @@
+#ifndef ENGINE_RESOURCETYPES_IMAGECACHEFORMAT_H
+#define ENGINE_RESOURCETYPES_IMAGECACHEFORMAT_H
+
+// Decoded image cache files hold the pixels of an image so that it doesn't
+// have to be decoded again. A file is named after the CRC32 and size of the
+// image file it came from, and whether it's the paletted or the full color
+// version, so it stays valid no matter where that file is stored.
+//
+// Header (little endian, 32 bytes):
+//     magic, version (2 bytes), flags (2 bytes), width, height,
+//     palette color count, source size, compressed pixel data size,
+//     reserved
+// followed by the palette colors (ARGB) and the LZ4 compressed pixels: one
+// palette index byte per pixel if paletted, otherwise ARGB.
+
+#define IMAGECACHE_MAGIC       0x43494D48 // "HMIC"
+#define IMAGECACHE_VERSION     1
+#define IMAGECACHE_HEADER_SIZE 32
+
+#define IMAGECACHE_FLAG_PALETTED 1
+
+#define IMAGECACHE_MAX_PALETTE_COLORS 256
+
+// Writes the filename of a cache entry (without its folder) into out
+#define IMAGECACHE_FILENAME(out, outSize, sourceHash, sourceSize, paletted) \
+    snprintf((out), (outSize), "%08X%08X.%s", (Uint32)(sourceHash), (Uint32)(sourceSize), (paletted) ? "pal" : "argb")
+
+#endif /* ENGINE_RESOURCETYPES_IMAGECACHEFORMAT_H */
@@ -19,6 +19,7 @@ public:
 #include <Engine/IO/FileStream.h>
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/IO/ResourceStream.h>
+#include <Engine/ResourceTypes/DecodedImageCache.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 
 #ifdef USING_LIBPNG
@@ -48,6 +49,13 @@ void png_read_fn(png_structp ctx, png_bytep area, png_size_t size) {
 #include <Libraries/stb_image.h>
 #endif
 
+#ifdef USING_SPNG
+// Whether the IHDR chunk, which always comes first, says the image is indexed
+static bool PNG_IsIndexed(Uint8* buffer, size_t buffer_len) {
+    return buffer_len > 25 && buffer[25] == 3;
+}
+#endif
+
 PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
 #ifdef USING_LIBPNG
     PNG* png = new PNG;
@@ -203,6 +211,9 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
     stream->ReadBytes(buffer, buffer_len);
     stream->Close();
 
+    if (DecodedImageCache::Load(png, buffer, buffer_len, Graphics::UsePalettes && PNG_IsIndexed(buffer, buffer_len)))
+        goto PNG_Load_Success;
+
     ctx = spng_ctx_new(0);
     if (ctx == NULL) {
         Log::Print(Log::LOG_ERROR, "spng_ctx_new() failed!");
@@ -284,6 +295,8 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
         png->Colors = nullptr;
     }
 
+    DecodedImageCache::Store(png, buffer, buffer_len);
+
     goto PNG_Load_Success;
 
 PNG_Load_FAIL:
@@ -320,6 +333,9 @@ PNG_Load_Success:
     stream->ReadBytes(buffer, buffer_len);
     stream->Close();
 
+    if (DecodedImageCache::Load(png, buffer, buffer_len, false))
+        goto PNG_Load_Success;
+
     pixelData = (Uint32*)stbi_load_from_memory(buffer, buffer_len, &width, &height, &num_channels, STBI_rgb_alpha);
     if (!pixelData) {
         Log::Print(Log::LOG_ERROR, "stbi_load failed: %s", stbi_failure_reason());
@@ -336,6 +352,8 @@ PNG_Load_Success:
     png->Paletted = false;
     png->NumPaletteColors = 0;
 
+    DecodedImageCache::Store(png, buffer, buffer_len);
+
     goto PNG_Load_Success;
 
 PNG_Load_FAIL:
@@ -0,0 +1,279 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Application.h>
+#include <Engine/ResourceTypes/ResourceType.h>
+
+class ResourceCache {
+public:
+    enum CacheType {
+        CACHE_SPRITE,
+        CACHE_IMAGE,
+        CACHE_SOUND,
+        CACHE_MODEL,
+
+        CACHE_TYPE_COUNT
+    };
+
+    static size_t Budget;
+
+    static Uint64 Hits;
+    static Uint64 Misses;
+    static Uint64 Evictions;
+};
+#endif
+
+#include <Engine/ResourceTypes/ResourceCache.h>
+#include <Engine/Audio/AudioManager.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Includes/HashMap.h>
+
+// Resources that went out of scope, kept around in case they're loaded
+// again. Scene::DisposeInScope hands them over instead of disposing them,
+// and the Resources.Load* functions take them back out. When the cache is
+// over its budget, the least recently stored resources are disposed.
+
+struct CacheEntry {
+    int           Type;
+    ResourceType* Resource;
+    size_t        Size;
+    CacheEntry*   Prev;
+    CacheEntry*   Next;
+};
+
+size_t ResourceCache::Budget = 0;
+
+Uint64 ResourceCache::Hits = 0;
+Uint64 ResourceCache::Misses = 0;
+Uint64 ResourceCache::Evictions = 0;
+
+// Most recently stored first
+static CacheEntry*          Newest = NULL;
+static CacheEntry*          Oldest = NULL;
+static HashMap<CacheEntry*>* Entries = NULL;
+static size_t               TotalSize = 0;
+static size_t               TypeSize[ResourceCache::CACHE_TYPE_COUNT];
+static Uint32               TypeCount[ResourceCache::CACHE_TYPE_COUNT];
+
+static Uint32 GetKey(int type, Uint32 filenameHash) {
+    return CRC32::EncryptData(&type, sizeof(type), filenameHash);
+}
+
+static void Unlink(CacheEntry* entry) {
+    if (entry->Prev)
+        entry->Prev->Next = entry->Next;
+    else
+        Newest = entry->Next;
+    if (entry->Next)
+        entry->Next->Prev = entry->Prev;
+    else
+        Oldest = entry->Prev;
+
+    Entries->Remove(GetKey(entry->Type, entry->Resource->FilenameHash));
+    TotalSize -= entry->Size;
+    TypeSize[entry->Type] -= entry->Size;
+    TypeCount[entry->Type]--;
+}
+static void DisposeResource(int type, ResourceType* resource) {
+    switch (type) {
+        case ResourceCache::CACHE_SPRITE:
+            resource->AsSprite->Dispose();
+            delete resource->AsSprite;
+            break;
+        case ResourceCache::CACHE_IMAGE:
+            resource->AsImage->Dispose();
+            delete resource->AsImage;
+            break;
+        case ResourceCache::CACHE_SOUND:
+            AudioManager::Lock();
+            // Channels read the sound's samples directly
+            AudioManager::AudioStop(resource->AsSound);
+            resource->AsSound->Dispose();
+            delete resource->AsSound;
+            AudioManager::Unlock();
+            break;
+        case ResourceCache::CACHE_MODEL:
+            resource->AsModel->Dispose();
+            delete resource->AsModel;
+            break;
+    }
+    delete resource;
+}
+
+// Roughly how much memory a resource holds on to. Sprite sheets belong to
+// Graphics::SpriteSheetTextureMap and outlive their sprites, so they aren't
+// counted.
+static size_t GetResourceSize(int type, ResourceType* resource) {
+    size_t size = 0;
+    switch (type) {
+        case ResourceCache::CACHE_SPRITE: {
+            ISprite* sprite = resource->AsSprite;
+            size = sizeof(ISprite);
+            for (size_t a = 0; a < sprite->Animations.size(); a++) {
+                Animation* animation = &sprite->Animations[a];
+                size += sizeof(Animation) + animation->Frames.size() * sizeof(AnimFrame);
+                for (size_t f = 0; f < animation->Frames.size(); f++)
+                    size += animation->Frames[f].BoxCount * sizeof(CollisionBox);
+            }
+            break;
+        }
+        case ResourceCache::CACHE_IMAGE: {
+            Texture* texture = resource->AsImage->TexturePtr;
+            size = sizeof(Image);
+            if (texture)
+                size += (size_t)texture->Width * texture->Height * 4;
+            break;
+        }
+        case ResourceCache::CACHE_SOUND: {
+            SoundFormat* data = resource->AsSound->SoundData;
+            size = sizeof(ISound);
+            if (data)
+                size += data->Samples.size() * (data->SampleSize + sizeof(Uint8*));
+            break;
+        }
+        case ResourceCache::CACHE_MODEL: {
+            IModel* model = resource->AsModel;
+            size = sizeof(IModel);
+            for (size_t i = 0; i < model->MeshCount; i++) {
+                Mesh* mesh = model->Meshes[i];
+                size_t frames = mesh->FrameCount ? mesh->FrameCount : 1;
+                size += sizeof(Mesh);
+                size += mesh->VertexCount * frames * sizeof(Vector3) * 2;
+                if (mesh->UVBuffer)
+                    size += mesh->VertexCount * frames * sizeof(Vector2);
+                if (mesh->ColorBuffer)
+                    size += mesh->VertexCount * frames * sizeof(Uint32);
+                size += mesh->VertexIndexCount * sizeof(Sint32);
+            }
+            break;
+        }
+    }
+    return size;
+}
+
+static void Evict(size_t budget) {
+    while (Oldest && TotalSize > budget) {
+        CacheEntry* entry = Oldest;
+        Unlink(entry);
+        DisposeResource(entry->Type, entry->Resource);
+        delete entry;
+        ResourceCache::Evictions++;
+    }
+}
+
+// Takes a resource that's no longer in a resource list. Returns false if the
+// cache is disabled or the resource is bigger than the whole budget, in which
+// case the caller still has to dispose of it.
+PUBLIC STATIC bool ResourceCache::Store(int type, ResourceType* resource) {
+    if (Budget == 0 || type < 0 || type >= CACHE_TYPE_COUNT)
+        return false;
+
+    size_t size = GetResourceSize(type, resource);
+    if (size > Budget)
+        return false;
+
+    if (!Entries)
+        Entries = new HashMap<CacheEntry*>(NULL, 8);
+
+    // Scripts can load the same resource under different unload policies,
+    // so it could already be cached
+    Uint32 key = GetKey(type, resource->FilenameHash);
+    CacheEntry* existing;
+    if (Entries->GetIfExists(key, &existing)) {
+        Unlink(existing);
+        DisposeResource(existing->Type, existing->Resource);
+        delete existing;
+    }
+
+    CacheEntry* entry = new CacheEntry;
+    entry->Type = type;
+    entry->Resource = resource;
+    entry->Size = size;
+    entry->Prev = NULL;
+    entry->Next = Newest;
+    if (Newest)
+        Newest->Prev = entry;
+    else
+        Oldest = entry;
+    Newest = entry;
+
+    Entries->Put(key, entry);
+    TotalSize += size;
+    TypeSize[type] += size;
+    TypeCount[type]++;
+
+    Evict(Budget);
+    return true;
+}
+// Fills in resource from the cache if it has a resource of the same type and
+// name. The cache's own ResourceType is freed, and resource keeps its unload
+// policy.
+PUBLIC STATIC bool ResourceCache::Revive(int type, ResourceType* resource) {
+    if (Budget == 0)
+        return false;
+
+    CacheEntry* entry;
+    if (!Entries || !Entries->GetIfExists(GetKey(type, resource->FilenameHash), &entry)) {
+        Misses++;
+        return false;
+    }
+
+    Unlink(entry);
+    switch (type) {
+        case CACHE_SPRITE:
+            resource->AsSprite = entry->Resource->AsSprite;
+            break;
+        case CACHE_IMAGE:
+            resource->AsImage = entry->Resource->AsImage;
+            break;
+        case CACHE_SOUND:
+            resource->AsSound = entry->Resource->AsSound;
+            break;
+        case CACHE_MODEL:
+            resource->AsModel = entry->Resource->AsModel;
+            break;
+    }
+    delete entry->Resource;
+    delete entry;
+
+    Hits++;
+    return true;
+}
+PUBLIC STATIC bool ResourceCache::Contains(int type, Uint32 filenameHash) {
+    return Budget > 0 && Entries && Entries->Exists(GetKey(type, filenameHash));
+}
+
+PUBLIC STATIC void ResourceCache::SetBudget(size_t budget) {
+    Budget = budget;
+    Evict(Budget);
+}
+
+PUBLIC STATIC size_t ResourceCache::GetSize() {
+    return TotalSize;
+}
+PUBLIC STATIC size_t ResourceCache::GetSize(int type) {
+    if (type < 0 || type >= CACHE_TYPE_COUNT)
+        return 0;
+    return TypeSize[type];
+}
+PUBLIC STATIC Uint32 ResourceCache::GetCount() {
+    Uint32 count = 0;
+    for (int i = 0; i < CACHE_TYPE_COUNT; i++)
+        count += TypeCount[i];
+    return count;
+}
+PUBLIC STATIC Uint32 ResourceCache::GetCount(int type) {
+    if (type < 0 || type >= CACHE_TYPE_COUNT)
+        return 0;
+    return TypeCount[type];
+}
+
+PUBLIC STATIC void ResourceCache::Clear() {
+    Evict(0);
+}
+PUBLIC STATIC void ResourceCache::Dispose() {
+    Clear();
+    if (Entries)
+        delete Entries;
+    Entries = NULL;
+}
@@ -13,34 +13,104 @@ public:
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Tracer.h>
 #include <Engine/Filesystem/Directory.h>
+#include <Engine/Filesystem/DirectoryIndex.h>
 #include <Engine/Filesystem/File.h>
+#include <Engine/Filesystem/MappedFile.h>
 #include <Engine/Hashing/CRC32.h>
 #include <Engine/Includes/StandardSDL2.h>
+#include <Engine/IO/Compression/LZ4.h>
 #include <Engine/IO/Compression/ZLibStream.h>
+#include <Engine/IO/Compression/Zstd.h>
 #include <Engine/IO/FileStream.h>
 #include <Engine/IO/SDLStream.h>
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/IO/Stream.h>
+#include <Engine/ResourceTypes/DataPackFormat.h>
+#include <Engine/Utilities/StringUtils.h>
 #include <Engine/Application.h>
 
+#if LINUX || MACOSX
+    #define USING_PREAD
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 #define KEEP_DATA_PACKS_IN_MEMORY
 
 struct      StreamNode {
     Stream*            Table;
+    MappedFile*        Mapping;
+    int                FileDescriptor;
+    SDL_mutex*         ReadLock;
+    void*              Dictionary;
     struct StreamNode* Next;
 };
 StreamNode* StreamNodeHead = NULL;
 
 struct  ResourceRegistryItem {
-    Stream* Table;
-    Uint64  Offset;
-    Uint64  Size;
-    Uint32  DataFlag;
-    Uint64  CompressedSize;
+    StreamNode* Pack;
+    bool        Mapped;
+    Uint64      Offset;
+    Uint64      Size;
+    Uint32      DataFlag;
+    Uint64      CompressedSize;
 };
+
+// Only written to by ResourceManager::Load, so once every data pack has been
+// loaded in Init, it can be read from any thread without locking.
 HashMap<ResourceRegistryItem>* ResourceRegistry = NULL;
 
+// Number of ResourceStreams reading straight from a data pack's mapping.
+// The mappings can't be unmapped while any of them are open.
+SDL_atomic_t MappedResourceCount;
+
+// With dev/recordLoadOrder set, every resource's name is written to that
+// file the first time it's loaded, so that hatchpack can lay out a data pack
+// in the order a game reads it.
+FILE*           LoadOrderFile = NULL;
+SDL_mutex*      LoadOrderLock = NULL;
+HashMap<Uint8>* LoadOrderSeen = NULL;
+
+// Every file in the data folder, so that looking for a resource that isn't
+// there doesn't have to go to the disk. Turned off with dev/indexDataFolder.
+DirectoryIndex* DataFolderIndex = NULL;
+
+static bool LoadPackResource(ResourceRegistryItem& item, Uint32 filenameHash, Uint8** out, size_t* size);
+
+// Writes the path of a resource in the data folder into out. Returns false if
+// the index knows it isn't there.
+static bool GetDataFolderPath(char* out, size_t outSize, const char* filename) {
+    char indexedPath[4096];
+    if (DataFolderIndex) {
+        switch (DataFolderIndex->Find(filename, indexedPath, sizeof indexedPath)) {
+            case DirectoryIndex::INDEX_MISSING:
+                return false;
+            case DirectoryIndex::INDEX_FOUND:
+                // Could be in a different case than filename
+                ResourceManager::PrefixResourcePath(out, outSize, indexedPath);
+                return true;
+        }
+    }
+    ResourceManager::PrefixResourcePath(out, outSize, filename);
+    return true;
+}
+
+static void RecordLoadOrder(const char* filename) {
+    if (!LoadOrderFile)
+        return;
+
+    SDL_LockMutex(LoadOrderLock);
+    Uint32 hash = CRC32::EncryptString(filename);
+    if (!LoadOrderSeen->Exists(hash)) {
+        LoadOrderSeen->Put(hash, 1);
+        fprintf(LoadOrderFile, "%s\n", filename);
+        fflush(LoadOrderFile);
+    }
+    SDL_UnlockMutex(LoadOrderLock);
+}
+
 bool                 ResourceManager::UsingDataFolder = true;
 bool                 ResourceManager::UsingModPack = false;
 
@@ -72,6 +142,18 @@ PUBLIC STATIC void   ResourceManager::Init(const char* filename) {
         Log::Print(Log::LOG_WARN, "Cannot find \"%s\".", filename);
     }
 
+    char loadOrderFilename[1024];
+    if (Application::Settings->GetString("dev", "recordLoadOrder", loadOrderFilename, sizeof loadOrderFilename) && *loadOrderFilename) {
+        LoadOrderFile = fopen(loadOrderFilename, "w");
+        if (LoadOrderFile) {
+            LoadOrderLock = SDL_CreateMutex();
+            LoadOrderSeen = new HashMap<Uint8>(NULL, 10);
+            Log::Print(Log::LOG_INFO, "Recording load order to \"%s\"", loadOrderFilename);
+        }
+        else
+            Log::Print(Log::LOG_ERROR, "Could not open \"%s\" to record the load order!", loadOrderFilename);
+    }
+
     char modpacksString[1024];
     if (Application::Settings->GetString("game", "modpacks", modpacksString, sizeof modpacksString)) {
         if (File::Exists(modpacksString)) {
@@ -82,19 +164,51 @@ PUBLIC STATIC void   ResourceManager::Init(const char* filename) {
             ResourceManager::Load(modpacksString);
         }
     }
-}
-PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
-    if (!ResourceRegistry)
-        return;
 
+    bool indexDataFolder = true;
+    Application::Settings->GetBool("dev", "indexDataFolder", &indexDataFolder);
+    if (indexDataFolder && Directory::Exists("Resources")) {
+        DataFolderIndex = new DirectoryIndex("Resources");
+        DataFolderIndex->Refresh();
+    }
+}
+// Lists the data folder again, for when files were changed in a way the
+// index can't notice by itself.
+PUBLIC STATIC void   ResourceManager::RefreshDataFolderIndex() {
+    if (DataFolderIndex)
+        DataFolderIndex->Refresh();
+}
+// Adds a file the engine wrote into the data folder to the index, so that it
+// can be loaded right away. path starts with "Resources/".
+PUBLIC STATIC void   ResourceManager::AddToDataFolderIndex(const char* path) {
+    if (DataFolderIndex && StringUtils::StartsWith(path, "Resources/"))
+        DataFolderIndex->Add(path + strlen("Resources/"));
+}
+PUBLIC STATIC void   ResourceManager::Update() {
+    if (DataFolderIndex)
+        DataFolderIndex->Update();
+}
+// Opens a data pack and adds its entries to registry. Returns NULL if it
+// isn't a data pack.
+static StreamNode* OpenPack(const char* filename, HashMap<ResourceRegistryItem>* registry) {
     // Load directly from Resource folder
     char resourcePath[4096];
     ResourceManager::PrefixParentPath(resourcePath, sizeof resourcePath, filename);
 
-    SDLStream* dataTableStream = SDLStream::New(resourcePath, SDLStream::READ_ACCESS);
+    // Map the whole file if possible, so that uncompressed resources can be
+    // read from it directly. Otherwise, read from it as needed.
+    Stream* dataTableStream = NULL;
+    MappedFile* mapping = MappedFile::Open(resourcePath);
+    if (mapping)
+        dataTableStream = MemoryStream::New(mapping->Data, mapping->Size);
+    else
+        dataTableStream = SDLStream::New(resourcePath, SDLStream::READ_ACCESS);
+
     if (!dataTableStream) {
         Log::Print(Log::LOG_ERROR, "Could not open MemoryStream!");
-        return;
+        if (mapping)
+            mapping->Close();
+        return NULL;
     }
 
     Uint16 fileCount;
@@ -103,7 +217,9 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     if (memcmp(magicHATCH, "HATCH", 5)) {
         Log::Print(Log::LOG_ERROR, "Invalid HATCH data file \"%s\"! (%02X %02X %02X %02X %02X)", filename, magicHATCH[0], magicHATCH[1], magicHATCH[2], magicHATCH[3], magicHATCH[4]);
         dataTableStream->Close();
-        return;
+        if (mapping)
+            mapping->Close();
+        return NULL;
     }
 
     // Uint8 major, minor, pad;
@@ -111,14 +227,30 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     dataTableStream->ReadByte();
     dataTableStream->ReadByte();
 
-    // Add stream to list for closure on disposal
     StreamNode* streamNode = new StreamNode;
     streamNode->Table = dataTableStream;
-    streamNode->Next = StreamNodeHead;
-    StreamNodeHead = streamNode;
+    streamNode->Mapping = mapping;
+    streamNode->FileDescriptor = -1;
+    streamNode->ReadLock = NULL;
+    streamNode->Dictionary = NULL;
+    streamNode->Next = NULL;
+
+    // Unmapped packs are read with positional reads where possible, so that
+    // threads don't fight over the stream's position
+    if (!mapping) {
+#ifdef USING_PREAD
+        streamNode->FileDescriptor = open(resourcePath, O_RDONLY);
+#endif
+        if (streamNode->FileDescriptor < 0)
+            streamNode->ReadLock = SDL_CreateMutex();
+    }
+
+    Uint32 dictionaryHash = CRC32::EncryptString(DATAPACK_DICTIONARY_NAME);
+    bool hasDictionary = false;
+    ResourceRegistryItem dictionaryItem;
 
     fileCount = dataTableStream->ReadUInt16();
-    Log::Print(Log::LOG_VERBOSE, "Loading resource table from \"%s\"...", filename);
+    Log::Print(Log::LOG_VERBOSE, "Loading resource table from \"%s\"%s...", filename, mapping ? " (memory mapped)" : "");
     for (int i = 0; i < fileCount; i++) {
         Uint32 crc32 = dataTableStream->ReadUInt32();
         Uint64 offset = dataTableStream->ReadUInt64();
@@ -126,117 +258,255 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
         Uint32 dataFlag = dataTableStream->ReadUInt32();
         Uint64 compressedSize = dataTableStream->ReadUInt64();
 
-        ResourceRegistryItem item { dataTableStream, offset, size, dataFlag, compressedSize };
-        ResourceRegistry->Put(crc32, item);
+        // Entries that don't fit in the file can't be read from the mapping
+        bool mapped = mapping && offset <= mapping->Size && compressedSize <= mapping->Size - offset;
+
+        ResourceRegistryItem item { streamNode, mapped, offset, size, dataFlag, compressedSize };
+        registry->Put(crc32, item);
+
+        if (crc32 == dictionaryHash) {
+            dictionaryItem = item;
+            hasDictionary = true;
+        }
         // Log::Print(Log::LOG_VERBOSE, "%08X: Offset: %08llX Size: %08llX Comp Size: %08llX Data Flag: %08X", crc32, offset, size, compressedSize, dataFlag);
     }
-}
-PUBLIC STATIC bool   ResourceManager::LoadResource(const char* filename, Uint8** out, size_t* size) {
-    Uint8* memory;
-    char resourcePath[4096];
-    ResourceRegistryItem item;
 
-    if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
-        goto DATA_FOLDER;
+    // Entries compressed with DataPackCodec::ZSTD_DICTIONARY use the
+    // dictionary from their own pack
+    if (hasDictionary) {
+        Uint8* dictionary;
+        size_t dictionarySize;
+        if (LoadPackResource(dictionaryItem, dictionaryHash, &dictionary, &dictionarySize)) {
+            streamNode->Dictionary = Zstd::CreateDictionary(dictionary, dictionarySize);
+            Memory::Free(dictionary);
+        }
+        if (!streamNode->Dictionary)
+            Log::Print(Log::LOG_ERROR, "Could not load the Zstd dictionary of \"%s\"!", filename);
+    }
+
+    return streamNode;
+}
+static void ClosePack(StreamNode* pack) {
+    pack->Table->Close();
+    if (pack->Mapping) {
+        // Leave the mapping alone if something can still read from
+        // it; the OS will unmap it when the application exits.
+        if (SDL_AtomicGet(&MappedResourceCount) == 0)
+            pack->Mapping->Close();
+        else
+            Log::Print(Log::LOG_VERBOSE, "Not unmapping data pack, %d resource(s) still open.", SDL_AtomicGet(&MappedResourceCount));
+    }
+#ifdef USING_PREAD
+    if (pack->FileDescriptor >= 0)
+        close(pack->FileDescriptor);
+#endif
+    if (pack->ReadLock)
+        SDL_DestroyMutex(pack->ReadLock);
+    if (pack->Dictionary)
+        Zstd::FreeDictionary(pack->Dictionary);
+    delete pack;
+}
 
+PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     if (!ResourceRegistry)
-        goto DATA_FOLDER;
+        return;
 
-    if (!ResourceRegistry->Exists(filename))
-        goto DATA_FOLDER;
+    // Add stream to list for closure on disposal
+    StreamNode* streamNode = OpenPack(filename, ResourceRegistry);
+    if (streamNode) {
+        streamNode->Next = StreamNodeHead;
+        StreamNodeHead = streamNode;
+    }
+}
 
-    item = ResourceRegistry->Get(filename);
+// Reads part of a data pack. Safe to call from any thread.
+static bool ReadPackData(ResourceRegistryItem& item, void* out, size_t size) {
+    StreamNode* pack = item.Pack;
+    if (pack->Mapping && item.Mapped) {
+        memcpy(out, pack->Mapping->Data + item.Offset, size);
+        return true;
+    }
+
+#ifdef USING_PREAD
+    if (pack->FileDescriptor >= 0) {
+        Uint8* dest = (Uint8*)out;
+        off_t offset = (off_t)item.Offset;
+        while (size > 0) {
+            ssize_t result = pread(pack->FileDescriptor, dest, size, offset);
+            if (result <= 0)
+                return false;
+            dest += result;
+            offset += result;
+            size -= (size_t)result;
+        }
+        return true;
+    }
+#endif
+
+    SDL_LockMutex(pack->ReadLock);
+    pack->Table->Seek(item.Offset);
+    size_t read = pack->Table->ReadBytes(out, size);
+    SDL_UnlockMutex(pack->ReadLock);
+    return read == size;
+}
+static void DecryptResource(Uint8* memory, Uint64 size, Uint32 filenameHash) {
+    Uint8 keyA[16];
+    Uint8 keyB[16];
+    Uint32 sizeHash = CRC32::EncryptData(&size, sizeof(size));
+
+    // Populate Key A
+    Uint32* keyA32 = (Uint32*)&keyA[0];
+    keyA32[0] = filenameHash;
+    keyA32[1] = filenameHash;
+    keyA32[2] = filenameHash;
+    keyA32[3] = filenameHash;
+
+    // Populate Key B
+    Uint32* keyB32 = (Uint32*)&keyB[0];
+    keyB32[0] = sizeHash;
+    keyB32[1] = sizeHash;
+    keyB32[2] = sizeHash;
+    keyB32[3] = sizeHash;
+
+    int swapNibbles = 0;
+    int indexKeyA = 0;
+    int indexKeyB = 8;
+    int xorValue = (size >> 2) & 0x7F;
+    for (Uint32 x = 0; x < size; x++) {
+        Uint8 temp = memory[x];
+
+        temp ^= xorValue ^ keyB[indexKeyB++];
+
+        if (swapNibbles)
+            temp = (((temp & 0x0F) << 4) | ((temp & 0xF0) >> 4));
+
+        temp ^= keyA[indexKeyA++];
+
+        memory[x] = temp;
+
+        if (indexKeyA <= 15) {
+            if (indexKeyB > 12) {
+                indexKeyB = 0;
+                swapNibbles ^= 1;
+            }
+        }
+        else if (indexKeyB <= 8) {
+            indexKeyA = 0;
+            swapNibbles ^= 1;
+        }
+        else {
+            xorValue = (xorValue + 2) & 0x7F;
+            if (swapNibbles) {
+                swapNibbles = false;
+                indexKeyA = xorValue % 7;
+                indexKeyB = (xorValue % 12) + 2;
+            }
+            else {
+                swapNibbles = true;
+                indexKeyA = (xorValue % 12) + 3;
+                indexKeyB = xorValue % 7;
+            }
+        }
+    }
+}
+static bool DecompressResource(ResourceRegistryItem& item, Uint8* in, Uint8* out) {
+    size_t size = (size_t)item.Size;
+    size_t compressedSize = (size_t)item.CompressedSize;
+
+    switch (DATAPACK_CODEC(item.DataFlag)) {
+        case DataPackCodec::ZLIB:
+            // Older packs were never checked, so this only warns
+            if (!ZLibStream::Decompress(out, size, in, compressedSize))
+                Log::Print(Log::LOG_WARN, "zlib data of resource is incomplete!");
+            return true;
+        case DataPackCodec::LZ4:
+            return LZ4::Decompress(in, compressedSize, out, size);
+        case DataPackCodec::ZSTD:
+            return Zstd::Decompress(in, compressedSize, out, size);
+        case DataPackCodec::ZSTD_DICTIONARY:
+            if (!item.Pack->Dictionary)
+                return false;
+            return Zstd::Decompress(in, compressedSize, out, size, item.Pack->Dictionary);
+    }
 
-    memory = (Uint8*)Memory::Malloc(item.Size + 1);
+    Log::Print(Log::LOG_ERROR, "Unknown compression type %d in data pack!", DATAPACK_CODEC(item.DataFlag));
+    return false;
+}
+static bool LoadPackResource(ResourceRegistryItem& item, Uint32 filenameHash, Uint8** out, size_t* size) {
+    Uint8* memory = (Uint8*)Memory::Malloc(item.Size + 1);
     if (!memory)
-        goto DATA_FOLDER;
+        return false;
 
     memory[item.Size] = 0;
 
-    item.Table->Seek(item.Offset);
     if (item.Size != item.CompressedSize) {
-        Uint8* compressedMemory = (Uint8*)Memory::Malloc(item.Size);
-        if (!compressedMemory) {
-            Memory::Free(memory);
-            goto DATA_FOLDER;
+        bool success;
+        if (item.Mapped)
+            success = DecompressResource(item, item.Pack->Mapping->Data + item.Offset, memory);
+        else {
+            Uint8* compressedMemory = (Uint8*)Memory::Malloc(item.CompressedSize);
+            if (!compressedMemory || !ReadPackData(item, compressedMemory, (size_t)item.CompressedSize)) {
+                Memory::Free(compressedMemory);
+                Memory::Free(memory);
+                return false;
+            }
+
+            success = DecompressResource(item, compressedMemory, memory);
+            Memory::Free(compressedMemory);
         }
-        item.Table->ReadBytes(compressedMemory, item.CompressedSize);
 
-        ZLibStream::Decompress(memory, (size_t)item.Size, compressedMemory, (size_t)item.CompressedSize);
-        Memory::Free(compressedMemory);
+        if (!success) {
+            Log::Print(Log::LOG_ERROR, "Could not decompress resource %08X!", filenameHash);
+            Memory::Free(memory);
+            return false;
+        }
     }
-    else {
-        item.Table->ReadBytes(memory, item.Size);
+    else if (!ReadPackData(item, memory, (size_t)item.Size)) {
+        Memory::Free(memory);
+        return false;
     }
 
-    if (item.DataFlag == 2) {
-        Uint8 keyA[16];
-        Uint8 keyB[16];
-        Uint32 filenameHash = CRC32::EncryptString(filename);
-        Uint32 sizeHash = CRC32::EncryptData(&item.Size, sizeof(item.Size));
-
-        // Populate Key A
-        Uint32* keyA32 = (Uint32*)&keyA[0];
-        keyA32[0] = filenameHash;
-        keyA32[1] = filenameHash;
-        keyA32[2] = filenameHash;
-        keyA32[3] = filenameHash;
-
-        // Populate Key B
-        Uint32* keyB32 = (Uint32*)&keyB[0];
-        keyB32[0] = sizeHash;
-        keyB32[1] = sizeHash;
-        keyB32[2] = sizeHash;
-        keyB32[3] = sizeHash;
-
-        int swapNibbles = 0;
-        int indexKeyA = 0;
-        int indexKeyB = 8;
-        int xorValue = (item.Size >> 2) & 0x7F;
-        for (Uint32 x = 0; x < item.Size; x++) {
-            Uint8 temp = memory[x];
-
-            temp ^= xorValue ^ keyB[indexKeyB++];
-
-            if (swapNibbles)
-                temp = (((temp & 0x0F) << 4) | ((temp & 0xF0) >> 4));
-
-            temp ^= keyA[indexKeyA++];
-
-            memory[x] = temp;
-
-            if (indexKeyA <= 15) {
-                if (indexKeyB > 12) {
-                    indexKeyB = 0;
-                    swapNibbles ^= 1;
-                }
-            }
-            else if (indexKeyB <= 8) {
-                indexKeyA = 0;
-                swapNibbles ^= 1;
-            }
-            else {
-                xorValue = (xorValue + 2) & 0x7F;
-                if (swapNibbles) {
-                    swapNibbles = false;
-                    indexKeyA = xorValue % 7;
-                    indexKeyB = (xorValue % 12) + 2;
-                }
-                else {
-                    swapNibbles = true;
-                    indexKeyA = (xorValue % 12) + 3;
-                    indexKeyB = xorValue % 7;
-                }
-            }
-        }
-    }
+    if (DATAPACK_STORAGE(item.DataFlag) == DATAPACK_FLAG_ENCRYPTED)
+        DecryptResource(memory, item.Size, filenameHash);
 
     *out = memory;
     *size = (size_t)item.Size;
     return true;
+}
+
+// LoadResource, MapResource and ResourceExists are safe to call from any
+// thread once the ResourceManager has been initialized.
+PUBLIC STATIC bool   ResourceManager::LoadResource(const char* filename, Uint8** out, size_t* size) {
+    if (!Tracer::Enabled)
+        return ResourceManager::ReadResource(filename, out, size);
+
+    double start = Clock::GetTicks();
+    bool loaded = ResourceManager::ReadResource(filename, out, size);
+    Tracer::Record("resource", filename, start, Clock::GetTicks() - start);
+    return loaded;
+}
+PRIVATE STATIC bool  ResourceManager::ReadResource(const char* filename, Uint8** out, size_t* size) {
+    Uint8* memory;
+    char resourcePath[4096];
+    ResourceRegistryItem item;
+
+    if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
+        goto DATA_FOLDER;
+
+    if (!ResourceRegistry)
+        goto DATA_FOLDER;
+
+    if (!ResourceRegistry->GetIfExists(filename, &item))
+        goto DATA_FOLDER;
+
+    if (LoadPackResource(item, CRC32::EncryptString(filename), out, size)) {
+        RecordLoadOrder(filename);
+        return true;
+    }
 
     DATA_FOLDER:
-    ResourceManager::PrefixResourcePath(resourcePath, sizeof resourcePath, filename);
+    if (!GetDataFolderPath(resourcePath, sizeof resourcePath, filename))
+        return false;
 
     SDL_RWops* rw = SDL_RWFromFile(resourcePath, "rb");
     if (!rw) {
@@ -247,21 +517,93 @@ PUBLIC STATIC bool   ResourceManager::LoadResource(const char* filename, Uint8**
     Sint64 rwSize = SDL_RWsize(rw);
     if (rwSize < 0) {
         Log::Print(Log::LOG_ERROR, "Could not get size of file \"%s\": %s", resourcePath, SDL_GetError());
+        SDL_RWclose(rw);
         return false;
     }
 
     memory = (Uint8*)Memory::Malloc(rwSize + 1);
-    if (!memory)
+    if (!memory) {
+        SDL_RWclose(rw);
         return false;
+    }
     memory[rwSize] = 0;
 
     SDL_RWread(rw, memory, rwSize, 1);
     SDL_RWclose(rw);
 
+    RecordLoadOrder(filename);
+
     *out = memory;
     *size = rwSize;
     return true;
 }
+// Loads a resource from the data packs by the CRC32 of its filename.
+PUBLIC STATIC bool   ResourceManager::LoadResource(Uint32 filenameHash, Uint8** out, size_t* size) {
+    ResourceRegistryItem item;
+    if (!ResourceRegistry || !ResourceRegistry->GetIfExists(filenameHash, &item))
+        return false;
+
+    return LoadPackResource(item, filenameHash, out, size);
+}
+// Reads every entry of a data pack without adding it to the ones resources
+// are loaded from, for checking a pack that was just written. The callback
+// gets each entry's filename hash and contents, or NULL if it couldn't be
+// read, and must free them. Returns false if the pack couldn't be opened.
+PUBLIC STATIC bool   ResourceManager::ReadDataPack(const char* filename, std::function<void(Uint32, Uint8*, size_t)> callback) {
+    HashMap<ResourceRegistryItem>* registry = new HashMap<ResourceRegistryItem>(CRC32::EncryptData, 16);
+    StreamNode* pack = OpenPack(filename, registry);
+    if (!pack) {
+        delete registry;
+        return false;
+    }
+
+    registry->WithAll([callback](Uint32 hash, ResourceRegistryItem item) -> void {
+        Uint8* data;
+        size_t size;
+        if (LoadPackResource(item, hash, &data, &size))
+            callback(hash, data, size);
+        else
+            callback(hash, NULL, 0);
+    });
+
+    delete registry;
+    ClosePack(pack);
+    return true;
+}
+PUBLIC STATIC vector<Uint32> ResourceManager::GetResourceHashes() {
+    vector<Uint32> hashes;
+    if (ResourceRegistry) {
+        ResourceRegistry->WithAll([&hashes](Uint32 hash, ResourceRegistryItem item) -> void {
+            hashes.push_back(hash);
+        });
+    }
+    return hashes;
+}
+// Gets a read-only view of a resource that's stored as-is in a memory
+// mapped data pack, without copying it. Returns false if the resource has to
+// be loaded with LoadResource instead. Every view must be released with
+// ReleaseMappedResource.
+PUBLIC STATIC bool   ResourceManager::MapResource(const char* filename, Uint8** out, size_t* size) {
+    if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
+        return false;
+
+    ResourceRegistryItem item;
+    if (!ResourceRegistry || !ResourceRegistry->GetIfExists(filename, &item))
+        return false;
+
+    if (!item.Mapped || DATAPACK_STORAGE(item.DataFlag) == DATAPACK_FLAG_ENCRYPTED || item.Size != item.CompressedSize)
+        return false;
+
+    SDL_AtomicAdd(&MappedResourceCount, 1);
+    RecordLoadOrder(filename);
+
+    *out = item.Pack->Mapping->Data + item.Offset;
+    *size = (size_t)item.Size;
+    return true;
+}
+PUBLIC STATIC void   ResourceManager::ReleaseMappedResource() {
+    SDL_AtomicAdd(&MappedResourceCount, -1);
+}
 PUBLIC STATIC bool   ResourceManager::ResourceExists(const char* filename) {
     char resourcePath[4096];
     if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
@@ -276,7 +618,8 @@ PUBLIC STATIC bool   ResourceManager::ResourceExists(const char* filename) {
     return true;
 
     DATA_FOLDER:
-    ResourceManager::PrefixResourcePath(resourcePath, sizeof resourcePath, filename);
+    if (!GetDataFolderPath(resourcePath, sizeof resourcePath, filename))
+        return false;
 
     SDL_RWops* rw = SDL_RWFromFile(resourcePath, "rb");
     if (!rw) {
@@ -290,12 +633,27 @@ PUBLIC STATIC void   ResourceManager::Dispose() {
         for (StreamNode *old, *streamNode = StreamNodeHead; streamNode; ) {
             old = streamNode;
             streamNode = streamNode->Next;
-
-            old->Table->Close();
-            delete old;
+            ClosePack(old);
         }
     }
     if (ResourceRegistry) {
         delete ResourceRegistry;
     }
+
+    StreamNodeHead = NULL;
+    ResourceRegistry = NULL;
+
+    if (LoadOrderFile) {
+        fclose(LoadOrderFile);
+        SDL_DestroyMutex(LoadOrderLock);
+        delete LoadOrderSeen;
+        LoadOrderFile = NULL;
+        LoadOrderLock = NULL;
+        LoadOrderSeen = NULL;
+    }
+
+    if (DataFolderIndex) {
+        delete DataFolderIndex;
+        DataFolderIndex = NULL;
+    }
 }
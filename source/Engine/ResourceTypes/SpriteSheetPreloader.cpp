@@ -0,0 +1,305 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class SpriteSheetPreloader {
+public:
+    static bool   Enabled;
+    static char   ManifestPath[4096];
+
+    // Main thread time spent on sprite sheets since the last Begin, in
+    // milliseconds
+    static double DecodeTime;
+    static double WaitTime;
+    static double UploadTime;
+    static Uint32 PreloadedCount;
+    static Uint32 DecodedCount;
+};
+#endif
+
+#include <Engine/ResourceTypes/SpriteSheetPreloader.h>
+#include <Engine/Graphics.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/ResourceTypes/Image.h>
+#include <Engine/Utilities/StringUtils.h>
+#include <Engine/Utilities/WorkerPool.h>
+
+// Decodes the sprite sheets a scene is going to need on the worker pool
+// while the scene loads, so that ISprite::AddSpriteSheet only has to create
+// their textures. Which sheets a scene needs isn't known until its objects
+// load their sprites, so every sheet asked for while a scene is current is
+// written to a manifest, and preloaded the next time that scene loads.
+//
+// The manifest is a text file with a line for every sheet:
+//     <scene filename> <tab> <sheet filename>
+
+enum {
+    PRELOAD_QUEUED,
+    PRELOAD_LOADING,
+    PRELOAD_DONE,
+    // Taken over by the main thread, or cancelled
+    PRELOAD_CLAIMED,
+};
+
+struct PreloadedSheet {
+    char*        Filename;
+    SDL_atomic_t State;
+    // Held by Sheets and by the queued job
+    SDL_atomic_t References;
+    Uint32*      Pixels;
+    Uint32       Width;
+    Uint32       Height;
+    Uint32*      PaletteColors;
+    unsigned     NumPaletteColors;
+};
+
+bool   SpriteSheetPreloader::Enabled = false;
+char   SpriteSheetPreloader::ManifestPath[4096];
+
+double SpriteSheetPreloader::DecodeTime = 0.0;
+double SpriteSheetPreloader::WaitTime = 0.0;
+double SpriteSheetPreloader::UploadTime = 0.0;
+Uint32 SpriteSheetPreloader::PreloadedCount = 0;
+Uint32 SpriteSheetPreloader::DecodedCount = 0;
+
+static SDL_mutex*              Lock = NULL;
+static SDL_cond*               SheetDone = NULL;
+static vector<PreloadedSheet*> Sheets;
+
+// Scene filename hash to the sheets it used
+static map<Uint32, vector<string>> Manifest;
+static map<Uint32, string>         ManifestScenes;
+static Uint32                      CurrentScene = 0;
+static bool                        ManifestChanged = false;
+
+static void ReleaseSheet(PreloadedSheet* sheet) {
+    if (!SDL_AtomicDecRef(&sheet->References))
+        return;
+
+    Memory::Free(sheet->Pixels);
+    Memory::Free(sheet->PaletteColors);
+    Memory::Free(sheet->Filename);
+    delete sheet;
+}
+
+static void PreloadJob(void* data) {
+    PreloadedSheet* sheet = (PreloadedSheet*)data;
+    if (SDL_AtomicCAS(&sheet->State, PRELOAD_QUEUED, PRELOAD_LOADING)) {
+        sheet->Pixels = Image::DecodeResource(sheet->Filename, &sheet->Width, &sheet->Height, &sheet->PaletteColors, &sheet->NumPaletteColors);
+
+        SDL_LockMutex(Lock);
+        SDL_AtomicSet(&sheet->State, PRELOAD_DONE);
+        SDL_CondBroadcast(SheetDone);
+        SDL_UnlockMutex(Lock);
+    }
+    ReleaseSheet(sheet);
+}
+
+// Waits for a sheet's job if it's running, and claims it. Returns true if
+// the job finished, false if it never started.
+static bool ClaimSheet(PreloadedSheet* sheet) {
+    if (SDL_AtomicCAS(&sheet->State, PRELOAD_QUEUED, PRELOAD_CLAIMED))
+        return false;
+
+    SDL_LockMutex(Lock);
+    while (SDL_AtomicGet(&sheet->State) == PRELOAD_LOADING)
+        SDL_CondWait(SheetDone, Lock);
+    SDL_UnlockMutex(Lock);
+
+    SDL_AtomicSet(&sheet->State, PRELOAD_CLAIMED);
+    return true;
+}
+// Drops every sheet that wasn't used
+static void ClearSheets() {
+    for (size_t i = 0; i < Sheets.size(); i++) {
+        ClaimSheet(Sheets[i]);
+        ReleaseSheet(Sheets[i]);
+    }
+    Sheets.clear();
+}
+
+static void LoadManifest() {
+    FileStream* stream = FileStream::New(SpriteSheetPreloader::ManifestPath, FileStream::READ_ACCESS);
+    if (!stream)
+        return;
+
+    size_t size = stream->Length();
+    char* text = (char*)Memory::Malloc(size + 1);
+    stream->ReadBytes(text, size);
+    stream->Close();
+    text[size] = 0;
+
+    for (char* line = text; line && *line;) {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+
+        char* tab = strchr(line, '\t');
+        if (tab) {
+            *tab = 0;
+            size_t length = strcspn(tab + 1, "\r");
+            tab[1 + length] = 0;
+
+            Uint32 sceneHash = CRC32::EncryptString(line);
+            ManifestScenes[sceneHash] = line;
+            Manifest[sceneHash].push_back(tab + 1);
+        }
+        line = next;
+    }
+    Memory::Free(text);
+}
+static void SaveManifest() {
+    if (!ManifestChanged)
+        return;
+
+    FileStream* stream = FileStream::New(SpriteSheetPreloader::ManifestPath, FileStream::WRITE_ACCESS);
+    if (!stream) {
+        Log::Print(Log::LOG_WARN, "Could not write sprite sheet manifest \"%s\"!", SpriteSheetPreloader::ManifestPath);
+        return;
+    }
+
+    for (auto& scene : Manifest) {
+        string& sceneName = ManifestScenes[scene.first];
+        for (string& sheet : scene.second) {
+            string line = sceneName + "\t" + sheet + "\n";
+            stream->WriteBytes((void*)line.c_str(), line.size());
+        }
+    }
+    stream->Close();
+    ManifestChanged = false;
+}
+
+// Reads the manifest. Without a path set, it's kept in the user's
+// preferences folder.
+PUBLIC STATIC void SpriteSheetPreloader::Init() {
+    if (!Enabled)
+        return;
+
+    if (!ManifestPath[0]) {
+        char* prefPath = SDL_GetPrefPath("aknetk", TARGET_NAME);
+        if (!prefPath) {
+            Log::Print(Log::LOG_WARN, "Could not find a folder for the sprite sheet manifest, disabling preloading.");
+            Enabled = false;
+            return;
+        }
+        snprintf(ManifestPath, sizeof ManifestPath, "%sSpriteSheets.txt", prefPath);
+        SDL_free(prefPath);
+    }
+
+    if (!Lock) {
+        Lock = SDL_CreateMutex();
+        SheetDone = SDL_CreateCond();
+    }
+
+    Manifest.clear();
+    ManifestScenes.clear();
+    LoadManifest();
+}
+
+// Starts decoding the sheets the scene used last time, skipping any that are
+// loaded already.
+PUBLIC STATIC void SpriteSheetPreloader::Begin(const char* sceneFilename) {
+    DecodeTime = 0.0;
+    WaitTime = 0.0;
+    UploadTime = 0.0;
+    PreloadedCount = 0;
+    DecodedCount = 0;
+
+    if (!Enabled)
+        return;
+
+    ClearSheets();
+    SaveManifest();
+
+    CurrentScene = CRC32::EncryptString(sceneFilename);
+    ManifestScenes[CurrentScene] = sceneFilename;
+
+    auto it = Manifest.find(CurrentScene);
+    if (it == Manifest.end())
+        return;
+
+    for (string& filename : it->second) {
+        if (Graphics::SpriteSheetTextureMap->Exists(filename.c_str()))
+            continue;
+
+        PreloadedSheet* sheet = new PreloadedSheet();
+        sheet->Filename = StringUtils::Duplicate(filename.c_str());
+        sheet->Pixels = NULL;
+        sheet->PaletteColors = NULL;
+        sheet->NumPaletteColors = 0;
+        SDL_AtomicSet(&sheet->State, PRELOAD_QUEUED);
+        SDL_AtomicSet(&sheet->References, 2);
+
+        // Without workers, AddSpriteSheet decodes it like it normally would
+        if (!WorkerPool::QueueJob(PreloadJob, sheet)) {
+            Memory::Free(sheet->Filename);
+            delete sheet;
+            break;
+        }
+        Sheets.push_back(sheet);
+    }
+}
+
+// Remembers that the current scene needed this sheet. Sheets that are loaded
+// already count too, since they might not be the next time.
+PUBLIC STATIC void SpriteSheetPreloader::Record(const char* filename) {
+    if (!Enabled || !CurrentScene)
+        return;
+
+    vector<string>& sheets = Manifest[CurrentScene];
+    for (size_t i = 0; i < sheets.size(); i++) {
+        if (sheets[i] == filename)
+            return;
+    }
+    sheets.push_back(filename);
+    ManifestChanged = true;
+}
+
+// Hands over the pixels of a preloaded sheet, waiting for them if they're
+// still being decoded. Returns false if the sheet wasn't preloaded, or
+// couldn't be.
+PUBLIC STATIC bool SpriteSheetPreloader::Take(const char* filename, Uint32** pixels, Uint32* width, Uint32* height, Uint32** paletteColors, unsigned* numPaletteColors) {
+    for (size_t i = 0; i < Sheets.size(); i++) {
+        PreloadedSheet* sheet = Sheets[i];
+        if (strcmp(sheet->Filename, filename))
+            continue;
+
+        Sheets.erase(Sheets.begin() + i);
+
+        double ticks = Clock::GetTicks();
+        bool finished = ClaimSheet(sheet);
+        WaitTime += Clock::GetTicks() - ticks;
+
+        bool success = finished && sheet->Pixels;
+        if (success) {
+            *pixels = sheet->Pixels;
+            *width = sheet->Width;
+            *height = sheet->Height;
+            *paletteColors = sheet->PaletteColors;
+            *numPaletteColors = sheet->NumPaletteColors;
+            sheet->Pixels = NULL;
+            sheet->PaletteColors = NULL;
+            PreloadedCount++;
+        }
+        ReleaseSheet(sheet);
+        return success;
+    }
+    return false;
+}
+
+PUBLIC STATIC void SpriteSheetPreloader::Dispose() {
+    if (!Lock)
+        return;
+
+    ClearSheets();
+    SaveManifest();
+
+    SDL_DestroyCond(SheetDone);
+    SDL_DestroyMutex(Lock);
+    SheetDone = NULL;
+    Lock = NULL;
+}
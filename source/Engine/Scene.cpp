@@ -137,14 +137,17 @@ public:
 
 #include <Engine/Audio/AudioManager.h>
 #include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Bytecode/ScriptJobs.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/GarbageCollector.h>
 #include <Engine/Bytecode/SourceFileMap.h>
+#include <Engine/Bytecode/SourceFileWatcher.h>
 #include <Engine/Bytecode/Compiler.h>
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Diagnostics/MemoryPools.h>
+#include <Engine/Diagnostics/Tracer.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Hashing/CombinedHash.h>
 #include <Engine/Hashing/CRC32.h>
@@ -159,7 +162,9 @@ public:
 #include <Engine/ResourceTypes/SceneFormats/HatchSceneReader.h>
 #include <Engine/ResourceTypes/SceneFormats/RSDKSceneReader.h>
 #include <Engine/ResourceTypes/ISound.h>
+#include <Engine/ResourceTypes/ResourceCache.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/SpriteSheetPreloader.h>
 #include <Engine/ResourceTypes/SceneFormats/TiledMapReader.h>
 #include <Engine/Rendering/SDL2/SDL2Renderer.h>
 #include <Engine/Scene/SceneInfo.h>
@@ -316,8 +321,10 @@ void UpdateObjectEarly(Entity* ent) {
 
     elapsed = Clock::GetTicks() - elapsed;
 
-    if (ent->List)
+    if (ent->List) {
         ent->List->Performance.EarlyUpdate.DoAverage(elapsed);
+        TRACE_ELAPSED("UpdateEarly", ent->List->ObjectName, elapsed);
+    }
 }
 void UpdateObjectLate(Entity* ent) {
     if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
@@ -333,8 +340,10 @@ void UpdateObjectLate(Entity* ent) {
 
     elapsed = Clock::GetTicks() - elapsed;
 
-    if (ent->List)
+    if (ent->List) {
         ent->List->Performance.LateUpdate.DoAverage(elapsed);
+        TRACE_ELAPSED("UpdateLate", ent->List->ObjectName, elapsed);
+    }
 }
 void UpdateObject(Entity* ent) {
     if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
@@ -455,8 +464,10 @@ void UpdateObject(Entity* ent) {
 
         elapsed = Clock::GetTicks() - elapsed;
 
-        if (ent->List)
+        if (ent->List) {
             ent->List->Performance.Update.DoAverage(elapsed);
+            TRACE_ELAPSED("Update", ent->List->ObjectName, elapsed);
+        }
 
         ent->WasOffScreen = false;
     }
@@ -677,6 +688,7 @@ PUBLIC STATIC void Scene::Init() {
     Compiler::Init();
 
     SourceFileMap::CheckForUpdate();
+    SourceFileWatcher::Init();
 
     Application::GameStart = true;
 
@@ -923,7 +935,8 @@ PUBLIC STATIC bool Scene::CheckPosOnScreen(float posX, float posY, float rangeX,
 }
 
 #define PERF_START(n) if (viewPerf) viewPerf->n = Clock::GetTicks()
-#define PERF_END(n) if (viewPerf) viewPerf->n = Clock::GetTicks() - viewPerf->n
+#define PERF_END_AS(n, name) if (viewPerf) { viewPerf->n = Clock::GetTicks() - viewPerf->n; TRACE_ELAPSED("view", name, viewPerf->n); }
+#define PERF_END(n) PERF_END_AS(n, #n)
 
 PUBLIC STATIC void Scene::RenderView(int viewIndex, bool doPerf) {
     View* currentView = &Scene::Views[viewIndex];
@@ -1100,8 +1113,10 @@ DoCheckRender:
 
                 elapsed = Clock::GetTicks() - elapsed;
 
-                if (ent->List)
+                if (ent->List) {
                     ent->List->Performance.Render.DoAverage(elapsed);
+                    TRACE_ELAPSED("Render", ent->List->ObjectName, elapsed);
+                }
             }
         }
         objectTime = Clock::GetTicks() - objectTime;
@@ -1144,7 +1159,7 @@ DoCheckRender:
 
                 Graphics::Restore();
 
-                PERF_END(LayerTileRenderTime[li]);
+                PERF_END_AS(LayerTileRenderTime[li], layer->Name);
             }
         }
         Graphics::TextureBlend = texBlend;
@@ -1279,6 +1294,8 @@ PUBLIC STATIC void Scene::Render() {
 
 PUBLIC STATIC void Scene::AfterScene() {
     ScriptManager::ResetStack();
+    ScriptJobs::Update();
+    SourceFileWatcher::Update();
     ScriptManager::RequestGarbageCollection();
 
     bool& doRestart = Scene::DoRestart;
@@ -1509,6 +1526,8 @@ PRIVATE STATIC void Scene::DeleteAllObjects() {
     }
 }
 PUBLIC STATIC void Scene::LoadScene(const char* filename) {
+    double loadStartTicks = Clock::GetTicks();
+
     // Remove non-persistent objects from lists
     if (Scene::ObjectLists) {
         Scene::ObjectLists->ForAll([](Uint32, ObjectList* list) -> void {
@@ -1595,6 +1614,11 @@ PUBLIC STATIC void Scene::LoadScene(const char* filename) {
         Scene::Layers[i].Dispose();
     Scene::Layers.clear();
 
+    // Start decoding the sprite sheets this scene used last time
+    double preloadStartTicks = Clock::GetTicks();
+    SpriteSheetPreloader::Begin(filename);
+    double readStartTicks = Clock::GetTicks();
+
     // Load Static class
     if (Application::GameStart)
         Scene::AddStaticClass();
@@ -1645,6 +1669,18 @@ PUBLIC STATIC void Scene::LoadScene(const char* filename) {
     }
 
     Scene::Loaded = false;
+
+    double endTicks = Clock::GetTicks();
+    double sheetTime = SpriteSheetPreloader::DecodeTime + SpriteSheetPreloader::WaitTime + SpriteSheetPreloader::UploadTime;
+    Log::Print(Log::LOG_VERBOSE, "Scene load took %.3f ms:", endTicks - loadStartTicks);
+    Log::Print(Log::LOG_VERBOSE, "    Cleanup:              %8.3f ms", preloadStartTicks - loadStartTicks);
+    Log::Print(Log::LOG_VERBOSE, "    Sprite sheet preload: %8.3f ms", readStartTicks - preloadStartTicks);
+    Log::Print(Log::LOG_VERBOSE, "    Scene and objects:    %8.3f ms", endTicks - readStartTicks - sheetTime);
+    Log::Print(Log::LOG_VERBOSE, "    Sprite sheets:        %8.3f ms (%u decoded, %u preloaded)",
+        sheetTime, SpriteSheetPreloader::DecodedCount, SpriteSheetPreloader::PreloadedCount);
+    Log::Print(Log::LOG_VERBOSE, "        Decoding:         %8.3f ms", SpriteSheetPreloader::DecodeTime);
+    Log::Print(Log::LOG_VERBOSE, "        Waiting:          %8.3f ms", SpriteSheetPreloader::WaitTime);
+    Log::Print(Log::LOG_VERBOSE, "        Textures:         %8.3f ms", SpriteSheetPreloader::UploadTime);
 }
 
 PUBLIC STATIC void Scene::ProcessSceneTimer() {
@@ -2430,11 +2466,23 @@ PUBLIC STATIC ISprite* Scene::GetSpriteResource(int index) {
 }
 
 PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
+    // Resources going out of scene scope can be kept in the resource cache,
+    // in case the next scene needs them again. It's emptied when the game
+    // scope ends.
+    bool useCache = scope == SCOPE_SCENE;
+    if (!useCache)
+        ResourceCache::Clear();
+
     // Images
     for (size_t i = 0, i_sz = Scene::ImageList.size(); i < i_sz; i++) {
         if (!Scene::ImageList[i]) continue;
         if (Scene::ImageList[i]->UnloadPolicy > scope) continue;
 
+        if (useCache && ResourceCache::Store(ResourceCache::CACHE_IMAGE, Scene::ImageList[i])) {
+            Scene::ImageList[i] = NULL;
+            continue;
+        }
+
         Scene::ImageList[i]->AsImage->Dispose();
         delete Scene::ImageList[i]->AsImage;
         delete Scene::ImageList[i];
@@ -2445,6 +2493,11 @@ PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
         if (!Scene::SpriteList[i]) continue;
         if (Scene::SpriteList[i]->UnloadPolicy > scope) continue;
 
+        if (useCache && ResourceCache::Store(ResourceCache::CACHE_SPRITE, Scene::SpriteList[i])) {
+            Scene::SpriteList[i] = NULL;
+            continue;
+        }
+
         Scene::SpriteList[i]->AsSprite->Dispose();
         delete Scene::SpriteList[i]->AsSprite;
         delete Scene::SpriteList[i];
@@ -2455,6 +2508,11 @@ PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
         if (!Scene::ModelList[i]) continue;
         if (Scene::ModelList[i]->UnloadPolicy > scope) continue;
 
+        if (useCache && ResourceCache::Store(ResourceCache::CACHE_MODEL, Scene::ModelList[i])) {
+            Scene::ModelList[i] = NULL;
+            continue;
+        }
+
         Scene::ModelList[i]->AsModel->Dispose();
         delete Scene::ModelList[i]->AsModel;
         delete Scene::ModelList[i];
@@ -2469,6 +2527,11 @@ PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
         if (!Scene::SoundList[i]) continue;
         if (Scene::SoundList[i]->UnloadPolicy > scope) continue;
 
+        if (useCache && ResourceCache::Store(ResourceCache::CACHE_SOUND, Scene::SoundList[i])) {
+            Scene::SoundList[i] = NULL;
+            continue;
+        }
+
         Scene::SoundList[i]->AsSound->Dispose();
         delete Scene::SoundList[i]->AsSound;
         delete Scene::SoundList[i];
@@ -2541,6 +2604,7 @@ PUBLIC STATIC void Scene::Dispose() {
     }
 
     Scene::DisposeInScope(SCOPE_GAME);
+    ResourceCache::Dispose();
     // Dispose of all resources
     Scene::ImageList.clear();
     Scene::SpriteList.clear();
@@ -2607,6 +2671,7 @@ PUBLIC STATIC void Scene::Dispose() {
         delete Scene::Properties;
     Scene::Properties = NULL;
 
+    SourceFileWatcher::Dispose();
     ScriptManager::Dispose();
     SourceFileMap::Dispose();
     Compiler::Dispose();
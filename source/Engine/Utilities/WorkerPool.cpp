@@ -0,0 +1,219 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class WorkerPool {
+public:
+    typedef void (*RangeFunction)(void* data, Uint32 start, Uint32 end);
+    typedef void (*JobFunction)(void* data);
+
+    static int ThreadCount;
+};
+#endif
+
+#include <Engine/Utilities/WorkerPool.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+
+// Persistent threads that split loops over large arrays with the calling
+// thread. The range is handed out in batches, so threads that finish early
+// just take more of them. Between loops, the threads also run queued
+// background jobs, one at a time each.
+
+int WorkerPool::ThreadCount = -1;
+
+static SDL_Thread**  Threads = NULL;
+static int           NumThreads = 0;
+static SDL_mutex*    Lock = NULL;
+static SDL_cond*     TaskReady = NULL;
+static SDL_cond*     TaskDone = NULL;
+static bool          Running = false;
+static SDL_atomic_t  Busy;
+
+// The current task. It's only written to while no workers are active.
+static WorkerPool::RangeFunction TaskFunction = NULL;
+static void*         TaskData = NULL;
+static Uint32        TaskCount = 0;
+static Uint32        TaskBatchSize = 0;
+static Uint32        TaskBatchCount = 0;
+static Uint32        TaskID = 0;
+static SDL_atomic_t  TaskNextBatch;
+static int           ActiveWorkers = 0;
+
+struct QueuedJob {
+    WorkerPool::JobFunction Function;
+    void*                   Data;
+};
+
+// Background jobs, guarded by Lock
+static deque<QueuedJob>  Jobs;
+
+static void RunBatches() {
+    for (;;) {
+        Uint32 batch = (Uint32)SDL_AtomicAdd(&TaskNextBatch, 1);
+        if (batch >= TaskBatchCount)
+            break;
+
+        Uint32 start = batch * TaskBatchSize;
+        Uint32 end = start + TaskBatchSize;
+        if (end > TaskCount)
+            end = TaskCount;
+
+        TaskFunction(TaskData, start, end);
+    }
+}
+static int WorkerThread(void* data) {
+    Uint32 lastTask = 0;
+
+    SDL_LockMutex(Lock);
+    for (;;) {
+        while (Running && TaskID == lastTask && Jobs.empty())
+            SDL_CondWait(TaskReady, Lock);
+
+        // Loops come first, since the thread that started them is waiting
+        if (Running && TaskID != lastTask) {
+            lastTask = TaskID;
+            ActiveWorkers++;
+            SDL_UnlockMutex(Lock);
+
+            RunBatches();
+
+            SDL_LockMutex(Lock);
+            if (--ActiveWorkers == 0)
+                SDL_CondSignal(TaskDone);
+            continue;
+        }
+
+        // Jobs that were queued before Dispose still get to run
+        if (Jobs.empty())
+            break;
+
+        QueuedJob job = Jobs.front();
+        Jobs.pop_front();
+        SDL_UnlockMutex(Lock);
+
+        job.Function(job.Data);
+
+        SDL_LockMutex(Lock);
+    }
+    SDL_UnlockMutex(Lock);
+
+    return 0;
+}
+
+PUBLIC STATIC void WorkerPool::Init() {
+    if (Running)
+        return;
+
+    // Leave a core for the main thread (and another for audio)
+    int threadCount = ThreadCount;
+    if (threadCount < 0) {
+        threadCount = SDL_GetCPUCount() - 2;
+        if (threadCount > 8)
+            threadCount = 8;
+    }
+    if (threadCount <= 0)
+        return;
+
+    Lock = SDL_CreateMutex();
+    TaskReady = SDL_CreateCond();
+    TaskDone = SDL_CreateCond();
+    SDL_AtomicSet(&Busy, 0);
+    Running = true;
+
+    Threads = (SDL_Thread**)Memory::TrackedCalloc("WorkerPool::Threads", threadCount, sizeof(SDL_Thread*));
+    for (NumThreads = 0; NumThreads < threadCount; NumThreads++) {
+        char name[16];
+        snprintf(name, sizeof(name), "Worker%d", NumThreads);
+        Threads[NumThreads] = SDL_CreateThread(WorkerThread, name, NULL);
+        if (!Threads[NumThreads])
+            break;
+    }
+
+    Log::Print(Log::LOG_VERBOSE, "Worker pool started with %d thread(s).", NumThreads);
+}
+PUBLIC STATIC void WorkerPool::Dispose() {
+    if (!Running)
+        return;
+
+    SDL_LockMutex(Lock);
+    Running = false;
+    SDL_CondBroadcast(TaskReady);
+    SDL_UnlockMutex(Lock);
+
+    for (int i = 0; i < NumThreads; i++)
+        SDL_WaitThread(Threads[i], NULL);
+
+    Memory::Free(Threads);
+    SDL_DestroyCond(TaskReady);
+    SDL_DestroyCond(TaskDone);
+    SDL_DestroyMutex(Lock);
+
+    Threads = NULL;
+    NumThreads = 0;
+    Lock = NULL;
+    TaskReady = NULL;
+    TaskDone = NULL;
+}
+
+PUBLIC STATIC int WorkerPool::GetThreadCount() {
+    return NumThreads;
+}
+
+// Calls function for every [start, end) range of at most batchSize items
+// between 0 and count, and returns once all of them are done. The calling
+// thread works on it too. If the pool is already in use (for example, when
+// called from inside a worker), the whole range runs on the calling thread.
+PUBLIC STATIC void WorkerPool::ParallelFor(RangeFunction function, void* data, Uint32 count, Uint32 batchSize) {
+    if (count == 0)
+        return;
+    if (batchSize == 0)
+        batchSize = 1;
+
+    if (NumThreads == 0 || count <= batchSize || !SDL_AtomicCAS(&Busy, 0, 1)) {
+        function(data, 0, count);
+        return;
+    }
+
+    SDL_LockMutex(Lock);
+    // A worker that woke up late for the previous task could still be running
+    while (ActiveWorkers > 0)
+        SDL_CondWait(TaskDone, Lock);
+
+    TaskFunction = function;
+    TaskData = data;
+    TaskCount = count;
+    TaskBatchSize = batchSize;
+    TaskBatchCount = (count + batchSize - 1) / batchSize;
+    SDL_AtomicSet(&TaskNextBatch, 0);
+    TaskID++;
+    SDL_CondBroadcast(TaskReady);
+    SDL_UnlockMutex(Lock);
+
+    RunBatches();
+
+    SDL_LockMutex(Lock);
+    while (ActiveWorkers > 0)
+        SDL_CondWait(TaskDone, Lock);
+    SDL_UnlockMutex(Lock);
+
+    SDL_AtomicSet(&Busy, 0);
+}
+
+// Runs function on one of the threads at some point, without waiting for
+// it. Returns false if there are no threads to run it on, in which case the
+// caller has to run it itself.
+PUBLIC STATIC bool WorkerPool::QueueJob(JobFunction function, void* data) {
+    if (NumThreads == 0)
+        return false;
+
+    QueuedJob job;
+    job.Function = function;
+    job.Data = data;
+
+    SDL_LockMutex(Lock);
+    Jobs.push_back(job);
+    SDL_CondSignal(TaskReady);
+    SDL_UnlockMutex(Lock);
+    return true;
+}
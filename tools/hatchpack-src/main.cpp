@@ -0,0 +1,252 @@
+// hatchpack: builds a data pack (.hatch) out of a resource folder.
+//
+// Packs with the engine's own DataPackWriter, so whatever it writes is what
+// ResourceManager reads. It can also decode every PNG ahead of time into
+// entries for the engine's decoded image cache. See PrintUsage for the
+// options.
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/IO/Compression/LZ4.h>
+#include <Engine/ResourceTypes/DataPackWriter.h>
+#include <Engine/ResourceTypes/ImageCacheFormat.h>
+
+#define SPNG_STATIC
+#include <Libraries/spng.h>
+
+#include <filesystem>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+static bool        Verbose = false;
+static const char* ImageCacheFolder = NULL;
+
+static void PrintUsage() {
+    printf("usage: hatchpack [options] <resource folder> <output.hatch>\n");
+    printf("\n");
+    printf("  --order <file>          Lay out entries in the order they are listed in <file>,\n");
+    printf("                          as recorded with the dev/recordLoadOrder setting\n");
+    printf("  --align <bytes>         Alignment of entries stored uncompressed (default 4096)\n");
+    printf("  --codec <ext>=<codec>   Codec for files ending in .<ext>: none, zlib, lz4 or zstd\n");
+    printf("                          (use * for files that have no other rule)\n");
+    printf("  --level <level>         Zstd compression level (default 19)\n");
+    printf("  --dictionary            Compress small Zstd files with a shared dictionary\n");
+    printf("  --image-cache <folder>  Also decode every PNG into <folder>, for the engine's\n");
+    printf("                          dev/decodedImageCachePath setting\n");
+    printf("  --verbose               List every entry\n");
+}
+
+static void WriteUInt16(vector<Uint8>& out, Uint16 value) {
+    for (int i = 0; i < 2; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+static void WriteUInt32(vector<Uint8>& out, Uint32 value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+
+// Decodes a PNG with spng, the same way the engine's PNG loader does.
+// Returns false if it isn't a PNG it can decode.
+static bool DecodePNG(vector<Uint8>& data, int format, vector<Uint8>& out, spng_ihdr& ihdr, spng_plte& plte) {
+    spng_ctx* ctx = spng_ctx_new(0);
+    if (!ctx)
+        return false;
+
+    size_t limit = 1024 * 1024 * 64;
+    size_t size = 0;
+    spng_set_chunk_limits(ctx, limit, limit);
+    spng_set_png_buffer(ctx, data.data(), data.size());
+
+    bool success = !spng_get_ihdr(ctx, &ihdr)
+        && (ihdr.color_type != SPNG_COLOR_TYPE_INDEXED || !spng_get_plte(ctx, &plte))
+        && !spng_decoded_image_size(ctx, format, &size);
+    if (success) {
+        out.resize(size);
+        success = !spng_decode_image(ctx, out.data(), out.size(), format, SPNG_DECODE_TRNS);
+    }
+    spng_ctx_free(ctx);
+    return success;
+}
+
+static bool WriteImageCacheEntry(const fs::path& folder, vector<Uint8>& source, Uint32 sourceHash, Uint32 width, Uint32 height,
+    vector<Uint32>& palette, vector<Uint8>& pixels) {
+    bool paletted = palette.size() > 0;
+
+    vector<Uint8> compressed(LZ4::CompressBound(pixels.size()));
+    size_t compressedSize = LZ4::Compress(pixels.data(), pixels.size(), compressed.data(), compressed.size());
+    if (compressedSize == 0)
+        return false;
+    compressed.resize(compressedSize);
+
+    vector<Uint8> file;
+    WriteUInt32(file, IMAGECACHE_MAGIC);
+    WriteUInt16(file, IMAGECACHE_VERSION);
+    WriteUInt16(file, paletted ? IMAGECACHE_FLAG_PALETTED : 0);
+    WriteUInt32(file, width);
+    WriteUInt32(file, height);
+    WriteUInt32(file, (Uint32)palette.size());
+    WriteUInt32(file, (Uint32)source.size());
+    WriteUInt32(file, (Uint32)compressedSize);
+    WriteUInt32(file, 0);
+    for (Uint32 color : palette)
+        WriteUInt32(file, color);
+    file.insert(file.end(), compressed.begin(), compressed.end());
+
+    char filename[32];
+    IMAGECACHE_FILENAME(filename, sizeof filename, sourceHash, source.size(), paletted);
+
+    FILE* f = fopen((folder / filename).string().c_str(), "wb");
+    if (!f)
+        return false;
+    bool success = fwrite(file.data(), 1, file.size(), f) == file.size();
+    success &= fclose(f) == 0;
+    return success;
+}
+
+// Writes decoded image cache entries for every PNG. Indexed images get both
+// a paletted entry, which the engine uses when the game enables palettes,
+// and a full color one.
+static bool WriteImageCache(vector<DataPackWriter::Entry>& entries, const fs::path& folder) {
+    std::error_code error;
+    fs::create_directories(folder, error);
+    if (error) {
+        fprintf(stderr, "Could not create \"%s\": %s\n", folder.string().c_str(), error.message().c_str());
+        return false;
+    }
+
+    Uint32 imageCount = 0, fileCount = 0;
+    for (DataPackWriter::Entry& entry : entries) {
+        if (entry.Original || DataPackWriter::GetExtension(entry.Path) != "png")
+            continue;
+
+        vector<Uint8> source;
+        if (!DataPackWriter::ReadFile(entry.SourcePath, source))
+            return false;
+
+        spng_ihdr ihdr;
+        spng_plte plte;
+        vector<Uint8> decoded;
+        if (!DecodePNG(source, SPNG_FMT_RGBA8, decoded, ihdr, plte)) {
+            fprintf(stderr, "Could not decode \"%s\", skipping it.\n", entry.Path.c_str());
+            continue;
+        }
+
+        Uint32 width = ihdr.width;
+        Uint32 height = ihdr.height;
+        size_t pixelCount = (size_t)width * height;
+
+        // Full color entries are ARGB
+        vector<Uint32> palette;
+        vector<Uint8> pixels(pixelCount * 4);
+        for (size_t i = 0; i < pixelCount; i++) {
+            Uint8* rgba = &decoded[i * 4];
+            Uint32 argb = ((Uint32)rgba[3] << 24) | (rgba[0] << 16) | (rgba[1] << 8) | rgba[2];
+            for (int b = 0; b < 4; b++)
+                pixels[i * 4 + b] = (argb >> (b * 8)) & 0xFF;
+        }
+        if (!WriteImageCacheEntry(folder, source, entry.ContentHash, width, height, palette, pixels))
+            return false;
+        fileCount++;
+
+        // Paletted entries are one index per pixel, and the palette is
+        // opaque, like the engine loads it
+        if (ihdr.color_type == SPNG_COLOR_TYPE_INDEXED && plte.n_entries <= IMAGECACHE_MAX_PALETTE_COLORS
+            && DecodePNG(source, SPNG_FMT_PNG, decoded, ihdr, plte)) {
+            size_t depth = ihdr.bit_depth;
+            size_t stride = (width * depth + 7) / 8;
+            for (size_t y = 0; y < height; y++) {
+                Uint8* row = &decoded[y * stride];
+                for (size_t x = 0; x < width; x++) {
+                    size_t bit = x * depth;
+                    pixels[y * width + x] = (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+                }
+            }
+            pixels.resize(pixelCount);
+
+            for (Uint32 i = 0; i < plte.n_entries; i++)
+                palette.push_back(0xFF000000U | (plte.entries[i].red << 16) | (plte.entries[i].green << 8) | plte.entries[i].blue);
+
+            if (!WriteImageCacheEntry(folder, source, entry.ContentHash, width, height, palette, pixels))
+                return false;
+            fileCount++;
+        }
+
+        imageCount++;
+        if (Verbose)
+            printf("%08X%08X %s\n", entry.ContentHash, (Uint32)entry.Size, entry.Path.c_str());
+    }
+
+    printf("Decoded %u images into %u image cache entries in \"%s\"\n", imageCount, fileCount, folder.string().c_str());
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    DataPackWriter writer;
+
+    const char* orderFilename = NULL;
+    vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--order") && hasValue)
+            orderFilename = argv[++i];
+        else if (!strcmp(arg, "--align") && hasValue)
+            writer.Alignment = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(arg, "--level") && hasValue)
+            writer.ZstdLevel = atoi(argv[++i]);
+        else if (!strcmp(arg, "--codec") && hasValue) {
+            const char* rule = argv[++i];
+            if (!writer.AddCodecRule(rule)) {
+                fprintf(stderr, "Invalid codec rule \"%s\"!\n", rule);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--dictionary"))
+            writer.UseDictionary = true;
+        else if (!strcmp(arg, "--image-cache") && hasValue)
+            ImageCacheFolder = argv[++i];
+        else if (!strcmp(arg, "--verbose"))
+            Verbose = true;
+        else if (!strcmp(arg, "--help")) {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] == '-' && arg[1] == '-') {
+            fprintf(stderr, "Unknown option \"%s\"!\n", arg);
+            PrintUsage();
+            return 1;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() != 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* resourceFolder = positional[0];
+    const char* outputFilename = positional[1];
+
+    if (orderFilename && !writer.ReadLoadOrder(orderFilename)) {
+        fprintf(stderr, "Could not read load order \"%s\"!\n", orderFilename);
+        return 1;
+    }
+
+    writer.Verbose = Verbose;
+    if (!writer.Write(resourceFolder, outputFilename)) {
+        fprintf(stderr, "%s\n", writer.Error.c_str());
+        return 1;
+    }
+    if (writer.UseDictionary && writer.DictionaryEntry.Size == 0)
+        printf("Not enough small files to train a dictionary, so none was used.\n");
+
+    printf("Packed %u files (%u duplicates) into \"%s\": %llu bytes -> %llu bytes\n",
+        (Uint32)writer.Entries.size(), writer.DuplicateCount, outputFilename,
+        (unsigned long long)writer.TotalSize, (unsigned long long)writer.PackSize);
+
+    if (ImageCacheFolder && !WriteImageCache(writer.Entries, ImageCacheFolder)) {
+        fprintf(stderr, "Could not write the image cache!\n");
+        return 1;
+    }
+    return 0;
+}
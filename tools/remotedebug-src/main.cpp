@@ -0,0 +1,394 @@
+// remotedebug: shows the timings a running game sends with the
+// dev/remoteDebug setting on, as tables that refresh every so often.
+//
+// Every table is averaged over the frames that arrived since it was last
+// printed. See RemoteDebugFormat.h for what the game sends, and PrintUsage
+// for the options.
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Diagnostics/RemoteDebugFormat.h>
+#include <Engine/Network/WebSocketIncludes.h>
+
+#ifndef _WIN32
+    #include <sys/select.h>
+#endif
+
+#include <chrono>
+#include <unordered_map>
+
+static const char* PhaseNames[REMOTEDEBUG_PHASE_COUNT] = {
+    "Event Polling",
+    "Garbage Collector",
+    "Input Polling",
+    "Entity Update",
+    "Clear Time",
+    "World Render Commands",
+    "FPS Counter",
+    "Frame Present Time",
+    "Frame Total Time",
+};
+static const char* ViewPhaseNames[REMOTEDEBUG_VIEW_PHASE_COUNT] = {
+    "Render Setup",
+    "Projection Setup",
+    "Object RenderEarly",
+    "Object Render",
+    "Object RenderLate",
+    "Finish",
+    "Total",
+};
+static const char* ObjectStatNames[REMOTEDEBUG_OBJECT_STAT_COUNT] = {
+    "Update Early",
+    "Update",
+    "Update Late",
+    "Render",
+};
+
+struct Stat {
+    double Total = 0.0;
+    double Max = 0.0;
+
+    void Add(double value) {
+        Total += value;
+        if (value > Max)
+            Max = value;
+    }
+};
+struct ViewStats {
+    Uint32 Frames = 0;
+    Stat   Phases[REMOTEDEBUG_VIEW_PHASE_COUNT];
+    std::unordered_map<Uint32, Stat> Layers;
+};
+struct ObjectStats {
+    Stat   Times[REMOTEDEBUG_OBJECT_STAT_COUNT];
+    Uint16 Counts[REMOTEDEBUG_OBJECT_STAT_COUNT] = { 0 };
+};
+
+// What arrived since the tables were last printed
+struct Window {
+    Uint32 Frames = 0;
+    Uint32 LastFrame = 0;
+    double FPS = 0.0;
+    Stat   Phases[REMOTEDEBUG_PHASE_COUNT];
+    Stat   GarbageCollection;
+    Uint32 FirstCollectCount = 0;
+    Uint32 CollectCount = 0;
+    Uint32 GarbageSize = 0;
+    bool   MemoryTracked = false;
+    Uint32 MemoryUsage = 0;
+    ViewStats Views[256];
+    std::unordered_map<Uint32, ObjectStats> Objects;
+};
+
+static std::unordered_map<Uint32, string> Names;
+static Window Current;
+static int    TopCount = 10;
+
+static void PrintUsage() {
+    printf("usage: remotedebug [options]\n");
+    printf("\n");
+    printf("Connects to a game on this machine that has dev/remoteDebug turned on.\n");
+    printf("\n");
+    printf("  --port <port>        Port the game listens on (default %d, or dev/remoteDebugPort)\n", REMOTEDEBUG_DEFAULT_PORT);
+    printf("  --top <count>        How many object lists and layers to show (default 10)\n");
+    printf("  --interval <ms>      How often to print the tables (default 1000)\n");
+}
+
+struct Reader {
+    const Uint8* Data;
+    size_t       Size;
+    size_t       Position = 0;
+
+    bool Has(size_t count) {
+        return Position + count <= Size;
+    }
+    Uint8 Read8() {
+        return Data[Position++];
+    }
+    Uint16 Read16() {
+        Uint16 value = Data[Position] | (Data[Position + 1] << 8);
+        Position += 2;
+        return value;
+    }
+    Uint32 Read32() {
+        Uint32 value = (Uint32)Data[Position]
+            | ((Uint32)Data[Position + 1] << 8)
+            | ((Uint32)Data[Position + 2] << 16)
+            | ((Uint32)Data[Position + 3] << 24);
+        Position += 4;
+        return value;
+    }
+    double ReadFloat() {
+        Uint32 bits = Read32();
+        float value;
+        memcpy(&value, &bits, sizeof value);
+        return value;
+    }
+};
+
+static const char* GetName(Uint32 id) {
+    auto it = Names.find(id);
+    if (it == Names.end())
+        return "?";
+    return it->second.c_str();
+}
+
+static bool ReadNames(Reader& in) {
+    if (!in.Has(2))
+        return false;
+    Uint16 count = in.Read16();
+    for (Uint16 i = 0; i < count; i++) {
+        if (!in.Has(6))
+            return false;
+        Uint32 id = in.Read32();
+        Uint16 length = in.Read16();
+        if (!in.Has(length))
+            return false;
+        Names[id] = string((const char*)in.Data + in.Position, length);
+        in.Position += length;
+    }
+    return true;
+}
+
+static bool ReadFrame(Reader& in) {
+    Window& w = Current;
+
+    if (!in.Has(4 + 4 * REMOTEDEBUG_PHASE_COUNT + 4 + 4 + 4 + 4 + 1 + 4 + 1))
+        return false;
+
+    w.LastFrame = in.Read32();
+    for (int i = 0; i < REMOTEDEBUG_PHASE_COUNT; i++)
+        w.Phases[i].Add(in.ReadFloat());
+    w.FPS = in.ReadFloat();
+
+    Uint32 collectCount = in.Read32();
+    if (w.Frames == 0)
+        w.FirstCollectCount = collectCount;
+    w.CollectCount = collectCount;
+    w.GarbageCollection.Add(in.ReadFloat());
+    w.GarbageSize = in.Read32();
+    w.MemoryTracked = !!in.Read8();
+    w.MemoryUsage = in.Read32();
+
+    Uint8 viewCount = in.Read8();
+    for (Uint8 v = 0; v < viewCount; v++) {
+        if (!in.Has(1 + 4 * REMOTEDEBUG_VIEW_PHASE_COUNT + 1))
+            return false;
+
+        ViewStats& view = w.Views[in.Read8()];
+        view.Frames++;
+        for (int i = 0; i < REMOTEDEBUG_VIEW_PHASE_COUNT; i++)
+            view.Phases[i].Add(in.ReadFloat());
+
+        Uint8 layerCount = in.Read8();
+        if (!in.Has(layerCount * 8))
+            return false;
+        for (Uint8 l = 0; l < layerCount; l++) {
+            Uint32 id = in.Read32();
+            view.Layers[id].Add(in.ReadFloat());
+        }
+    }
+
+    if (!in.Has(2))
+        return false;
+    Uint16 listCount = in.Read16();
+    if (!in.Has(listCount * (4 + 6 * REMOTEDEBUG_OBJECT_STAT_COUNT)))
+        return false;
+    for (Uint16 l = 0; l < listCount; l++) {
+        ObjectStats& stats = w.Objects[in.Read32()];
+        for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++) {
+            stats.Times[i].Add(in.ReadFloat());
+            stats.Counts[i] = in.Read16();
+        }
+    }
+
+    w.Frames++;
+    return true;
+}
+
+static void PrintTables() {
+    Window& w = Current;
+    double frames = w.Frames ? w.Frames : 1;
+
+    // Clear the terminal and go to its top
+    printf("\x1b[H\x1b[2J");
+    printf("Frame %u, %.1f FPS (%u frames since the last update)\n\n", w.LastFrame, w.FPS, w.Frames);
+
+    printf("%-24s %10s %10s\n", "Phase", "Avg ms", "Max ms");
+    for (int i = 0; i < REMOTEDEBUG_PHASE_COUNT; i++)
+        printf("%-24s %10.3f %10.3f\n", PhaseNames[i], w.Phases[i].Total / frames, w.Phases[i].Max);
+
+    printf("\nGarbage collections: %u (%.3f ms avg, %.3f ms longest frame)   Garbage size: %u KB\n",
+        w.CollectCount - w.FirstCollectCount, w.GarbageCollection.Total / frames, w.GarbageCollection.Max, w.GarbageSize / 1024);
+    if (w.MemoryTracked)
+        printf("Tracked memory: %.1f MB\n", w.MemoryUsage / (1024.0 * 1024.0));
+    else
+        printf("Tracked memory: not tracked\n");
+
+    for (int v = 0; v < 256; v++) {
+        ViewStats& view = w.Views[v];
+        if (!view.Frames)
+            continue;
+
+        double viewFrames = view.Frames;
+        printf("\nView %d\n", v);
+        for (int i = 0; i < REMOTEDEBUG_VIEW_PHASE_COUNT; i++)
+            printf("  %-22s %10.3f %10.3f\n", ViewPhaseNames[i], view.Phases[i].Total / viewFrames, view.Phases[i].Max);
+
+        vector<std::pair<Uint32, Stat>> layers(view.Layers.begin(), view.Layers.end());
+        std::sort(layers.begin(), layers.end(), [](const std::pair<Uint32, Stat>& a, const std::pair<Uint32, Stat>& b) -> bool {
+            return a.second.Total > b.second.Total;
+        });
+        for (size_t i = 0; i < layers.size() && (int)i < TopCount; i++)
+            printf("    > %-18.18s %10.3f %10.3f\n", GetName(layers[i].first), layers[i].second.Total / viewFrames, layers[i].second.Max);
+    }
+
+    vector<std::pair<Uint32, ObjectStats>> objects(w.Objects.begin(), w.Objects.end());
+    auto objectTotal = [](const ObjectStats& stats) -> double {
+        double total = 0.0;
+        for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++)
+            total += stats.Times[i].Total;
+        return total;
+    };
+    std::sort(objects.begin(), objects.end(), [&objectTotal](const std::pair<Uint32, ObjectStats>& a, const std::pair<Uint32, ObjectStats>& b) -> bool {
+        return objectTotal(a.second) > objectTotal(b.second);
+    });
+
+    printf("\n%-24s", "Object (avg mcs, count)");
+    for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++)
+        printf(" %18s", ObjectStatNames[i]);
+    printf(" %10s\n", "Total");
+    for (size_t o = 0; o < objects.size() && (int)o < TopCount; o++) {
+        ObjectStats& stats = objects[o].second;
+        printf("%-24.24s", GetName(objects[o].first));
+        for (int i = 0; i < REMOTEDEBUG_OBJECT_STAT_COUNT; i++)
+            printf(" %10.1f (%5u)", stats.Times[i].Total / frames, stats.Counts[i]);
+        printf(" %10.1f\n", objectTotal(stats) / frames);
+    }
+
+    fflush(stdout);
+    Current = Window();
+}
+
+static socket_t Connect(int port) {
+    socket_t sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET)
+        return INVALID_SOCKET;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((Uint16)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+int main(int argc, char* argv[]) {
+    int port = REMOTEDEBUG_DEFAULT_PORT;
+    int interval = 1000;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--port") && hasValue)
+            port = atoi(argv[++i]);
+        else if (!strcmp(arg, "--top") && hasValue)
+            TopCount = atoi(argv[++i]);
+        else if (!strcmp(arg, "--interval") && hasValue)
+            interval = atoi(argv[++i]);
+        else if (!strcmp(arg, "--help")) {
+            PrintUsage();
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Unknown option \"%s\"!\n", arg);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed!\n");
+        return 1;
+    }
+#endif
+
+    socket_t sock = Connect(port);
+    if (sock == INVALID_SOCKET) {
+        fprintf(stderr, "Could not connect to port %d! Is the game running with dev/remoteDebug on?\n", port);
+        return 1;
+    }
+
+    vector<Uint8> buffer;
+    bool greeted = false;
+    auto lastPrint = std::chrono::steady_clock::now();
+    while (true) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(sock, &readable);
+        timeval timeout = { 0, 100 * 1000 };
+        if (select((int)sock + 1, &readable, NULL, NULL, &timeout) > 0) {
+            char chunk[16384];
+            int got = (int)recv(sock, chunk, sizeof chunk, 0);
+            if (got <= 0) {
+                printf("The game closed the connection.\n");
+                break;
+            }
+            buffer.insert(buffer.end(), chunk, chunk + got);
+        }
+
+        size_t offset = 0;
+        while (buffer.size() - offset >= REMOTEDEBUG_HEADER_SIZE) {
+            Reader header = { buffer.data() + offset, REMOTEDEBUG_HEADER_SIZE };
+            Uint32 size = header.Read32();
+            Uint8 type = header.Read8();
+            if (buffer.size() - offset - REMOTEDEBUG_HEADER_SIZE < size)
+                break;
+
+            Reader in = { buffer.data() + offset + REMOTEDEBUG_HEADER_SIZE, size };
+            bool valid = true;
+            switch (type) {
+                case RemoteDebugPacket::HELLO:
+                    valid = in.Has(6) && !memcmp(in.Data, REMOTEDEBUG_MAGIC, 4);
+                    if (valid) {
+                        in.Position = 4;
+                        Uint16 version = in.Read16();
+                        if (version != REMOTEDEBUG_VERSION) {
+                            fprintf(stderr, "The game sends version %d, but this only reads version %d!\n", version, REMOTEDEBUG_VERSION);
+                            return 1;
+                        }
+                        greeted = true;
+                    }
+                    break;
+                case RemoteDebugPacket::NAMES:
+                    valid = greeted && ReadNames(in);
+                    break;
+                case RemoteDebugPacket::FRAME:
+                    valid = greeted && ReadFrame(in);
+                    break;
+            }
+            if (!valid) {
+                fprintf(stderr, "Got a malformed packet!\n");
+                return 1;
+            }
+            offset += REMOTEDEBUG_HEADER_SIZE + size;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPrint).count() >= interval) {
+            lastPrint = now;
+            PrintTables();
+        }
+    }
+
+    closesocket(sock);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}